@@ -313,6 +313,7 @@ void glBindBuffer(GLenum target, GLuint buffer) {
 	if (_vgl_enqueue_list_func(glBindBuffer, DLIST_FUNC_U32_U32, target, buffer))
 		return;
 #endif
+	CAPTURE_CALL(CAPTURE_BIND_BUFFER, target, buffer)
 	switch (target) {
 	case GL_ARRAY_BUFFER:
 		vertex_array_unit = buffer;
@@ -370,6 +371,9 @@ inline void glNamedBufferData(GLuint buffer, GLsizei size, const void *data, GLe
 		return;
 	}
 #endif
+	// The whole buffer content is replaced, so there's no need to describe it
+	CAPTURE_OBJECT(capture_object_is_new, CAPTURE_OBJ_BUFFER, buffer)
+	CAPTURE_CALL_WITH_DATA(CAPTURE_BUFFER_DATA, data, size, buffer, size, usage)
 #if defined(HAVE_SCRATCH_MEMORY) && !defined(DISABLE_CIRCULAR_POOL)
 	GLboolean was_scratch = gpu_buf->scratch;
 #endif
@@ -468,6 +472,8 @@ inline void glNamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size
 		return;
 	}
 #endif
+	CAPTURE_OBJECT(capture_buffer, buffer)
+	CAPTURE_CALL_WITH_DATA(CAPTURE_BUFFER_SUB_DATA, data, size, buffer, offset, size)
 
 #ifndef BUFFERS_SPEEDHACK
 	// Allocating a new buffer
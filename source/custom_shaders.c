@@ -26,7 +26,7 @@
 #include "shared.h"
 #include "utils/glsl_utils.h"
 #include "utils/shacccg_paramquery.h"
-#if defined(HAVE_SHADER_CACHE) || defined(HAVE_TEX_CACHE)
+// xxHash is always needed since compiled programs are shared by hash
 #define XXH_STATIC_LINKING_ONLY
 #define XXH_IMPLEMENTATION
 #define XXH_NAMESPACE VITAGL_
@@ -35,14 +35,17 @@
 #include "utils/xxhash_utils.h"
 #ifdef HAVE_SHADER_CACHE
 char vgl_shader_cache_path[256];
+shader_pack glsl_shader_pack = {.fd = -1};
+shader_pack glsl_translation_pack = {.fd = -1};
 #endif
 #ifdef HAVE_TEX_CACHE
 char vgl_file_cache_path[256];
 #endif
-#endif
 
 #define MAX_CUSTOM_SHADERS 2048 // Maximum number of linkable custom shaders
 #define MAX_CUSTOM_PROGRAMS 1024 // Maximum number of linkable custom programs
+#define MAX_SHADER_JOBS 256 // Maximum number of queued background shader compilation jobs
+#define SHADER_BINS_HASH_SIZE 256 // Number of buckets of the compiled programs hash tables (must be a power of two)
 
 #define set_default_attrib_binding() \
 	uint32_t cnt = sceGxmProgramGetParameterCount(p->vshader->prog); \
@@ -136,16 +139,34 @@ char vgl_file_cache_path[256];
 		disable_draw_attrib(i) \
 	}
 
+/*
+ * Default uniform buffers are copied to GPU memory only if their content changed since the last copy
+ * reserved for the program, otherwise the previous copy is bound again. Copies are retained only for
+ * the frame they got reserved on and until the uniform circular pool wraps around.
+ */
+#define upload_default_uniforms(stage, data, data_gen, copy, size) \
+	if ((copy).gen == data_gen && (copy).frame == vgl_framecount && (copy).cycle == vgl_unif_pool_cycle) { \
+		vglBind##stage##UniformBuffer((copy).ptr); \
+		vgl_unif_buffers_reuses++; \
+		vgl_unif_buffers_saved += size; \
+	} else { \
+		PROFILER_SCOPE(PROF_UNIFORMS_UPLOAD) \
+		(copy).ptr = vglReserve##stage##UniformBuffer(size); \
+		vgl_fast_memcpy((copy).ptr, data, size); \
+		(copy).gen = data_gen; \
+		(copy).frame = vgl_framecount; \
+		(copy).cycle = vgl_unif_pool_cycle; \
+		vgl_unif_buffers_uploads++; \
+	}
+
 #ifndef HAVE_FFP_SHADER_SUPPORT
 #define upload_uniforms() \
 	if (p->vert_uniforms && dirty_shader_vert_unifs) { \
-		void *buffer = vglReserveVertexUniformBuffer(p->vshader->unif_buf_size); \
-		vgl_fast_memcpy(buffer, p->unif_vbuffer, p->vshader->unif_buf_size); \
+		upload_default_uniforms(Vertex, p->unif_vbuffer, p->unif_vbuffer_gen, p->vbuffer_copy, p->vshader->unif_buf_size) \
 		dirty_shader_vert_unifs = GL_FALSE; \
 	} \
 	if (p->frag_uniforms && dirty_shader_frag_unifs) { \
-		void *buffer = vglReserveFragmentUniformBuffer(p->fshader->unif_buf_size); \
-		vgl_fast_memcpy(buffer, p->unif_fbuffer, p->fshader->unif_buf_size); \
+		upload_default_uniforms(Fragment, p->unif_fbuffer, p->unif_fbuffer_gen, p->fbuffer_copy, p->fshader->unif_buf_size) \
 		dirty_shader_frag_unifs = GL_FALSE; \
 	} \
 	if (p->vert_ubos) { \
@@ -168,35 +189,36 @@ char vgl_file_cache_path[256];
 #else
 #define upload_uniforms() \
 	if (p->vert_uniforms && (dirty_vert_unifs || dirty_shader_vert_unifs)) { \
-		void *buffer = vglReserveVertexUniformBuffer(p->vshader->unif_buf_size); \
 		if (dirty_vert_unifs) { \
 			dirty_vert_unifs = GL_FALSE; \
 			if (p->ffp_binds[FFP_MVP_MATRIX]) { \
 				if (mvp_modified) { \
-					matrix4x4_multiply(vgl_mvp_matrix, projection_matrix, modelview_matrix); \
+					recalculate_mvp_matrix(); \
 					recalculate_normal_matrix(); \
 					mvp_modified = GL_FALSE; \
 				} \
 				vglSetUniformData(p->ffp_binds[FFP_MVP_MATRIX]->vptr, SCE_GXM_PARAMETER_TYPE_F32, 0, 4, 4, (const float *)vgl_mvp_matrix, SCE_GXM_PARAMETER_TYPE_F32); \
+				p->unif_vbuffer_gen++; \
 			} \
 			if (p->ffp_binds[FFP_MV_MATRIX]) { \
 				vglSetUniformData(p->ffp_binds[FFP_MV_MATRIX]->vptr, SCE_GXM_PARAMETER_TYPE_F32, 0, 4, 4, (const float *)modelview_matrix, SCE_GXM_PARAMETER_TYPE_F32); \
+				p->unif_vbuffer_gen++; \
 			} \
 			if (p->ffp_binds[FFP_NORMAL_MATRIX]) { \
 				if (mvp_modified) { \
-					matrix4x4_multiply(vgl_mvp_matrix, projection_matrix, modelview_matrix); \
+					recalculate_mvp_matrix(); \
 					recalculate_normal_matrix(); \
 					mvp_modified = GL_FALSE; \
 				} \
 				vglSetUniformData(p->ffp_binds[FFP_NORMAL_MATRIX]->vptr, SCE_GXM_PARAMETER_TYPE_F32, 0, 3, 3, (const float *)normal_matrix, SCE_GXM_PARAMETER_TYPE_F32); \
+				p->unif_vbuffer_gen++; \
 			} \
 		} \
-		vgl_fast_memcpy(buffer, p->unif_vbuffer, p->vshader->unif_buf_size); \
+		upload_default_uniforms(Vertex, p->unif_vbuffer, p->unif_vbuffer_gen, p->vbuffer_copy, p->vshader->unif_buf_size) \
 		dirty_shader_vert_unifs = GL_FALSE; \
 	} \
 	if (p->frag_uniforms && dirty_shader_frag_unifs) { \
-		void *buffer = vglReserveFragmentUniformBuffer(p->fshader->unif_buf_size); \
-		vgl_fast_memcpy(buffer, p->unif_fbuffer, p->fshader->unif_buf_size); \
+		upload_default_uniforms(Fragment, p->unif_fbuffer, p->unif_fbuffer_gen, p->fbuffer_copy, p->fshader->unif_buf_size) \
 		dirty_shader_frag_unifs = GL_FALSE; \
 	} \
 	if (p->vert_ubos) { \
@@ -222,6 +244,7 @@ char vgl_file_cache_path[256];
 	if ((p->blend_info.raw != blend_info.raw) || (is_fbo_float != p->is_fbo_float)) { \
 		p->is_fbo_float = is_fbo_float; \
 		p->blend_info.raw = blend_info.raw; \
+		PROFILER_SCOPE(PROF_SHADER_RELOAD) \
 		rebuild_frag_shader(p->fshader->id, &p->fprog, (SceGxmProgram *)p->vshader->prog, is_fbo_float ? SCE_GXM_OUTPUT_REGISTER_FORMAT_HALF4 : SCE_GXM_OUTPUT_REGISTER_FORMAT_UCHAR4); \
 	} \
 	sceGxmSetFragmentProgram(gxm_context, p->fprog);
@@ -251,6 +274,8 @@ const char *ffp_bind_names[FFP_BINDS_NUM] = {
 
 // Internal stuffs
 GLboolean is_shark_online = GL_FALSE; // Current vitaShaRK status
+SceUID shark_sema = -1; // Semaphore guarding vitaShaRK usage during background compilation jobs
+static uint32_t shark_sema_refs = 0; // Number of background compilation users of vitaShaRK
 static SceGxmVertexAttribute temp_attributes[VERTEX_ATTRIBS_NUM];
 static SceGxmVertexStream temp_streams[VERTEX_ATTRIBS_NUM];
 static unsigned short orig_stride[VERTEX_ATTRIBS_NUM];
@@ -261,6 +286,9 @@ static uint32_t ubo_offset[UBOS_NUM];
 static uint8_t tex2d_override = 0;
 GLboolean dirty_shader_frag_unifs = GL_TRUE;
 GLboolean dirty_shader_vert_unifs = GL_TRUE;
+uint32_t vgl_unif_buffers_uploads = 0;
+uint32_t vgl_unif_buffers_reuses = 0;
+uint64_t vgl_unif_buffers_saved = 0;
 
 typedef struct {
 	GLuint idx;
@@ -304,12 +332,22 @@ typedef struct {
 	void *vptr;
 	uniform_type type;
 	uint8_t sampler_index;
+	uint16_t prog_idx; // Index of the program owning the uniform
 } uniform;
 
+// Last GPU copy of a program default uniform buffer
+typedef struct {
+	void *ptr;
+	uint32_t gen; // Generation of the uniform buffer content held by the copy
+	uint32_t frame; // Frame the copy got reserved on
+	uint32_t cycle; // Uniform circular pool cycle the copy got reserved on
+} unif_buffer_copy;
+
 // Program status enum
 typedef enum {
 	PROG_INVALID,
 	PROG_UNLINKED,
+	PROG_LINKING, // Linking is performed once its background compilation job completes
 	PROG_LINKED
 } prog_status;
 
@@ -322,6 +360,18 @@ typedef struct {
 	void *chain;
 } ubo;
 
+// Open addressing hash table mapping uniform and uniform block names to their internal structs
+typedef struct {
+	const char *name;
+	uint32_t hash;
+	void *ref;
+} name_entry;
+
+typedef struct {
+	name_entry *entries;
+	uint32_t mask;
+} names_table;
+
 #ifdef ENABLE_LEGACY_PIPELINE
 typedef enum {
 	VGL_ATTRIB_REGULAR,
@@ -362,6 +412,8 @@ typedef struct {
 	uint32_t frag_uniforms_num;
 	ubo *vert_ubos;
 	ubo *frag_ubos;
+	names_table unif_names; // Uniforms by name, vertex uniforms take priority over fragment ones
+	names_table block_names; // Uniform blocks by name
 	GLuint attr_highest_idx;
 	GLboolean has_unaligned_attrs;
 	GLboolean is_fbo_float;
@@ -369,11 +421,20 @@ typedef struct {
 	attr_mapping *glsl_attr_map;
 	void *unif_fbuffer;
 	void *unif_vbuffer;
+	uint32_t unif_fbuffer_gen; // Generation of the fragment default uniform buffer content
+	uint32_t unif_vbuffer_gen; // Generation of the vertex default uniform buffer content
+	unif_buffer_copy fbuffer_copy;
+	unif_buffer_copy vbuffer_copy;
+	uint32_t link_job; // Background compilation job the program linking depends on
+	GLboolean deferred_binds; // Attributes binding is performed on linking
+	GLint palette_unif; // Uniform receiving the model matrix of vglMultiDrawArraysMatrices draws
 } program;
 
 // Internal shaders and array
 static shader shaders[MAX_CUSTOM_SHADERS];
 static program progs[MAX_CUSTOM_PROGRAMS];
+static shader_bin *shader_bins_by_src[SHADER_BINS_HASH_SIZE]; // Compiled programs indexed by translated source hash
+static shader_bin *shader_bins_by_prog[SHADER_BINS_HASH_SIZE]; // Compiled programs indexed by program hash
 
 #ifdef HAVE_SHARK_LOG
 static char *shark_log = NULL;
@@ -391,22 +452,125 @@ static inline __attribute__((always_inline)) uniform *get_uniform_from_ptr(GLint
 #define get_uniform_from_ptr(ptr, offs) (-ptr)
 #endif
 
+static void sync_shader(shader *s);
+
+// Frees matrix uniforms and uniform blocks info of a compiled program
+static void free_shader_metadata(matrix_uniform *mat, block_uniform *unif_blk) {
+	while (mat) {
+		matrix_uniform *m = (matrix_uniform *)mat->chain;
+		vgl_free(mat);
+		mat = m;
+	}
+	while (unif_blk) {
+		block_uniform *b = (block_uniform *)unif_blk->chain;
+		vgl_free(unif_blk);
+		unif_blk = b;
+	}
+}
+
+// Makes a shader use a compiled program, must be called with the shader compiler locked
+static void attach_shader_bin(shader *s, shader_bin *b) {
+	b->ref_counter++;
+	s->bin = b;
+	s->prog = b->prog;
+	s->id = NULL;
+	s->size = b->size;
+	s->unif_buf_size = b->unif_buf_size;
+	s->mat = b->mat;
+	s->unif_blk = b->unif_blk;
+}
+
+// Drops a reference to a compiled program, must be called with the shader compiler locked
+static void release_shader_bin(shader_bin *b) {
+	if (--b->ref_counter)
+		return;
+
+	shader_bin **ptr = &shader_bins_by_prog[b->prog_hash & (SHADER_BINS_HASH_SIZE - 1)];
+	while (*ptr != b) {
+		ptr = &(*ptr)->prog_chain;
+	}
+	*ptr = b->prog_chain;
+	if (b->src_hash) {
+		ptr = &shader_bins_by_src[b->src_hash & (SHADER_BINS_HASH_SIZE - 1)];
+		while (*ptr != b) {
+			ptr = &(*ptr)->src_chain;
+		}
+		*ptr = b->src_chain;
+	}
+
+	// Deallocating program and unregistering it from sceGxmShaderPatcher
+	if (b->id)
+		sceGxmShaderPatcherForceUnregisterProgram(gxm_shader_patcher, b->id);
+	vgl_free((void *)b->prog);
+	free_shader_metadata(b->mat, b->unif_blk);
+	vgl_free(b);
+}
+
+// Looks for a program compiled from a given translated source, must be called with the shader compiler locked
+static shader_bin *get_shader_bin_by_src(uint64_t src_hash) {
+	shader_bin *b = shader_bins_by_src[src_hash & (SHADER_BINS_HASH_SIZE - 1)];
+	while (b) {
+		if (b->src_hash == src_hash)
+			return b;
+		b = b->src_chain;
+	}
+	return NULL;
+}
+
+// Shares the program just built for a shader with any identical one, must be called with the shader compiler locked
+static void share_shader_bin(shader *s, uint64_t src_hash) {
+	uint64_t prog_hash = XXH3_64bits(s->prog, s->size);
+	shader_bin *b = shader_bins_by_prog[prog_hash & (SHADER_BINS_HASH_SIZE - 1)];
+	while (b) {
+		if (b->prog_hash == prog_hash && b->size == s->size && !sceClibMemcmp(b->prog, s->prog, s->size))
+			break;
+		b = b->prog_chain;
+	}
+
+	if (b) {
+		// An identical program is already in use, dropping the one we just built
+		if (!b->unif_blk) {
+			b->unif_blk = s->unif_blk;
+			s->unif_blk = NULL;
+		}
+		vgl_free((void *)s->prog);
+		free_shader_metadata(s->mat, s->unif_blk);
+	} else {
+		b = (shader_bin *)vglMalloc(sizeof(shader_bin));
+		b->src_hash = 0;
+		b->prog_hash = prog_hash;
+		b->prog = s->prog;
+		b->id = NULL;
+		b->size = s->size;
+		b->unif_buf_size = s->unif_buf_size;
+		b->mat = s->mat;
+		b->unif_blk = s->unif_blk;
+		b->ref_counter = 0;
+		b->prog_chain = shader_bins_by_prog[prog_hash & (SHADER_BINS_HASH_SIZE - 1)];
+		shader_bins_by_prog[prog_hash & (SHADER_BINS_HASH_SIZE - 1)] = b;
+	}
+	if (src_hash && !b->src_hash) {
+		b->src_hash = src_hash;
+		b->src_chain = shader_bins_by_src[src_hash & (SHADER_BINS_HASH_SIZE - 1)];
+		shader_bins_by_src[src_hash & (SHADER_BINS_HASH_SIZE - 1)] = b;
+	}
+	attach_shader_bin(s, b);
+}
+
 void release_shader(shader *s) {
-	// Deallocating shader and unregistering it from sceGxmShaderPatcher
+	sync_shader(s);
+
+	// Deallocating shader and dropping its compiled program
 	if (s->valid) {
 		if (s->prog) {
-			sceGxmShaderPatcherForceUnregisterProgram(gxm_shader_patcher, s->id);
-			vgl_free((void *)s->prog);
-			while (s->mat) {
-				matrix_uniform *m = (matrix_uniform *)s->mat->chain;
-				vgl_free(s->mat);
-				s->mat = m;
-			}
-			while (s->unif_blk) {
-				block_uniform *b = (block_uniform *)s->unif_blk->chain;
-				vgl_free(s->unif_blk);
-				s->unif_blk = b;
-			}
+			lock_shader_compiler()
+			release_shader_bin(s->bin);
+			unlock_shader_compiler()
+			s->bin = NULL;
+			s->prog = NULL;
+			s->id = NULL;
+			s->mat = NULL;
+			s->unif_blk = NULL;
 #ifdef HAVE_SHARK_LOG
 			if (s->log) {
 				vgl_free(s->log);
@@ -579,7 +743,7 @@ void *serialize_shader(void *out, size_t *sz, shader *s, GLboolean save_bindings
 	return _out;
 }
 
-void unserialize_shader(void *in, size_t sz, shader *s, GLboolean load_bindings) {
+static void unserialize_shader_data(void *in, size_t sz, shader *s, GLboolean load_bindings) {
 	uint8_t *buf = (uint8_t *)in;
 	uint32_t matrix_uniforms_num;
 	vgl_fast_memcpy(&matrix_uniforms_num, buf, sizeof(uint32_t));
@@ -599,7 +763,6 @@ void unserialize_shader(void *in, size_t sz, shader *s, GLboolean load_bindings)
 	s->size = sz - ((uintptr_t)buf - (uintptr_t)in);
 	s->prog = (SceGxmProgram *)vglMalloc(s->size);
 	vgl_fast_memcpy((SceGxmProgram *)s->prog, buf, s->size);
-	sceGxmShaderPatcherRegisterProgram(gxm_shader_patcher, s->prog, &s->id);
 	s->unif_buf_size = sceGxmProgramGetDefaultUniformBufferSize(s->prog);
 	if (matrix_uniforms_num) {
 		uint32_t *_m = (uint32_t *)in + 1;
@@ -611,28 +774,85 @@ void unserialize_shader(void *in, size_t sz, shader *s, GLboolean load_bindings)
 			s->mat = m;
 		}
 	}
+	lock_shader_compiler()
+	share_shader_bin(s, 0);
+	unlock_shader_compiler()
+}
+
+// Registers a shader on sceGxmShaderPatcher, this must happen on the rendering thread
+static void register_shader(shader *s) {
+	if (s->prog && !s->id) {
+		// Identical shaders share a single registration
+		shader_bin *b = s->bin;
+		if (!b->id) {
+			int r = sceGxmShaderPatcherRegisterProgram(gxm_shader_patcher, b->prog, &b->id);
+#ifdef LOG_ERRORS
+			if (r) {
+				vgl_log("%s:%d %s: Program failed to register on sceGxm (%s).\n", __FILE__, __LINE__, __func__, get_gxm_error_literal(r));
+			}
+#endif
+		}
+		s->id = b->id;
+	}
 }
 
+void unserialize_shader(void *in, size_t sz, shader *s, GLboolean load_bindings) {
+	unserialize_shader_data(in, sz, s, load_bindings);
+	register_shader(s);
+}
+
+// Builds the seed used to hash translated sources, so that programs are only shared with matching compiler settings
+#define get_shader_bin_seed(type) (((uint64_t)(type) << 32) | ((uint64_t)compiler_opts << 3) | (compiler_fastmath ? 4 : 0) | (compiler_fastprecision ? 2 : 0) | (compiler_fastint ? 1 : 0))
+
 #ifdef HAVE_SHADER_CACHE
-#define vgl_compile_shader(shd, sv) compile_shader(shd, sv, fname)
-static inline __attribute__((always_inline)) void compile_shader(shader *s, GLboolean save_bindings, const char *cache_fname) {
+// Builds the key identifying a shader inside the packed filesystem cache
+#define get_glsl_shader_pack_key(key, type, src, size) \
+	key[0] = XXH3_64bits(src, size); \
+	key[1] = type; \
+	key[2] = 0;
+#define vgl_compile_shader(shd, sv) compile_shader(shd, sv, cache_key)
+static inline __attribute__((always_inline)) void compile_shader(shader *s, GLboolean save_bindings, const uint64_t *cache_key) {
 #else
 #define vgl_compile_shader(shd, sv) compile_shader(shd, sv)
 static inline __attribute__((always_inline)) void compile_shader(shader *s, GLboolean save_bindings) {
 #endif
 	// Compiling shader source
+	lock_shader_compiler()
+
+	// Reusing any program compiled from the same translated source with the same compiler settings
+	uint64_t src_hash = XXH3_64bits_withSeed(s->source, s->size, get_shader_bin_seed(s->type));
+	shader_bin *b = get_shader_bin_by_src(src_hash);
+	if (b) {
+		vgl_perf_counters.glsl_shader_cache_hits++;
+		vgl_free(s->source);
+		s->source = NULL;
+		attach_shader_bin(s, b);
+#ifdef HAVE_SHARK_LOG
+		if (s->log) {
+			vgl_free(s->log);
+			s->log = NULL;
+		}
+#endif
+		unlock_shader_compiler()
+#ifdef HAVE_SHADER_CACHE
+		size_t sz;
+		void *buf = serialize_shader(NULL, &sz, s, save_bindings);
+		shader_pack_write(&glsl_shader_pack, cache_key, buf, sz);
+		vgl_free(buf);
+#endif
+		return;
+	}
+
+	// Restarting vitaShaRK if we released it before
+	if (!is_shark_online)
+		start_shader_compiler();
+	vgl_perf_counters.glsl_shader_cache_misses++;
 	s->prog = shark_compile_shader_extended((const char *)s->source, &s->size, s->type == GL_FRAGMENT_SHADER ? SHARK_FRAGMENT_SHADER : SHARK_VERTEX_SHADER, compiler_opts, compiler_fastmath, compiler_fastprecision, compiler_fastint);
 	if (s->prog) {
 		vgl_free(s->source);
 		s->source = NULL;
 		SceGxmProgram *res = (SceGxmProgram *)vglMalloc(s->size);
 		vgl_fast_memcpy((void *)res, (void *)s->prog, s->size);
-		int r = sceGxmShaderPatcherRegisterProgram(gxm_shader_patcher, res, &s->id);
-#ifdef LOG_ERRORS
-		if (r) {
-			vgl_log("%s:%d %s: Program failed to register on sceGxm (%s).\n", __FILE__, __LINE__, __func__, get_gxm_error_literal(r));
-		}
-#endif
 		s->unif_buf_size = sceGxmProgramGetDefaultUniformBufferSize(res);
 		s->prog = res;
 		SceShaccCgCompileOutput *cout = (SceShaccCgCompileOutput *)shark_get_internal_compile_output();
@@ -652,6 +872,7 @@ static inline __attribute__((always_inline)) void compile_shader(shader *s, GLbo
 			}
 			param = sceShaccCgGetNextParameter(param);
 		}
+		share_shader_bin(s, src_hash);
 	}
 #ifdef HAVE_SHARK_LOG
 	if (s->log)
@@ -660,16 +881,330 @@ static inline __attribute__((always_inline)) void compile_shader(shader *s, GLbo
 	shark_log = NULL;
 #endif
 	shark_clear_output();
+	unlock_shader_compiler()
 #ifdef HAVE_SHADER_CACHE
-	SceUID f = sceIoOpen(cache_fname, SCE_O_CREAT | SCE_O_WRONLY | SCE_O_TRUNC, 0777);
 	size_t sz;
 	void *buf = serialize_shader(NULL, &sz, s, save_bindings);
-	sceIoWrite(f, buf, sz);
-	sceIoClose(f);
+	shader_pack_write(&glsl_shader_pack, cache_key, buf, sz);
 	vgl_free(buf);
 #endif
 }
 
+// Translates and compiles a shader, loading it from filesystem cache if available
+static void process_shader(shader *s) {
+#ifdef HAVE_SHADER_CACHE
+	uint64_t cache_key[SHADER_PACK_KEY_WORDS];
+	uint32_t sz;
+	get_glsl_shader_pack_key(cache_key, s->type, s->source, s->size);
+	void *buf = shader_pack_read(&glsl_shader_pack, cache_key, &sz);
+	if (buf) {
+		vgl_perf_counters.glsl_shader_cache_hits++;
+		vgl_free(s->source);
+		s->source = NULL;
+		unserialize_shader_data(buf, sz, s, GL_FALSE);
+		vgl_free(buf);
+		return;
+	}
+#endif
+
+	if (s->is_glsl) {
+		glsl_translator_process(s);
+	}
+	vgl_compile_shader(s, GL_FALSE);
+}
+
+// Translates and compiles the shaders of a program linked with VGL_MODE_POSTPONED, returns GL_TRUE if attributes binding must be performed on linking
+static GLboolean process_postponed_shaders(shader *vs, shader *fs) {
+	if (!vs->is_glsl && !fs->is_glsl)
+		return GL_FALSE;
+#ifdef HAVE_SHADER_CACHE
+	uint64_t frag_cache_key[SHADER_PACK_KEY_WORDS], vert_cache_key[SHADER_PACK_KEY_WORDS];
+	uint64_t *cache_key;
+	if (!vs->prog) {
+		uint32_t sz;
+		get_glsl_shader_pack_key(vert_cache_key, GL_VERTEX_SHADER, vs->source, vs->size);
+		void *buf = shader_pack_read(&glsl_shader_pack, vert_cache_key, &sz);
+		if (buf) {
+			vgl_perf_counters.glsl_shader_cache_hits++;
+			unserialize_shader_data(buf, sz, vs, GL_TRUE);
+			vgl_free(buf);
+		}
+	}
+	if (!fs->prog) {
+		uint32_t sz;
+		get_glsl_shader_pack_key(frag_cache_key, GL_FRAGMENT_SHADER, fs->source, fs->size);
+		void *buf = shader_pack_read(&glsl_shader_pack, frag_cache_key, &sz);
+		if (buf) {
+			vgl_perf_counters.glsl_shader_cache_hits++;
+			unserialize_shader_data(buf, sz, fs, GL_TRUE);
+			vgl_free(buf);
+		}
+	}
+#endif
+	if (!vs->prog || !fs->prog) {
+		if (vs->is_glsl || fs->is_glsl) {
+			glsl_translator_set_process(vs, fs);
+		}
+		if (!vs->prog) {
+#ifdef HAVE_SHADER_CACHE
+			cache_key = vert_cache_key;
+#endif
+			vgl_compile_shader(vs, GL_TRUE);
+		}
+		if (!fs->prog) {
+#ifdef HAVE_SHADER_CACHE
+			cache_key = frag_cache_key;
+#endif
+			vgl_compile_shader(fs, GL_TRUE);
+		}
+	}
+	return GL_TRUE;
+}
+
+void acquire_shader_compiler_sema(void) {
+	if (!shark_sema_refs++)
+		shark_sema = sceKernelCreateSema("vitaGL ShaRK Sema", 0, 1, 1, NULL);
+}
+
+void release_shader_compiler_sema(void) {
+	if (!--shark_sema_refs) {
+		sceKernelDeleteSema(shark_sema);
+		shark_sema = -1;
+	}
+}
+
+/*
+ * Background shaders compilation (GL_KHR_parallel_shader_compile)
+ * GLSL translation assigns semantic bindings in submission order and vitaShaRK
+ * is not reentrant, so jobs are processed in order by a single worker thread
+ * while the rendering thread keeps going until a shader or program is used.
+ */
+typedef struct {
+	shader *vs; // Shader to compile or vertex shader of the program to link
+	shader *fs; // Fragment shader of the program to link (NULL for shader compilation jobs)
+	program *p; // Program to link (NULL for shader compilation jobs)
+} shader_job;
+
+static shader_job shader_jobs[MAX_SHADER_JOBS];
+static uint32_t shader_jobs_queued = 0; // Number of queued background compilation jobs
+static volatile uint32_t shader_jobs_done = 0; // Number of completed background compilation jobs
+static SceUID shader_jobs_sema = -1; // Semaphore signaled for every queued background compilation job
+GLuint shader_compiler_threads = 0; // Number of threads requested with glMaxShaderCompilerThreadsKHR
+
+#define is_shader_job_pending(id) ((id) > shader_jobs_done)
+
+static int shader_compiler_thread(unsigned int args, void *arg) {
+	for (;;) {
+		sceKernelWaitSema(shader_jobs_sema, 1, NULL);
+		uint32_t id = shader_jobs_done + 1;
+		shader_job *j = &shader_jobs[id % MAX_SHADER_JOBS];
+		if (j->p) {
+			if (process_postponed_shaders(j->vs, j->fs))
+				j->p->deferred_binds = GL_TRUE;
+		} else if (j->vs)
+			process_shader(j->vs);
+
+		// Publishing job results before marking it as completed
+		__sync_synchronize();
+		shader_jobs_done = id;
+		if (!j->vs)
+			break;
+	}
+	return sceKernelExitDeleteThread(0);
+}
+
+static void wait_shader_job(uint32_t id) {
+	while (is_shader_job_pending(id)) {
+		sceKernelDelayThread(100);
+	}
+	__sync_synchronize();
+}
+
+static uint32_t queue_shader_job(shader *vs, shader *fs, program *p) {
+	// Waiting for a free slot if the queue is full
+	if (shader_jobs_queued - shader_jobs_done >= MAX_SHADER_JOBS)
+		wait_shader_job(shader_jobs_queued + 1 - MAX_SHADER_JOBS);
+	uint32_t id = ++shader_jobs_queued;
+	shader_job *j = &shader_jobs[id % MAX_SHADER_JOBS];
+	j->vs = vs;
+	j->fs = fs;
+	j->p = p;
+	sceKernelSignalSema(shader_jobs_sema, 1);
+	return id;
+}
+
+void finish_shader_jobs(void) {
+	wait_shader_job(shader_jobs_queued);
+}
+
+// Waits for the background compilation job processing a shader and completes its setup
+static void sync_shader(shader *s) {
+	if (s->compile_job) {
+		wait_shader_job(s->compile_job);
+		s->compile_job = 0;
+	}
+	register_shader(s);
+}
+
+static void link_program(GLuint progr);
+
+// Completes the linking of a program waiting for background compilation jobs
+#define sync_program(p, progr) \
+	if ((p)->status == PROG_LINKING) \
+		link_program(progr);
+
+#ifdef HAVE_FRAME_CAPTURE
+void capture_shader(GLuint shad) {
+	if (!shad || !capture_object_is_new(CAPTURE_OBJ_SHADER, shad))
+		return;
+	shader *s = &shaders[shad - 1];
+	sync_shader(s);
+
+	// Shaders are recreated with the type they got created with, compiled ones from their binary
+	GLenum type = s->is_glsl ? s->type : (s->type == GL_VERTEX_SHADER ? GL_CG_VERTEX_SHADER_EXT : GL_CG_FRAGMENT_SHADER_EXT);
+	if (s->prog) {
+		uint32_t matrix_uniforms_num;
+		size_t size = serialized_shader_size(s, GL_FALSE, &matrix_uniforms_num);
+		void *bin = capture_scratch(size);
+		if (bin) {
+			serialize_shader(bin, &size, s, GL_FALSE);
+			capture_write_state(CAPTURE_SHADER, CAPTURE_ARGS(shad, type, GL_TRUE), bin, size);
+			return;
+		}
+	}
+	capture_write_state(CAPTURE_SHADER, CAPTURE_ARGS(shad, type, GL_FALSE), s->source, s->source ? s->size : 0);
+}
+
+static uint32_t capture_program_entry_add(capture_program_entry *e, uint32_t kind, uint32_t value, const char *name) {
+	e->kind = kind;
+	e->value = value;
+	sceClibMemset(e->name, 0, sizeof(e->name));
+	strncpy(e->name, name, sizeof(e->name) - 1);
+	return 1;
+}
+
+void capture_program(GLuint prog) {
+	if (!prog || !capture_object_is_new(CAPTURE_OBJ_PROGRAM, prog))
+		return;
+	program *p = &progs[prog - 1];
+	sync_program(p, prog);
+	GLuint vs = p->vshader ? (p->vshader - shaders) + 1 : 0;
+	GLuint fs = p->fshader ? (p->fshader - shaders) + 1 : 0;
+	capture_shader(vs);
+	capture_shader(fs);
+
+	// Storing attributes and samplers bindings by name so that they can be restored on any build
+	GLboolean linked = p->status == PROG_LINKED;
+	uint32_t n = 0;
+	capture_program_entry *e = (capture_program_entry *)capture_scratch((VERTEX_ATTRIBS_NUM + p->vert_uniforms_num + p->frag_uniforms_num + 1) * sizeof(capture_program_entry));
+	if (!e)
+		return;
+	if (linked) {
+		uint32_t cnt = sceGxmProgramGetParameterCount(p->vshader->prog);
+		for (int i = 0; i < p->attr_highest_idx; i++) {
+			uint32_t *ptr = vglProgramGetParameterBase(p->vshader->prog);
+			for (int j = 0; j < cnt; j++) {
+				SceGxmProgramParameter *param = (SceGxmProgramParameter *)ptr;
+				if (sceGxmProgramParameterGetCategory(param) == SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE && sceGxmProgramParameterGetResourceIndex(param) == p->attr[i].regIndex) {
+					n += capture_program_entry_add(&e[n], CAPTURE_PROG_ATTRIB, i, sceGxmProgramParameterGetName(param));
+					break;
+				}
+				ptr += 4;
+			}
+		}
+		for (int i = 0; i < p->vert_uniforms_num; i++) {
+			if (p->vert_uniforms[i].type != UNIFORM_DATA)
+				n += capture_program_entry_add(&e[n], CAPTURE_PROG_SAMPLER, p->vert_uniforms[i].sampler_index, sceGxmProgramParameterGetName(p->vert_uniforms[i].ptr));
+		}
+		for (int i = 0; i < p->frag_uniforms_num; i++) {
+			if (p->frag_uniforms[i].type != UNIFORM_DATA)
+				n += capture_program_entry_add(&e[n], CAPTURE_PROG_SAMPLER, p->frag_uniforms[i].sampler_index, sceGxmProgramParameterGetName(p->frag_uniforms[i].ptr));
+		}
+		if (p->palette_unif) {
+			int offs = 0;
+			uniform *u = (uniform *)get_uniform_from_ptr(p->palette_unif, &offs);
+			n += capture_program_entry_add(&e[n], CAPTURE_PROG_PALETTE, 0, sceGxmProgramParameterGetName(u->ptr));
+		}
+	}
+	capture_write_state(CAPTURE_PROGRAM, CAPTURE_ARGS(prog, vs, fs, linked), e, n * sizeof(capture_program_entry));
+}
+
+void capture_program_state(uint32_t vertices_num) {
+	capture_program(cur_program);
+	capture_vertex_array *a = (capture_vertex_array *)capture_scratch(VERTEX_ATTRIBS_NUM * sizeof(capture_vertex_array));
+	if (!a)
+		return;
+	uint32_t n = 0;
+	for (int i = 0; i < VERTEX_ATTRIBS_NUM; i++) {
+		if (cur_vao->vertex_attrib_state & (1 << i)) {
+			// Per instance arrays content from client memory is not stored as the instances count is not known here
+			uint8_t divisor = (cur_vao->vertex_attrib_divisor >> i) & 1;
+			capture_fill_vertex_array(&a[n], i, &cur_vao->vertex_attrib_config[i], &cur_vao->vertex_stream_config[i], cur_vao->vertex_attrib_vbo[i], cur_vao->vertex_attrib_offsets[i], 0, divisor ? 0 : vertices_num);
+			a[n++].divisor = divisor;
+		}
+	}
+	capture_buffer(cur_vao->index_array_unit);
+	capture_update_state(CAPTURE_SLOT_VERTEX_ARRAYS, CAPTURE_VERTEX_ARRAYS, CAPTURE_ARGS(GL_FALSE, cur_vao->index_array_unit), a, n * sizeof(capture_vertex_array));
+}
+
+// Joins the strings passed to glShaderSource
+static const GLchar *capture_join_sources(GLuint handle, GLsizei count, const GLchar *const *string, const GLint *length, uint32_t *size) {
+	// The shader gets described first as it also makes use of the scratch buffer
+	capture_shader(handle);
+	*size = 0;
+	for (int i = 0; i < count; i++)
+		*size += (length && length[i] >= 0) ? length[i] : strlen(string[i]);
+	GLchar *src = (GLchar *)capture_scratch(*size);
+	if (!src)
+		return NULL;
+	GLchar *dst = src;
+	for (int i = 0; i < count; i++) {
+		size_t len = (length && length[i] >= 0) ? length[i] : strlen(string[i]);
+		vgl_fast_memcpy(dst, string[i], len);
+		dst += len;
+	}
+	return src;
+}
+#endif
+
+#ifdef HAVE_SHADER_CACHE
+// Parses the name of a shader cached with the loose files layout (eg. 1234ABCD.gxp)
+static GLboolean get_glsl_loose_shader_key(const char *name, uint64_t *key, GLenum type) {
+	char *end;
+	uint64_t hash = strtoull(name, &end, 16);
+	if (end == name || strcmp(end, ".gxp"))
+		return GL_FALSE;
+	key[0] = hash;
+	key[1] = type;
+	key[2] = 0;
+	return GL_TRUE;
+}
+
+static GLboolean get_glsl_loose_vert_shader_key(const char *name, uint64_t *key) {
+	return get_glsl_loose_shader_key(name, key, GL_VERTEX_SHADER);
+}
+
+static GLboolean get_glsl_loose_frag_shader_key(const char *name, uint64_t *key) {
+	return get_glsl_loose_shader_key(name, key, GL_FRAGMENT_SHADER);
+}
+
+void setup_glsl_shader_pack(void) {
+	char path[256];
+	sprintf(path, "%s/shaders.pack", vgl_shader_cache_path);
+	shader_pack_open(&glsl_shader_pack, path);
+
+	// Importing shaders cached with the loose files layout
+	if (!glsl_shader_pack.num) {
+		sprintf(path, "%s/v", vgl_shader_cache_path);
+		shader_pack_import(&glsl_shader_pack, path, get_glsl_loose_vert_shader_key);
+		sprintf(path, "%s/f", vgl_shader_cache_path);
+		shader_pack_import(&glsl_shader_pack, path, get_glsl_loose_frag_shader_key);
+	}
+	sprintf(path, "%s/translations.pack", vgl_shader_cache_path);
+	shader_pack_open(&glsl_translation_pack, path);
+}
+#endif
+
 void reset_custom_shaders(void) {
 	// Init custom shaders
 	for (int i = 0; i < MAX_CUSTOM_SHADERS; i++) {
@@ -686,7 +1221,56 @@ void reset_custom_shaders(void) {
 	}
 }
 
+// Uploads the vertex uniforms of a draw of vglMultiDrawArraysMatrices, matrices are written straight into the reserved buffer
+static void upload_palette_matrix(program *p, const GLfloat *m) {
+	PROFILER_SCOPE(PROF_UNIFORMS_UPLOAD)
+	if (!p->vert_uniforms)
+		return;
+
+	// Program default uniform buffer is left untouched so that values set by the application are preserved for later draws
+	uint8_t *buffer = (uint8_t *)vglReserveVertexUniformBuffer(p->vshader->unif_buf_size);
+	vgl_fast_memcpy(buffer, p->unif_vbuffer, p->vshader->unif_buf_size);
+	vgl_unif_buffers_uploads++;
+#define palette_unif_ptr(ptr) (buffer + ((uint8_t *)(ptr) - (uint8_t *)p->unif_vbuffer))
+
+	if (p->palette_unif) {
+		int offs = 0;
+		uniform *u = (uniform *)get_uniform_from_ptr(p->palette_unif, &offs);
+		if (u->vptr)
+			vglSetUniformData(palette_unif_ptr(u->vptr), sceGxmProgramParameterGetType(u->ptr), offs, 4, 4, m, SCE_GXM_PARAMETER_TYPE_F32);
+	}
+#ifdef HAVE_FFP_SHADER_SUPPORT
+	if (p->ffp_binds[FFP_MVP_MATRIX] || p->ffp_binds[FFP_MV_MATRIX] || p->ffp_binds[FFP_NORMAL_MATRIX]) {
+		matrix4x4 model, mv;
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				model[i][j] = m[j * 4 + i];
+			}
+		}
+		uint8_t model_kind = matrix4x4_get_kind(model);
+		uint8_t kind = matrix_kind_combine(modelview_kind, model_kind);
+		matrix4x4_multiply_kind(mv, modelview_matrix, modelview_kind, model, model_kind);
+		if (p->ffp_binds[FFP_MVP_MATRIX]) {
+			matrix4x4 mvp;
+			matrix4x4_multiply_kind(mvp, projection_matrix, projection_kind, mv, kind);
+			vglSetUniformData(palette_unif_ptr(p->ffp_binds[FFP_MVP_MATRIX]->vptr), SCE_GXM_PARAMETER_TYPE_F32, 0, 4, 4, (const float *)mvp, SCE_GXM_PARAMETER_TYPE_F32);
+		}
+		if (p->ffp_binds[FFP_MV_MATRIX]) {
+			vglSetUniformData(palette_unif_ptr(p->ffp_binds[FFP_MV_MATRIX]->vptr), SCE_GXM_PARAMETER_TYPE_F32, 0, 4, 4, (const float *)mv, SCE_GXM_PARAMETER_TYPE_F32);
+		}
+		if (p->ffp_binds[FFP_NORMAL_MATRIX]) {
+			matrix3x3 normal;
+			matrix4x4_normal_matrix_kind(normal, mv, kind);
+			vglSetUniformData(palette_unif_ptr(p->ffp_binds[FFP_NORMAL_MATRIX]->vptr), SCE_GXM_PARAMETER_TYPE_F32, 0, 3, 3, (const float *)normal, SCE_GXM_PARAMETER_TYPE_F32);
+		}
+	}
+#endif
+#undef palette_unif_ptr
+}
+
 void _glMultiDrawArrays_CustomShadersIMPL(SceGxmPrimitiveType gxm_p, uint16_t *idx_ptr, const GLint *first, const GLsizei *count, GLint lowest, GLsizei highest, GLsizei drawcount) {
+	PROFILER_SCOPE(PROF_SHADERS_DRAW)
+	vgl_perf_counters.shaders_draws++;
 #ifdef HAVE_PROFILING
 	uint32_t draw_start = sceKernelGetProcessTimeLow();
 #endif
@@ -735,9 +1319,13 @@ void _glMultiDrawArrays_CustomShadersIMPL(SceGxmPrimitiveType gxm_p, uint16_t *i
 			if (info) {
 				uint32_t sizes[2];
 				vglGetTexSizes(&tex->gxm_tex, &sizes[0], &sizes[1]);
-				float fsizes[2] = {sizes[0], sizes[1]};
-				vglSetUniformData(p->frag_texunits[i]->fptr, SCE_GXM_PARAMETER_TYPE_F32, 0, 1, 2, fsizes, SCE_GXM_PARAMETER_TYPE_F32);
-				dirty_shader_frag_unifs = GL_TRUE;
+				float *fsizes = (float *)p->frag_texunits[i]->fptr;
+				if (fsizes[0] != sizes[0] || fsizes[1] != sizes[1]) {
+					fsizes[0] = sizes[0];
+					fsizes[1] = sizes[1];
+					p->unif_fbuffer_gen++;
+					dirty_shader_frag_unifs = GL_TRUE;
+				}
 			}
 #endif
 #ifndef SAMPLERS_SPEEDHACK
@@ -871,13 +1459,21 @@ void _glMultiDrawArrays_CustomShadersIMPL(SceGxmPrimitiveType gxm_p, uint16_t *i
 #endif
 
 	// Uploading new vertex program
-	patch_vertex_program(gxm_shader_patcher, p->vshader->id, attributes, p->attr_num, streams, p->attr_num, &p->vprog);
+	{
+		PROFILER_SCOPE(PROF_SHADER_RELOAD)
+		patch_vertex_program(gxm_shader_patcher, p->vshader->id, attributes, p->attr_num, streams, p->attr_num, &p->vprog);
+	}
 	sceGxmSetVertexProgram(gxm_context, p->vprog);
 
 	// Uploading both fragment and vertex uniforms data
 	upload_uniforms();
 	
 	for (int j = 0; j < drawcount; j++) {
+		// Uploading model matrix for this draw
+		if (matrix_palette) {
+			upload_palette_matrix(p, &matrix_palette[j * 16]);
+		}
+
 		// Uploading vertex streams
 		for (int i = 0; i < p->attr_num; i++) {
 			uint8_t attr_idx = p->attr_map[i];
@@ -899,6 +1495,12 @@ void _glMultiDrawArrays_CustomShadersIMPL(SceGxmPrimitiveType gxm_p, uint16_t *i
 		
 		sceGxmDraw(gxm_context, gxm_p, SCE_GXM_INDEX_FORMAT_U16, idx_ptr, count[j]);
 	}
+
+	// Bound vertex uniforms buffer holds the last draw matrices, so the program one needs to be bound again on next draw
+	if (matrix_palette) {
+		dirty_shader_vert_unifs = GL_TRUE;
+		flag_dirty_vert_unif(WVP_MATRIX_UNIF)
+	}
 #ifdef HAVE_PROFILING
 	shaders_draw_profiler_cnt += sceKernelGetProcessTimeLow() - draw_start;
 	shaders_draw_cnt++;
@@ -906,6 +1508,8 @@ void _glMultiDrawArrays_CustomShadersIMPL(SceGxmPrimitiveType gxm_p, uint16_t *i
 }
 
 GLboolean _glDrawArrays_CustomShadersIMPL(GLint first, GLsizei count, GLboolean instanced) {
+	PROFILER_SCOPE(PROF_SHADERS_DRAW)
+	vgl_perf_counters.shaders_draws++;
 #ifdef HAVE_PROFILING
 	uint32_t draw_start = sceKernelGetProcessTimeLow();
 #endif
@@ -954,9 +1558,13 @@ GLboolean _glDrawArrays_CustomShadersIMPL(GLint first, GLsizei count, GLboolean
 			if (info) {
 				uint32_t sizes[2];
 				vglGetTexSizes(&tex->gxm_tex, &sizes[0], &sizes[1]);
-				float fsizes[2] = {sizes[0], sizes[1]};
-				vglSetUniformData(p->frag_texunits[i]->fptr, SCE_GXM_PARAMETER_TYPE_F32, 0, 1, 2, fsizes, SCE_GXM_PARAMETER_TYPE_F32);
-				dirty_shader_frag_unifs = GL_TRUE;
+				float *fsizes = (float *)p->frag_texunits[i]->fptr;
+				if (fsizes[0] != sizes[0] || fsizes[1] != sizes[1]) {
+					fsizes[0] = sizes[0];
+					fsizes[1] = sizes[1];
+					p->unif_fbuffer_gen++;
+					dirty_shader_frag_unifs = GL_TRUE;
+				}
 			}
 #endif
 #ifndef SAMPLERS_SPEEDHACK
@@ -1049,8 +1657,292 @@ GLboolean _glDrawArrays_CustomShadersIMPL(GLint first, GLsizei count, GLboolean
 		} else
 #endif
 		{
-			ptrs[0] = gpu_alloc_mapped_temp(count * streams[0].stride);
-			vgl_fast_memcpy(ptrs[0], (void *)cur_vao->vertex_attrib_offsets[p->attr_map[0]] + first * streams[0].stride, count * streams[0].stride);
+			ptrs[0] = gpu_alloc_mapped_temp(count * streams[0].stride);
+			vgl_fast_memcpy(ptrs[0], (void *)cur_vao->vertex_attrib_offsets[p->attr_map[0]] + first * streams[0].stride, count * streams[0].stride);
+		}
+	}
+	for (int i = 0; i < p->attr_num; i++) {
+		uint8_t attr_idx = p->attr_map[i];
+		attributes[i].regIndex = p->attr[attr_idx].regIndex;
+		if (is_packed[i]) {
+			handle_packed_attrib();
+		} else {
+			handle_unpacked_attrib(first, count);
+		}
+	}
+#else
+	// Gathering real attribute data pointers
+	if (is_packed) {
+		if (target_vbo) {
+			ptrs[0] = (void *)target_vbo->ptr + first * streams[0].stride;
+			target_vbo->last_frame = vgl_framecount;
+			for (int i = 0; i < p->attr_num; i++) {
+				uint8_t attr_idx = p->attr_map[i];
+				attributes[i].regIndex = p->attr[attr_idx].regIndex;
+				handle_packed_vbo_attrib();
+			}
+		} else {
+#ifdef SAFER_DRAW_SPEEDHACK
+			if (count * streams[0].stride > SAFE_DRAW_SIZE_THRESHOLD) {
+				ptrs[0] = (void *)cur_vao->vertex_attrib_offsets[p->attr_map[0]] + first * streams[0].stride;
+			} else
+#endif
+			{
+				ptrs[0] = gpu_alloc_mapped_temp(count * streams[0].stride);
+				vgl_fast_memcpy(ptrs[0], (void *)cur_vao->vertex_attrib_offsets[p->attr_map[0]] + first * streams[0].stride, count * streams[0].stride);
+			}
+			for (int i = 0; i < p->attr_num; i++) {
+				uint8_t attr_idx = p->attr_map[i];
+				attributes[i].regIndex = p->attr[attr_idx].regIndex;
+				handle_packed_attrib();
+			}
+		}
+	} else {
+		for (int i = 0; i < p->attr_num; i++) {
+			uint8_t attr_idx = p->attr_map[i];
+			attributes[i].regIndex = p->attr[attr_idx].regIndex;
+			handle_unpacked_attrib(first, count);
+		}
+	}
+#endif
+#else // DRAW_SPEEDHACK
+	handle_speedhack_attrib();
+#endif
+
+#ifndef INDICES_SPEEDHACK
+	if (instanced) { // Instanced draw
+		for (int i = 0; i < p->attr_num; i++) {
+			uint8_t attr_idx = p->attr_map[i];
+			streams[i].indexSource = (cur_vao->vertex_attrib_divisor & (1 << attr_idx)) ? SCE_GXM_INDEX_SOURCE_INSTANCE_16BIT : SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
+		}		
+	} else {
+		for (int i = 0; i < p->attr_num; i++) {
+			streams[i].indexSource = SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
+		}
+	}
+#endif
+
+	// Uploading new vertex program
+	{
+		PROFILER_SCOPE(PROF_SHADER_RELOAD)
+		patch_vertex_program(gxm_shader_patcher, p->vshader->id, attributes, p->attr_num, streams, p->attr_num, &p->vprog);
+	}
+	sceGxmSetVertexProgram(gxm_context, p->vprog);
+
+	// Uploading both fragment and vertex uniforms data
+	upload_uniforms();
+
+	// Uploading vertex streams
+	for (int i = 0; i < p->attr_num; i++) {
+		uint8_t attr_idx = p->attr_map[i];
+		GLboolean is_active = (cur_vao->vertex_attrib_state & (1 << attr_idx)) ? GL_TRUE : GL_FALSE;
+		if (is_active) {
+#ifdef DRAW_SPEEDHACK
+			sceGxmSetVertexStream(gxm_context, i, ptrs[i]);
+#else
+#ifdef STRICT_DRAW_COMPLIANCE
+			sceGxmSetVertexStream(gxm_context, i, is_packed[i] ? ptrs[0] : ptrs[i]);
+#else
+			sceGxmSetVertexStream(gxm_context, i, is_packed ? ptrs[0] : ptrs[i]);
+#endif
+#endif
+		} else {
+			sceGxmSetVertexStream(gxm_context, i, cur_vao->vertex_attrib_value[attr_idx]);
+		}
+		if (!p->has_unaligned_attrs) {
+			attributes[i].regIndex = i;
+			if (!is_active) {
+				streams[i].stride = orig_stride[i];
+				attributes[i].componentCount = orig_size[i];
+				attributes[i].format = orig_fmt[i];
+			}
+		}
+	}
+#ifdef HAVE_PROFILING
+	shaders_draw_profiler_cnt += sceKernelGetProcessTimeLow() - draw_start;
+	shaders_draw_cnt++;
+#endif
+	return GL_TRUE;
+}
+
+GLboolean _glDrawElements_CustomShadersIMPL(uint16_t *idx_buf, GLsizei count, uint32_t top_idx, uint32_t base_idx, SceGxmIndexSource index_type) {
+	PROFILER_SCOPE(PROF_SHADERS_DRAW)
+	vgl_perf_counters.shaders_draws++;
+#ifdef HAVE_PROFILING
+	uint32_t draw_start = sceKernelGetProcessTimeLow();
+#endif
+	program *p = &progs[cur_program - 1];
+
+	// Check if a blend info rebuild is required and upload fragment program
+	setup_frag_program();
+
+	// Uploading fragment textures on relative texture units
+	for (int i = 0; i < p->max_frag_texunit_idx; i++) {
+#ifndef SAMPLERS_SPEEDHACK
+		if (p->frag_texunits[i]) {
+#endif
+			texture_unit *tex_unit = &texture_units[(int)p->frag_texunits[i]->sampler_index];
+			uint8_t tex_type = p->frag_texunits[i]->type == UNIFORM_CUBE_SAMPLER ? 2 : tex2d_override;
+			texture *tex = &texture_slots[tex_unit->tex_id[tex_type]];
+#ifdef HAVE_TEX_CACHE
+			restore_tex_cache(tex);
+#endif
+#ifndef TEXTURES_SPEEDHACK
+			tex->last_frame = vgl_framecount;
+#endif
+			sampler *smp = samplers[(int)p->frag_texunits[i]->sampler_index];
+			if (smp) {
+				vglSetTexMinFilter(&tex->gxm_tex, smp->min_filter);
+				vglSetTexMipFilter(&tex->gxm_tex, smp->mip_filter);
+				vglSetTexMagFilter(&tex->gxm_tex, smp->mag_filter);
+				vglSetTexUMode(&tex->gxm_tex, smp->u_mode);
+				vglSetTexVMode(&tex->gxm_tex, smp->v_mode);
+				vglSetTexMipmapCount(&tex->gxm_tex, smp->use_mips ? tex->mip_count : 0);
+				vglSetTexLodBias(&tex->gxm_tex, smp->lod_bias);
+				tex->overridden = GL_TRUE;
+			} else if (tex->overridden) {
+				vglSetTexMinFilter(&tex->gxm_tex, tex->min_filter);
+				vglSetTexMipFilter(&tex->gxm_tex, tex->mip_filter);
+				vglSetTexMagFilter(&tex->gxm_tex, tex->mag_filter);
+				vglSetTexUMode(&tex->gxm_tex, tex->u_mode);
+				vglSetTexVMode(&tex->gxm_tex, tex->v_mode);
+				vglSetTexMipmapCount(&tex->gxm_tex, tex->use_mips ? tex->mip_count : 0);
+				vglSetTexLodBias(&tex->gxm_tex, tex->lod_bias);
+				tex->overridden = GL_FALSE;
+			}
+			sceGxmSetFragmentTexture(gxm_context, i, &tex->gxm_tex);
+#ifdef HAVE_GLSL_TEXTURE_SIZE
+			glsl_samplers_info *info = p->frag_texunits[i]->sampler;
+			if (info) {
+				uint32_t sizes[2];
+				vglGetTexSizes(&tex->gxm_tex, &sizes[0], &sizes[1]);
+				float *fsizes = (float *)p->frag_texunits[i]->fptr;
+				if (fsizes[0] != sizes[0] || fsizes[1] != sizes[1]) {
+					fsizes[0] = sizes[0];
+					fsizes[1] = sizes[1];
+					p->unif_fbuffer_gen++;
+					dirty_shader_frag_unifs = GL_TRUE;
+				}
+			}
+#endif
+#ifndef SAMPLERS_SPEEDHACK
+		}
+#endif
+	}
+
+	// Uploading vertex textures on relative texture units
+	for (int i = 0; i < p->max_vert_texunit_idx; i++) {
+#ifndef SAMPLERS_SPEEDHACK
+		if (p->vert_texunits[i]) {
+#endif
+			texture_unit *tex_unit = &texture_units[(int)p->vert_texunits[i]->sampler_index];
+			uint8_t tex_type = p->vert_texunits[i]->type == UNIFORM_CUBE_SAMPLER ? 2 : tex2d_override;
+			texture *tex = &texture_slots[tex_unit->tex_id[tex_type]];
+#ifndef TEXTURES_SPEEDHACK
+			tex->last_frame = vgl_framecount;
+#endif
+			sampler *smp = samplers[(int)p->vert_texunits[i]->sampler_index];
+			if (smp) {
+				vglSetTexMinFilter(&tex->gxm_tex, smp->min_filter);
+				vglSetTexMipFilter(&tex->gxm_tex, smp->mip_filter);
+				vglSetTexMagFilter(&tex->gxm_tex, smp->mag_filter);
+				vglSetTexUMode(&tex->gxm_tex, smp->u_mode);
+				vglSetTexVMode(&tex->gxm_tex, smp->v_mode);
+				vglSetTexMipmapCount(&tex->gxm_tex, smp->use_mips ? tex->mip_count : 0);
+				tex->overridden = GL_TRUE;
+			} else if (tex->overridden) {
+				vglSetTexMinFilter(&tex->gxm_tex, tex->min_filter);
+				vglSetTexMipFilter(&tex->gxm_tex, tex->mip_filter);
+				vglSetTexMagFilter(&tex->gxm_tex, tex->mag_filter);
+				vglSetTexUMode(&tex->gxm_tex, tex->u_mode);
+				vglSetTexVMode(&tex->gxm_tex, tex->v_mode);
+				vglSetTexMipmapCount(&tex->gxm_tex, tex->use_mips ? tex->mip_count : 0);
+				tex->overridden = GL_FALSE;
+			}
+			sceGxmSetVertexTexture(gxm_context, i, &tex->gxm_tex);
+#ifndef SAMPLERS_SPEEDHACK
+		}
+#endif
+	}
+
+	// Aligning attributes
+	SceGxmVertexAttribute *attributes;
+	SceGxmVertexStream *streams;
+	align_attributes(attributes, streams);
+
+	void *ptrs[VERTEX_ATTRIBS_NUM];
+#ifndef DRAW_SPEEDHACK
+	vbo *target_vbo = (vbo *)cur_vao->vertex_attrib_vbo[p->attr_map[0]];
+	GLboolean is_full_vbo = GL_TRUE;
+#ifdef STRICT_DRAW_COMPLIANCE
+	GLboolean is_packed[VERTEX_ATTRIBS_NUM];
+	vgl_memset(is_packed, GL_TRUE, p->attr_num * sizeof(GLboolean));
+#else
+	GLboolean is_packed = p->attr_num > 1;
+	if (is_packed) {
+#endif
+		for (int i = 0; i < p->attr_num; i++) {
+			uint8_t attr_idx = p->attr_map[i];
+			vbo *attr_vbo = (vbo *)cur_vao->vertex_attrib_vbo[attr_idx];
+			if (attr_vbo) {
+#ifdef STRICT_DRAW_COMPLIANCE
+					vgl_memset(is_packed, 0, p->attr_num * sizeof(GLboolean));
+					break;
+#else
+				if (attr_vbo != target_vbo) {
+					is_packed = GL_FALSE;
+					break;
+				}
+#endif
+			} else {
+#ifdef STRICT_DRAW_COMPLIANCE
+				if (!(cur_vao->vertex_attrib_offsets[p->attr_map[0]] + streams[0].stride > cur_vao->vertex_attrib_offsets[attr_idx] && cur_vao->vertex_attrib_offsets[attr_idx] >= cur_vao->vertex_attrib_offsets[p->attr_map[0]])) {
+					is_packed[attr_idx] = GL_FALSE;
+				}
+#endif
+				is_full_vbo = GL_FALSE;
+			}
+		}
+#ifndef STRICT_DRAW_COMPLIANCE
+		if (is_packed && (!(cur_vao->vertex_attrib_offsets[p->attr_map[0]] + streams[0].stride > cur_vao->vertex_attrib_offsets[p->attr_map[1]] && cur_vao->vertex_attrib_offsets[p->attr_map[1]] > cur_vao->vertex_attrib_offsets[p->attr_map[0]])))
+			is_packed = GL_FALSE;
+	} else if (!target_vbo)
+		is_full_vbo = GL_FALSE;
+#endif
+
+	// Detecting highest index value
+	if (!is_full_vbo && !top_idx) {
+		if ((index_type & 1) == 0)
+		{
+			for (int i = 0; i < count; i++) {
+				if (idx_buf[i] > top_idx) {
+					top_idx = idx_buf[i];
+				}
+			}
+		}
+		else
+		{
+			uint32_t *_idx_buf = (uint32_t *)idx_buf;
+			for (int i = 0; i < count; i++) {
+				if (_idx_buf[i] > top_idx) {
+					top_idx = _idx_buf[i];
+				}
+			}
+		}
+		top_idx += base_idx + 1;
+	}
+
+#ifdef STRICT_DRAW_COMPLIANCE
+	// Gathering real attribute data pointers
+	if (is_packed[0]) {
+#ifdef SAFER_DRAW_SPEEDHACK
+		if (top_idx * streams[0].stride > SAFE_DRAW_SIZE_THRESHOLD) {
+			ptrs[0] = (void *)cur_vao->vertex_attrib_offsets[p->attr_map[0]];
+		} else
+#endif
+		{
+			ptrs[0] = gpu_alloc_mapped_temp(top_idx * streams[0].stride);
+			vgl_fast_memcpy(ptrs[0], (void *)cur_vao->vertex_attrib_offsets[p->attr_map[0]], top_idx * streams[0].stride);
 		}
 	}
 	for (int i = 0; i < p->attr_num; i++) {
@@ -1059,14 +1951,14 @@ GLboolean _glDrawArrays_CustomShadersIMPL(GLint first, GLsizei count, GLboolean
 		if (is_packed[i]) {
 			handle_packed_attrib();
 		} else {
-			handle_unpacked_attrib(first, count);
+			handle_unpacked_attrib(0, top_idx);
 		}
 	}
 #else
 	// Gathering real attribute data pointers
 	if (is_packed) {
 		if (target_vbo) {
-			ptrs[0] = (void *)target_vbo->ptr + first * streams[0].stride;
+			ptrs[0] = (void *)target_vbo->ptr;
 			target_vbo->last_frame = vgl_framecount;
 			for (int i = 0; i < p->attr_num; i++) {
 				uint8_t attr_idx = p->attr_map[i];
@@ -1075,25 +1967,25 @@ GLboolean _glDrawArrays_CustomShadersIMPL(GLint first, GLsizei count, GLboolean
 			}
 		} else {
 #ifdef SAFER_DRAW_SPEEDHACK
-			if (count * streams[0].stride > SAFE_DRAW_SIZE_THRESHOLD) {
-				ptrs[0] = (void *)cur_vao->vertex_attrib_offsets[p->attr_map[0]] + first * streams[0].stride;
+			if (top_idx * streams[0].stride > SAFE_DRAW_SIZE_THRESHOLD) {
+				ptrs[0] = (void *)cur_vao->vertex_attrib_offsets[p->attr_map[0]];
 			} else
 #endif
 			{
-				ptrs[0] = gpu_alloc_mapped_temp(count * streams[0].stride);
-				vgl_fast_memcpy(ptrs[0], (void *)cur_vao->vertex_attrib_offsets[p->attr_map[0]] + first * streams[0].stride, count * streams[0].stride);
+				ptrs[0] = gpu_alloc_mapped_temp(top_idx * streams[0].stride);
+				vgl_fast_memcpy(ptrs[0], (void *)cur_vao->vertex_attrib_offsets[p->attr_map[0]], top_idx * streams[0].stride);
 			}
 			for (int i = 0; i < p->attr_num; i++) {
 				uint8_t attr_idx = p->attr_map[i];
 				attributes[i].regIndex = p->attr[attr_idx].regIndex;
 				handle_packed_attrib();
 			}
-		}
+		}	
 	} else {
 		for (int i = 0; i < p->attr_num; i++) {
 			uint8_t attr_idx = p->attr_map[i];
 			attributes[i].regIndex = p->attr[attr_idx].regIndex;
-			handle_unpacked_attrib(first, count);
+			handle_unpacked_attrib(0, top_idx);
 		}
 	}
 #endif
@@ -1102,20 +1994,28 @@ GLboolean _glDrawArrays_CustomShadersIMPL(GLint first, GLsizei count, GLboolean
 #endif
 
 #ifndef INDICES_SPEEDHACK
-	if (instanced) { // Instanced draw
+	// Check if highest index is small enough for 16 bit usage and if so, downgrade to 16 bit vertex sources for faster emitted code
+	if (top_idx && top_idx < 0xFFFF) {
+		index_type &= ~1;
+	}
+
+	if (index_type & 2) { // Instanced draw
 		for (int i = 0; i < p->attr_num; i++) {
 			uint8_t attr_idx = p->attr_map[i];
-			streams[i].indexSource = (cur_vao->vertex_attrib_divisor & (1 << attr_idx)) ? SCE_GXM_INDEX_SOURCE_INSTANCE_16BIT : SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
+			streams[i].indexSource = (cur_vao->vertex_attrib_divisor & (1 << attr_idx)) ? index_type : (index_type & 1);
 		}		
 	} else {
 		for (int i = 0; i < p->attr_num; i++) {
-			streams[i].indexSource = SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
+			streams[i].indexSource = index_type;
 		}
 	}
 #endif
 
 	// Uploading new vertex program
-	patch_vertex_program(gxm_shader_patcher, p->vshader->id, attributes, p->attr_num, streams, p->attr_num, &p->vprog);
+	{
+		PROFILER_SCOPE(PROF_SHADER_RELOAD)
+		patch_vertex_program(gxm_shader_patcher, p->vshader->id, attributes, p->attr_num, streams, p->attr_num, &p->vprog);
+	}
 	sceGxmSetVertexProgram(gxm_context, p->vprog);
 
 	// Uploading both fragment and vertex uniforms data
@@ -1154,7 +2054,9 @@ GLboolean _glDrawArrays_CustomShadersIMPL(GLint first, GLsizei count, GLboolean
 	return GL_TRUE;
 }
 
-GLboolean _glDrawElements_CustomShadersIMPL(uint16_t *idx_buf, GLsizei count, uint32_t top_idx, uint32_t base_idx, SceGxmIndexSource index_type) {
+void _glMultiDrawElements_CustomShadersIMPL(SceGxmPrimitiveType gxm_p, SceGxmIndexFormat idx_fmt, uint16_t **idx_bufs, const GLsizei *count, const GLint *base_vertex, uint32_t top_idx, SceGxmIndexSource index_type, GLsizei drawcount) {
+	PROFILER_SCOPE(PROF_SHADERS_DRAW)
+	vgl_perf_counters.shaders_draws++;
 #ifdef HAVE_PROFILING
 	uint32_t draw_start = sceKernelGetProcessTimeLow();
 #endif
@@ -1203,9 +2105,13 @@ GLboolean _glDrawElements_CustomShadersIMPL(uint16_t *idx_buf, GLsizei count, ui
 			if (info) {
 				uint32_t sizes[2];
 				vglGetTexSizes(&tex->gxm_tex, &sizes[0], &sizes[1]);
-				float fsizes[2] = {sizes[0], sizes[1]};
-				vglSetUniformData(p->frag_texunits[i]->fptr, SCE_GXM_PARAMETER_TYPE_F32, 0, 1, 2, fsizes, SCE_GXM_PARAMETER_TYPE_F32);
-				dirty_shader_frag_unifs = GL_TRUE;
+				float *fsizes = (float *)p->frag_texunits[i]->fptr;
+				if (fsizes[0] != sizes[0] || fsizes[1] != sizes[1]) {
+					fsizes[0] = sizes[0];
+					fsizes[1] = sizes[1];
+					p->unif_fbuffer_gen++;
+					dirty_shader_frag_unifs = GL_TRUE;
+				}
 			}
 #endif
 #ifndef SAMPLERS_SPEEDHACK
@@ -1293,26 +2199,29 @@ GLboolean _glDrawElements_CustomShadersIMPL(uint16_t *idx_buf, GLsizei count, ui
 		is_full_vbo = GL_FALSE;
 #endif
 
-	// Detecting highest index value
+	// Detecting highest index value among all the draws
 	if (!is_full_vbo && !top_idx) {
-		if ((index_type & 1) == 0)
-		{
-			for (int i = 0; i < count; i++) {
-				if (idx_buf[i] > top_idx) {
-					top_idx = idx_buf[i];
+		for (int j = 0; j < drawcount; j++) {
+			uint32_t draw_top_idx = 0;
+			if ((index_type & 1) == 0) {
+				uint16_t *_idx_buf = idx_bufs[j];
+				for (int i = 0; i < count[j]; i++) {
+					if (_idx_buf[i] > draw_top_idx) {
+						draw_top_idx = _idx_buf[i];
+					}
 				}
-			}
-		}
-		else
-		{
-			uint32_t *_idx_buf = (uint32_t *)idx_buf;
-			for (int i = 0; i < count; i++) {
-				if (_idx_buf[i] > top_idx) {
-					top_idx = _idx_buf[i];
+			} else {
+				uint32_t *_idx_buf = (uint32_t *)idx_bufs[j];
+				for (int i = 0; i < count[j]; i++) {
+					if (_idx_buf[i] > draw_top_idx) {
+						draw_top_idx = _idx_buf[i];
+					}
 				}
 			}
+			draw_top_idx += (base_vertex ? base_vertex[j] : 0) + 1;
+			if (draw_top_idx > top_idx)
+				top_idx = draw_top_idx;
 		}
-		top_idx += base_idx + 1;
 	}
 
 #ifdef STRICT_DRAW_COMPLIANCE
@@ -1382,42 +2291,56 @@ GLboolean _glDrawElements_CustomShadersIMPL(uint16_t *idx_buf, GLsizei count, ui
 		index_type &= ~1;
 	}
 
-	if (index_type & 2) { // Instanced draw
-		for (int i = 0; i < p->attr_num; i++) {
-			uint8_t attr_idx = p->attr_map[i];
-			streams[i].indexSource = (cur_vao->vertex_attrib_divisor & (1 << attr_idx)) ? index_type : (index_type & 1);
-		}		
-	} else {
-		for (int i = 0; i < p->attr_num; i++) {
-			streams[i].indexSource = index_type;
-		}
+	for (int i = 0; i < p->attr_num; i++) {
+		streams[i].indexSource = index_type;
 	}
 #endif
 
 	// Uploading new vertex program
-	patch_vertex_program(gxm_shader_patcher, p->vshader->id, attributes, p->attr_num, streams, p->attr_num, &p->vprog);
+	{
+		PROFILER_SCOPE(PROF_SHADER_RELOAD)
+		patch_vertex_program(gxm_shader_patcher, p->vshader->id, attributes, p->attr_num, streams, p->attr_num, &p->vprog);
+	}
 	sceGxmSetVertexProgram(gxm_context, p->vprog);
 
 	// Uploading both fragment and vertex uniforms data
 	upload_uniforms();
 
-	// Uploading vertex streams
+	// Uploading constant vertex streams and resolving real pointers for the active ones
 	for (int i = 0; i < p->attr_num; i++) {
 		uint8_t attr_idx = p->attr_map[i];
-		GLboolean is_active = (cur_vao->vertex_attrib_state & (1 << attr_idx)) ? GL_TRUE : GL_FALSE;
-		if (is_active) {
-#ifdef DRAW_SPEEDHACK
-			sceGxmSetVertexStream(gxm_context, i, ptrs[i]);
-#else
+		if (!(cur_vao->vertex_attrib_state & (1 << attr_idx)))
+			sceGxmSetVertexStream(gxm_context, i, cur_vao->vertex_attrib_value[attr_idx]);
+#ifndef DRAW_SPEEDHACK
 #ifdef STRICT_DRAW_COMPLIANCE
-			sceGxmSetVertexStream(gxm_context, i, is_packed[i] ? ptrs[0] : ptrs[i]);
+		else if (is_packed[i])
+			ptrs[i] = ptrs[0];
 #else
-			sceGxmSetVertexStream(gxm_context, i, is_packed ? ptrs[0] : ptrs[i]);
+		else if (is_packed)
+			ptrs[i] = ptrs[0];
 #endif
 #endif
-		} else {
-			sceGxmSetVertexStream(gxm_context, i, cur_vao->vertex_attrib_value[attr_idx]);
+	}
+
+	// Only vertex streams offsets change between the draws
+	int32_t last_base = 0;
+	for (int j = 0; j < drawcount; j++) {
+		int32_t base = base_vertex ? base_vertex[j] : 0;
+		if (j == 0 || base != last_base) {
+			for (int i = 0; i < p->attr_num; i++) {
+				uint8_t attr_idx = p->attr_map[i];
+				if (cur_vao->vertex_attrib_state & (1 << attr_idx))
+					sceGxmSetVertexStream(gxm_context, i, (uint8_t *)ptrs[i] + base * streams[i].stride);
+			}
+			last_base = base;
 		}
+		sceGxmDraw(gxm_context, gxm_p, idx_fmt, idx_bufs[j], count[j]);
+	}
+
+	// Restoring original attributes setup
+	for (int i = 0; i < p->attr_num; i++) {
+		uint8_t attr_idx = p->attr_map[i];
+		GLboolean is_active = (cur_vao->vertex_attrib_state & (1 << attr_idx)) ? GL_TRUE : GL_FALSE;
 		if (!p->has_unaligned_attrs) {
 			attributes[i].regIndex = i;
 			if (!is_active) {
@@ -1431,11 +2354,12 @@ GLboolean _glDrawElements_CustomShadersIMPL(uint16_t *idx_buf, GLsizei count, ui
 	shaders_draw_profiler_cnt += sceKernelGetProcessTimeLow() - draw_start;
 	shaders_draw_cnt++;
 #endif
-	return GL_TRUE;
 }
 
 #ifdef ENABLE_LEGACY_PIPELINE
 void _vglDrawObjects_CustomShadersIMPL() {
+	PROFILER_SCOPE(PROF_SHADERS_DRAW)
+	vgl_perf_counters.shaders_draws++;
 #ifdef HAVE_PROFILING
 	uint32_t draw_start = sceKernelGetProcessTimeLow();
 #endif
@@ -1462,9 +2386,13 @@ void _vglDrawObjects_CustomShadersIMPL() {
 			if (info) {
 				uint32_t sizes[2];
 				vglGetTexSizes(&tex->gxm_tex, &sizes[0], &sizes[1]);
-				float fsizes[2] = {sizes[0], sizes[1]};
-				vglSetUniformData(p->frag_texunits[i]->fptr, SCE_GXM_PARAMETER_TYPE_F32, 0, 1, 2, fsizes, SCE_GXM_PARAMETER_TYPE_F32);
-				dirty_shader_frag_unifs = GL_TRUE;
+				float *fsizes = (float *)p->frag_texunits[i]->fptr;
+				if (fsizes[0] != sizes[0] || fsizes[1] != sizes[1]) {
+					fsizes[0] = sizes[0];
+					fsizes[1] = sizes[1];
+					p->unif_fbuffer_gen++;
+					dirty_shader_frag_unifs = GL_TRUE;
+				}
 			}
 #endif
 #ifndef SAMPLERS_SPEEDHACK
@@ -1529,12 +2457,57 @@ void shark_log_cb(const char *msg, shark_log_level msg_level, int line) {
 }
 #endif
 
-static inline __attribute__((always_inline)) float *get_uniform_alias_data_ptr(uniform *src, uint32_t cnt, const char *name) {
-	for (int i = 0; i < cnt; i++) {
-		uniform *u = &src[i];
-		if (!strcmp(name, sceGxmProgramParameterGetName(u->ptr))) {
-			return u->fptr;
-		}
+static inline __attribute__((always_inline)) uint32_t get_name_hash(const char *name) {
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	while (*name) {
+		hash = (hash ^ (uint8_t)*name++) * 16777619u;
+	}
+	return hash;
+}
+
+static void names_table_init(names_table *t, uint32_t num) {
+	if (!num) {
+		t->entries = NULL;
+		t->mask = 0;
+		return;
+	}
+	// Keeping load factor below 50% so that probe sequences stay short
+	uint32_t size = nearest_po2(num * 2);
+	t->entries = (name_entry *)vglCalloc(size, sizeof(name_entry));
+	t->mask = size - 1;
+}
+
+static void names_table_free(names_table *t) {
+	if (t->entries) {
+		vgl_free(t->entries);
+		t->entries = NULL;
+	}
+}
+
+// Adds an entry to a names table, replacing any previous entry with the same name
+static void names_table_add(names_table *t, const char *name, void *ref) {
+	uint32_t hash = get_name_hash(name);
+	uint32_t i = hash & t->mask;
+	while (t->entries[i].name) {
+		if (t->entries[i].hash == hash && !strcmp(t->entries[i].name, name))
+			break;
+		i = (i + 1) & t->mask;
+	}
+	t->entries[i].name = name;
+	t->entries[i].hash = hash;
+	t->entries[i].ref = ref;
+}
+
+static void *names_table_find(names_table *t, const char *name) {
+	if (!t->entries)
+		return NULL;
+	uint32_t hash = get_name_hash(name);
+	uint32_t i = hash & t->mask;
+	while (t->entries[i].name) {
+		if (t->entries[i].hash == hash && !strcmp(t->entries[i].name, name))
+			return t->entries[i].ref;
+		i = (i + 1) & t->mask;
 	}
 	return NULL;
 }
@@ -1564,12 +2537,43 @@ static inline __attribute__((always_inline)) block_uniform *get_block_details(bl
  * ------------------------------
  */
 void vglSetupRuntimeShaderCompiler(shark_opt opt_level, int32_t use_fastmath, int32_t use_fastprecision, int32_t use_fastint) {
+	finish_shader_jobs();
 	compiler_opts = opt_level;
 	compiler_fastmath = use_fastmath;
 	compiler_fastprecision = use_fastprecision;
 	compiler_fastint = use_fastint;
 }
 
+void glMaxShaderCompilerThreadsKHR(GLuint count) {
+	THREAD_SAFE()
+
+	if (!count == !shader_compiler_threads) {
+		shader_compiler_threads = count;
+		return;
+	}
+
+	if (count) {
+		// Starting the shader compiler thread, a single one is used regardless of the requested amount
+		shader_jobs_sema = sceKernelCreateSema("vitaGL Shader Jobs Sema", 0, 0, MAX_SHADER_JOBS, NULL);
+		SceUID thd = sceKernelCreateThread("vitaGL Shader Compiler", &shader_compiler_thread, 0x10000100, 0x40000, 0, SCE_KERNEL_CPU_MASK_USER_ALL, NULL);
+		if (thd < 0) {
+			sceKernelDeleteSema(shader_jobs_sema);
+			shader_jobs_sema = -1;
+			return;
+		}
+		acquire_shader_compiler_sema();
+		sceKernelStartThread(thd, 0, NULL);
+	} else {
+		// Stopping the shader compiler thread once every queued job got processed
+		queue_shader_job(NULL, NULL, NULL);
+		finish_shader_jobs();
+		sceKernelDeleteSema(shader_jobs_sema);
+		shader_jobs_sema = -1;
+		release_shader_compiler_sema();
+	}
+	shader_compiler_threads = count;
+}
+
 GLuint glCreateShader(GLenum shaderType) {
 #ifndef SKIP_ERROR_HANDLING
 	if (shaderType != GL_FRAGMENT_SHADER && shaderType != GL_VERTEX_SHADER && shaderType != GL_CG_FRAGMENT_SHADER_EXT && shaderType != GL_CG_VERTEX_SHADER_EXT) {
@@ -1612,6 +2616,9 @@ GLuint glCreateShader(GLenum shaderType) {
 	shaders[res - 1].mat = NULL;
 	shaders[res - 1].unif_blk = NULL;
 	shaders[res - 1].prog = NULL;
+	shaders[res - 1].bin = NULL;
+	shaders[res - 1].id = NULL;
+	shaders[res - 1].compile_job = 0;
 	shaders[res - 1].valid = GL_TRUE;
 	shaders[res - 1].source = NULL;
 
@@ -1623,6 +2630,12 @@ void glGetShaderiv(GLuint handle, GLenum pname, GLint *params) {
 
 	// Grabbing passed shader
 	shader *s = &shaders[handle - 1];
+	if (pname == GL_COMPLETION_STATUS_KHR) {
+		*params = is_shader_job_pending(s->compile_job) ? GL_FALSE : GL_TRUE;
+		return;
+	}
+	sync_shader(s);
+
 	switch (pname) {
 	case GL_SHADER_TYPE:
 		*params = s->type;
@@ -1664,6 +2677,7 @@ void glGetShaderInfoLog(GLuint handle, GLsizei maxLength, GLsizei *length, GLcha
 	GLsizei len = 0;
 #ifdef HAVE_SHARK_LOG
 	shader *s = &shaders[handle - 1];
+	sync_shader(s);
 	if (s->log) {
 		len = min(strlen(s->log), maxLength - 1);
 		vgl_fast_memcpy(infoLog, s->log, len);
@@ -1685,6 +2699,7 @@ void glGetShaderSource(GLuint handle, GLsizei bufSize, GLsizei *length, GLchar *
 
 	// Grabbing passed shader
 	shader *s = &shaders[handle - 1];
+	sync_shader(s);
 
 	GLsizei size = 0;
 	if (s->source) {
@@ -1706,8 +2721,15 @@ void glShaderSource(GLuint handle, GLsizei count, const GLchar *const *string, c
 		SET_GL_ERROR(GL_INVALID_VALUE)
 	}
 #endif
+#ifdef HAVE_FRAME_CAPTURE
+	uint32_t capture_size = 0;
+	const GLchar *capture_src = vgl_capture_active ? capture_join_sources(handle, count, string, length, &capture_size) : NULL;
+#endif
+	CAPTURE_CALL_WITH_DATA(CAPTURE_SHADER_SOURCE, capture_src, capture_size, handle)
+
 	// Grabbing passed shader
 	shader *s = &shaders[handle - 1];
+	sync_shader(s);
 	
 	uint32_t size = 1;
 	size_t lengths[32];
@@ -1737,47 +2759,40 @@ void glShaderBinary(GLsizei count, const GLuint *handles, GLenum binaryFormat, c
 
 	// Grabbing passed shader
 	shader *s = &shaders[handles[0] - 1];
+	sync_shader(s);
 
 	unserialize_shader((void *)binary, length, s, GL_FALSE);
 }
 
 void glCompileShader(GLuint handle) {
 	THREAD_SAFE()
+	CAPTURE_OBJECT(capture_shader, handle)
+	CAPTURE_CALL(CAPTURE_COMPILE_SHADER, handle)
 
 	// If vitaShaRK is not enabled, we try to initialize it
-	if (!is_shark_online && !start_shader_compiler()) {
+	lock_shader_compiler()
+	GLboolean has_compiler = is_shark_online || start_shader_compiler();
+	unlock_shader_compiler()
+	if (!has_compiler) {
 		SET_GL_ERROR(GL_INVALID_OPERATION)
 	}
 	
 	// Grabbing passed shader
 	shader *s = &shaders[handle - 1];
+	sync_shader(s);
 	
 	// If we use VGL_MODE_POSTPONED, we compile shaders in glLinkProgram
 	if (s->is_glsl && glsl_sema_mode == VGL_MODE_POSTPONED)
 		return;
 	
-#ifdef HAVE_SHADER_CACHE
-	char fname[256];
-	sprintf(fname, "%s/%s/%llX.gxp", vgl_shader_cache_path, s->type == GL_VERTEX_SHADER ? "v" : "f", XXH3_64bits(s->source, s->size));
-	SceUID f = sceIoOpen(fname, SCE_O_RDONLY, 0777);
-	if (f >= 0) {
-		vgl_free(s->source);
-		s->source = NULL;
-		size_t sz = sceIoLseek(f, 0, SCE_SEEK_END);
-		sceIoLseek(f, 0, SCE_SEEK_SET);
-		void *buf = vglMalloc(sz);
-		sceIoRead(f, buf, sz);
-		sceIoClose(f);
-		unserialize_shader(buf, sz, s, GL_FALSE);
-		vgl_free(buf);
+	// If background compilation is enabled, we let the shader compiler thread process the shader
+	if (shader_compiler_threads) {
+		s->compile_job = queue_shader_job(s, NULL, NULL);
 		return;
 	}
-#endif
-
-	if (s->is_glsl) {
-		glsl_translator_process(s);
-	}
-	vgl_compile_shader(s, GL_FALSE);
+	
+	process_shader(s);
+	register_shader(s);
 }
 
 void glDeleteShader(GLuint shad) {
@@ -1795,6 +2810,9 @@ void glDeleteShader(GLuint shad) {
 
 void glAttachShader(GLuint prog, GLuint shad) {
 	THREAD_SAFE()
+	CAPTURE_OBJECT(capture_program, prog)
+	CAPTURE_OBJECT(capture_shader, shad)
+	CAPTURE_CALL(CAPTURE_ATTACH_SHADER, prog, shad)
 
 	// Grabbing passed shader and program
 	shader *s = &shaders[shad - 1];
@@ -1813,8 +2831,14 @@ void glAttachShader(GLuint prog, GLuint shad) {
 			p->vshader = s;
 			// If we use VGL_MODE_POSTPONED, we perform attributes binding in glLinkProgram
 			if (glsl_sema_mode != VGL_MODE_POSTPONED || !s->is_glsl) {
-				// Setting progressive default attribute bindings
-				set_default_attrib_binding();	
+				// If the shader is still being compiled, we perform attributes binding in glLinkProgram
+				if (is_shader_job_pending(s->compile_job))
+					p->deferred_binds = GL_TRUE;
+				else {
+					// Setting progressive default attribute bindings
+					sync_shader(s);
+					set_default_attrib_binding();
+				}
 			}
 			break;
 		case GL_FRAGMENT_SHADER:
@@ -1897,14 +2921,23 @@ GLuint glCreateProgram(void) {
 			progs[i].frag_uniforms = NULL;
 			progs[i].unif_vbuffer = NULL;
 			progs[i].unif_fbuffer = NULL;
+			progs[i].unif_vbuffer_gen = 1;
+			progs[i].unif_fbuffer_gen = 1;
+			progs[i].vbuffer_copy.gen = 0;
+			progs[i].fbuffer_copy.gen = 0;
 			progs[i].vert_uniforms_num = 0;
 			progs[i].frag_uniforms_num = 0;
 			progs[i].vert_ubos = NULL;
 			progs[i].frag_ubos = NULL;
+			progs[i].unif_names.entries = NULL;
+			progs[i].block_names.entries = NULL;
+			progs[i].palette_unif = 0;
 			progs[i].attr_highest_idx = 0;
 			progs[i].num_glsl_attr = 0;
 			progs[i].glsl_attr_map = NULL;
 			progs[i].is_fbo_float = 0xFF;
+			progs[i].link_job = 0;
+			progs[i].deferred_binds = GL_FALSE;
 			for (j = 0; j < VERTEX_ATTRIBS_NUM; j++) {
 				progs[i].attr[j].regIndex = 0xDEAD;
 			}
@@ -1937,6 +2970,7 @@ void glGetProgramBinary(GLuint prog, GLsizei bufSize, GLsizei *length, GLenum *b
 
 	// Grabbing passed program
 	program *p = &progs[prog - 1];
+	sync_program(p, prog);
 
 	// Saving info related to bound attributes locations
 	GLuint *b = (GLuint *)binary;
@@ -1961,6 +2995,7 @@ void glProgramBinary(GLuint prog, GLenum binaryFormat, const void *binary, GLsiz
 
 	// Grabbing passed program
 	program *p = &progs[prog - 1];
+	sync_program(p, prog);
 	
 	// Restoring bound attributes info
 	GLuint *b = (GLuint *)binary;
@@ -1989,6 +3024,7 @@ void glDeleteProgram(GLuint prog) {
 
 	// Grabbing passed program
 	program *p = &progs[prog - 1];
+	sync_program(p, prog);
 
 	// Releasing both vertex and fragment programs from sceGxmShaderPatcher
 	if (p->status) {
@@ -2015,6 +3051,8 @@ void glDeleteProgram(GLuint prog) {
 			p->frag_ubos = (ubo *)p->frag_ubos->chain;
 			vgl_free(old);
 		}
+		names_table_free(&p->unif_names);
+		names_table_free(&p->block_names);
 		if (p->glsl_attr_map) {
 			vgl_free(p->glsl_attr_map);
 		}
@@ -2051,6 +3089,12 @@ void glGetProgramiv(GLuint progr, GLenum pname, GLint *params) {
 	uint32_t *ptr;
 	uint32_t dummy;
 
+	if (pname == GL_COMPLETION_STATUS_KHR) {
+		*params = (p->status == PROG_LINKING && is_shader_job_pending(p->link_job)) ? GL_FALSE : GL_TRUE;
+		return;
+	}
+	sync_program(p, progr);
+
 	switch (pname) {
 	case GL_LINK_STATUS:
 	case GL_VALIDATE_STATUS:
@@ -2110,93 +3154,110 @@ void glGetProgramiv(GLuint progr, GLenum pname, GLint *params) {
 	}
 }
 
+// Binds a vertex attribute of a program to a given location
+static void bind_attrib_location(program *p, GLuint index, const GLchar *name) {
+	// Looking for desired parameter in requested program
+	const SceGxmProgramParameter *param = sceGxmProgramFindParameterByName(p->vshader->prog, name);
+	if (param == NULL || sceGxmProgramParameterGetCategory(param) != SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE)
+		return;
+	uint32_t attr_index = sceGxmProgramParameterGetResourceIndex(param);
+	
+	// Swapping any previously made bind to the requested attribute
+	for (int i = 0; i < p->attr_highest_idx; i++) {
+		if (p->attr[i].regIndex == attr_index) {
+			p->attr[i].regIndex = p->attr[index].regIndex;
+			break;
+		}
+	}
+	
+	// Set new binding to the requested attribute
+	p->attr[index].regIndex = attr_index;
+	if (p->attr_highest_idx <= index)
+		p->attr_highest_idx = index + 1;
+}
+
 void glLinkProgram(GLuint progr) {
 	THREAD_SAFE()
+	CAPTURE_OBJECT(capture_program, progr)
+	CAPTURE_CALL(CAPTURE_LINK_PROGRAM, progr)
 
 	// Grabbing passed program
 	program *p = &progs[progr - 1];
+	sync_program(p, progr);
+	shader *vs = p->vshader;
+	shader *fs = p->fshader;
 #ifndef SKIP_ERROR_HANDLING
 	if (glsl_sema_mode == VGL_MODE_POSTPONED) {
-		if (!(p->fshader->prog || (p->fshader->is_glsl && p->fshader->source)) || !(p->vshader->prog || (p->vshader->is_glsl && p->vshader->source))) {
-			vgl_log("%s:%d: %s: %s shader is missing.\n", __FILE__, __LINE__, __func__, (p->fshader->prog || (p->fshader->is_glsl && p->fshader->source)) ? "vertex" : "fragment");
+		if (!(fs->prog || fs->compile_job || (fs->is_glsl && fs->source)) || !(vs->prog || vs->compile_job || (vs->is_glsl && vs->source))) {
+			vgl_log("%s:%d: %s: %s shader is missing.\n", __FILE__, __LINE__, __func__, (fs->prog || fs->compile_job || (fs->is_glsl && fs->source)) ? "vertex" : "fragment");
 			return;
 		}
 	} else {
-		if (!p->fshader->prog || !p->vshader->prog) {
-			vgl_log("%s:%d: %s: %s shader is missing.\n", __FILE__, __LINE__, __func__, p->fshader->prog ? "vertex" : "fragment");
+		if (!(fs->prog || fs->compile_job) || !(vs->prog || vs->compile_job)) {
+			vgl_log("%s:%d: %s: %s shader is missing.\n", __FILE__, __LINE__, __func__, (fs->prog || fs->compile_job) ? "vertex" : "fragment");
 			return;
 		}
 	}
 #endif
 
-	// With VGL_MODE_POSTPONED we perform shaders translation+compilation and attributes binding prior actual program linking
-	if (glsl_sema_mode == VGL_MODE_POSTPONED && (p->vshader->is_glsl || p->fshader->is_glsl)) {
-		glsl_sema_mode = VGL_MODE_SHADER_PAIR;
-#ifdef HAVE_SHADER_CACHE
-		char frag_fname[256], vert_fname[256];
-		char *fname;
-		if (!p->vshader->prog) {
-			sprintf(vert_fname, "%s/v/%llX.gxp", vgl_shader_cache_path, XXH3_64bits(p->vshader->source, p->vshader->size));
-			SceUID f = sceIoOpen(vert_fname, SCE_O_RDONLY, 0777);
-			if (f >= 0) {
-				size_t sz = sceIoLseek(f, 0, SCE_SEEK_END);
-				sceIoLseek(f, 0, SCE_SEEK_SET);
-				void *buf = vglMalloc(sz);
-				sceIoRead(f, buf, sz);
-				sceIoClose(f);
-				unserialize_shader(buf, sz, p->vshader, GL_TRUE);
-				vgl_free(buf);
-			}
-		}
-		if (!p->fshader->prog) {
-			sprintf(frag_fname, "%s/f/%llX.gxp", vgl_shader_cache_path, XXH3_64bits(p->fshader->source, p->fshader->size));
-			SceUID f = sceIoOpen(frag_fname, SCE_O_RDONLY, 0777);
-			if (f >= 0) {
-				size_t sz = sceIoLseek(f, 0, SCE_SEEK_END);
-				sceIoLseek(f, 0, SCE_SEEK_SET);
-				void *buf = vglMalloc(sz);
-				sceIoRead(f, buf, sz);
-				sceIoClose(f);
-				unserialize_shader(buf, sz, p->fshader, GL_TRUE);
-				vgl_free(buf);
-			}
-		}
-#endif
-		if (!p->vshader->prog || !p->fshader->prog) {
-			if (p->vshader->is_glsl || p->fshader->is_glsl) {
-				glsl_translator_set_process(p->vshader, p->fshader);
-			}
-			if (!p->vshader->prog) {
-#ifdef HAVE_SHADER_CACHE
-				fname = vert_fname;
-#endif
-				vgl_compile_shader(p->vshader, GL_TRUE);
-			}
-			if (!p->fshader->prog) {
-#ifdef HAVE_SHADER_CACHE
-				fname = frag_fname;
-#endif
-				vgl_compile_shader(p->fshader, GL_TRUE);
-			}
-		}
+	// With background compilation enabled, we complete linking once the program is actually needed
+	if (shader_compiler_threads && p->status != PROG_LINKED) {
+		if (glsl_sema_mode == VGL_MODE_POSTPONED && (vs->is_glsl || fs->is_glsl)) {
+			p->link_job = queue_shader_job(vs, fs, p);
+			vs->compile_job = p->link_job;
+			fs->compile_job = p->link_job;
+		} else
+			p->link_job = max(vs->compile_job, fs->compile_job);
+		p->status = PROG_LINKING;
+		return;
+	}
 
-		// Setting progressive default attribute bindings
-		set_default_attrib_binding();
+	// With VGL_MODE_POSTPONED we perform shaders translation+compilation and attributes binding prior actual program linking
+	if (glsl_sema_mode == VGL_MODE_POSTPONED) {
+		finish_shader_jobs();
+		if (process_postponed_shaders(vs, fs))
+			p->deferred_binds = GL_TRUE;
+	}
+	link_program(progr);
+}
 
-		if (p->glsl_attr_map) {
+static void link_program(GLuint progr) {
+	// Grabbing passed program
+	program *p = &progs[progr - 1];
+	if (p->status == PROG_LINKING)
+		p->status = PROG_UNLINKED;
+
+	// Waiting for attached shaders to be compiled
+	sync_shader(p->vshader);
+	sync_shader(p->fshader);
+
+	// Performing attributes binding postponed to linking time
+	if (p->deferred_binds) {
+		p->deferred_binds = GL_FALSE;
+		if (p->vshader->prog) {
+			// Setting progressive default attribute bindings
+			set_default_attrib_binding();
+		}
+	}
+	if (p->glsl_attr_map) {
+		if (p->vshader->prog) {
 			for (int i = 0; i < p->num_glsl_attr; i++) {
-				glBindAttribLocation(progr, p->glsl_attr_map[i].idx, p->glsl_attr_map[i].name);
+				bind_attrib_location(p, p->glsl_attr_map[i].idx, p->glsl_attr_map[i].name);
 			}
-			vgl_free(p->glsl_attr_map);
-			p->glsl_attr_map = NULL;
 		}
-		glsl_sema_mode = VGL_MODE_POSTPONED;
+		vgl_free(p->glsl_attr_map);
+		p->glsl_attr_map = NULL;
+		p->num_glsl_attr = 0;
 	}
 
 	if (p->status == PROG_LINKED) {
 		vgl_log("%s:%d: %s: A program has been re-linked. vitaGL doesn't support re-linking, glitches may happen.\n", __FILE__, __LINE__, __func__);
 		return;
 	}
+	if (!p->vshader->prog || !p->fshader->prog) {
+		vgl_log("%s:%d: %s: Failed to compile %s shader.\n", __FILE__, __LINE__, __func__, p->vshader->prog ? "fragment" : "vertex");
+		return;
+	}
 	p->status = PROG_LINKED;
 	
 	// Set up uniform buffers
@@ -2245,6 +3306,7 @@ void glLinkProgram(GLuint progr) {
 					p->max_frag_texunit_idx = texunit_idx;
 				uniform *u = &p->frag_uniforms[j++];
 				u->ptr = param;
+				u->prog_idx = p - progs;
 				u->type = sceGxmProgramParameterIsSamplerCube(param) ? UNIFORM_CUBE_SAMPLER : UNIFORM_SAMPLER;
 				u->sampler_index = 0;
 				p->frag_texunits[texunit_idx - 1] = u;
@@ -2265,6 +3327,7 @@ void glLinkProgram(GLuint progr) {
 			} else if (cat == SCE_GXM_PARAMETER_CATEGORY_UNIFORM && sceGxmProgramParameterGetContainerIndex(param) == UBOS_NUM) {
 				uniform *u = &p->frag_uniforms[j++];
 				u->ptr = param;
+				u->prog_idx = p - progs;
 				u->vptr = NULL;
 				u->fptr = (uint8_t *)p->unif_fbuffer + sceGxmProgramParameterGetResourceIndex(param) * 4;
 				u->type = UNIFORM_DATA;
@@ -2335,6 +3398,26 @@ void glLinkProgram(GLuint progr) {
 		}
 		ptr += 4;
 	}
+
+	// Setting up names lookup tables, fragment uniforms are added first so that vertex ones can alias them
+	names_table_init(&p->unif_names, p->vert_uniforms_num + p->frag_uniforms_num);
+	for (i = 0; i < p->frag_uniforms_num; i++) {
+		names_table_add(&p->unif_names, sceGxmProgramParameterGetName(p->frag_uniforms[i].ptr), &p->frag_uniforms[i]);
+	}
+	uint32_t ubos_num = 0;
+	for (ubo *u = p->frag_ubos; u; u = (ubo *)u->chain) {
+		ubos_num++;
+	}
+	for (ubo *u = p->vert_ubos; u; u = (ubo *)u->chain) {
+		ubos_num++;
+	}
+	names_table_init(&p->block_names, ubos_num);
+	for (ubo *u = p->frag_ubos; u; u = (ubo *)u->chain) {
+		names_table_add(&p->block_names, ((block_uniform *)u->ptr)->name, u);
+	}
+	for (ubo *u = p->vert_ubos; u; u = (ubo *)u->chain) {
+		names_table_add(&p->block_names, ((block_uniform *)u->ptr)->name, u->alias ? u->alias : u);
+	}
 	if (p->vert_uniforms_num) {
 		p->vert_uniforms = (uniform *)vglMalloc(sizeof(uniform) * p->vert_uniforms_num);
 		j = 0;
@@ -2348,18 +3431,24 @@ void glLinkProgram(GLuint progr) {
 					p->max_vert_texunit_idx = texunit_idx;
 				uniform *u = &p->vert_uniforms[j++];
 				u->ptr = param;
+				u->prog_idx = p - progs;
 				u->type = sceGxmProgramParameterIsSamplerCube(param) ? UNIFORM_CUBE_SAMPLER : UNIFORM_SAMPLER;
 				u->sampler_index = 0;
 				p->vert_texunits[texunit_idx - 1] = u;
 			} else if (cat == SCE_GXM_PARAMETER_CATEGORY_UNIFORM && sceGxmProgramParameterGetContainerIndex(param) == UBOS_NUM) {
 				uniform *u = &p->vert_uniforms[j++];
 				u->ptr = param;
+				u->prog_idx = p - progs;
 				u->type = UNIFORM_DATA;
 				u->vptr = (uint8_t *)p->unif_vbuffer + sceGxmProgramParameterGetResourceIndex(param) * 4;
-				u->fptr = get_uniform_alias_data_ptr(p->frag_uniforms, p->frag_uniforms_num, sceGxmProgramParameterGetName(param));
+				uniform *alias = (uniform *)names_table_find(&p->unif_names, sceGxmProgramParameterGetName(param));
+				u->fptr = alias ? alias->fptr : NULL;
 			}
 			ptr += 4;
 		}
+		for (i = 0; i < p->vert_uniforms_num; i++) {
+			names_table_add(&p->unif_names, sceGxmProgramParameterGetName(p->vert_uniforms[i].ptr), &p->vert_uniforms[i]);
+		}
 #ifdef HAVE_FFP_SHADER_SUPPORT
 		for (int i = 0; i < FFP_BINDS_NUM; i++) {
 			SceGxmProgramParameter *param = sceGxmProgramFindParameterByName(p->vshader->prog, ffp_bind_names[i]);
@@ -2414,8 +3503,13 @@ void glLinkProgram(GLuint progr) {
 
 void glUseProgram(GLuint prog) {
 	THREAD_SAFE()
+	CAPTURE_OBJECT(capture_program, prog)
+	CAPTURE_CALL(CAPTURE_USE_PROGRAM, prog)
 
 	// Setting current custom program to passed program
+	if (prog) {
+		sync_program(&progs[prog - 1], prog);
+	}
 	cur_program = prog;
 	dirty_shader_frag_unifs = GL_TRUE;
 	dirty_shader_vert_unifs = GL_TRUE;
@@ -2426,24 +3520,11 @@ void glUseProgram(GLuint prog) {
 GLuint glGetUniformBlockIndex(GLuint prog, const GLchar *uniformBlockName) {
 	// Grabbing passed program
 	program *p = &progs[prog - 1];
+	sync_program(p, prog);
 
 	// Getting the desired location
-	ubo *j = p->vert_ubos;
-	while (j) {
-		block_uniform *b = (block_uniform *)j->ptr;
-		if (!strcmp(b->name, uniformBlockName))
-			return j->alias ? (GLuint)j->alias : (GLuint)j;
-		j = j->chain;
-	}
-	j = p->frag_ubos;
-	while (j) {
-		block_uniform *b = (block_uniform *)j->ptr;
-		if (!strcmp(b->name, uniformBlockName))
-			return (GLuint)j;
-		j = j->chain;
-	}
-
-	return GL_INVALID_INDEX;
+	ubo *j = (ubo *)names_table_find(&p->block_names, uniformBlockName);
+	return j ? (GLuint)j : GL_INVALID_INDEX;
 }
 
 void glUniformBlockBinding(GLuint prog, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
@@ -2456,6 +3537,7 @@ void glUniformBlockBinding(GLuint prog, GLuint uniformBlockIndex, GLuint uniform
 GLint glGetUniformLocation(GLuint prog, const GLchar *name) {
 	// Grabbing passed program
 	program *p = &progs[prog - 1];
+	sync_program(p, prog);
 
 	// texture, sampler and matrix are reserved keywords in CG but are not in GLSL
 	if (!strcmp(name, "texture"))
@@ -2483,58 +3565,66 @@ GLint glGetUniformLocation(GLuint prog, const GLchar *name) {
 	}
 
 	uniform_location ret;
-#endif
-	// Checking if parameter is a vertex or fragment related one
-	uniform *j;
-	uint32_t cnt;
-	const SceGxmProgramParameter *u = sceGxmProgramFindParameterByName(p->vshader->prog, name);
-	if (u == NULL) {
-		u = sceGxmProgramFindParameterByName(p->fshader->prog, name);
-		if (u == NULL) {
-			return -1;
-		} else {
-			j = p->frag_uniforms;
-			cnt = p->frag_uniforms_num;
-#ifdef STRICT_UNIFORMS_COMPLIANCE
-			ret.is_vertex = GL_FALSE;
-#endif
-		}
-	} else {
-		j = p->vert_uniforms;
-		cnt = p->vert_uniforms_num;
-#ifdef STRICT_UNIFORMS_COMPLIANCE
-		ret.is_vertex = GL_TRUE;
-#endif
+#else
+	// Without strict uniforms compliance, only the first element of an array can be addressed
+	char tmp[64];
+	const char *start = strchr(name, '[');
+	if (start && !strcmp(start, "[0]") && start - name < sizeof(tmp)) {
+		sceClibMemcpy(tmp, name, start - name);
+		tmp[start - name] = 0;
+		name = tmp;
 	}
-
+#endif
 	// Getting the desired location
-	for (uint32_t i = 0; i < cnt; i++) {
-		if (j[i].ptr == u) {
-#ifdef STRICT_UNIFORMS_COMPLIANCE			
-			ret.offset = index;
-			ret.zero = 0;
-			ret.program_idx = prog - 1;
-			ret.uniform_idx = i;
-			return ret.raw;
+	uniform *u = (uniform *)names_table_find(&p->unif_names, name);
+	if (!u)
+		return -1;
+#ifdef STRICT_UNIFORMS_COMPLIANCE
+	ret.is_vertex = u >= p->vert_uniforms && u < p->vert_uniforms + p->vert_uniforms_num;
+	ret.offset = index;
+	ret.zero = 0;
+	ret.program_idx = prog - 1;
+	ret.uniform_idx = ret.is_vertex ? u - p->vert_uniforms : u - p->frag_uniforms;
+	return ret.raw;
 #else
-			return -((GLint)&j[i]);
+	return -((GLint)u);
 #endif
-		}
-	}
-
-	return -1;
 }
 
 #define vgl_fill_uniform_data(p, type, size, count) \
 	if (u->vptr) { \
 		vglSetUniformData(u->vptr, sceGxmProgramParameterGetType(u->ptr), offs, count, size, p, type); \
+		progs[u->prog_idx].unif_vbuffer_gen++; \
 		dirty_shader_vert_unifs = GL_TRUE; \
 	} \
 	if (u->fptr) { \
 		vglSetUniformData(u->fptr, sceGxmProgramParameterGetType(u->ptr), offs, count, size, p, type); \
+		progs[u->prog_idx].unif_fbuffer_gen++; \
 		dirty_shader_frag_unifs = GL_TRUE; \
 	}
 
+#ifdef HAVE_FRAME_CAPTURE
+static void capture_uniform_location(GLint location, uniform *u, int offs) {
+	if (!capture_object_is_new(CAPTURE_OBJ_UNIFORM, location))
+		return;
+	capture_program(u->prog_idx + 1);
+	char name[CAPTURE_NAME_SIZE * 2];
+	if (offs)
+		snprintf(name, sizeof(name), "%s[%d]", sceGxmProgramParameterGetName(u->ptr), offs);
+	else
+		snprintf(name, sizeof(name), "%s", sceGxmProgramParameterGetName(u->ptr));
+	capture_write_state(CAPTURE_UNIFORM_LOCATION, CAPTURE_ARGS(location, u->prog_idx + 1), name, strlen(name) + 1);
+}
+
+// Captures a uniform update, describing its location the first time it gets referenced
+#define capture_uniform_call(type, count, transpose, value, size) \
+	if (vgl_capture_active) \
+		capture_uniform_location(location, u, offs); \
+	CAPTURE_CALL_WITH_DATA(CAPTURE_UNIFORM, value, (count) * (size), location, type, count, transpose)
+#else
+#define capture_uniform_call(type, count, transpose, value, size)
+#endif
+
 inline void glUniform1i(GLint location, GLint v0) {
 	THREAD_SAFE()
 
@@ -2545,6 +3635,7 @@ inline void glUniform1i(GLint location, GLint v0) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_INT, 1, 0, &v0, sizeof(GLint))
 
 	// Setting passed value to desired uniform
 	if (u->type != UNIFORM_DATA) { // Sampler
@@ -2568,6 +3659,7 @@ inline void glUniform1iv(GLint location, GLsizei count, const GLint *value) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_INT, count, 0, value, sizeof(GLint))
 	
 	// Setting passed value to desired uniform
 	if (u->type != UNIFORM_DATA) { // Sampler
@@ -2591,6 +3683,7 @@ inline void glUniform1f(GLint location, GLfloat v0) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_FLOAT, 1, 0, &v0, sizeof(GLfloat))
 	
 	// Setting passed value to desired uniform
 	vgl_fill_uniform_data(&v0, SCE_GXM_PARAMETER_TYPE_F32, 1, 1)
@@ -2610,6 +3703,7 @@ inline void glUniform1fv(GLint location, GLsizei count, const GLfloat *value) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_FLOAT, count, 0, value, sizeof(GLfloat))
 
 	// Setting passed value to desired uniform
 	vgl_fill_uniform_data(value, SCE_GXM_PARAMETER_TYPE_F32, 1, count)
@@ -2629,6 +3723,7 @@ inline void glUniform2i(GLint location, GLint v0, GLint v1) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_INT_VEC2, 1, 0, ((const GLint[]){v0, v1}), 2 * sizeof(GLint))
 
 	// Setting passed value to desired uniform
 	GLint src[2] = {v0, v1};
@@ -2649,6 +3744,7 @@ inline void glUniform2iv(GLint location, GLsizei count, const GLint *value) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_INT_VEC2, count, 0, value, 2 * sizeof(GLint))
 
 	// Setting passed value to desired uniform
 	vgl_fill_uniform_data(value, SCE_GXM_PARAMETER_TYPE_S32, 2, count)
@@ -2668,6 +3764,7 @@ inline void glUniform2f(GLint location, GLfloat v0, GLfloat v1) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_FLOAT_VEC2, 1, 0, ((const GLfloat[]){v0, v1}), 2 * sizeof(GLfloat))
 
 	// Setting passed value to desired uniform
 	GLfloat src[2] = {v0, v1};
@@ -2688,6 +3785,7 @@ inline void glUniform2fv(GLint location, GLsizei count, const GLfloat *value) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_FLOAT_VEC2, count, 0, value, 2 * sizeof(GLfloat))
 
 	// Setting passed value to desired uniform
 	vgl_fill_uniform_data(value, SCE_GXM_PARAMETER_TYPE_F32, 2, count)
@@ -2707,6 +3805,7 @@ inline void glUniform3i(GLint location, GLint v0, GLint v1, GLint v2) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_INT_VEC3, 1, 0, ((const GLint[]){v0, v1, v2}), 3 * sizeof(GLint))
 
 	// Setting passed value to desired uniform
 	GLint src[3] = {v0, v1, v2};
@@ -2727,6 +3826,7 @@ inline void glUniform3iv(GLint location, GLsizei count, const GLint *value) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_INT_VEC3, count, 0, value, 3 * sizeof(GLint))
 
 	// Setting passed value to desired uniform
 	vgl_fill_uniform_data(value, SCE_GXM_PARAMETER_TYPE_S32, 3, count)
@@ -2746,6 +3846,7 @@ inline void glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_FLOAT_VEC3, 1, 0, ((const GLfloat[]){v0, v1, v2}), 3 * sizeof(GLfloat))
 
 	// Setting passed value to desired uniform
 	GLfloat src[3] = {v0, v1, v2};
@@ -2766,6 +3867,7 @@ inline void glUniform3fv(GLint location, GLsizei count, const GLfloat *value) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_FLOAT_VEC3, count, 0, value, 3 * sizeof(GLfloat))
 
 	// Setting passed value to desired uniform
 	vgl_fill_uniform_data(value, SCE_GXM_PARAMETER_TYPE_F32, 3, count)
@@ -2785,6 +3887,7 @@ inline void glUniform4i(GLint location, GLint v0, GLint v1, GLint v2, GLint v3)
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_INT_VEC4, 1, 0, ((const GLint[]){v0, v1, v2, v3}), 4 * sizeof(GLint))
 
 	// Setting passed value to desired uniform
 	GLint src[4] = {v0, v1, v2, v3};
@@ -2805,6 +3908,7 @@ inline void glUniform4iv(GLint location, GLsizei count, const GLint *value) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_INT_VEC4, count, 0, value, 4 * sizeof(GLint))
 
 	// Setting passed value to desired uniform
 	vgl_fill_uniform_data(value, SCE_GXM_PARAMETER_TYPE_S32, 4, 1)
@@ -2824,6 +3928,7 @@ inline void glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfl
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_FLOAT_VEC4, 1, 0, ((const GLfloat[]){v0, v1, v2, v3}), 4 * sizeof(GLfloat))
 
 	// Setting passed value to desired uniform
 	GLfloat src[4] = {v0, v1, v2, v3};
@@ -2844,6 +3949,7 @@ inline void glUniform4fv(GLint location, GLsizei count, const GLfloat *value) {
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_FLOAT_VEC4, count, 0, value, 4 * sizeof(GLfloat))
 
 	// Setting passed value to desired uniform
 	vgl_fill_uniform_data(value, SCE_GXM_PARAMETER_TYPE_F32, 4, count)
@@ -2863,6 +3969,7 @@ inline void glUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpos
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_FLOAT_MAT2, count, transpose, value, 4 * sizeof(GLfloat))
 
 	// Setting passed value to desired uniform
 	if (transpose) {
@@ -2889,6 +3996,7 @@ inline void glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpos
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_FLOAT_MAT3, count, transpose, value, 9 * sizeof(GLfloat))
 
 	// Setting passed value to desired uniform
 	if (transpose) {
@@ -2916,6 +4024,7 @@ inline void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpos
 	// Grabbing passed uniform
 	int offs = 0;
 	uniform *u = (uniform *)get_uniform_from_ptr(location, &offs);
+	capture_uniform_call(GL_FLOAT_MAT4, count, transpose, value, 16 * sizeof(GLfloat))
 
 	// Setting passed value to desired uniform
 	if (transpose) {
@@ -3235,12 +4344,15 @@ void glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
 
 void glBindAttribLocation(GLuint prog, GLuint index, const GLchar *name) {
 	THREAD_SAFE()
+	CAPTURE_OBJECT(capture_program, prog)
+	CAPTURE_CALL_WITH_DATA(CAPTURE_BIND_ATTRIB_LOCATION, name, strlen(name) + 1, prog, index)
 
 	// Grabbing passed program
 	program *p = &progs[prog - 1];
+	sync_program(p, prog);
 	
-	// If we use VGL_MODE_POSTPONED, we perform attributes binding in glLinkProgram
-	if (glsl_sema_mode == VGL_MODE_POSTPONED && p->vshader->is_glsl) {
+	// If we use VGL_MODE_POSTPONED or the vertex shader is still being compiled, we perform attributes binding in glLinkProgram
+	if ((glsl_sema_mode == VGL_MODE_POSTPONED && p->vshader->is_glsl) || p->deferred_binds) {
 		if (!p->glsl_attr_map)
 			p->glsl_attr_map = vglMalloc(sizeof(attr_mapping) * VERTEX_ATTRIBS_NUM);
 		p->glsl_attr_map[p->num_glsl_attr].idx = index;
@@ -3248,28 +4360,13 @@ void glBindAttribLocation(GLuint prog, GLuint index, const GLchar *name) {
 		return;
 	}
 
-	// Looking for desired parameter in requested program
-	const SceGxmProgramParameter *param = sceGxmProgramFindParameterByName(p->vshader->prog, name);
-	if (param == NULL || sceGxmProgramParameterGetCategory(param) != SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE)
-		return;
-	uint32_t attr_index = sceGxmProgramParameterGetResourceIndex(param);
-	
-	// Swapping any previously made bind to the requested attribute
-	for (int i = 0; i < p->attr_highest_idx; i++) {
-		if (p->attr[i].regIndex == attr_index) {
-			p->attr[i].regIndex = p->attr[index].regIndex;
-			break;
-		}
-	}
-	
-	// Set new binding to the requested attribute
-	p->attr[index].regIndex = attr_index;
-	if (p->attr_highest_idx <= index)
-		p->attr_highest_idx = index + 1;
+	sync_shader(p->vshader);
+	bind_attrib_location(p, index, name);
 }
 
 GLint glGetAttribLocation(GLuint prog, const GLchar *name) {
 	program *p = &progs[prog - 1];
+	sync_program(p, prog);
 	const SceGxmProgramParameter *param = sceGxmProgramFindParameterByName(p->vshader->prog, name);
 	if (param == NULL || sceGxmProgramParameterGetCategory(param) != SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE)
 		return -1;
@@ -3295,6 +4392,7 @@ void glGetActiveAttrib(GLuint prog, GLuint index, GLsizei bufSize, GLsizei *leng
 
 	// Grabbing passed program
 	program *p = &progs[prog - 1];
+	sync_program(p, prog);
 
 	int i, cnt = sceGxmProgramGetParameterCount(p->vshader->prog);
 	uint32_t *ptr = vglProgramGetParameterBase(p->vshader->prog);
@@ -3323,6 +4421,7 @@ void glGetActiveUniform(GLuint prog, GLuint index, GLsizei bufSize, GLsizei *len
 
 	// Grabbing passed program
 	program *p = &progs[prog - 1];
+	sync_program(p, prog);
 
 #ifndef SKIP_ERROR_HANDLING
 	if (bufSize < 0 || (index >= p->vert_uniforms_num + p->frag_uniforms_num)) {
@@ -3404,6 +4503,7 @@ void vglBindAttribLocation(GLuint prog, GLuint index, const GLchar *name, const
 #ifdef ENABLE_LEGACY_PIPELINE
 	// Grabbing passed program
 	program *p = &progs[prog - 1];
+	sync_program(p, prog);
 	SceGxmVertexAttribute *attributes = &p->attr[index];
 	SceGxmVertexStream *streams = &p->stream[index];
 
@@ -3449,6 +4549,7 @@ GLint vglBindPackedAttribLocation(GLuint prog, const GLchar *name, const GLuint
 #ifdef ENABLE_LEGACY_PIPELINE
 	// Grabbing passed program
 	program *p = &progs[prog - 1];
+	sync_program(p, prog);
 	SceGxmVertexAttribute *attributes = &p->attr[p->attr_idx];
 	SceGxmVertexStream *streams = &p->stream[0];
 
@@ -3547,6 +4648,16 @@ void vglVertexAttribPointerMapped(GLuint index, const GLvoid *pointer) {
 #endif
 }
 
+void vglMatrixPaletteUniform(GLuint prog, GLint location) {
+	THREAD_SAFE()
+
+	// Grabbing passed program
+	program *p = &progs[prog - 1];
+	sync_program(p, prog);
+
+	p->palette_unif = location == -1 ? 0 : location;
+}
+
 void vglGetShaderBinary(GLuint handle, GLsizei bufSize, GLsizei *length, void *binary) {
 	THREAD_SAFE()
 
@@ -3558,6 +4669,7 @@ void vglGetShaderBinary(GLuint handle, GLsizei bufSize, GLsizei *length, void *b
 
 	// Grabbing passed shader
 	shader *s = &shaders[handle - 1];
+	sync_shader(s);
 
 #ifndef SKIP_ERROR_HANDLING
 	if (s->prog == NULL) {
@@ -3572,38 +4684,25 @@ void vglGetShaderBinary(GLuint handle, GLsizei bufSize, GLsizei *length, void *b
 void vglAddSemanticBinding(const GLchar *const *varying, GLint index, GLenum type) {
 	THREAD_SAFE()
 
-#ifndef SKIP_ERROR_HANDLING
-	if (glsl_custom_bindings_num >= MAX_CUSTOM_BINDINGS) {
-		vgl_log("%s:%d %s: Too many custom bindings supplied. Consider increasing MAX_CUSTOM_BINDINGS.\n", __FILE__, __LINE__, __func__);
-		return;
-	}			
-#endif
-	strcpy(glsl_custom_bindings[glsl_custom_bindings_num].name, varying);
-	glsl_custom_bindings[glsl_custom_bindings_num].idx = index;
-	glsl_custom_bindings[glsl_custom_bindings_num].type = type;
-	glsl_custom_bindings[glsl_custom_bindings_num++].ref_idx = glsl_current_ref_idx;
+	// GLSL translation state can't change while background compilation jobs are running
+	finish_shader_jobs();
+	glsl_add_custom_binding((const char *)varying, index, type);
 }
 
 void vglAddSemanticBindingHint(const GLchar *const *varying, GLenum type) {
 	THREAD_SAFE()
 
-#ifndef SKIP_ERROR_HANDLING
-	if (glsl_custom_bindings_num >= MAX_CUSTOM_BINDINGS) {
-		vgl_log("%s:%d %s: Too many custom bindings supplied. Consider increasing MAX_CUSTOM_BINDINGS.\n", __FILE__, __LINE__, __func__);
-		return;
-	}			
-#endif
-	strcpy(glsl_custom_bindings[glsl_custom_bindings_num].name, varying);
-	glsl_custom_bindings[glsl_custom_bindings_num].idx = -1;
-	glsl_custom_bindings[glsl_custom_bindings_num].type = type;
-	glsl_custom_bindings[glsl_custom_bindings_num++].ref_idx = glsl_current_ref_idx;
+	finish_shader_jobs();
+	glsl_add_custom_binding((const char *)varying, -1, type);
 }
 
 void vglUseLowPrecision(GLboolean val) {
+	finish_shader_jobs();
 	glsl_precision_low = val;
 }
 
 void vglSetSemanticBindingMode(GLenum mode) {
+	finish_shader_jobs();
 	glsl_sema_mode = mode;
 }
 
@@ -3627,10 +4726,14 @@ void vglShaderGxpBinary(GLsizei count, const GLuint *handles, const void *binary
 
 	// Grabbing passed shader
 	shader *s = &shaders[handles[0] - 1];
+	sync_shader(s);
 	
 	s->size = length;
 	s->prog = (SceGxmProgram *)vglMalloc(s->size);
 	vgl_fast_memcpy((SceGxmProgram *)s->prog, binary, s->size);
-	sceGxmShaderPatcherRegisterProgram(gxm_shader_patcher, s->prog, &s->id);
 	s->unif_buf_size = sceGxmProgramGetDefaultUniformBufferSize(s->prog);
+	lock_shader_compiler()
+	share_shader_bin(s, 0);
+	unlock_shader_compiler()
+	register_shader(s);
 }
@@ -23,11 +23,11 @@
 
 #include "shared.h"
 
-#ifdef HAVE_DLISTS
-#define NUM_DISPLAY_LISTS 512
-#else
-#define NUM_DISPLAY_LISTS 1 // Save on memory usage if display lists are disabled
-#endif
+#define DLIST_CHUNK_SHIFT 8
+#define DLIST_CHUNK_SIZE (1 << DLIST_CHUNK_SHIFT) // Number of display lists allocated at once
+#define DLIST_INITIAL_SIZE 256 // Initial size of a display list commands stream
+#define DLIST_BAKE_MAX_MISSES 4 // Maximum number of times a glBegin/glEnd block gets baked again due to a state change
+#define dlist_cmd_size(type) ((sizeof(dlist_cmd) + get_dlist_args_size(type) + 3) & ~3) // Commands are kept 4 bytes aligned
 
 #define call_full_list(t) \
 	for (i = 0; i < n; i++) { \
@@ -39,11 +39,251 @@
 
 display_list *curr_display_list = NULL;
 GLboolean display_list_execute;
-display_list display_lists[NUM_DISPLAY_LISTS];
 static uint32_t dlist_offs = 0;
 
-void resetDlists() {
-	vgl_memset(&display_lists[0], 0, sizeof(display_list) * NUM_DISPLAY_LISTS);
+// Display lists are stored in fixed size chunks so that their addresses never change when the namespace grows
+static display_list **dlist_chunks = NULL;
+static uint32_t dlist_chunks_num = 0;
+
+// Free display list names are tracked as a sorted array of ranges plus the first never allocated name
+typedef struct {
+	GLuint first;
+	GLuint count;
+} dlist_range;
+static dlist_range *dlist_free_ranges = NULL;
+static uint32_t dlist_free_ranges_num = 0;
+static uint32_t dlist_free_ranges_size = 0;
+static GLuint dlist_top = 1;
+
+static inline __attribute__((always_inline)) display_list *get_dlist(GLuint name) {
+	if (name == 0 || name >= dlist_top)
+		return NULL;
+	name--;
+	return &dlist_chunks[name >> DLIST_CHUNK_SHIFT][name & (DLIST_CHUNK_SIZE - 1)];
+}
+
+static GLboolean grow_dlists(GLuint top) {
+	uint32_t chunks_num = (top - 1 + DLIST_CHUNK_SIZE - 1) >> DLIST_CHUNK_SHIFT;
+	if (chunks_num > dlist_chunks_num) {
+		display_list **chunks = (display_list **)vglRealloc(dlist_chunks, sizeof(display_list *) * chunks_num);
+		if (!chunks)
+			return GL_FALSE;
+		dlist_chunks = chunks;
+		while (dlist_chunks_num < chunks_num) {
+			display_list *chunk = (display_list *)vglCalloc(DLIST_CHUNK_SIZE, sizeof(display_list));
+			if (!chunk)
+				return GL_FALSE;
+			dlist_chunks[dlist_chunks_num++] = chunk;
+		}
+	}
+	dlist_top = top;
+	return GL_TRUE;
+}
+
+static GLboolean insert_dlist_range(uint32_t idx, GLuint first, GLuint count) {
+	if (dlist_free_ranges_num == dlist_free_ranges_size) {
+		uint32_t size = dlist_free_ranges_size ? dlist_free_ranges_size * 2 : 16;
+		dlist_range *ranges = (dlist_range *)vglRealloc(dlist_free_ranges, sizeof(dlist_range) * size);
+		if (!ranges)
+			return GL_FALSE;
+		dlist_free_ranges = ranges;
+		dlist_free_ranges_size = size;
+	}
+	vgl_memmove(&dlist_free_ranges[idx + 1], &dlist_free_ranges[idx], sizeof(dlist_range) * (dlist_free_ranges_num - idx));
+	dlist_free_ranges[idx].first = first;
+	dlist_free_ranges[idx].count = count;
+	dlist_free_ranges_num++;
+	return GL_TRUE;
+}
+
+static inline __attribute__((always_inline)) void remove_dlist_range(uint32_t idx) {
+	dlist_free_ranges_num--;
+	vgl_memmove(&dlist_free_ranges[idx], &dlist_free_ranges[idx + 1], sizeof(dlist_range) * (dlist_free_ranges_num - idx));
+}
+
+static GLuint alloc_dlist_range(GLuint count) {
+	// First fit among the ranges freed by glDeleteLists
+	for (uint32_t i = 0; i < dlist_free_ranges_num; i++) {
+		dlist_range *r = &dlist_free_ranges[i];
+		if (r->count >= count) {
+			GLuint first = r->first;
+			r->first += count;
+			r->count -= count;
+			if (!r->count)
+				remove_dlist_range(i);
+			return first;
+		}
+	}
+
+	// Growing the namespace, the last free range is never adjacent to the top so it can't be merged
+	GLuint first = dlist_top;
+	if (first + count < first || !grow_dlists(first + count))
+		return 0;
+	return first;
+}
+
+static void free_dlist_range(GLuint first, GLuint count) {
+	// Finding the first range placed after the freed one
+	uint32_t lo = 0, hi = dlist_free_ranges_num;
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) >> 1;
+		if (dlist_free_ranges[mid].first < first)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	// Merging with adjacent ranges
+	if (lo > 0 && dlist_free_ranges[lo - 1].first + dlist_free_ranges[lo - 1].count == first) {
+		lo--;
+		first = dlist_free_ranges[lo].first;
+		count += dlist_free_ranges[lo].count;
+		remove_dlist_range(lo);
+	}
+	if (lo < dlist_free_ranges_num && first + count == dlist_free_ranges[lo].first) {
+		count += dlist_free_ranges[lo].count;
+		remove_dlist_range(lo);
+	}
+
+	// Ranges touching the top are given back to the never allocated names
+	if (first + count == dlist_top) {
+		dlist_top = first;
+		return;
+	}
+	insert_dlist_range(lo, first, count);
+}
+
+static GLboolean claim_dlist(GLuint name) {
+	if (name >= dlist_top) {
+		GLuint top = dlist_top;
+		if (name + 1 == 0 || !grow_dlists(name + 1))
+			return GL_FALSE;
+		if (name > top && !insert_dlist_range(dlist_free_ranges_num, top, name - top)) {
+			// Skipped names couldn't be tracked as free, giving them back to the never allocated ones
+			dlist_top = top;
+			return GL_FALSE;
+		}
+		return GL_TRUE;
+	}
+
+	// Removing the name from the free range containing it
+	for (uint32_t i = 0; i < dlist_free_ranges_num; i++) {
+		dlist_range *r = &dlist_free_ranges[i];
+		if (name >= r->first && name < r->first + r->count) {
+			GLuint tail = r->first + r->count - (name + 1);
+			r->count = name - r->first;
+			if (!r->count) {
+				if (tail) {
+					r->first = name + 1;
+					r->count = tail;
+				} else
+					remove_dlist_range(i);
+			} else if (tail && !insert_dlist_range(i + 1, name + 1, tail)) {
+				// Range couldn't be split, restoring it whole
+				r->count += 1 + tail;
+				return GL_FALSE;
+			}
+			break;
+		}
+	}
+	return GL_TRUE;
+}
+
+#ifdef HAVE_DLISTS
+// Functions allowed inside a glBegin/glEnd block for it to be baked
+static void (*const bakeable_funcs[])() = {
+	(void (*)())glColor3f,
+	(void (*)())glColor3fv,
+	(void (*)())glColor3ub,
+	(void (*)())glColor3ubv,
+	(void (*)())glColor4f,
+	(void (*)())glColor4fv,
+	(void (*)())glColor4ub,
+	(void (*)())glColor4ubv,
+	(void (*)())glColor4x,
+	(void (*)())glMultiTexCoord2f,
+	(void (*)())glNormal3f,
+	(void (*)())glNormal3fv,
+	(void (*)())glTexCoord2f,
+	(void (*)())glVertex3f,
+};
+
+static inline __attribute__((always_inline)) GLboolean is_bakeable_func(void (*func)()) {
+	for (int i = 0; i < sizeof(bakeable_funcs) / sizeof(*bakeable_funcs); i++) {
+		if (bakeable_funcs[i] == func)
+			return GL_TRUE;
+	}
+	return GL_FALSE;
+}
+
+// Locates glBegin/glEnd blocks of a display list made only of vertex attributes calls
+static void find_dlist_runs(display_list *l) {
+	uint32_t offs = 0, begin = 0;
+	GLboolean in_run = GL_FALSE;
+	while (offs < l->size) {
+		dlist_cmd *c = (dlist_cmd *)(l->code + offs);
+		if (c->func == (void (*)())glBegin) {
+			in_run = GL_TRUE;
+			begin = offs;
+		} else if (in_run) {
+			if (c->func == (void (*)())glEnd) {
+				l->runs = (dlist_run *)vglRealloc(l->runs, sizeof(dlist_run) * (l->runs_num + 1));
+				dlist_run *r = &l->runs[l->runs_num++];
+				r->begin = begin;
+				r->end_call = offs;
+				r->end = offs + c->size;
+				r->misses = 0;
+				r->geom.verts = NULL;
+				in_run = GL_FALSE;
+			} else if (!is_bakeable_func(c->func)) {
+				in_run = GL_FALSE;
+			}
+		}
+		offs += c->size;
+	}
+}
+
+static void free_dlist_runs(display_list *l) {
+	for (uint32_t i = 0; i < l->runs_num; i++) {
+		ffp_free_baked_geometry(&l->runs[i].geom);
+	}
+	if (l->runs) {
+		vglFree(l->runs);
+		l->runs = NULL;
+	}
+	l->runs_num = 0;
+}
+#endif
+
+void reset_dlists() {
+	for (uint32_t i = 0; i < dlist_chunks_num; i++) {
+		vgl_memset(dlist_chunks[i], 0, sizeof(display_list) * DLIST_CHUNK_SIZE);
+	}
+	dlist_free_ranges_num = 0;
+	dlist_top = 1;
+}
+
+static inline __attribute__((always_inline)) uint32_t get_dlist_args_size(dlist_func_type type) {
+	uint32_t size = 0;
+	while (type) {
+		switch ((uint8_t)type) {
+		case DLIST_ARG_U32:
+		case DLIST_ARG_I32:
+		case DLIST_ARG_F32:
+			size += 4;
+			break;
+		case DLIST_ARG_I16:
+			size += 2;
+			break;
+		case DLIST_ARG_U8:
+			size += 1;
+			break;
+		default:
+			break;
+		}
+		type >>= 8;
+	}
+	return size;
 }
 
 GLboolean _vgl_enqueue_list_func(void (*func)(), dlist_func_type type, ...) {
@@ -51,19 +291,25 @@ GLboolean _vgl_enqueue_list_func(void (*func)(), dlist_func_type type, ...) {
 	if (!curr_display_list)
 		return GL_FALSE;
 
-	// Enqueuing function call
-	list_chain *new_tail = (list_chain *)vglMalloc(sizeof(list_chain));
-	if (curr_display_list->tail)
-		curr_display_list->tail->next = new_tail;
-	curr_display_list->tail = new_tail;
-	if (!curr_display_list->head)
-		curr_display_list->head = new_tail;
-	new_tail->func = func;
-	new_tail->next = NULL;
-	new_tail->type = type;
+	// Reserving space for the function call in the commands stream
+	uint32_t size = dlist_cmd_size(type);
+	if (curr_display_list->size + size > curr_display_list->capacity) {
+		uint32_t capacity = curr_display_list->capacity ? curr_display_list->capacity * 2 : DLIST_INITIAL_SIZE;
+		while (curr_display_list->size + size > capacity) {
+			capacity *= 2;
+		}
+		curr_display_list->code = (uint8_t *)vglRealloc(curr_display_list->code, capacity);
+		curr_display_list->capacity = capacity;
+	}
+	dlist_cmd *cmd = (dlist_cmd *)(curr_display_list->code + curr_display_list->size);
+	curr_display_list->size += size;
+	cmd->func = func;
+	cmd->type = type;
+	cmd->size = size;
 
 	// Recording function arguments
 	if (type) {
+		uint8_t *args = (uint8_t *)cmd + sizeof(dlist_cmd);
 		int i = 0;
 		va_list arglist;
 		va_start(arglist, type);
@@ -77,27 +323,27 @@ GLboolean _vgl_enqueue_list_func(void (*func)(), dlist_func_type type, ...) {
 			switch (arg_type) {
 			case DLIST_ARG_U32:
 				uarg = va_arg(arglist, uint32_t);
-				vgl_fast_memcpy(&new_tail->args[i], &uarg, sizeof(uarg));
+				vgl_fast_memcpy(&args[i], &uarg, sizeof(uarg));
 				i += sizeof(uarg);
 				break;
 			case DLIST_ARG_I32:
 				iarg = va_arg(arglist, int32_t);
-				vgl_fast_memcpy(&new_tail->args[i], &iarg, sizeof(iarg));
+				vgl_fast_memcpy(&args[i], &iarg, sizeof(iarg));
 				i += sizeof(iarg);
 				break;
 			case DLIST_ARG_F32:
 				farg = (float)va_arg(arglist, double);
-				vgl_fast_memcpy(&new_tail->args[i], &farg, sizeof(farg));
+				vgl_fast_memcpy(&args[i], &farg, sizeof(farg));
 				i += sizeof(farg);
 				break;
 			case DLIST_ARG_I16:
 				sarg = (int16_t)va_arg(arglist, int);
-				vgl_fast_memcpy(&new_tail->args[i], &sarg, sizeof(sarg));
+				vgl_fast_memcpy(&args[i], &sarg, sizeof(sarg));
 				i += sizeof(sarg);
 				break;
 			case DLIST_ARG_U8:
 				suarg = (uint8_t)va_arg(arglist, int);
-				vgl_fast_memcpy(&new_tail->args[i], &suarg, sizeof(suarg));
+				vgl_fast_memcpy(&args[i], &suarg, sizeof(suarg));
 				i += sizeof(suarg);
 				break;
 			case DLIST_ARG_VOID:
@@ -119,7 +365,9 @@ void glListBase(GLuint base) {
 void glCallList(GLuint list) {
 	THREAD_SAFE()
 
-	list_chain *l = display_lists[list + dlist_offs - 1].head;
+	display_list *dl = get_dlist(list + dlist_offs);
+	if (!dl)
+		return;
 #ifdef DEBUG_DLISTS
 	vgl_log("%s:%d %s: Executing display list %d (Offset: %d)\n", __FILE__, __LINE__, __func__, list + dlist_offs, dlist_offs);
 #endif
@@ -148,178 +396,216 @@ void glCallList(GLuint list) {
 	void (*f_f32_f32_f32_f32)(float, float, float, float); // DLIST_FUNC_F32_F32_F32_F32
 	void (*f_u8_u8_u8_u8)(uint8_t, uint8_t, uint8_t, uint8_t); // DLIST_FUNC_U8_U8_U8_U8
 	
-	while (l) {
-		switch (l->type) {
+#ifdef HAVE_DLISTS
+	// glBegin/glEnd blocks are drawn from their baked vertices when possible, baking is not performed while compiling a list
+	dlist_run *run = dl->runs;
+	dlist_run *runs_end = curr_display_list ? run : run + dl->runs_num;
+	dlist_run *baking = NULL;
+	float *baking_verts = NULL;
+	legacy_vtx_attachment baking_vtx;
+#endif
+
+	// Commands are addressed by offset since the list may grow while being executed
+	uint32_t size = dl->size;
+	uint32_t offs = 0;
+	while (offs < size) {
+#ifdef HAVE_DLISTS
+		if (run < runs_end && offs == run->begin) {
+			if (run->geom.verts && ffp_draw_baked_geometry(&run->geom)) {
+				offs = run->end;
+				run++;
+				continue;
+			}
+			if (run->misses < DLIST_BAKE_MAX_MISSES) {
+				if (run->geom.verts)
+					run->misses++;
+				baking = run;
+				vgl_fast_memcpy(&baking_vtx, &current_vtx, sizeof(legacy_vtx_attachment));
+			}
+			run++;
+		}
+		if (baking && offs == baking->end_call)
+			baking_verts = legacy_pool;
+#endif
+		dlist_cmd *c = (dlist_cmd *)(dl->code + offs);
+		uint8_t *args = (uint8_t *)c + sizeof(dlist_cmd);
+		offs += c->size;
+		switch (c->type) {
 		// No arguments
 		case DLIST_FUNC_VOID:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s()\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func));
+			vgl_log("%s:%d %s: %s()\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func));
 #endif
-			f_void = l->func;
+			f_void = c->func;
 			f_void();
 			break;
 		// 1 argument
 		case DLIST_FUNC_U32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args));
+			vgl_log("%s:%d %s: %s(%u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args));
 #endif		
-			f_u32 = l->func;
-			f_u32(*(uint32_t *)(l->args));
+			f_u32 = c->func;
+			f_u32(*(uint32_t *)(args));
 			break;
 		// 2 arguments
 		case DLIST_FUNC_U32_U32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args), *(uint32_t *)(&l->args[4]));
+			vgl_log("%s:%d %s: %s(%u, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args), *(uint32_t *)(&args[4]));
 #endif	
-			f_u32_u32 = l->func;
-			f_u32_u32(*(uint32_t *)(l->args), *(uint32_t *)(&l->args[4]));
+			f_u32_u32 = c->func;
+			f_u32_u32(*(uint32_t *)(args), *(uint32_t *)(&args[4]));
 			break;
 		case DLIST_FUNC_U32_I32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u, %d)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args), *(int32_t *)(&l->args[4]));
+			vgl_log("%s:%d %s: %s(%u, %d)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args), *(int32_t *)(&args[4]));
 #endif
-			f_u32_i32 = l->func;
-			f_u32_i32(*(uint32_t *)(l->args), *(int32_t *)(&l->args[4]));
+			f_u32_i32 = c->func;
+			f_u32_i32(*(uint32_t *)(args), *(int32_t *)(&args[4]));
 			break;
 		case DLIST_FUNC_I32_I32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%i, %i)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(int32_t *)(l->args), *(int32_t *)(&l->args[4]));
+			vgl_log("%s:%d %s: %s(%i, %i)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(int32_t *)(args), *(int32_t *)(&args[4]));
 #endif
-			f_i32_i32 = l->func;
-			f_i32_i32(*(int32_t *)(l->args), *(int32_t *)(&l->args[4]));
+			f_i32_i32 = c->func;
+			f_i32_i32(*(int32_t *)(args), *(int32_t *)(&args[4]));
 			break;
 		case DLIST_FUNC_U32_F32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args), *(float *)(&l->args[4]));
+			vgl_log("%s:%d %s: %s(%u, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args), *(float *)(&args[4]));
 #endif
-			f_u32_f32 = l->func;
-			f_u32_f32(*(uint32_t *)(l->args), *(float *)(&l->args[4]));
+			f_u32_f32 = c->func;
+			f_u32_f32(*(uint32_t *)(args), *(float *)(&args[4]));
 			break;
 		case DLIST_FUNC_F32_F32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%f, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(float *)(l->args), *(float *)(&l->args[4]));
+			vgl_log("%s:%d %s: %s(%f, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(float *)(args), *(float *)(&args[4]));
 #endif
-			f_f32_f32 = l->func;
-			f_f32_f32(*(float *)(l->args), *(float *)(&l->args[4]));
+			f_f32_f32 = c->func;
+			f_f32_f32(*(float *)(args), *(float *)(&args[4]));
 			break;
 		// 3 arguments
 		case DLIST_FUNC_I32_I32_I32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%d, %d, %d)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(int32_t *)(l->args), *(int32_t *)(&l->args[4]), *(int32_t *)(&l->args[8]));
+			vgl_log("%s:%d %s: %s(%d, %d, %d)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(int32_t *)(args), *(int32_t *)(&args[4]), *(int32_t *)(&args[8]));
 #endif
-			f_i32_i32_i32 = l->func;
-			f_i32_i32_i32(*(int32_t *)(l->args), *(int32_t *)(&l->args[4]), *(int32_t *)(&l->args[8]));
+			f_i32_i32_i32 = c->func;
+			f_i32_i32_i32(*(int32_t *)(args), *(int32_t *)(&args[4]), *(int32_t *)(&args[8]));
 			break;
 		case DLIST_FUNC_U32_I32_I32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u, %d, %d)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args), *(int32_t *)(&l->args[4]), *(int32_t *)(&l->args[8]));
+			vgl_log("%s:%d %s: %s(%u, %d, %d)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args), *(int32_t *)(&args[4]), *(int32_t *)(&args[8]));
 #endif
-			f_u32_i32_i32 = l->func;
-			f_u32_i32_i32(*(uint32_t *)(l->args), *(int32_t *)(&l->args[4]), *(int32_t *)(&l->args[8]));
+			f_u32_i32_i32 = c->func;
+			f_u32_i32_i32(*(uint32_t *)(args), *(int32_t *)(&args[4]), *(int32_t *)(&args[8]));
 			break;
 		case DLIST_FUNC_U32_I32_U32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u, %d, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args), *(int32_t *)(&l->args[4]), *(uint32_t *)(&l->args[8]));
+			vgl_log("%s:%d %s: %s(%u, %d, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args), *(int32_t *)(&args[4]), *(uint32_t *)(&args[8]));
 #endif
-			f_u32_i32_u32 = l->func;
-			f_u32_i32_u32(*(uint32_t *)(l->args), *(int32_t *)(&l->args[4]), *(uint32_t *)(&l->args[8]));
+			f_u32_i32_u32 = c->func;
+			f_u32_i32_u32(*(uint32_t *)(args), *(int32_t *)(&args[4]), *(uint32_t *)(&args[8]));
 			break;
 		case DLIST_FUNC_U32_U32_U32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u, %u, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args), *(uint32_t *)(&l->args[4]), *(uint32_t *)(&l->args[8]));
+			vgl_log("%s:%d %s: %s(%u, %u, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args), *(uint32_t *)(&args[4]), *(uint32_t *)(&args[8]));
 #endif
-			f_u32_u32_u32 = l->func;
-			f_u32_u32_u32(*(uint32_t *)(l->args), *(uint32_t *)(&l->args[4]), *(uint32_t *)(&l->args[8]));
+			f_u32_u32_u32 = c->func;
+			f_u32_u32_u32(*(uint32_t *)(args), *(uint32_t *)(&args[4]), *(uint32_t *)(&args[8]));
 			break;
 		case DLIST_FUNC_U32_U32_I32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u, %u, %d)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args), *(uint32_t *)(&l->args[4]), *(int32_t *)(&l->args[8]));
+			vgl_log("%s:%d %s: %s(%u, %u, %d)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args), *(uint32_t *)(&args[4]), *(int32_t *)(&args[8]));
 #endif
-			f_u32_u32_i32 = l->func;
-			f_u32_u32_i32(*(uint32_t *)(l->args), *(uint32_t *)(&l->args[4]), *(int32_t *)(&l->args[8]));
+			f_u32_u32_i32 = c->func;
+			f_u32_u32_i32(*(uint32_t *)(args), *(uint32_t *)(&args[4]), *(int32_t *)(&args[8]));
 			break;
 		case DLIST_FUNC_U8_U8_U8:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%hhu, %hhu, %hhu)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint8_t *)(l->args), *(uint8_t *)(&l->args[1]), *(uint8_t *)(&l->args[2]));
+			vgl_log("%s:%d %s: %s(%hhu, %hhu, %hhu)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint8_t *)(args), *(uint8_t *)(&args[1]), *(uint8_t *)(&args[2]));
 #endif
-			f_u8_u8_u8 = l->func;
-			f_u8_u8_u8(*(uint8_t *)(l->args), *(uint8_t *)(&l->args[1]), *(uint8_t *)(&l->args[2]));
+			f_u8_u8_u8 = c->func;
+			f_u8_u8_u8(*(uint8_t *)(args), *(uint8_t *)(&args[1]), *(uint8_t *)(&args[2]));
 			break;
 		case DLIST_FUNC_I16_I16_I16:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%hd, %hd, %hd)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(int16_t *)(l->args), *(int16_t *)(&l->args[2]), *(int16_t *)(&l->args[4]));
+			vgl_log("%s:%d %s: %s(%hd, %hd, %hd)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(int16_t *)(args), *(int16_t *)(&args[2]), *(int16_t *)(&args[4]));
 #endif
-			f_i16_i16_i16 = l->func;
-			f_i16_i16_i16(*(int16_t *)(l->args), *(int16_t *)(&l->args[2]), *(int16_t *)(&l->args[4]));
+			f_i16_i16_i16 = c->func;
+			f_i16_i16_i16(*(int16_t *)(args), *(int16_t *)(&args[2]), *(int16_t *)(&args[4]));
 			break;
 		case DLIST_FUNC_U32_F32_F32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u, %f, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args), *(float *)(&l->args[4]), *(float *)(&l->args[8]));
+			vgl_log("%s:%d %s: %s(%u, %f, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args), *(float *)(&args[4]), *(float *)(&args[8]));
 #endif
-			f_u32_f32_f32 = l->func;
-			f_u32_f32_f32(*(uint32_t *)(l->args), *(float *)(&l->args[4]), *(float *)(&l->args[8]));
+			f_u32_f32_f32 = c->func;
+			f_u32_f32_f32(*(uint32_t *)(args), *(float *)(&args[4]), *(float *)(&args[8]));
 			break;
 		case DLIST_FUNC_U32_U32_F32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u, %u, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args), *(uint32_t *)(&l->args[4]), *(float *)(&l->args[8]));
+			vgl_log("%s:%d %s: %s(%u, %u, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args), *(uint32_t *)(&args[4]), *(float *)(&args[8]));
 #endif
-			f_u32_u32_f32 = l->func;
-			f_u32_u32_f32(*(uint32_t *)(l->args), *(uint32_t *)(&l->args[4]), *(float *)(&l->args[8]));
+			f_u32_u32_f32 = c->func;
+			f_u32_u32_f32(*(uint32_t *)(args), *(uint32_t *)(&args[4]), *(float *)(&args[8]));
 			break;
 		case DLIST_FUNC_F32_F32_F32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%f, %f, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(float *)(l->args), *(float *)(&l->args[4]), *(float *)(&l->args[8]));
+			vgl_log("%s:%d %s: %s(%f, %f, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(float *)(args), *(float *)(&args[4]), *(float *)(&args[8]));
 #endif
-			f_f32_f32_f32 = l->func;
-			f_f32_f32_f32(*(float *)(l->args), *(float *)(&l->args[4]), *(float *)(&l->args[8]));
+			f_f32_f32_f32 = c->func;
+			f_f32_f32_f32(*(float *)(args), *(float *)(&args[4]), *(float *)(&args[8]));
 			break;
 		// 4 arguments
 		case DLIST_FUNC_U32_U32_U32_U32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u, %u, %u, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args), *(uint32_t *)(&l->args[4]), *(uint32_t *)(&l->args[8]), *(uint32_t *)(&l->args[12]));
+			vgl_log("%s:%d %s: %s(%u, %u, %u, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args), *(uint32_t *)(&args[4]), *(uint32_t *)(&args[8]), *(uint32_t *)(&args[12]));
 #endif
-			f_u32_u32_u32_u32 = l->func;
-			f_u32_u32_u32_u32(*(uint32_t *)(l->args), *(uint32_t *)(&l->args[4]), *(uint32_t *)(&l->args[8]), *(uint32_t *)(&l->args[12]));
+			f_u32_u32_u32_u32 = c->func;
+			f_u32_u32_u32_u32(*(uint32_t *)(args), *(uint32_t *)(&args[4]), *(uint32_t *)(&args[8]), *(uint32_t *)(&args[12]));
 			break;
 		case DLIST_FUNC_I32_I32_I32_I32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%d, %d, %d, %d)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(int32_t *)(l->args), *(int32_t *)(&l->args[4]), *(int32_t *)(&l->args[8]), *(int32_t *)(&l->args[12]));
+			vgl_log("%s:%d %s: %s(%d, %d, %d, %d)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(int32_t *)(args), *(int32_t *)(&args[4]), *(int32_t *)(&args[8]), *(int32_t *)(&args[12]));
 #endif
-			f_i32_i32_i32_i32 = l->func;
-			f_i32_i32_i32_i32(*(int32_t *)(l->args), *(int32_t *)(&l->args[4]), *(int32_t *)(&l->args[8]), *(int32_t *)(&l->args[12]));
+			f_i32_i32_i32_i32 = c->func;
+			f_i32_i32_i32_i32(*(int32_t *)(args), *(int32_t *)(&args[4]), *(int32_t *)(&args[8]), *(int32_t *)(&args[12]));
 			break;
 		case DLIST_FUNC_I32_U32_I32_U32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%d, %u, %d, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(int32_t *)(l->args), *(uint32_t *)(&l->args[4]), *(int32_t *)(&l->args[8]), *(uint32_t *)(&l->args[12]));
+			vgl_log("%s:%d %s: %s(%d, %u, %d, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(int32_t *)(args), *(uint32_t *)(&args[4]), *(int32_t *)(&args[8]), *(uint32_t *)(&args[12]));
 #endif
-			f_i32_u32_i32_u32 = l->func;
-			f_i32_u32_i32_u32(*(int32_t *)(l->args), *(uint32_t *)(&l->args[4]), *(int32_t *)(&l->args[8]), *(uint32_t *)(&l->args[12]));
+			f_i32_u32_i32_u32 = c->func;
+			f_i32_u32_i32_u32(*(int32_t *)(args), *(uint32_t *)(&args[4]), *(int32_t *)(&args[8]), *(uint32_t *)(&args[12]));
 			break;
 		case DLIST_FUNC_U32_I32_U32_U32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%u, %d, %u, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint32_t *)(l->args), *(int32_t *)(&l->args[4]), *(uint32_t *)(&l->args[8]), *(uint32_t *)(&l->args[12]));
+			vgl_log("%s:%d %s: %s(%u, %d, %u, %u)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint32_t *)(args), *(int32_t *)(&args[4]), *(uint32_t *)(&args[8]), *(uint32_t *)(&args[12]));
 #endif
-			f_u32_i32_u32_u32 = l->func;
-			f_u32_i32_u32_u32(*(uint32_t *)(l->args), *(int32_t *)(&l->args[4]), *(uint32_t *)(&l->args[8]), *(uint32_t *)(&l->args[12]));
+			f_u32_i32_u32_u32 = c->func;
+			f_u32_i32_u32_u32(*(uint32_t *)(args), *(int32_t *)(&args[4]), *(uint32_t *)(&args[8]), *(uint32_t *)(&args[12]));
 			break;
 		case DLIST_FUNC_F32_F32_F32_F32:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%f, %f, %f, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(float *)(l->args), *(float *)(&l->args[4]), *(float *)(&l->args[8]), *(float *)(&l->args[12]));
+			vgl_log("%s:%d %s: %s(%f, %f, %f, %f)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(float *)(args), *(float *)(&args[4]), *(float *)(&args[8]), *(float *)(&args[12]));
 #endif
-			f_f32_f32_f32_f32 = l->func;
-			f_f32_f32_f32_f32(*(float *)(l->args), *(float *)(&l->args[4]), *(float *)(&l->args[8]), *(float *)(&l->args[12]));
+			f_f32_f32_f32_f32 = c->func;
+			f_f32_f32_f32_f32(*(float *)(args), *(float *)(&args[4]), *(float *)(&args[8]), *(float *)(&args[12]));
 			break;
 		case DLIST_FUNC_U8_U8_U8_U8:
 #ifdef DEBUG_DLISTS
-			vgl_log("%s:%d %s: %s(%hhu, %hhu, %hhu, %hhu)\n", __FILE__, __LINE__, __func__, vglGetFuncName(l->func), *(uint8_t *)(l->args), *(uint8_t *)(&l->args[1]), *(uint8_t *)(&l->args[2]), *(uint8_t *)(&l->args[3]));
+			vgl_log("%s:%d %s: %s(%hhu, %hhu, %hhu, %hhu)\n", __FILE__, __LINE__, __func__, vglGetFuncName(c->func), *(uint8_t *)(args), *(uint8_t *)(&args[1]), *(uint8_t *)(&args[2]), *(uint8_t *)(&args[3]));
 #endif
-			f_u8_u8_u8_u8 = l->func;
-			f_u8_u8_u8_u8(*(uint8_t *)(l->args), *(uint8_t *)(&l->args[1]), *(uint8_t *)(&l->args[2]), *(uint8_t *)(&l->args[3]));
+			f_u8_u8_u8_u8 = c->func;
+			f_u8_u8_u8_u8(*(uint8_t *)(args), *(uint8_t *)(&args[1]), *(uint8_t *)(&args[2]), *(uint8_t *)(&args[3]));
 			break;
 		default:
 			break;
 		}
-		l = (list_chain *)l->next;
+#ifdef HAVE_DLISTS
+		if (baking && offs == baking->end) {
+			ffp_bake_geometry(&baking->geom, baking_verts, &baking_vtx);
+			baking = NULL;
+		}
+#endif
 	}
 }
 
@@ -369,13 +655,41 @@ void glNewList(GLuint list, GLenum mode) {
 		SET_GL_ERROR(GL_INVALID_OPERATION)
 	}
 #endif
-	curr_display_list = &display_lists[list - 1];
+	display_list *dl = get_dlist(list);
+	if (!dl || !dl->used) {
+		if (!claim_dlist(list)) {
+			SET_GL_ERROR(GL_OUT_OF_MEMORY)
+		}
+		dl = get_dlist(list);
+		dl->used = GL_TRUE;
+	}
+	curr_display_list = dl;
+	curr_display_list->size = 0;
+#ifdef HAVE_DLISTS
+	free_dlist_runs(curr_display_list);
+#endif
 	display_list_execute = mode == GL_COMPILE ? GL_FALSE : GL_TRUE;
 }
 
 void glEndList(void) {
 	THREAD_SAFE()
 
+	// Checked even with SKIP_ERROR_HANDLING since glNewList may have failed
+	if (!curr_display_list) {
+		SET_GL_ERROR(GL_INVALID_OPERATION)
+	}
+
+	// Trimming the commands stream to its final size
+	if (curr_display_list->size && curr_display_list->size < curr_display_list->capacity) {
+		uint8_t *code = (uint8_t *)vglRealloc(curr_display_list->code, curr_display_list->size);
+		if (code) {
+			curr_display_list->code = code;
+			curr_display_list->capacity = curr_display_list->size;
+		}
+	}
+#ifdef HAVE_DLISTS
+	find_dlist_runs(curr_display_list);
+#endif
 	curr_display_list = NULL;
 }
 
@@ -387,29 +701,14 @@ GLuint glGenLists(GLsizei range) {
 		SET_GL_ERROR_WITH_RET(GL_INVALID_OPERATION, 0)
 	}
 #endif
-	GLsizei r = range;
-	GLuint first = 0;
-	for (GLuint i = 0; i < NUM_DISPLAY_LISTS; i++) {
-		if (!display_lists[i].used) {
-			if (first == 0)
-				first = i + 1;
-			r--;
-		} else {
-			first = i + 1;
-			r = range;
-		}
-		if (!r)
-			break;
-	}
-#ifndef SKIP_ERROR_HANDLING
-	if (r) {
-		vgl_log("%s:%d glGenLists: Not enough display lists! Consider increasing the display lists maximum number...\n", __FILE__, __LINE__);
+	if (range == 0)
 		return 0;
+	GLuint first = alloc_dlist_range(range);
+	if (!first) {
+		SET_GL_ERROR_WITH_RET(GL_OUT_OF_MEMORY, 0)
 	}
-#endif
-	for (GLuint i = first - 1; i < first + range; i++) {
-		display_lists[i].used = GL_TRUE;
-		display_lists[i].head = display_lists[i].tail = NULL;
+	for (GLuint i = first; i < first + range; i++) {
+		get_dlist(i)->used = GL_TRUE;
 	}
 	return first;
 }
@@ -424,13 +723,27 @@ void glDeleteLists(GLuint list, GLsizei range) {
 		SET_GL_ERROR(GL_INVALID_OPERATION)
 	}
 #endif
-	for (GLuint i = list - 1; i < list + range; i++) {
-		list_chain *l = display_lists[i].head;
-		while (l) {
-			list_chain *old = l;
-			l = l->next;
-			vglFree(old);
+	GLuint freed_first = 0;
+	for (GLuint i = list; i < list + range; i++) {
+		display_list *dl = get_dlist(i);
+		if (dl && dl->used) {
+			if (dl->code) {
+				vglFree(dl->code);
+				dl->code = NULL;
+			}
+			dl->size = 0;
+			dl->capacity = 0;
+			dl->used = GL_FALSE;
+#ifdef HAVE_DLISTS
+			free_dlist_runs(dl);
+#endif
+			if (!freed_first)
+				freed_first = i;
+		} else if (freed_first) {
+			free_dlist_range(freed_first, i - freed_first);
+			freed_first = 0;
 		}
-		display_lists[i].used = GL_FALSE;
 	}
+	if (freed_first)
+		free_dlist_range(freed_first, list + range - freed_first);
 }
@@ -24,6 +24,102 @@
 #include "vitaGL.h"
 
 GLboolean prim_is_non_native = GL_FALSE; // Flag for when a primitive not supported natively by sceGxm is used
+const GLfloat *matrix_palette = NULL; // Model matrices of the draws of the vglMultiDrawArraysMatrices call being processed
+
+// Captures an indexed draw call storing its indices if they are provided from client memory
+#define capture_elements_call(call, vertices_num, count, type, gl_indices, ...) \
+	CAPTURE_DRAW_STATE(vertices_num) \
+	CAPTURE_CALL_WITH_DATA(call, cur_vao->index_array_unit ? NULL : (gl_indices), (count) * (type == GL_UNSIGNED_INT ? sizeof(uint32_t) : (type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint8_t))), __VA_ARGS__)
+
+#ifdef HAVE_FRAME_CAPTURE
+// Packs first and count arrays of a multi draw followed, if any, by its model matrices
+static const void *capture_multi_arrays_data(const GLint *first, const GLsizei *count, GLsizei drawcount, uint32_t *size) {
+	uint32_t arrays_size = drawcount * sizeof(GLint);
+	*size = arrays_size * 2 + (matrix_palette ? drawcount * 16 * sizeof(GLfloat) : 0);
+	uint8_t *data = (uint8_t *)capture_scratch(*size);
+	if (!data)
+		return NULL;
+	vgl_fast_memcpy(data, first, arrays_size);
+	vgl_fast_memcpy(data + arrays_size, count, arrays_size);
+	if (matrix_palette)
+		vgl_fast_memcpy(data + arrays_size * 2, matrix_palette, drawcount * 16 * sizeof(GLfloat));
+	return data;
+}
+
+// Returns the highest vertex referenced by the draws of a multi draw plus one
+static uint32_t capture_multi_elements_range(GLenum type, const GLsizei *counts, const void *const *indices, const GLint *bases, GLsizei drawcount) {
+	uint32_t highest = 0;
+	for (int j = 0; j < drawcount; j++) {
+		uint32_t last = counts[j] > 0 ? capture_indices_range(type, indices[j], counts[j]) + (bases ? bases[j] : 0) : 0;
+		if (last > highest)
+			highest = last;
+	}
+	return highest;
+}
+
+// Packs counts, base vertices and indices offsets of a multi draw followed, if provided from client memory, by its indices
+static const void *capture_multi_elements_data(GLenum type, const GLsizei *counts, const void *const *indices, const GLint *bases, GLsizei drawcount, uint32_t *size) {
+	uint32_t idx_size = type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	GLboolean is_client = cur_vao->index_array_unit == 0;
+	uint32_t header_size = drawcount * 3 * sizeof(uint32_t);
+	*size = header_size;
+	if (is_client) {
+		for (int j = 0; j < drawcount; j++) {
+			if (counts[j] > 0)
+				*size += counts[j] * idx_size;
+		}
+	}
+	uint32_t *data = (uint32_t *)capture_scratch(*size);
+	if (!data)
+		return NULL;
+	uint32_t offs = 0;
+	for (int j = 0; j < drawcount; j++) {
+		uint32_t len = counts[j] > 0 ? counts[j] * idx_size : 0;
+		data[j] = counts[j];
+		data[drawcount + j] = bases ? bases[j] : 0;
+		if (is_client) {
+			// Client indices offsets are relative to the indices following the draws entries
+			data[drawcount * 2 + j] = offs;
+			vgl_fast_memcpy((uint8_t *)data + header_size + offs, indices[j], len);
+			offs += len;
+		} else
+			data[drawcount * 2 + j] = (uint32_t)indices[j];
+	}
+	return data;
+}
+
+// Returns the highest vertex referenced by the commands of an indirect multi draw plus one
+static uint32_t capture_indirect_range(GLenum type, const void *indices, const vglDrawElementsIndirectCommand *cmds, GLsizei drawcount) {
+	uint32_t idx_size = type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	uint32_t highest = 0;
+	for (int j = 0; j < drawcount; j++) {
+		uint32_t last = cmds[j].count ? capture_indices_range(type, (const uint8_t *)indices + cmds[j].firstIndex * idx_size, cmds[j].count) + cmds[j].baseVertex : 0;
+		if (last > highest)
+			highest = last;
+	}
+	return highest;
+}
+
+// Packs the commands of an indirect multi draw followed, if provided from client memory, by the indices they reference
+static const void *capture_indirect_data(GLenum type, const void *indices, const vglDrawElementsIndirectCommand *cmds, GLsizei drawcount, uint32_t *size) {
+	uint32_t idx_size = type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	uint32_t cmds_size = drawcount * sizeof(vglDrawElementsIndirectCommand);
+	uint32_t idx_num = 0;
+	if (cur_vao->index_array_unit == 0) {
+		for (int j = 0; j < drawcount; j++) {
+			if (cmds[j].count && cmds[j].firstIndex + cmds[j].count > idx_num)
+				idx_num = cmds[j].firstIndex + cmds[j].count;
+		}
+	}
+	*size = cmds_size + idx_num * idx_size;
+	uint8_t *data = (uint8_t *)capture_scratch(*size);
+	if (!data)
+		return NULL;
+	vgl_fast_memcpy(data, cmds, cmds_size);
+	vgl_fast_memcpy(data + cmds_size, indices, idx_num * idx_size);
+	return data;
+}
+#endif
 
 #ifndef INDICES_DRAW_SPEEDHACK
 #define setup_elements_indices(type_t) \
@@ -32,6 +128,7 @@ GLboolean prim_is_non_native = GL_FALSE; // Flag for when a primitive not suppor
 		ptr = src; \
 		gpu_buf->last_frame = vgl_framecount; \
 	} else { \
+		PROFILER_SCOPE(PROF_INDEX_CONVERSION) \
 		switch (mode) { \
 		case GL_QUADS: \
 			ptr = gpu_alloc_mapped_temp(count * 3 * sizeof(type_t)); \
@@ -76,6 +173,7 @@ GLboolean prim_is_non_native = GL_FALSE; // Flag for when a primitive not suppor
 		ptr = src; \
 		gpu_buf->last_frame = vgl_framecount; \
 	} else { \
+		PROFILER_SCOPE(PROF_INDEX_CONVERSION) \
 		switch (mode) { \
 		case GL_QUADS: \
 			ptr = gpu_alloc_mapped_temp(count * 3 * sizeof(type_t)); \
@@ -167,6 +265,8 @@ void glDrawArrays(GLenum mode, GLint first, GLsizei count) {
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_VALUE, count)
 	}
 #endif
+	CAPTURE_DRAW_STATE(first + count)
+	CAPTURE_CALL(CAPTURE_DRAW_ARRAYS, mode, first, count, cur_program)
 	SceGxmPrimitiveType gxm_p;
 	gl_primitive_to_gxm(mode, gxm_p, count);
 	scene_reset();
@@ -224,9 +324,6 @@ void glMultiDrawArrays(GLenum mode, const GLint *first, const GLsizei *count, GL
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_VALUE, drawcount)
 	}
 #endif
-
-	scene_reset();
-	
 	GLint lowest = 0x7FFFFFFF;
 	GLsizei highest = 0, highest_count = 0;
 	for (int i = 0; i < drawcount; i++) {
@@ -238,6 +335,14 @@ void glMultiDrawArrays(GLenum mode, const GLint *first, const GLsizei *count, GL
 		if (count[i] > highest_count)
 			highest_count = count[i];
 	}
+	CAPTURE_DRAW_STATE(highest)
+#ifdef HAVE_FRAME_CAPTURE
+	uint32_t capture_size = 0;
+	const void *capture_data = vgl_capture_active ? capture_multi_arrays_data(first, count, drawcount, &capture_size) : NULL;
+#endif
+	CAPTURE_CALL_WITH_DATA(CAPTURE_MULTI_DRAW_ARRAYS, capture_data, capture_size, mode, drawcount, matrix_palette != NULL, cur_program)
+
+	scene_reset();
 	
 	SceGxmPrimitiveType gxm_p;
 	gl_primitive_to_gxm(mode, gxm_p, highest_count);
@@ -275,6 +380,15 @@ void glMultiDrawArrays(GLenum mode, const GLint *first, const GLsizei *count, GL
 	restore_polygon_mode(gxm_p);
 }
 
+void vglMultiDrawArraysMatrices(GLenum mode, const GLint *first, const GLsizei *count, const GLfloat *matrices, GLsizei drawcount) {
+	THREAD_SAFE()
+
+	// Draws are performed as a regular multi draw with per draw matrices uploaded by the draw implementations
+	matrix_palette = matrices;
+	glMultiDrawArrays(mode, first, count, drawcount);
+	matrix_palette = NULL;
+}
+
 void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei primcount) {
 	THREAD_SAFE()
 
@@ -287,6 +401,8 @@ void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei prim
 		SET_GL_ERROR(GL_INVALID_OPERATION)
 	}
 #endif
+	CAPTURE_DRAW_STATE(first + count)
+	CAPTURE_CALL(CAPTURE_DRAW_ARRAYS_INSTANCED, mode, first, count, primcount, cur_program)
 	SceGxmPrimitiveType gxm_p;
 	gl_primitive_to_gxm(mode, gxm_p, count);
 	scene_reset();
@@ -345,6 +461,7 @@ void glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *gl_in
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_VALUE, count)
 	}
 #endif
+	capture_elements_call(CAPTURE_DRAW_ELEMENTS, capture_indices_range(type, gl_indices, count), count, type, gl_indices, mode, count, type, (uint32_t)gl_indices, cur_program)
 
 	SceGxmPrimitiveType gxm_p;
 	gl_primitive_to_gxm(mode, gxm_p, count);
@@ -356,6 +473,7 @@ void glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *gl_in
 	
 	// sceGxm doesn't support 8bit indices natively, so we internally convert to 16bit
 	if (type == GL_UNSIGNED_BYTE) {
+		PROFILER_SCOPE(PROF_INDEX_CONVERSION)
 		uint16_t *idx16 = gpu_alloc_mapped_temp(count * sizeof(uint16_t));
 		uint8_t *idx8 = (uint8_t *)src;
 		for (GLsizei i = 0; i < count; i++) {
@@ -402,6 +520,7 @@ void glDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const GLv
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_VALUE, count)
 	}
 #endif
+	capture_elements_call(CAPTURE_DRAW_ELEMENTS_BASE_VERTEX, capture_indices_range(type, gl_indices, count) + baseVertex, count, type, gl_indices, mode, count, type, (uint32_t)gl_indices, baseVertex, cur_program)
 
 	SceGxmPrimitiveType gxm_p;
 	gl_primitive_to_gxm(mode, gxm_p, count);
@@ -449,6 +568,7 @@ void glDrawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, G
 		SET_GL_ERROR(GL_INVALID_VALUE)
 	}
 #endif
+	capture_elements_call(CAPTURE_DRAW_RANGE_ELEMENTS, end + 1, count, type, gl_indices, mode, start, end, count, type, (uint32_t)gl_indices, 0, cur_program)
 
 	SceGxmPrimitiveType gxm_p;
 	gl_primitive_to_gxm(mode, gxm_p, count);
@@ -494,6 +614,7 @@ void glDrawRangeElementsBaseVertex(GLenum mode, GLuint start, GLuint end, GLsize
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_VALUE, count)
 	}
 #endif
+	capture_elements_call(CAPTURE_DRAW_RANGE_ELEMENTS, end + baseVertex + 1, count, type, gl_indices, mode, start, end, count, type, (uint32_t)gl_indices, baseVertex, cur_program)
 
 	SceGxmPrimitiveType gxm_p;
 	gl_primitive_to_gxm(mode, gxm_p, count);
@@ -541,6 +662,7 @@ void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void
 		SET_GL_ERROR(GL_INVALID_OPERATION)
 	}
 #endif
+	capture_elements_call(CAPTURE_DRAW_ELEMENTS_INSTANCED, capture_indices_range(type, gl_indices, count), count, type, gl_indices, mode, count, type, (uint32_t)gl_indices, primcount, cur_program)
 
 	SceGxmPrimitiveType gxm_p;
 	gl_primitive_to_gxm(mode, gxm_p, count);
@@ -567,6 +689,159 @@ void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void
 	restore_polygon_mode(gxm_p);
 }
 
+static uint16_t **multi_draw_idx_bufs = NULL; // Indices passed to sceGxm for every draw of a multi draw call
+static GLsizei *multi_draw_counts = NULL; // Indices count passed to sceGxm for every draw of a multi draw call
+static const void **multi_draw_srcs = NULL; // Application provided indices for every draw of an indirect multi draw call
+static GLint *multi_draw_bases = NULL; // Base vertex for every draw of an indirect multi draw call
+static GLsizei multi_draw_size = 0; // Number of draws the multi draw scratch buffers can hold
+
+static void reserve_multi_draw_scratch(GLsizei drawcount) {
+	if (drawcount > multi_draw_size) {
+		multi_draw_idx_bufs = vgl_realloc(multi_draw_idx_bufs, drawcount * sizeof(uint16_t *));
+		multi_draw_counts = vgl_realloc(multi_draw_counts, drawcount * sizeof(GLsizei));
+		multi_draw_srcs = vgl_realloc(multi_draw_srcs, drawcount * sizeof(void *));
+		multi_draw_bases = vgl_realloc(multi_draw_bases, drawcount * sizeof(GLint));
+		multi_draw_size = drawcount;
+	}
+}
+
+static void _glMultiDrawElements(GLenum mode, const GLsizei *counts, GLenum type, const void *const *gl_indices, const GLint *base_vertex, GLsizei drawcount) {
+	GLsizei highest_count = 0;
+	for (int j = 0; j < drawcount; j++) {
+		if (counts[j] > highest_count)
+			highest_count = counts[j];
+	}
+	if (!highest_count)
+		return;
+
+	SceGxmPrimitiveType gxm_p;
+	gl_primitive_to_gxm(mode, gxm_p, highest_count);
+	scene_reset();
+
+	vbo *gpu_buf = (vbo *)cur_vao->index_array_unit;
+	SceGxmIndexSource index_type = type == GL_UNSIGNED_SHORT ? SCE_GXM_INDEX_SOURCE_INDEX_16BIT : SCE_GXM_INDEX_SOURCE_INDEX_32BIT;
+	SceGxmIndexFormat idx_fmt = type == GL_UNSIGNED_SHORT ? SCE_GXM_INDEX_FORMAT_U16 : SCE_GXM_INDEX_FORMAT_U32;
+
+	if (cur_program != 0) {
+		// Indices are prepared upfront so that shader state gets set up only once for all the draws
+		reserve_multi_draw_scratch(drawcount);
+		GLsizei num = 0;
+		for (int j = 0; j < drawcount; j++) {
+			GLsizei count = counts[j];
+			if (count <= 0)
+				continue;
+			uint16_t *src = gpu_buf ? (uint16_t *)((uint8_t *)gpu_buf->ptr + (uint32_t)gl_indices[j]) : (uint16_t *)gl_indices[j];
+			if (type == GL_UNSIGNED_SHORT) {
+				setup_elements_indices(uint16_t);
+				multi_draw_idx_bufs[num] = ptr;
+			} else {
+				setup_elements_indices(uint32_t);
+				multi_draw_idx_bufs[num] = (uint16_t *)ptr;
+			}
+			multi_draw_counts[num] = count;
+			if (base_vertex)
+				multi_draw_bases[num] = base_vertex[j];
+			num++;
+		}
+		if (num)
+			_glMultiDrawElements_CustomShadersIMPL(gxm_p, idx_fmt, multi_draw_idx_bufs, multi_draw_counts, base_vertex ? multi_draw_bases : NULL, 0, index_type, num);
+	} else {
+		if (!(ffp_vertex_attrib_state & (1 << 0)))
+			return;
+		for (int j = 0; j < drawcount; j++) {
+			GLsizei count = counts[j];
+			if (count <= 0)
+				continue;
+			GLint base = base_vertex ? base_vertex[j] : 0;
+			uint16_t *src = gpu_buf ? (uint16_t *)((uint8_t *)gpu_buf->ptr + (uint32_t)gl_indices[j]) : (uint16_t *)gl_indices[j];
+			_glDrawElements_FixedFunctionIMPL(src, count, 0, base, index_type);
+			if (type == GL_UNSIGNED_SHORT) {
+				setup_elements_indices(uint16_t);
+				sceGxmDraw(gxm_context, gxm_p, idx_fmt + base, ptr, count);
+			} else {
+				setup_elements_indices(uint32_t);
+				sceGxmDraw(gxm_context, gxm_p, idx_fmt + base, ptr, count);
+			}
+		}
+	}
+	restore_polygon_mode(gxm_p);
+}
+
+void glMultiDrawElements(GLenum mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei drawcount) {
+	THREAD_SAFE()
+
+#ifndef SKIP_ERROR_HANDLING
+	if (type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_INT) {
+		SET_GL_ERROR_WITH_VALUE(GL_INVALID_ENUM, type)
+	} else if (phase == MODEL_CREATION) {
+		SET_GL_ERROR(GL_INVALID_OPERATION)
+	} else if (drawcount < 0) {
+		SET_GL_ERROR_WITH_VALUE(GL_INVALID_VALUE, drawcount)
+	}
+#endif
+	CAPTURE_DRAW_STATE(capture_multi_elements_range(type, count, indices, NULL, drawcount))
+#ifdef HAVE_FRAME_CAPTURE
+	uint32_t capture_size = 0;
+	const void *capture_data = vgl_capture_active ? capture_multi_elements_data(type, count, indices, NULL, drawcount, &capture_size) : NULL;
+#endif
+	CAPTURE_CALL_WITH_DATA(CAPTURE_MULTI_DRAW_ELEMENTS, capture_data, capture_size, mode, type, drawcount, cur_program)
+
+	_glMultiDrawElements(mode, count, type, indices, NULL, drawcount);
+}
+
+void glMultiDrawElementsBaseVertex(GLenum mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei drawcount, const GLint *basevertex) {
+	THREAD_SAFE()
+
+#ifndef SKIP_ERROR_HANDLING
+	if (type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_INT) {
+		SET_GL_ERROR_WITH_VALUE(GL_INVALID_ENUM, type)
+	} else if (phase == MODEL_CREATION) {
+		SET_GL_ERROR(GL_INVALID_OPERATION)
+	} else if (drawcount < 0) {
+		SET_GL_ERROR_WITH_VALUE(GL_INVALID_VALUE, drawcount)
+	}
+#endif
+	CAPTURE_DRAW_STATE(capture_multi_elements_range(type, count, indices, basevertex, drawcount))
+#ifdef HAVE_FRAME_CAPTURE
+	uint32_t capture_size = 0;
+	const void *capture_data = vgl_capture_active ? capture_multi_elements_data(type, count, indices, basevertex, drawcount, &capture_size) : NULL;
+#endif
+	CAPTURE_CALL_WITH_DATA(CAPTURE_MULTI_DRAW_ELEMENTS, capture_data, capture_size, mode, type, drawcount, cur_program)
+
+	_glMultiDrawElements(mode, count, type, indices, basevertex, drawcount);
+}
+
+void vglMultiDrawElementsIndirect(GLenum mode, GLenum type, const void *indices, const vglDrawElementsIndirectCommand *cmds, GLsizei drawcount) {
+	THREAD_SAFE()
+
+#ifndef SKIP_ERROR_HANDLING
+	if (type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_INT) {
+		SET_GL_ERROR_WITH_VALUE(GL_INVALID_ENUM, type)
+	} else if (phase == MODEL_CREATION) {
+		SET_GL_ERROR(GL_INVALID_OPERATION)
+	} else if (drawcount < 0) {
+		SET_GL_ERROR_WITH_VALUE(GL_INVALID_VALUE, drawcount)
+	}
+#endif
+	CAPTURE_DRAW_STATE(capture_indirect_range(type, indices, cmds, drawcount))
+#ifdef HAVE_FRAME_CAPTURE
+	uint32_t capture_size = 0;
+	const void *capture_data = vgl_capture_active ? capture_indirect_data(type, indices, cmds, drawcount, &capture_size) : NULL;
+#endif
+	CAPTURE_CALL_WITH_DATA(CAPTURE_MULTI_DRAW_ELEMENTS_INDIRECT, capture_data, capture_size, mode, type, (uint32_t)indices, drawcount, cur_program)
+
+	// Commands are unpacked in the scratch buffers, draws get compacted in place so aliasing is safe
+	reserve_multi_draw_scratch(drawcount);
+	uint32_t idx_size = type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	for (int j = 0; j < drawcount; j++) {
+		multi_draw_counts[j] = cmds[j].count;
+		multi_draw_srcs[j] = (const uint8_t *)indices + cmds[j].firstIndex * idx_size;
+		multi_draw_bases[j] = cmds[j].baseVertex;
+	}
+
+	_glMultiDrawElements(mode, multi_draw_counts, type, multi_draw_srcs, multi_draw_bases, drawcount);
+}
+
 void vglDrawObjects(GLenum mode, GLsizei count) {
 	THREAD_SAFE()
 
@@ -29,6 +29,11 @@
 #endif
 #include "shaders/tex_env.h"
 #include "shared.h"
+#ifdef HAVE_CLIENT_ARRAYS_CACHE
+#define XXH_STATIC_LINKING_ONLY
+#define XXH_NAMESPACE VITAGL_
+#include "utils/xxhash_utils.h"
+#endif
 
 #define setup_lighting_attributes(type, type2, attr) \
 	if (mask.has_colors && color_material_state && (color_material_mode == type || color_material_mode == type2)) { \
@@ -76,11 +81,33 @@ uint8_t ffp_texcoord_binds[3] = {FFP_ATTRIB_TEX0, FFP_ATTRIB_TEX1, FFP_ATTRIB_TE
 static uint32_t vertex_count = 0; // Vertex counter for vertex list
 static SceGxmPrimitiveType prim; // Current in use primitive for rendering
 
+// Immediate mode lighting attributes (in the same order they're stored in current_vtx starting from amb)
+enum {
+	LEGACY_LIT_AMBIENT,
+	LEGACY_LIT_DIFFUSE,
+	LEGACY_LIT_SPECULAR,
+	LEGACY_LIT_EMISSION,
+	LEGACY_LIT_NORMAL,
+	LEGACY_LIT_ATTRIBS_NUM
+};
+static const uint8_t legacy_lit_attr_offs[LEGACY_LIT_ATTRIBS_NUM] = {0, 4, 8, 12, 16}; // Offsets (in floats) from current_vtx.amb
+static const uint8_t legacy_lit_attr_size[LEGACY_LIT_ATTRIBS_NUM] = {4, 4, 4, 4, 3}; // Sizes (in floats)
+static GLboolean legacy_lit_tracking = GL_FALSE; // Are we building a lighting enabled immediate mode primitive?
+static uint8_t legacy_lit_varying = 0; // Bitmask of lighting attributes that changed since glBegin
+static uint8_t legacy_lit_base = 0; // Per-vertex floats preceding lighting attributes (position + texcoords)
+static uint8_t legacy_lit_stride = 0; // Current vertex stride (in floats) for lighting enabled immediate mode primitives
+static uint8_t legacy_lit_layout = 0; // Layout used for last lighting enabled immediate mode draw
+static void *legacy_lit_streams[FFP_VERTEX_ATTRIBS_NUM]; // Streams addresses for lighting enabled immediate mode draws
+
 #ifdef HAVE_UNPURE_TEXCOORDS
 static uint8_t base_texture_id = 0; // First enabled texture to use during draws
 #else
 #define base_texture_id (0)
 #endif
+static uint16_t ffp_draw_mask_state = 0; // Streams mask derived from the last fixed function pipeline mask rebuild
+static vector4f *ffp_clip_planes = NULL; // Enabled clip planes equations to upload for draws
+static vector4f ffp_temp_clip_planes[MAX_CLIP_PLANES_NUM]; // Compacted clip planes equations when enabled ones are not contiguous
+static float *ffp_light_vars[MAX_LIGHTS_NUM][5]; // Enabled lights properties to upload for draws
 
 // Lighting
 GLboolean lighting_state = GL_FALSE; // Current lighting processor state
@@ -153,6 +180,10 @@ SceGxmVertexStream legacy_mt_vertex_stream_config[FFP_VERTEX_ATTRIBS_NUM];
 SceGxmVertexAttribute legacy_nt_vertex_attrib_config[FFP_VERTEX_ATTRIBS_NUM - 2];
 SceGxmVertexStream legacy_nt_vertex_stream_config[FFP_VERTEX_ATTRIBS_NUM - 2];
 
+// Immediate Mode with Lighting (Compacted vertices layout)
+static SceGxmVertexAttribute legacy_lit_vertex_attrib_config[FFP_VERTEX_ATTRIBS_NUM];
+static SceGxmVertexStream legacy_lit_vertex_stream_config[FFP_VERTEX_ATTRIBS_NUM];
+
 static uint32_t ffp_vertex_attrib_offsets[FFP_VERTEX_ATTRIBS_NUM] = {0, 0, 0, 0, 0, 0, 0, 0};
 static uint32_t ffp_vertex_attrib_vbo[FFP_VERTEX_ATTRIBS_NUM] = {0, 0, 0, 0, 0, 0, 0, 0};
 static GLenum ffp_mode;
@@ -239,6 +270,8 @@ typedef struct {
 #ifndef DISABLE_TEXTURE_COMBINER
 	combiner_mask cmb_mask;
 #endif
+	uint32_t hash;
+	uint32_t last_use;
 } cached_fragment_shader;
 typedef struct {
 	SceGxmProgram *prog;
@@ -248,13 +281,50 @@ typedef struct {
 	int attributes[FFP_ATTRIBS_NUM];
 	SceGxmShaderPatcherId id;
 	shader_mask mask;
+	uint32_t hash;
+	uint32_t last_use;
 } cached_vertex_shader;
-cached_fragment_shader frag_shader_cache[SHADER_CACHE_SIZE];
-cached_vertex_shader vert_shader_cache[SHADER_CACHE_SIZE];
-uint8_t frag_shader_cache_size = 0;
-uint8_t vert_shader_cache_size = 0;
-int frag_shader_cache_idx = -1;
-int vert_shader_cache_idx = -1;
+typedef struct {
+	uint32_t hash;
+	uint32_t slot; // Cache slot + 1, 0 for empty buckets
+} shader_cache_bucket;
+enum {
+	FFP_MANIFEST_VERTEX_SHADER,
+	FFP_MANIFEST_FRAGMENT_SHADER
+};
+typedef struct {
+	uint32_t magic; // FFP_SHADER_CACHE_MAGIC the entry got recorded with
+	uint32_t type; // Shader type (FFP_MANIFEST_VERTEX_SHADER or FFP_MANIFEST_FRAGMENT_SHADER)
+	uint64_t mask; // Vertex or fragment shader mask
+	uint64_t cmb_mask[2]; // Combiner mask for fragment shaders
+} ffp_manifest_entry;
+typedef struct {
+	ffp_manifest_entry info;
+	SceGxmProgram *prog;
+} ffp_precompile_entry;
+static cached_fragment_shader *frag_shader_cache = NULL; // RAM cache for fixed function fragment shaders
+static cached_vertex_shader *vert_shader_cache = NULL; // RAM cache for fixed function vertex shaders
+static shader_cache_bucket *frag_shader_cache_table = NULL; // Open addressing hash table indexing frag_shader_cache
+static shader_cache_bucket *vert_shader_cache_table = NULL; // Open addressing hash table indexing vert_shader_cache
+static cached_fragment_shader *cur_frag_shader = NULL; // Cache entry of the currently in use fragment shader
+static cached_vertex_shader *cur_vert_shader = NULL; // Cache entry of the currently in use vertex shader
+static uint32_t frag_shader_cache_num = 0; // Number of fragment shaders currently in the RAM cache
+static uint32_t vert_shader_cache_num = 0; // Number of vertex shaders currently in the RAM cache
+static uint32_t shader_cache_capacity = 0; // Number of slots allocated for each RAM cache
+static uint32_t shader_cache_table_mask = 0; // Size of the hash tables - 1
+static ffp_manifest_entry *ffp_manifest = NULL; // Entries of the recorded warm-up manifest
+static uint32_t ffp_manifest_num = 0; // Number of entries in the recorded warm-up manifest
+static uint32_t ffp_manifest_size = 0; // Number of entries allocated for the recorded warm-up manifest
+static GLboolean ffp_manifest_loaded = GL_FALSE; // Has the recorded warm-up manifest been read from filesystem?
+static ffp_precompile_entry *ffp_precompile_queue = NULL; // Shaders scheduled for precompilation
+static uint32_t ffp_precompile_num = 0; // Number of shaders scheduled for precompilation
+static volatile uint32_t ffp_precompile_ready = 0; // Number of shaders made available by the precompilation job
+static uint32_t ffp_precompile_registered = 0; // Number of precompiled shaders already processed by the main thread
+static uint32_t shader_cache_tick = 0; // Counter used to track least recently used shaders
+uint32_t vgl_ffp_shader_cache_size = SHADER_CACHE_SIZE;
+uint32_t vgl_ffp_shader_cache_hits = 0;
+uint32_t vgl_ffp_shader_cache_misses = 0;
+uint32_t vgl_ffp_shader_cache_evictions = 0;
 uint8_t ffp_vertex_num_params = 1;
 uint32_t ffp_vertex_unif_buf_size;
 uint8_t *ffp_vertex_unif_buf;
@@ -269,8 +339,9 @@ SceGxmProgram *ffp_fragment_program = NULL;
 SceGxmProgram *ffp_vertex_program = NULL;
 SceGxmVertexProgram *ffp_vertex_program_patched; // Patched vertex program for the fixed function pipeline implementation
 SceGxmFragmentProgram *ffp_fragment_program_patched; // Patched fragment program for the fixed function pipeline implementation
-GLboolean ffp_dirty_frag = GL_TRUE;
-GLboolean ffp_dirty_vert = GL_TRUE;
+static GLboolean ffp_dirty_frag = GL_TRUE; // Does the fixed function pipeline need a new fragment program?
+static GLboolean ffp_dirty_vert = GL_TRUE; // Does the fixed function pipeline need a new vertex program?
+GLboolean ffp_dirty_mask = GL_TRUE; // Did any state the fixed function pipeline mask depends on change?
 uint16_t ffp_dirty_vert_attr = 0xFFFF;
 uint16_t dirty_vert_unifs = 0xFFFF;
 uint32_t dirty_frag_unifs = 0xFFFFFFFF;
@@ -316,10 +387,10 @@ void adjust_color_material_state() {
 	}
 }
 
-void reload_vertex_uniforms_and_attributes(int *vertex_params, int *vertex_attributes) {
+void reload_vertex_uniforms_and_attributes(const SceGxmProgram *prog, int *vertex_params, int *vertex_attributes) {
 	sceClibMemset(vertex_params, -1, VERTEX_UNIFORMS_NUM * sizeof(int));
-	int cnt = sceGxmProgramGetParameterCount(ffp_vertex_program);
-	uint32_t *ptr = vglProgramGetParameterBase(ffp_vertex_program);
+	int cnt = sceGxmProgramGetParameterCount(prog);
+	uint32_t *ptr = vglProgramGetParameterBase(prog);
 	for (int i = 0; i < cnt; i++) {
 		SceGxmProgramParameter *p = (SceGxmProgramParameter *)ptr;
 		SceGxmParameterCategory cat = sceGxmProgramParameterGetCategory(p);
@@ -335,14 +406,12 @@ void reload_vertex_uniforms_and_attributes(int *vertex_params, int *vertex_attri
 		}
 		ptr += 4;
 	}
-	ffp_vertex_params = vertex_params;
-	ffp_vertex_attribs = vertex_attributes;
 }
 
-void reload_fragment_uniforms(int *fragment_params) {
+void reload_fragment_uniforms(const SceGxmProgram *prog, int *fragment_params) {
 	sceClibMemset(fragment_params, -1, FRAGMENT_UNIFORMS_NUM * sizeof(int));
-	int cnt = sceGxmProgramGetParameterCount(ffp_fragment_program);
-	uint32_t *ptr = vglProgramGetParameterBase(ffp_fragment_program);
+	int cnt = sceGxmProgramGetParameterCount(prog);
+	uint32_t *ptr = vglProgramGetParameterBase(prog);
 	for (int i = 0; i < cnt; i++) {
 		SceGxmProgramParameter *p = (SceGxmProgramParameter *)ptr;
 		if (sceGxmProgramParameterGetCategory(p) == SCE_GXM_PARAMETER_CATEGORY_UNIFORM) {
@@ -350,31 +419,29 @@ void reload_fragment_uniforms(int *fragment_params) {
 		}
 		ptr += 4;
 	}
-	ffp_fragment_params = fragment_params;
 }
 
 #ifndef DISABLE_TEXTURE_COMBINER
-void setup_combiner_pass(int i, char *dst) {
+void setup_combiner_pass(int i, combiner_state cmb, char *dst) {
 	char tmp[2048];
 	char arg0_rgb[32], arg1_rgb[32], arg2_rgb[32];
 	char arg0_a[32], arg1_a[32], arg2_a[32];
 	char *args[7] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL};
 	int extra_args_count;
-	texture_unit *tex_unit = &texture_units[base_texture_id + i];
 
 	// Note: arg0_rgb is implicit cause it's always used
 	// Note: We append arg0_a at the end of RGB pass since always used
-	if (tex_unit->combiner.rgb_func == INTERPOLATE) { // Arg0, Arg1, Arg2
-		sprintf(arg2_rgb, op_modes[tex_unit->combiner.op_mode_rgb_2], operands[tex_unit->combiner.op_rgb_2]);
+	if (cmb.rgb_func == INTERPOLATE) { // Arg0, Arg1, Arg2
+		sprintf(arg2_rgb, op_modes[cmb.op_mode_rgb_2], operands[cmb.op_rgb_2]);
 		args[0] = arg2_rgb;
 		args[1] = arg1_rgb;
 		args[2] = arg2_rgb;
 		args[3] = arg0_a;
 		extra_args_count = 4;
 	}
-	if (tex_unit->combiner.rgb_func != REPLACE) { // Arg0, Arg1
-		sprintf(arg1_rgb, op_modes[tex_unit->combiner.op_mode_rgb_1], operands[tex_unit->combiner.op_rgb_1]);
-		if (tex_unit->combiner.rgb_func != INTERPOLATE) {
+	if (cmb.rgb_func != REPLACE) { // Arg0, Arg1
+		sprintf(arg1_rgb, op_modes[cmb.op_mode_rgb_1], operands[cmb.op_rgb_1]);
+		if (cmb.rgb_func != INTERPOLATE) {
 			args[0] = arg1_rgb;
 			args[1] = arg0_a;
 			extra_args_count = 2;
@@ -383,23 +450,23 @@ void setup_combiner_pass(int i, char *dst) {
 		args[0] = arg0_a;
 		extra_args_count = 1;
 	}
-	if (tex_unit->combiner.a_func == INTERPOLATE) { // Arg0, Arg1, Arg2
-		sprintf(arg2_a, op_modes[tex_unit->combiner.op_mode_a_2], operands[tex_unit->combiner.op_a_2]);
+	if (cmb.a_func == INTERPOLATE) { // Arg0, Arg1, Arg2
+		sprintf(arg2_a, op_modes[cmb.op_mode_a_2], operands[cmb.op_a_2]);
 		args[extra_args_count++] = arg2_a;
 		args[extra_args_count++] = arg1_a;
 		args[extra_args_count++] = arg2_a;
 	}
-	if (tex_unit->combiner.a_func != REPLACE) { // Arg0, Arg1
-		sprintf(arg1_a, op_modes[tex_unit->combiner.op_mode_a_1], operands[tex_unit->combiner.op_a_1]);
-		if (tex_unit->combiner.a_func != INTERPOLATE) {
+	if (cmb.a_func != REPLACE) { // Arg0, Arg1
+		sprintf(arg1_a, op_modes[cmb.op_mode_a_1], operands[cmb.op_a_1]);
+		if (cmb.a_func != INTERPOLATE) {
 			args[extra_args_count++] = arg1_a;
 		}
 	}
 	// Common arguments
-	sprintf(arg0_rgb, op_modes[tex_unit->combiner.op_mode_rgb_0], operands[tex_unit->combiner.op_rgb_0]);
-	sprintf(arg0_a, op_modes[tex_unit->combiner.op_mode_a_0], operands[tex_unit->combiner.op_a_0]);
+	sprintf(arg0_rgb, op_modes[cmb.op_mode_rgb_0], operands[cmb.op_rgb_0]);
+	sprintf(arg0_a, op_modes[cmb.op_mode_a_0], operands[cmb.op_a_0]);
 
-	sprintf(tmp, combine_src, i, calc_funcs[tex_unit->combiner.rgb_func], 'O' + i, i, calc_funcs[tex_unit->combiner.a_func], 'O' + i, i);
+	sprintf(tmp, combine_src, i, calc_funcs[cmb.rgb_func], 'O' + i, i, calc_funcs[cmb.a_func], 'O' + i, i);
 	switch (extra_args_count) {
 	case 1:
 		sprintf(dst, tmp, arg0_rgb, args[0]);
@@ -428,12 +495,512 @@ void setup_combiner_pass(int i, char *dst) {
 }
 #endif
 
-uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *streams, SceGxmIndexSource index_type) {
-#ifdef HAVE_PROFILING
-	uint32_t reload_ffp_shaders_start = sceKernelGetProcessTimeLow();
+static inline uint32_t shader_cache_hash(uint64_t a, uint64_t b) {
+	uint64_t h = (a ^ (b * 0xC2B2AE3D27D4EB4FULL)) * 0x9E3779B97F4A7C15ULL;
+	return (uint32_t)(h >> 32);
+}
+
+#ifdef DISABLE_TEXTURE_COMBINER
+#define get_cmb_mask_key(cmb) (0)
+#elif defined(HAVE_HIGH_FFP_TEXUNITS)
+#define get_cmb_mask_key(cmb) ((cmb).raw_high ^ ((uint64_t)(cmb).raw_low << 29))
+#else
+#define get_cmb_mask_key(cmb) ((cmb).raw)
 #endif
-	// Checking if mask changed
-	GLboolean ffp_dirty_frag_blend = ffp_blend_info.raw != blend_info.raw;
+
+static void setup_shader_cache(void) {
+	shader_cache_capacity = vgl_ffp_shader_cache_size ? vgl_ffp_shader_cache_size : 1;
+	uint32_t table_size = 1;
+	while (table_size < shader_cache_capacity * 2) {
+		table_size <<= 1;
+	}
+	shader_cache_table_mask = table_size - 1;
+	frag_shader_cache = (cached_fragment_shader *)vglCalloc(shader_cache_capacity, sizeof(cached_fragment_shader));
+	vert_shader_cache = (cached_vertex_shader *)vglCalloc(shader_cache_capacity, sizeof(cached_vertex_shader));
+	frag_shader_cache_table = (shader_cache_bucket *)vglCalloc(table_size, sizeof(shader_cache_bucket));
+	vert_shader_cache_table = (shader_cache_bucket *)vglCalloc(table_size, sizeof(shader_cache_bucket));
+}
+
+static void shader_cache_table_insert(shader_cache_bucket *table, uint32_t hash, uint32_t slot) {
+	uint32_t i = hash & shader_cache_table_mask;
+	while (table[i].slot) {
+		i = (i + 1) & shader_cache_table_mask;
+	}
+	table[i].hash = hash;
+	table[i].slot = slot + 1;
+}
+
+static void shader_cache_table_remove(shader_cache_bucket *table, uint32_t hash, uint32_t slot) {
+	uint32_t i = hash & shader_cache_table_mask;
+	while (table[i].slot != slot + 1) {
+		i = (i + 1) & shader_cache_table_mask;
+	}
+
+	// Backward shift deletion to keep probe sequences intact without tombstones
+	uint32_t j = i;
+	for (;;) {
+		table[i].slot = 0;
+		for (;;) {
+			j = (j + 1) & shader_cache_table_mask;
+			if (!table[j].slot)
+				return;
+			uint32_t home = table[j].hash & shader_cache_table_mask;
+			if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+				continue;
+			table[i] = table[j];
+			i = j;
+			break;
+		}
+	}
+}
+
+#define get_lru_shader_slot(cache, slot) \
+	uint32_t oldest = 0xFFFFFFFF; \
+	for (uint32_t i = 0; i < shader_cache_capacity; i++) { \
+		if (cache[i].last_use < oldest) { \
+			oldest = cache[i].last_use; \
+			slot = i; \
+		} \
+	}
+
+static cached_vertex_shader *get_cached_vert_shader(uint64_t mask) {
+	uint32_t hash = shader_cache_hash(mask, 0);
+	for (uint32_t i = hash & shader_cache_table_mask; vert_shader_cache_table[i].slot; i = (i + 1) & shader_cache_table_mask) {
+		cached_vertex_shader *s = &vert_shader_cache[vert_shader_cache_table[i].slot - 1];
+		if (vert_shader_cache_table[i].hash == hash && s->mask.raw == mask) {
+			s->last_use = ++shader_cache_tick;
+			vgl_ffp_shader_cache_hits++;
+			return s;
+		}
+	}
+	vgl_ffp_shader_cache_misses++;
+	return NULL;
+}
+
+static cached_vertex_shader *add_cached_vert_shader(uint64_t mask) {
+	uint32_t slot = 0;
+	cached_vertex_shader *s;
+	if (vert_shader_cache_num < shader_cache_capacity) {
+		slot = vert_shader_cache_num++;
+		s = &vert_shader_cache[slot];
+	} else {
+		get_lru_shader_slot(vert_shader_cache, slot);
+		s = &vert_shader_cache[slot];
+		shader_cache_table_remove(vert_shader_cache_table, s->hash, slot);
+		sceGxmShaderPatcherForceUnregisterProgram(gxm_shader_patcher, s->id);
+		vgl_free(s->prog);
+		vgl_free(s->unif_buf);
+		vgl_ffp_shader_cache_evictions++;
+	}
+	s->mask.raw = mask;
+	s->hash = shader_cache_hash(mask, 0);
+	s->last_use = ++shader_cache_tick;
+	shader_cache_table_insert(vert_shader_cache_table, s->hash, slot);
+	return s;
+}
+
+#ifdef DISABLE_TEXTURE_COMBINER
+static cached_fragment_shader *get_cached_frag_shader(uint64_t mask) {
+	uint32_t hash = shader_cache_hash(mask, 0);
+#else
+static cached_fragment_shader *get_cached_frag_shader(uint64_t mask, combiner_mask cmb_mask) {
+	uint32_t hash = shader_cache_hash(mask, get_cmb_mask_key(cmb_mask));
+#endif
+	for (uint32_t i = hash & shader_cache_table_mask; frag_shader_cache_table[i].slot; i = (i + 1) & shader_cache_table_mask) {
+		cached_fragment_shader *s = &frag_shader_cache[frag_shader_cache_table[i].slot - 1];
+#ifdef DISABLE_TEXTURE_COMBINER
+		if (frag_shader_cache_table[i].hash == hash && s->mask.raw == mask) {
+#elif defined(HAVE_HIGH_FFP_TEXUNITS)
+		if (frag_shader_cache_table[i].hash == hash && s->mask.raw == mask && s->cmb_mask.raw_high == cmb_mask.raw_high && s->cmb_mask.raw_low == cmb_mask.raw_low) {
+#else
+		if (frag_shader_cache_table[i].hash == hash && s->mask.raw == mask && s->cmb_mask.raw == cmb_mask.raw) {
+#endif
+			s->last_use = ++shader_cache_tick;
+			vgl_ffp_shader_cache_hits++;
+			return s;
+		}
+	}
+	vgl_ffp_shader_cache_misses++;
+	return NULL;
+}
+
+#ifdef DISABLE_TEXTURE_COMBINER
+static cached_fragment_shader *add_cached_frag_shader(uint64_t mask) {
+#else
+static cached_fragment_shader *add_cached_frag_shader(uint64_t mask, combiner_mask cmb_mask) {
+#endif
+	uint32_t slot = 0;
+	cached_fragment_shader *s;
+	if (frag_shader_cache_num < shader_cache_capacity) {
+		slot = frag_shader_cache_num++;
+		s = &frag_shader_cache[slot];
+	} else {
+		get_lru_shader_slot(frag_shader_cache, slot);
+		s = &frag_shader_cache[slot];
+		shader_cache_table_remove(frag_shader_cache_table, s->hash, slot);
+		sceGxmShaderPatcherForceUnregisterProgram(gxm_shader_patcher, s->id);
+		vgl_free(s->prog);
+		if (s->unif_buf) {
+			vgl_free(s->unif_buf);
+		}
+		vgl_ffp_shader_cache_evictions++;
+	}
+	s->mask.raw = mask;
+#ifdef DISABLE_TEXTURE_COMBINER
+	s->hash = shader_cache_hash(mask, 0);
+#else
+#ifdef HAVE_HIGH_FFP_TEXUNITS
+	s->cmb_mask.raw_low = cmb_mask.raw_low;
+	s->cmb_mask.raw_high = cmb_mask.raw_high;
+#else
+	s->cmb_mask.raw = cmb_mask.raw;
+#endif
+	s->hash = shader_cache_hash(mask, get_cmb_mask_key(cmb_mask));
+#endif
+	s->last_use = ++shader_cache_tick;
+	shader_cache_table_insert(frag_shader_cache_table, s->hash, slot);
+	return s;
+}
+
+#ifdef HAVE_HIGH_FFP_TEXUNITS
+#define get_ffp_pass_env_mode(mask, i) ((i) == 0 ? (mask).tex_env_mode_pass0 : ((i) == 1 ? (mask).tex_env_mode_pass1 : (mask).tex_env_mode_pass2))
+#define get_ffp_pass_combiner(cmb_mask, i) ((i) == 0 ? (cmb_mask).pass0 : ((i) == 1 ? (cmb_mask).pass1 : (cmb_mask).pass2))
+#else
+#define get_ffp_pass_env_mode(mask, i) ((i) == 0 ? (mask).tex_env_mode_pass0 : (mask).tex_env_mode_pass1)
+#define get_ffp_pass_combiner(cmb_mask, i) ((i) == 0 ? (cmb_mask).pass0 : (cmb_mask).pass1)
+#endif
+
+shader_pack ffp_shader_pack = {.fd = -1};
+
+// Builds the key identifying a fixed function shader inside the packed filesystem cache
+static inline void get_ffp_shader_pack_key(uint64_t *key, uint32_t type, uint64_t mask, uint64_t extra_high, uint32_t extra_low) {
+	key[0] = mask;
+	key[1] = extra_high;
+	key[2] = ((uint64_t)type << 32) | extra_low;
+}
+
+// Parses the hex fields of a fixed function shader cached with the loose files layout (eg. 0000ABCD-1.gxp)
+static int parse_ffp_loose_shader_name(const char *name, uint64_t *fields) {
+	int n = 0;
+	const char *p = name;
+	while (n < 3) {
+		char *end;
+		fields[n++] = strtoull(p, &end, 16);
+		if (end == p)
+			return 0;
+		if (*end != '-')
+			return strcmp(end, ".gxp") ? 0 : n;
+		p = end + 1;
+	}
+	return 0;
+}
+
+static GLboolean get_ffp_loose_vert_shader_key(const char *name, uint64_t *key) {
+	uint64_t fields[3];
+	if (parse_ffp_loose_shader_name(name, fields) != 2)
+		return GL_FALSE;
+	get_ffp_shader_pack_key(key, FFP_MANIFEST_VERTEX_SHADER, fields[0], fields[1], 0);
+	return GL_TRUE;
+}
+
+static GLboolean get_ffp_loose_frag_shader_key(const char *name, uint64_t *key) {
+	uint64_t fields[3] = {0, 0, 0};
+#ifdef HAVE_HIGH_FFP_TEXUNITS
+	if (parse_ffp_loose_shader_name(name, fields) != 3)
+		return GL_FALSE;
+#else
+	if (parse_ffp_loose_shader_name(name, fields) != 2)
+		return GL_FALSE;
+#endif
+	get_ffp_shader_pack_key(key, FFP_MANIFEST_FRAGMENT_SHADER, fields[0], fields[1], fields[2]);
+	return GL_TRUE;
+}
+
+void setup_ffp_shader_pack(void) {
+	char path[256];
+	sprintf(path, "ux0:data/shader_cache/v%d/ffp.pack", FFP_SHADER_CACHE_MAGIC);
+	shader_pack_open(&ffp_shader_pack, path);
+
+	// Importing shaders cached with the loose files layout
+	if (!ffp_shader_pack.num) {
+		sprintf(path, "ux0:data/shader_cache/v%d/v", FFP_SHADER_CACHE_MAGIC);
+		shader_pack_import(&ffp_shader_pack, path, get_ffp_loose_vert_shader_key);
+		sprintf(path, "ux0:data/shader_cache/v%d/f", FFP_SHADER_CACHE_MAGIC);
+		shader_pack_import(&ffp_shader_pack, path, get_ffp_loose_frag_shader_key);
+	}
+}
+
+// Loads a fixed function vertex shader from filesystem cache, compiling it if missing
+static SceGxmProgram *load_ffp_vert_shader(uint64_t vert_shader_mask) {
+	shader_mask mask = {.raw = vert_shader_mask};
+	uint64_t key[SHADER_PACK_KEY_WORDS];
+	uint32_t size;
+	get_ffp_shader_pack_key(key, FFP_MANIFEST_VERTEX_SHADER, vert_shader_mask, WVP_ON_GPU, 0);
+
+	// Gathering the precompiled shader from cache
+	lock_shader_compiler()
+	SceGxmProgram *prog = (SceGxmProgram *)shader_pack_read(&ffp_shader_pack, key, &size);
+	if (!prog) {
+		// Restarting vitaShaRK if we released it before
+		if (!is_shark_online)
+			start_shader_compiler();
+
+		// Compiling the new shader
+		char vshader[8192];
+		sprintf(vshader, ffp_vert_src, mask.clip_planes_num, mask.num_textures, mask.has_colors, mask.lights_num, mask.shading_mode, mask.normalize, mask.fixed_mask, mask.pos_fixed_mask, WVP_ON_GPU, mask.fast_perspective_correction);
+		size = strlen(vshader);
+		SceGxmProgram *t = shark_compile_shader_extended(vshader, &size, SHARK_VERTEX_SHADER, compiler_opts, compiler_fastmath, compiler_fastprecision, compiler_fastint);
+		prog = (SceGxmProgram *)vglMalloc(size);
+		vgl_fast_memcpy((void *)prog, (void *)t, size);
+		shark_clear_output();
+
+		// Saving compiled shader in filesystem cache
+		shader_pack_write(&ffp_shader_pack, key, prog, size);
+	}
+	unlock_shader_compiler()
+	return prog;
+}
+
+// Loads a fixed function fragment shader from filesystem cache, compiling it if missing
+#ifdef DISABLE_TEXTURE_COMBINER
+static SceGxmProgram *load_ffp_frag_shader(uint64_t frag_shader_mask) {
+#else
+static SceGxmProgram *load_ffp_frag_shader(uint64_t frag_shader_mask, combiner_mask cmb_mask) {
+#endif
+	shader_mask mask = {.raw = frag_shader_mask};
+	uint64_t key[SHADER_PACK_KEY_WORDS];
+	uint32_t size;
+#ifndef DISABLE_TEXTURE_COMBINER
+#ifdef HAVE_HIGH_FFP_TEXUNITS
+	get_ffp_shader_pack_key(key, FFP_MANIFEST_FRAGMENT_SHADER, frag_shader_mask, cmb_mask.raw_high, cmb_mask.raw_low);
+#else
+	get_ffp_shader_pack_key(key, FFP_MANIFEST_FRAGMENT_SHADER, frag_shader_mask, cmb_mask.raw, 0);
+#endif
+#else
+	get_ffp_shader_pack_key(key, FFP_MANIFEST_FRAGMENT_SHADER, frag_shader_mask, 0, 0);
+#endif
+
+	// Gathering the precompiled shader from cache
+	lock_shader_compiler()
+	SceGxmProgram *prog = (SceGxmProgram *)shader_pack_read(&ffp_shader_pack, key, &size);
+	if (!prog) {
+		// Restarting vitaShaRK if we released it before
+		if (!is_shark_online)
+			start_shader_compiler();
+
+		// Compiling the new shader
+		char fshader[8192];
+		char texenv_shad[8192] = {0};
+		GLboolean unused_mode[5] = {GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE};
+		for (int i = 0; i < mask.num_textures; i++) {
+#ifndef DISABLE_TEXTURE_COMBINER
+			char tmp[1024];
+#endif
+			switch (get_ffp_pass_env_mode(mask, i)) {
+			case MODULATE:
+				if (unused_mode[MODULATE]) {
+					sprintf(texenv_shad, "%s\n%s", texenv_shad, modulate_src);
+					unused_mode[MODULATE] = GL_FALSE;
+				}
+				break;
+			case DECAL:
+				if (unused_mode[DECAL]) {
+					sprintf(texenv_shad, "%s\n%s", texenv_shad, decal_src);
+					unused_mode[DECAL] = GL_FALSE;
+				}
+				break;
+			case BLEND:
+				if (unused_mode[BLEND]) {
+					sprintf(texenv_shad, "%s\n%s", texenv_shad, blend_src);
+					unused_mode[BLEND] = GL_FALSE;
+				}
+				break;
+			case ADD:
+				if (unused_mode[ADD]) {
+					sprintf(texenv_shad, "%s\n%s", texenv_shad, add_src);
+					unused_mode[ADD] = GL_FALSE;
+				}
+				break;
+			case REPLACE:
+				if (unused_mode[REPLACE]) {
+					sprintf(texenv_shad, "%s\n%s", texenv_shad, replace_src);
+					unused_mode[REPLACE] = GL_FALSE;
+				}
+				break;
+#ifndef DISABLE_TEXTURE_COMBINER
+			case COMBINE:
+				setup_combiner_pass(i, get_ffp_pass_combiner(cmb_mask, i), tmp);
+				sprintf(texenv_shad, "%s\n%s", texenv_shad, tmp);
+				break;
+#endif
+			default:
+				break;
+			}
+		}
+#ifdef HAVE_HIGH_FFP_TEXUNITS
+		sprintf(fshader, ffp_frag_src, texenv_shad, mask.alpha_test_mode,
+			mask.num_textures, mask.has_colors, mask.fog_mode,
+			(mask.tex_env_mode_pass0 != COMBINE) ? mask.tex_env_mode_pass0 : TEX0_ENV_PASS_COMBINE,
+			(mask.tex_env_mode_pass1 != COMBINE) ? mask.tex_env_mode_pass1 : TEX1_ENV_PASS_COMBINE,
+			(mask.tex_env_mode_pass2 != COMBINE) ? mask.tex_env_mode_pass2 : TEX2_ENV_PASS_COMBINE,
+			mask.lights_num, mask.shading_mode, mask.point_sprite, mask.fast_perspective_correction, mask.srgb_mode);
+#else
+		sprintf(fshader, ffp_frag_src, texenv_shad, mask.alpha_test_mode,
+			mask.num_textures, mask.has_colors, mask.fog_mode,
+			(mask.tex_env_mode_pass0 != COMBINE) ? mask.tex_env_mode_pass0 : TEX0_ENV_PASS_COMBINE,
+			(mask.tex_env_mode_pass1 != COMBINE) ? mask.tex_env_mode_pass1 : TEX1_ENV_PASS_COMBINE,
+			mask.lights_num, mask.shading_mode, mask.point_sprite, mask.fast_perspective_correction, mask.srgb_mode);
+#endif
+		size = strlen(fshader);
+		SceGxmProgram *t = shark_compile_shader_extended(fshader, &size, SHARK_FRAGMENT_SHADER, compiler_opts, compiler_fastmath, compiler_fastprecision, compiler_fastint);
+		prog = (SceGxmProgram *)vglMalloc(size);
+		vgl_fast_memcpy((void *)prog, (void *)t, size);
+		shark_clear_output();
+
+		// Saving compiled shader in filesystem cache
+		shader_pack_write(&ffp_shader_pack, key, prog, size);
+	}
+	unlock_shader_compiler()
+	return prog;
+}
+
+static ffp_manifest_entry *read_ffp_manifest(const char *path, uint32_t *num) {
+	ffp_manifest_entry *res = NULL;
+	*num = 0;
+	SceUID f = sceIoOpen(path, SCE_O_RDONLY, 0777);
+	if (f >= 0) {
+		*num = sceIoLseek(f, 0, SCE_SEEK_END) / sizeof(ffp_manifest_entry);
+		sceIoLseek(f, 0, SCE_SEEK_SET);
+		if (*num) {
+			res = (ffp_manifest_entry *)vglMalloc(*num * sizeof(ffp_manifest_entry));
+			sceIoRead(f, res, *num * sizeof(ffp_manifest_entry));
+		}
+		sceIoClose(f);
+	}
+	return res;
+}
+
+// Appends a newly seen shader to the warm-up manifest
+static void record_ffp_manifest_entry(uint32_t type, uint64_t mask, uint64_t cmb_high, uint64_t cmb_low) {
+	if (!ffp_manifest_loaded) {
+		ffp_manifest = read_ffp_manifest(FFP_MANIFEST_PATH, &ffp_manifest_num);
+		ffp_manifest_size = ffp_manifest_num;
+		ffp_manifest_loaded = GL_TRUE;
+	}
+	for (uint32_t i = 0; i < ffp_manifest_num; i++) {
+		ffp_manifest_entry *e = &ffp_manifest[i];
+		if (e->magic == FFP_SHADER_CACHE_MAGIC && e->type == type && e->mask == mask && e->cmb_mask[0] == cmb_high && e->cmb_mask[1] == cmb_low)
+			return;
+	}
+	if (ffp_manifest_num == ffp_manifest_size) {
+		ffp_manifest_size = ffp_manifest_size ? ffp_manifest_size * 2 : 64;
+		ffp_manifest = ffp_manifest ? vglRealloc(ffp_manifest, ffp_manifest_size * sizeof(ffp_manifest_entry)) : vglMalloc(ffp_manifest_size * sizeof(ffp_manifest_entry));
+	}
+	ffp_manifest_entry *e = &ffp_manifest[ffp_manifest_num++];
+	e->magic = FFP_SHADER_CACHE_MAGIC;
+	e->type = type;
+	e->mask = mask;
+	e->cmb_mask[0] = cmb_high;
+	e->cmb_mask[1] = cmb_low;
+	SceUID f = sceIoOpen(FFP_MANIFEST_PATH, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_APPEND, 0777);
+	if (f >= 0) {
+		sceIoWrite(f, e, sizeof(ffp_manifest_entry));
+		sceIoClose(f);
+	}
+}
+
+static void precompile_ffp_shaders(void) {
+	for (uint32_t i = 0; i < ffp_precompile_num; i++) {
+		ffp_precompile_entry *e = &ffp_precompile_queue[i];
+		if (e->info.type == FFP_MANIFEST_VERTEX_SHADER) {
+			e->prog = load_ffp_vert_shader(e->info.mask);
+		} else {
+#ifdef DISABLE_TEXTURE_COMBINER
+			e->prog = load_ffp_frag_shader(e->info.mask);
+#else
+			combiner_mask cmb_mask;
+#ifdef HAVE_HIGH_FFP_TEXUNITS
+			cmb_mask.raw_high = e->info.cmb_mask[0];
+			cmb_mask.raw_low = e->info.cmb_mask[1];
+#else
+			cmb_mask.raw = e->info.cmb_mask[0];
+#endif
+			e->prog = load_ffp_frag_shader(e->info.mask, cmb_mask);
+#endif
+		}
+
+		// Publishing the shader to the main thread only once fully written
+		__sync_synchronize();
+		ffp_precompile_ready = i + 1;
+	}
+}
+
+static int ffp_precompile_thread(SceSize args, void *argp) {
+	precompile_ffp_shaders();
+	return sceKernelExitDeleteThread(0);
+}
+
+// Registers precompiled shaders on the main thread while the RAM cache has free slots
+static void register_precompiled_ffp_shaders(void) {
+	uint32_t ready = ffp_precompile_ready;
+	__sync_synchronize();
+	if (!vert_shader_cache)
+		setup_shader_cache();
+
+	// Lookups performed here must not alter RAM cache statistics
+	uint32_t hits = vgl_ffp_shader_cache_hits;
+	uint32_t misses = vgl_ffp_shader_cache_misses;
+	while (ffp_precompile_registered < ready) {
+		ffp_precompile_entry *e = &ffp_precompile_queue[ffp_precompile_registered++];
+		if (e->info.type == FFP_MANIFEST_VERTEX_SHADER) {
+			if (vert_shader_cache_num < shader_cache_capacity && !get_cached_vert_shader(e->info.mask)) {
+				cached_vertex_shader *s = add_cached_vert_shader(e->info.mask);
+				s->prog = e->prog;
+				sceGxmShaderPatcherRegisterProgram(gxm_shader_patcher, s->prog, &s->id);
+				s->unif_buf_size = sceGxmProgramGetDefaultUniformBufferSize(s->prog);
+				s->unif_buf = vglMalloc(s->unif_buf_size);
+				reload_vertex_uniforms_and_attributes(s->prog, s->vert_unifs, s->attributes);
+			} else {
+				vgl_free(e->prog);
+			}
+		} else {
+#ifdef DISABLE_TEXTURE_COMBINER
+			if (frag_shader_cache_num < shader_cache_capacity && !get_cached_frag_shader(e->info.mask)) {
+				cached_fragment_shader *s = add_cached_frag_shader(e->info.mask);
+#else
+			combiner_mask cmb_mask;
+#ifdef HAVE_HIGH_FFP_TEXUNITS
+			cmb_mask.raw_high = e->info.cmb_mask[0];
+			cmb_mask.raw_low = e->info.cmb_mask[1];
+#else
+			cmb_mask.raw = e->info.cmb_mask[0];
+#endif
+			if (frag_shader_cache_num < shader_cache_capacity && !get_cached_frag_shader(e->info.mask, cmb_mask)) {
+				cached_fragment_shader *s = add_cached_frag_shader(e->info.mask, cmb_mask);
+#endif
+				s->prog = e->prog;
+				sceGxmShaderPatcherRegisterProgram(gxm_shader_patcher, s->prog, &s->id);
+				s->unif_buf_size = sceGxmProgramGetDefaultUniformBufferSize(s->prog);
+				s->unif_buf = s->unif_buf_size ? vglMalloc(s->unif_buf_size) : NULL;
+				reload_fragment_uniforms(s->prog, s->frag_unifs);
+			} else {
+				vgl_free(e->prog);
+			}
+		}
+	}
+	vgl_ffp_shader_cache_hits = hits;
+	vgl_ffp_shader_cache_misses = misses;
+
+	// Releasing precompilation resources once every scheduled shader got processed
+	if (ffp_precompile_registered == ffp_precompile_num) {
+		vgl_free(ffp_precompile_queue);
+		ffp_precompile_queue = NULL;
+		release_shader_compiler_sema();
+	}
+}
+
+// Rebuilds fixed function pipeline mask from current state, returns GL_TRUE if it changed
+static GLboolean update_ffp_mask() {
 	shader_mask mask = {.raw = 0};
 #ifndef DISABLE_TEXTURE_COMBINER
 #ifdef HAVE_HIGH_FFP_TEXUNITS
@@ -506,40 +1073,37 @@ uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *str
 		}
 	}
 
-	vector4f *clip_planes;
-	vector4f temp_clip_planes[MAX_CLIP_PLANES_NUM];
 	if (clip_planes_aligned) {
-		clip_planes = &clip_planes_eq[clip_plane_range[0]];
+		ffp_clip_planes = &clip_planes_eq[clip_plane_range[0]];
 		mask.clip_planes_num = clip_plane_range[1] - clip_plane_range[0];
 	} else {
-		clip_planes = &temp_clip_planes[0];
+		ffp_clip_planes = &ffp_temp_clip_planes[0];
 		for (int i = clip_plane_range[0]; i < clip_plane_range[1]; i++) {
 			if (clip_planes_mask & (1 << i)) {
-				vgl_fast_memcpy(&clip_planes[mask.clip_planes_num], &clip_planes_eq[i], sizeof(vector4f));
+				vgl_fast_memcpy(&ffp_clip_planes[mask.clip_planes_num], &clip_planes_eq[i], sizeof(vector4f));
 				mask.clip_planes_num++;
 			}
 		}
 	}
 
-	float *light_vars[MAX_LIGHTS_NUM][5];
 	if (!lighting_state)
 		mask.lights_num = 0;
 	else {
 		if (lights_aligned) {
-			light_vars[0][0] = &lights_ambients[light_range[0]].x;
-			light_vars[0][1] = &lights_diffuses[light_range[0]].x;
-			light_vars[0][2] = &lights_speculars[light_range[0]].x;
-			light_vars[0][3] = &lights_positions[light_range[0]].x;
-			light_vars[0][4] = &lights_attenuations[light_range[0]].x;
+			ffp_light_vars[0][0] = &lights_ambients[light_range[0]].x;
+			ffp_light_vars[0][1] = &lights_diffuses[light_range[0]].x;
+			ffp_light_vars[0][2] = &lights_speculars[light_range[0]].x;
+			ffp_light_vars[0][3] = &lights_positions[light_range[0]].x;
+			ffp_light_vars[0][4] = &lights_attenuations[light_range[0]].x;
 			mask.lights_num = light_range[1] - light_range[0];
 		} else {
 			for (int i = light_range[0]; i < light_range[1]; i++) {
 				if (light_mask & (1 << i)) {
-					light_vars[mask.lights_num][0] = &lights_ambients[i].x;
-					light_vars[mask.lights_num][1] = &lights_diffuses[i].x;
-					light_vars[mask.lights_num][2] = &lights_speculars[i].x;
-					light_vars[mask.lights_num][3] = &lights_positions[i].x;
-					light_vars[mask.lights_num][4] = &lights_attenuations[i].x;
+					ffp_light_vars[mask.lights_num][0] = &lights_ambients[i].x;
+					ffp_light_vars[mask.lights_num][1] = &lights_diffuses[i].x;
+					ffp_light_vars[mask.lights_num][2] = &lights_speculars[i].x;
+					ffp_light_vars[mask.lights_num][3] = &lights_positions[i].x;
+					ffp_light_vars[mask.lights_num][4] = &lights_attenuations[i].x;
 					mask.lights_num++;
 				}
 			}
@@ -562,136 +1126,126 @@ uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *str
 		draw_mask_state &= ~(1 << FFP_ATTRIB_NORMAL);
 	}
 	
-	uint32_t vert_shader_mask = mask.raw & VERTEX_SHADER_MASK;
-	uint32_t frag_shader_mask = mask.raw & FRAGMENT_SHADER_MASK;
+	ffp_draw_mask_state = draw_mask_state;
+
+	uint64_t vert_shader_mask = mask.raw & VERTEX_SHADER_MASK;
+	uint64_t frag_shader_mask = mask.raw & FRAGMENT_SHADER_MASK;
 	
 #ifdef DISABLE_TEXTURE_COMBINER
 	#define is_ffp_mask_matching(src_mask, dst_mask) \
 		((src_mask) == (dst_mask))
-	#define is_cached_mask_matching(src_mask, dst_mask, src_cmb_mask, dst_cmb_mask) \
-		((src_mask) == (dst_mask))	
 #elif defined(HAVE_HIGH_FFP_TEXUNITS)
 	GLboolean is_combiner_matching = ffp_combiner_mask.raw_high == cmb_mask.raw_high && ffp_combiner_mask.raw_low == cmb_mask.raw_low;
 	#define is_ffp_mask_matching(src_mask, dst_mask) \
 		(is_combiner_matching && (src_mask) == (dst_mask))
-	#define is_cached_mask_matching(src_mask, dst_mask, src_cmb_mask, dst_cmb_mask) \
-		((src_mask) == (dst_mask) && src_cmb_mask.raw_high == dst_cmb_mask.raw_high && src_cmb_mask.raw_low == dst_cmb_mask.raw_low)
 #else
 	GLboolean is_combiner_matching = ffp_combiner_mask.raw == cmb_mask.raw;
 	#define is_ffp_mask_matching(src_mask, dst_mask) \
 		(is_combiner_matching && (src_mask) == (dst_mask))
-	#define is_cached_mask_matching(src_mask, dst_mask, src_cmb_mask, dst_cmb_mask) \
-		((src_mask) == (dst_mask) && src_cmb_mask.raw == dst_cmb_mask.raw)
 #endif
 
-	if (is_ffp_mask_matching(ffp_mask.raw, mask.raw)) { // Fixed function pipeline config didn't change
-		ffp_dirty_vert = GL_FALSE;
-		ffp_dirty_frag = GL_FALSE;
-	} else {
-		ffp_dirty_frag_blend = GL_TRUE; // We need to relink fragment with vertex shader if mask changed
-
-		if ((ffp_mask.raw & VERTEX_SHADER_MASK) == vert_shader_mask) {
-			ffp_dirty_vert = GL_FALSE;
+	if (is_ffp_mask_matching(ffp_mask.raw, mask.raw)) // Fixed function pipeline config didn't change
+		return GL_FALSE;
+
+	if (!vert_shader_cache)
+		setup_shader_cache();
+
+	// Registering shaders made available by a background precompilation job
+	if (ffp_precompile_queue)
+		register_precompiled_ffp_shaders();
+
+	if ((ffp_mask.raw & VERTEX_SHADER_MASK) != vert_shader_mask) {
+		// The shader we're switching away from is the most recently used one
+		if (cur_vert_shader)
+			cur_vert_shader->last_use = ++shader_cache_tick;
+		cached_vertex_shader *cached = get_cached_vert_shader(vert_shader_mask);
+		if (cached) {
+			ffp_vertex_program = cached->prog;
+			ffp_vertex_program_id = cached->id;
+			ffp_vertex_unif_buf_size = cached->unif_buf_size;
+			ffp_vertex_unif_buf = cached->unif_buf;
+			ffp_vertex_params = cached->vert_unifs;
+			ffp_vertex_attribs = cached->attributes;
+			ffp_dirty_vert_attr = 0xFFFF;
+			cur_vert_shader = cached;
 		} else {
-			for (int i = 0; i < vert_shader_cache_size; i++) {
-				if (vert_shader_cache[i].mask.raw == vert_shader_mask) {
-					ffp_vertex_program = vert_shader_cache[i].prog;
-					ffp_vertex_program_id = vert_shader_cache[i].id;
-					ffp_vertex_unif_buf_size = vert_shader_cache[i].unif_buf_size;
-					ffp_vertex_unif_buf = vert_shader_cache[i].unif_buf;
-					ffp_vertex_params = vert_shader_cache[i].vert_unifs;
-					ffp_vertex_attribs = vert_shader_cache[i].attributes;
-					ffp_dirty_vert_attr = 0xFFFF;
-					ffp_dirty_vert = GL_FALSE;
-					break;
-				}
-			}
-			dirty_vert_unifs = 0xFFFF;
+			ffp_dirty_vert = GL_TRUE;
 		}
-		if (is_ffp_mask_matching(ffp_mask.raw & FRAGMENT_SHADER_MASK, frag_shader_mask)) {
-			ffp_dirty_frag = GL_FALSE;
+		dirty_vert_unifs = 0xFFFF;
+	}
+	if (!is_ffp_mask_matching(ffp_mask.raw & FRAGMENT_SHADER_MASK, frag_shader_mask)) {
+		if (cur_frag_shader)
+			cur_frag_shader->last_use = ++shader_cache_tick;
+#ifdef DISABLE_TEXTURE_COMBINER
+		cached_fragment_shader *cached = get_cached_frag_shader(frag_shader_mask);
+#else
+		cached_fragment_shader *cached = get_cached_frag_shader(frag_shader_mask, cmb_mask);
+#endif
+		if (cached) {
+			ffp_fragment_program = cached->prog;
+			ffp_fragment_program_id = cached->id;
+			ffp_fragment_unif_buf_size = cached->unif_buf_size;
+			ffp_fragment_unif_buf = cached->unif_buf;
+			ffp_fragment_params = cached->frag_unifs;
+			cur_frag_shader = cached;
 		} else {
-			for (int i = 0; i < frag_shader_cache_size; i++) {
-				if (is_cached_mask_matching(frag_shader_cache[i].mask.raw, frag_shader_mask, frag_shader_cache[i].cmb_mask, cmb_mask)) {
-					ffp_fragment_program = frag_shader_cache[i].prog;
-					ffp_fragment_program_id = frag_shader_cache[i].id;
-					ffp_fragment_unif_buf_size = frag_shader_cache[i].unif_buf_size;
-					ffp_fragment_unif_buf = frag_shader_cache[i].unif_buf;
-					ffp_fragment_params = frag_shader_cache[i].frag_unifs;
-					ffp_dirty_frag = GL_FALSE;
-					break;
-				}
-			}
-			dirty_frag_unifs = 0xFFFFFFFF;
+			ffp_dirty_frag = GL_TRUE;
 		}
+		dirty_frag_unifs = 0xFFFFFFFF;
+	}
 
-		ffp_mask.raw = mask.raw;
+	ffp_mask.raw = mask.raw;
 #ifndef DISABLE_TEXTURE_COMBINER
 #ifdef HAVE_HIGH_FFP_TEXUNITS
-		ffp_combiner_mask.raw_high = cmb_mask.raw_high;
-		ffp_combiner_mask.raw_low = cmb_mask.raw_low;
+	ffp_combiner_mask.raw_high = cmb_mask.raw_high;
+	ffp_combiner_mask.raw_low = cmb_mask.raw_low;
 #else
-		ffp_combiner_mask.raw = cmb_mask.raw;
+	ffp_combiner_mask.raw = cmb_mask.raw;
+#endif
 #endif
+	return GL_TRUE;
+}
+
+uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *streams, SceGxmIndexSource index_type) {
+	PROFILER_SCOPE(PROF_SHADER_RELOAD)
+#ifdef HAVE_PROFILING
+	uint32_t reload_ffp_shaders_start = sceKernelGetProcessTimeLow();
 #endif
+	// Checking if mask changed (state setters flag ffp_dirty_mask so that unchanged state draws skip the rebuild)
+	GLboolean ffp_dirty_frag_blend = ffp_blend_info.raw != blend_info.raw;
+	if (ffp_dirty_mask) {
+		if (update_ffp_mask())
+			ffp_dirty_frag_blend = GL_TRUE; // We need to relink fragment with vertex shader if mask changed
+		ffp_dirty_mask = GL_FALSE;
 	}
+	shader_mask mask = {.raw = ffp_mask.raw};
+#ifndef DISABLE_TEXTURE_COMBINER
+	combiner_mask cmb_mask = ffp_combiner_mask;
+#endif
+	uint64_t vert_shader_mask = mask.raw & VERTEX_SHADER_MASK;
+	uint64_t frag_shader_mask = mask.raw & FRAGMENT_SHADER_MASK;
 
 	// Checking if vertex shader requires a recompilation
 	if (ffp_dirty_vert) {
-		char fname[256];
-#ifdef HAVE_HIGH_FFP_TEXUNITS
-		sprintf(fname, "ux0:data/shader_cache/v%d/v/%016llX-%d.gxp", FFP_SHADER_CACHE_MAGIC, vert_shader_mask, WVP_ON_GPU);
-#else
-		sprintf(fname, "ux0:data/shader_cache/v%d/v/%08X-%d.gxp", FFP_SHADER_CACHE_MAGIC, vert_shader_mask, WVP_ON_GPU);
-#endif
-		SceUID f = sceIoOpen(fname, SCE_O_RDONLY, 0777);
-		if (f >= 0) {
-			// Gathering the precompiled shader from cache
-			uint32_t size = sceIoLseek(f, 0, SCE_SEEK_END);
-			sceIoLseek(f, 0, SCE_SEEK_SET);
-			ffp_vertex_program = (SceGxmProgram *)vglMalloc(size);
-			sceIoRead(f, ffp_vertex_program, size);
-			sceIoClose(f);
-		} else {
-			// Restarting vitaShaRK if we released it before
-			if (!is_shark_online)
-				start_shader_compiler();
-
-			// Compiling the new shader
-			char vshader[8192];
-			sprintf(vshader, ffp_vert_src, mask.clip_planes_num, mask.num_textures, mask.has_colors, mask.lights_num, mask.shading_mode, mask.normalize, mask.fixed_mask, mask.pos_fixed_mask, WVP_ON_GPU, mask.fast_perspective_correction);
-			uint32_t size = strlen(vshader);
-			SceGxmProgram *t = shark_compile_shader_extended(vshader, &size, SHARK_VERTEX_SHADER, compiler_opts, compiler_fastmath, compiler_fastprecision, compiler_fastint);
-			ffp_vertex_program = (SceGxmProgram *)vglMalloc(size);
-			vgl_fast_memcpy((void *)ffp_vertex_program, (void *)t, size);
-			shark_clear_output();
-				
-			// Saving compiled shader in filesystem cache
-			f = sceIoOpen(fname, SCE_O_WRONLY | SCE_O_TRUNC | SCE_O_CREAT, 0777);
-			sceIoWrite(f, ffp_vertex_program, size);
-			sceIoClose(f);
-		}
+		ffp_vertex_program = load_ffp_vert_shader(vert_shader_mask);
 		sceGxmShaderPatcherRegisterProgram(gxm_shader_patcher, ffp_vertex_program, &ffp_vertex_program_id);
 		ffp_vertex_unif_buf_size = sceGxmProgramGetDefaultUniformBufferSize(ffp_vertex_program);
 		ffp_vertex_unif_buf = vglMalloc(ffp_vertex_unif_buf_size);
 
-		// Adding new shader to RAM cache
-		vert_shader_cache_idx = (vert_shader_cache_idx + 1) % SHADER_CACHE_SIZE;
-		if (vert_shader_cache_size < SHADER_CACHE_SIZE) {
-			vert_shader_cache_size++;
-		} else {
-			sceGxmShaderPatcherForceUnregisterProgram(gxm_shader_patcher, vert_shader_cache[vert_shader_cache_idx].id);
-			vgl_free(vert_shader_cache[vert_shader_cache_idx].prog);
-			vgl_free(vert_shader_cache[vert_shader_cache_idx].unif_buf);
-		}
-		vert_shader_cache[vert_shader_cache_idx].mask.raw = vert_shader_mask;
-		vert_shader_cache[vert_shader_cache_idx].prog = ffp_vertex_program;
-		vert_shader_cache[vert_shader_cache_idx].id = ffp_vertex_program_id;
-		vert_shader_cache[vert_shader_cache_idx].unif_buf_size = ffp_vertex_unif_buf_size;
-		vert_shader_cache[vert_shader_cache_idx].unif_buf = ffp_vertex_unif_buf;
+		// Adding new shader to RAM cache, evicting the least recently used one if full
+		cur_vert_shader = add_cached_vert_shader(vert_shader_mask);
+		cur_vert_shader->prog = ffp_vertex_program;
+		cur_vert_shader->id = ffp_vertex_program_id;
+		cur_vert_shader->unif_buf_size = ffp_vertex_unif_buf_size;
+		cur_vert_shader->unif_buf = ffp_vertex_unif_buf;
 
 		// Reload existing uniform references
-		reload_vertex_uniforms_and_attributes(vert_shader_cache[vert_shader_cache_idx].vert_unifs, vert_shader_cache[vert_shader_cache_idx].attributes);
+		reload_vertex_uniforms_and_attributes(ffp_vertex_program, cur_vert_shader->vert_unifs, cur_vert_shader->attributes);
+		ffp_vertex_params = cur_vert_shader->vert_unifs;
+		ffp_vertex_attribs = cur_vert_shader->attributes;
+
+		// Tracking the shader in the warm-up manifest
+		record_ffp_manifest_entry(FFP_MANIFEST_VERTEX_SHADER, vert_shader_mask, 0, 0);
 
 		// Clearing dirty flags
 		ffp_dirty_vert = GL_FALSE;
@@ -850,107 +1404,11 @@ uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *str
 
 	// Checking if fragment shader requires a recompilation
 	if (ffp_dirty_frag) {
-		char fname[256];
-#ifndef DISABLE_TEXTURE_COMBINER
-#ifdef HAVE_HIGH_FFP_TEXUNITS
-		sprintf(fname, "ux0:data/shader_cache/v%d/f/%016llX-%016llX-%08X.gxp", FFP_SHADER_CACHE_MAGIC, frag_shader_mask, cmb_mask.raw_high, cmb_mask.raw_low);
-#else
-		sprintf(fname, "ux0:data/shader_cache/v%d/f/%08X-%016llX.gxp", FFP_SHADER_CACHE_MAGIC, frag_shader_mask, cmb_mask.raw);
-#endif
-#else
-#ifdef HAVE_HIGH_FFP_TEXUNITS
-		sprintf(fname, "ux0:data/shader_cache/v%d/f/%016llX-0000000000000000.gxp", FFP_SHADER_CACHE_MAGIC, frag_shader_mask);
+#ifdef DISABLE_TEXTURE_COMBINER
+		ffp_fragment_program = load_ffp_frag_shader(frag_shader_mask);
 #else
-		sprintf(fname, "ux0:data/shader_cache/v%d/f/%08X-0000000000000000.gxp", FFP_SHADER_CACHE_MAGIC, frag_shader_mask);
-#endif
-#endif
-		SceUID f = sceIoOpen(fname, SCE_O_RDONLY, 0777);
-		if (f >= 0) {
-			// Gathering the precompiled shader from cache
-			uint32_t size = sceIoLseek(f, 0, SCE_SEEK_END);
-			sceIoLseek(f, 0, SCE_SEEK_SET);
-			ffp_fragment_program = (SceGxmProgram *)vglMalloc(size);
-			sceIoRead(f, ffp_fragment_program, size);
-			sceIoClose(f);
-		} else {
-			// Restarting vitaShaRK if we released it before
-			if (!is_shark_online)
-				start_shader_compiler();
-
-			// Compiling the new shader
-			char fshader[8192];
-			char texenv_shad[8192] = {0};
-			GLboolean unused_mode[5] = {GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE};
-			for (int i = 0; i < mask.num_textures; i++) {
-#ifndef DISABLE_TEXTURE_COMBINER
-				char tmp[1024];
+		ffp_fragment_program = load_ffp_frag_shader(frag_shader_mask, cmb_mask);
 #endif
-				switch (texture_units[base_texture_id + i].env_mode) {
-				case MODULATE:
-					if (unused_mode[MODULATE]) {
-						sprintf(texenv_shad, "%s\n%s", texenv_shad, modulate_src);
-						unused_mode[MODULATE] = GL_FALSE;
-					}
-					break;
-				case DECAL:
-					if (unused_mode[DECAL]) {
-						sprintf(texenv_shad, "%s\n%s", texenv_shad, decal_src);
-						unused_mode[DECAL] = GL_FALSE;
-					}
-					break;
-				case BLEND:
-					if (unused_mode[BLEND]) {
-						sprintf(texenv_shad, "%s\n%s", texenv_shad, blend_src);
-						unused_mode[BLEND] = GL_FALSE;
-					}
-					break;
-				case ADD:
-					if (unused_mode[ADD]) {
-						sprintf(texenv_shad, "%s\n%s", texenv_shad, add_src);
-						unused_mode[ADD] = GL_FALSE;
-					}
-					break;
-				case REPLACE:
-					if (unused_mode[REPLACE]) {
-						sprintf(texenv_shad, "%s\n%s", texenv_shad, replace_src);
-						unused_mode[REPLACE] = GL_FALSE;
-					}
-					break;
-#ifndef DISABLE_TEXTURE_COMBINER
-				case COMBINE:
-					setup_combiner_pass(i, tmp);
-					sprintf(texenv_shad, "%s\n%s", texenv_shad, tmp);
-					break;
-#endif
-				default:
-					break;
-				}
-			}
-#ifdef HAVE_HIGH_FFP_TEXUNITS
-			sprintf(fshader, ffp_frag_src, texenv_shad, alpha_op,
-				mask.num_textures, mask.has_colors, mask.fog_mode,
-				(mask.tex_env_mode_pass0 != COMBINE) ? mask.tex_env_mode_pass0 : TEX0_ENV_PASS_COMBINE,
-				(mask.tex_env_mode_pass1 != COMBINE) ? mask.tex_env_mode_pass1 : TEX1_ENV_PASS_COMBINE,
-				(mask.tex_env_mode_pass2 != COMBINE) ? mask.tex_env_mode_pass2 : TEX2_ENV_PASS_COMBINE,
-				mask.lights_num, mask.shading_mode, mask.point_sprite, mask.fast_perspective_correction, mask.srgb_mode);
-#else
-			sprintf(fshader, ffp_frag_src, texenv_shad, alpha_op,
-				mask.num_textures, mask.has_colors, mask.fog_mode,
-				(mask.tex_env_mode_pass0 != COMBINE) ? mask.tex_env_mode_pass0 : TEX0_ENV_PASS_COMBINE,
-				(mask.tex_env_mode_pass1 != COMBINE) ? mask.tex_env_mode_pass1 : TEX1_ENV_PASS_COMBINE,
-				mask.lights_num, mask.shading_mode, mask.point_sprite, mask.fast_perspective_correction, mask.srgb_mode);
-#endif
-			uint32_t size = strlen(fshader);
-			SceGxmProgram *t = shark_compile_shader_extended(fshader, &size, SHARK_FRAGMENT_SHADER, compiler_opts, compiler_fastmath, compiler_fastprecision, compiler_fastint);
-			ffp_fragment_program = (SceGxmProgram *)vglMalloc(size);
-			vgl_fast_memcpy((void *)ffp_fragment_program, (void *)t, size);
-			shark_clear_output();
-
-			// Saving compiled shader in filesystem cache
-			f = sceIoOpen(fname, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
-			sceIoWrite(f, ffp_fragment_program, size);
-			sceIoClose(f);
-		}
 		sceGxmShaderPatcherRegisterProgram(gxm_shader_patcher, ffp_fragment_program, &ffp_fragment_program_id);
 		ffp_fragment_unif_buf_size = sceGxmProgramGetDefaultUniformBufferSize(ffp_fragment_program);
 		if (ffp_fragment_unif_buf_size) {
@@ -959,38 +1417,35 @@ uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *str
 			ffp_fragment_unif_buf = NULL;
 		}
 		
-		// Adding new shader to RAM cache
-		frag_shader_cache_idx = (frag_shader_cache_idx + 1) % SHADER_CACHE_SIZE;
-		if (frag_shader_cache_size < SHADER_CACHE_SIZE) {
-			frag_shader_cache_size++;
-		} else {
-			sceGxmShaderPatcherForceUnregisterProgram(gxm_shader_patcher, frag_shader_cache[frag_shader_cache_idx].id);
-			vgl_free(frag_shader_cache[frag_shader_cache_idx].prog);
-			if (frag_shader_cache[frag_shader_cache_idx].unif_buf) {
-				vgl_free(frag_shader_cache[frag_shader_cache_idx].unif_buf);
-			}
-		}
-		frag_shader_cache[frag_shader_cache_idx].mask.raw = frag_shader_mask;
-#ifndef DISABLE_TEXTURE_COMBINER
-#ifdef HAVE_HIGH_FFP_TEXUNITS
-		frag_shader_cache[frag_shader_cache_idx].cmb_mask.raw_low = cmb_mask.raw_low;
-		frag_shader_cache[frag_shader_cache_idx].cmb_mask.raw_high = cmb_mask.raw_high;
+		// Adding new shader to RAM cache, evicting the least recently used one if full
+#ifdef DISABLE_TEXTURE_COMBINER
+		cur_frag_shader = add_cached_frag_shader(frag_shader_mask);
 #else
-		frag_shader_cache[frag_shader_cache_idx].cmb_mask.raw = cmb_mask.raw;
-#endif
+		cur_frag_shader = add_cached_frag_shader(frag_shader_mask, cmb_mask);
 #endif
-		frag_shader_cache[frag_shader_cache_idx].prog = ffp_fragment_program;
-		frag_shader_cache[frag_shader_cache_idx].id = ffp_fragment_program_id;
-		frag_shader_cache[frag_shader_cache_idx].unif_buf_size = ffp_fragment_unif_buf_size;
-		frag_shader_cache[frag_shader_cache_idx].unif_buf = ffp_fragment_unif_buf;
+		cur_frag_shader->prog = ffp_fragment_program;
+		cur_frag_shader->id = ffp_fragment_program_id;
+		cur_frag_shader->unif_buf_size = ffp_fragment_unif_buf_size;
+		cur_frag_shader->unif_buf = ffp_fragment_unif_buf;
 
 		// Reload existing uniform references
-		reload_fragment_uniforms(frag_shader_cache[frag_shader_cache_idx].frag_unifs);
+		reload_fragment_uniforms(ffp_fragment_program, cur_frag_shader->frag_unifs);
+		ffp_fragment_params = cur_frag_shader->frag_unifs;
+
+		// Tracking the shader in the warm-up manifest
+#ifdef DISABLE_TEXTURE_COMBINER
+		record_ffp_manifest_entry(FFP_MANIFEST_FRAGMENT_SHADER, frag_shader_mask, 0, 0);
+#elif defined(HAVE_HIGH_FFP_TEXUNITS)
+		record_ffp_manifest_entry(FFP_MANIFEST_FRAGMENT_SHADER, frag_shader_mask, cmb_mask.raw_high, cmb_mask.raw_low);
+#else
+		record_ffp_manifest_entry(FFP_MANIFEST_FRAGMENT_SHADER, frag_shader_mask, cmb_mask.raw, 0);
+#endif
 
 		// Clearing dirty flags
 		ffp_dirty_frag = GL_FALSE;
 	}
 
+
 	// Checking if fragment shader requires a blend settings change
 	if (ffp_dirty_frag_blend) {
 		rebuild_frag_shader(ffp_fragment_program_id, &ffp_fragment_program_patched, ffp_vertex_program, SCE_GXM_OUTPUT_REGISTER_FORMAT_UCHAR4);
@@ -1005,7 +1460,7 @@ uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *str
 	// Recalculating MVP matrix if necessary
 	if (mvp_modified) {
 #ifndef HAVE_WVP_ON_GPU
-		matrix4x4_multiply(vgl_mvp_matrix, projection_matrix, modelview_matrix);
+		recalculate_mvp_matrix();
 #endif
 		// Recalculating normal matrix if necessary (TODO: This should be recalculated only when MV changes)
 		if (mask.lights_num > 0) {
@@ -1021,6 +1476,7 @@ uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *str
 			vglSetUniformData(ffp_fragment_unif_buf + ffp_fragment_params[x], SCE_GXM_PARAMETER_TYPE_F32, offs, cnt, size, ptr, SCE_GXM_PARAMETER_TYPE_F32); \
 		}
 	if (dirty_frag_unifs) {
+		PROFILER_SCOPE(PROF_UNIFORMS_UPLOAD)
 		if (ffp_fragment_unif_buf_size) {
 			uint8_t *buffer = vglReserveFragmentUniformBuffer(ffp_fragment_unif_buf_size);
 			if (ffp_fragment_params[ALPHA_CUT_UNIF] >= 0) {
@@ -1063,18 +1519,18 @@ uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *str
 				upload_ffp_fragment_unif(LIGHT_GLOBAL_AMBIENT_F_UNIF, 0, 1, 4, (const float *)&light_global_ambient.r)
 				upload_ffp_fragment_unif(SHININESS_F_UNIF, 0, 1, 1, (const float *)&current_shininess)
 				if (lights_aligned) {
-					upload_ffp_fragment_unif(LIGHTS_AMBIENTS_F_UNIF, 0, mask.lights_num, 4, (const float *)light_vars[0][0])
-					upload_ffp_fragment_unif(LIGHTS_DIFFUSES_F_UNIF, 0, mask.lights_num, 4, (const float *)light_vars[0][1])
-					upload_ffp_fragment_unif(LIGHTS_SPECULARS_F_UNIF, 0, mask.lights_num, 4, (const float *)light_vars[0][2])
-					upload_ffp_fragment_unif(LIGHTS_POSITIONS_F_UNIF, 0, mask.lights_num, 4, (const float *)light_vars[0][3])
-					upload_ffp_fragment_unif(LIGHTS_ATTENUATIONS_F_UNIF, 0, mask.lights_num, 4, (const float *)light_vars[0][4])
+					upload_ffp_fragment_unif(LIGHTS_AMBIENTS_F_UNIF, 0, mask.lights_num, 4, (const float *)ffp_light_vars[0][0])
+					upload_ffp_fragment_unif(LIGHTS_DIFFUSES_F_UNIF, 0, mask.lights_num, 4, (const float *)ffp_light_vars[0][1])
+					upload_ffp_fragment_unif(LIGHTS_SPECULARS_F_UNIF, 0, mask.lights_num, 4, (const float *)ffp_light_vars[0][2])
+					upload_ffp_fragment_unif(LIGHTS_POSITIONS_F_UNIF, 0, mask.lights_num, 4, (const float *)ffp_light_vars[0][3])
+					upload_ffp_fragment_unif(LIGHTS_ATTENUATIONS_F_UNIF, 0, mask.lights_num, 4, (const float *)ffp_light_vars[0][4])
 				} else {
 					for (int i = 0; i < mask.lights_num; i++) {
-						upload_ffp_fragment_unif(LIGHTS_AMBIENTS_F_UNIF, i, 1, 4, (const float *)light_vars[i][0])
-						upload_ffp_fragment_unif(LIGHTS_DIFFUSES_F_UNIF, i, 1, 4, (const float *)light_vars[i][1])
-						upload_ffp_fragment_unif(LIGHTS_SPECULARS_F_UNIF, i, 1, 4, (const float *)light_vars[i][2])
-						upload_ffp_fragment_unif(LIGHTS_POSITIONS_F_UNIF, i, 1, 4, (const float *)light_vars[i][3])
-						upload_ffp_fragment_unif(LIGHTS_ATTENUATIONS_F_UNIF, i, 1, 3, (const float *)light_vars[i][4])
+						upload_ffp_fragment_unif(LIGHTS_AMBIENTS_F_UNIF, i, 1, 4, (const float *)ffp_light_vars[i][0])
+						upload_ffp_fragment_unif(LIGHTS_DIFFUSES_F_UNIF, i, 1, 4, (const float *)ffp_light_vars[i][1])
+						upload_ffp_fragment_unif(LIGHTS_SPECULARS_F_UNIF, i, 1, 4, (const float *)ffp_light_vars[i][2])
+						upload_ffp_fragment_unif(LIGHTS_POSITIONS_F_UNIF, i, 1, 4, (const float *)ffp_light_vars[i][3])
+						upload_ffp_fragment_unif(LIGHTS_ATTENUATIONS_F_UNIF, i, 1, 3, (const float *)ffp_light_vars[i][4])
 					}
 				}
 			}
@@ -1089,9 +1545,10 @@ uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *str
 			vglSetUniformData(ffp_vertex_unif_buf + ffp_vertex_params[x], SCE_GXM_PARAMETER_TYPE_F32, offs, cnt, size, ptr, SCE_GXM_PARAMETER_TYPE_F32); \
 		}
 	if (dirty_vert_unifs) {
+		PROFILER_SCOPE(PROF_UNIFORMS_UPLOAD)
 		uint8_t *buffer = vglReserveVertexUniformBuffer(ffp_vertex_unif_buf_size);
 		if (ffp_vertex_params[CLIP_PLANES_EQUATION_UNIF] >= 0) {
-			upload_ffp_vertex_unif(CLIP_PLANES_EQUATION_UNIF, 0, mask.clip_planes_num, 4, &clip_planes[0].x)
+			upload_ffp_vertex_unif(CLIP_PLANES_EQUATION_UNIF, 0, mask.clip_planes_num, 4, &ffp_clip_planes[0].x)
 		}
 		if (ffp_vertex_params[MODELVIEW_MATRIX_UNIF] >= 0) {
 			upload_ffp_vertex_unif(MODELVIEW_MATRIX_UNIF, 0, 4, 4, (const float *)modelview_matrix)
@@ -1111,32 +1568,250 @@ uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *str
 				upload_ffp_vertex_unif(LIGHT_GLOBAL_AMBIENT_V_UNIF, 0, 1, 4, (const float *)&light_global_ambient.r)
 				upload_ffp_vertex_unif(SHININESS_V_UNIF, 0, 1, 1, (const float *)&current_shininess)
 				if (lights_aligned) {
-					upload_ffp_vertex_unif(LIGHTS_AMBIENTS_V_UNIF, 0, mask.lights_num, 4, (const float *)light_vars[0][0])
-					upload_ffp_vertex_unif(LIGHTS_DIFFUSES_V_UNIF, 0, mask.lights_num, 4, (const float *)light_vars[0][1])
-					upload_ffp_vertex_unif(LIGHTS_SPECULARS_V_UNIF, 0, mask.lights_num, 4, (const float *)light_vars[0][2])
-					upload_ffp_vertex_unif(LIGHTS_POSITIONS_V_UNIF, 0, mask.lights_num, 4, (const float *)light_vars[0][3])
-					upload_ffp_vertex_unif(LIGHTS_ATTENUATIONS_V_UNIF, 0, mask.lights_num, 3, (const float *)light_vars[0][4])
+					upload_ffp_vertex_unif(LIGHTS_AMBIENTS_V_UNIF, 0, mask.lights_num, 4, (const float *)ffp_light_vars[0][0])
+					upload_ffp_vertex_unif(LIGHTS_DIFFUSES_V_UNIF, 0, mask.lights_num, 4, (const float *)ffp_light_vars[0][1])
+					upload_ffp_vertex_unif(LIGHTS_SPECULARS_V_UNIF, 0, mask.lights_num, 4, (const float *)ffp_light_vars[0][2])
+					upload_ffp_vertex_unif(LIGHTS_POSITIONS_V_UNIF, 0, mask.lights_num, 4, (const float *)ffp_light_vars[0][3])
+					upload_ffp_vertex_unif(LIGHTS_ATTENUATIONS_V_UNIF, 0, mask.lights_num, 3, (const float *)ffp_light_vars[0][4])
 				} else {
 					for (int i = 0; i < mask.lights_num; i++) {
-						upload_ffp_vertex_unif(LIGHTS_AMBIENTS_V_UNIF, i, 1, 4, (const float *)light_vars[i][0])
-						upload_ffp_vertex_unif(LIGHTS_DIFFUSES_V_UNIF, i, 1, 4, (const float *)light_vars[i][1])
-						upload_ffp_vertex_unif(LIGHTS_SPECULARS_V_UNIF, i, 1, 4, (const float *)light_vars[i][2])
-						upload_ffp_vertex_unif(LIGHTS_POSITIONS_V_UNIF, i, 1, 4, (const float *)light_vars[i][3])
-						upload_ffp_vertex_unif(LIGHTS_ATTENUATIONS_V_UNIF, i, 1, 3, (const float *)light_vars[i][4])
+						upload_ffp_vertex_unif(LIGHTS_AMBIENTS_V_UNIF, i, 1, 4, (const float *)ffp_light_vars[i][0])
+						upload_ffp_vertex_unif(LIGHTS_DIFFUSES_V_UNIF, i, 1, 4, (const float *)ffp_light_vars[i][1])
+						upload_ffp_vertex_unif(LIGHTS_SPECULARS_V_UNIF, i, 1, 4, (const float *)ffp_light_vars[i][2])
+						upload_ffp_vertex_unif(LIGHTS_POSITIONS_V_UNIF, i, 1, 4, (const float *)ffp_light_vars[i][3])
+						upload_ffp_vertex_unif(LIGHTS_ATTENUATIONS_V_UNIF, i, 1, 3, (const float *)ffp_light_vars[i][4])
 					}
 				}
 			}
 		}
-		sceClibMemcpy(buffer, ffp_vertex_unif_buf, ffp_vertex_unif_buf_size);
-		dirty_vert_unifs = 0;
+		sceClibMemcpy(buffer, ffp_vertex_unif_buf, ffp_vertex_unif_buf_size);
+		dirty_vert_unifs = 0;
+	}
+#ifdef HAVE_PROFILING
+	ffp_reload_profiler_cnt += sceKernelGetProcessTimeLow() - reload_ffp_shaders_start;
+#endif
+	return ffp_draw_mask_state;
+}
+
+#ifdef HAVE_CLIENT_ARRAYS_CACHE
+#define CLIENT_ARRAYS_CACHE_SIZE 64 // Maximum number of tracked client arrays ranges (must be a power of two)
+#define CLIENT_ARRAYS_CACHE_PROBES 4 // Number of slots a range can be stored in
+#define CLIENT_ARRAYS_CACHE_LIFETIME 60 // Number of frames prior a cached client array range gets released if not used
+#define CLIENT_ARRAYS_SAMPLES_NUM 8 // Number of chunks sampled for the pre-check signature
+#define CLIENT_ARRAYS_SAMPLE_SIZE 32 // Size in bytes of a sampled chunk
+
+typedef struct {
+	uint8_t *src; // Client memory address
+	uint32_t size; // Size in bytes of the range
+	uint64_t sample; // Signature of the sampled chunks of the range
+	uint64_t hash; // Hash of the whole range content at the time the GPU mapped copy got made
+	uint8_t *ptr; // GPU mapped copy of the range (NULL if not yet promoted)
+	uint32_t last_frame; // Last frame the range got used
+} client_array_range;
+
+static client_array_range client_arrays_cache[CLIENT_ARRAYS_CACHE_SIZE];
+uint32_t vgl_client_arrays_cache_threshold = 0x4000; // Minimum size in bytes for a client array range to be cacheable
+uint32_t vgl_client_arrays_cache_hits = 0; // Number of copies avoided thanks to the client arrays cache
+uint32_t vgl_client_arrays_cache_misses = 0; // Number of cacheable ranges that required a copy
+uint64_t vgl_client_arrays_cache_saved = 0; // Number of bytes not copied thanks to the client arrays cache
+
+static inline __attribute__((always_inline)) uint64_t sample_client_range(uint8_t *src, uint32_t size) {
+	// Hashing few evenly spaced chunks of the range, way cheaper than hashing the whole range
+	uint64_t res = size;
+	uint32_t step = (size - CLIENT_ARRAYS_SAMPLE_SIZE) / (CLIENT_ARRAYS_SAMPLES_NUM - 1);
+	for (int i = 0; i < CLIENT_ARRAYS_SAMPLES_NUM; i++) {
+		res = XXH3_64bits_withSeed(src + i * step, CLIENT_ARRAYS_SAMPLE_SIZE, res);
+	}
+	return res;
+}
+
+static inline __attribute__((always_inline)) void release_client_range(client_array_range *r) {
+	if (r->ptr)
+		mark_as_dirty(r->ptr);
+	r->src = NULL;
+	r->ptr = NULL;
+}
+
+static inline __attribute__((always_inline)) uint32_t client_range_slot(uint8_t *src, uint32_t size) {
+	return (((uint32_t)src >> 4) ^ size) * 0x9E3779B1 >> (32 - __builtin_ctz(CLIENT_ARRAYS_CACHE_SIZE));
+}
+
+void age_client_arrays_cache(void) {
+	// Releasing ranges not used since a lot of time, performed once per frame to keep draws lookups cheap
+	for (int i = 0; i < CLIENT_ARRAYS_CACHE_SIZE; i++) {
+		client_array_range *e = &client_arrays_cache[i];
+		if (e->src && vgl_framecount - e->last_frame > CLIENT_ARRAYS_CACHE_LIFETIME)
+			release_client_range(e);
+	}
+}
+
+/*
+ * Returns a GPU mapped copy of a client array range whose content didn't change since
+ * last time it got used, or NULL if the range has to be copied. A signature of few sampled
+ * chunks is used as a cheap pre-check to reject changed ranges: a range whose signature is
+ * stable gets promoted to a dedicated allocation, and later draws reuse it only if a hash
+ * of the whole range still matches the one of the copy.
+ */
+static uint8_t *get_cached_client_range(uint8_t *src, uint32_t size) {
+	client_array_range *r = NULL;
+	client_array_range *slot = NULL;
+	uint32_t idx = client_range_slot(src, size);
+	for (int i = 0; i < CLIENT_ARRAYS_CACHE_PROBES; i++) {
+		client_array_range *e = &client_arrays_cache[(idx + i) & (CLIENT_ARRAYS_CACHE_SIZE - 1)];
+		if (e->src == src && e->size == size) {
+			r = e;
+			break;
+		}
+		// Picking a free slot or the least recently used one for a new range
+		if (!slot || (slot->src && (!e->src || e->last_frame < slot->last_frame)))
+			slot = e;
+	}
+
+	uint64_t sample = sample_client_range(src, size);
+	if (!r) {
+		release_client_range(slot);
+		slot->src = src;
+		slot->size = size;
+		slot->sample = sample;
+		slot->last_frame = vgl_framecount;
+		vgl_client_arrays_cache_misses++;
+		return NULL;
+	}
+	r->last_frame = vgl_framecount;
+
+	// Sampled chunks changed, content surely changed too
+	if (r->sample != sample) {
+		r->sample = sample;
+		if (r->ptr) {
+			mark_as_dirty(r->ptr);
+			r->ptr = NULL;
+		}
+		vgl_client_arrays_cache_misses++;
+		return NULL;
+	}
+
+	if (!r->ptr) {
+		// Signature is stable, promoting the range to a dedicated allocation in place of the regular staging copy
+		r->ptr = (uint8_t *)gpu_alloc_mapped_for_cpu(size);
+		if (r->ptr) {
+			vgl_fast_memcpy(r->ptr, src, size);
+			r->hash = XXH3_64bits(src, size);
+		}
+		vgl_client_arrays_cache_misses++;
+		return r->ptr;
+	}
+
+	// Sampled chunks match, confirming the whole content didn't change
+	uint64_t hash = XXH3_64bits(src, size);
+	if (r->hash != hash) {
+		// Content changed outside of the sampled chunks, the copy gets refreshed on a new allocation since the GPU may still be using it
+		mark_as_dirty(r->ptr);
+		r->ptr = (uint8_t *)gpu_alloc_mapped_for_cpu(size);
+		if (r->ptr) {
+			vgl_fast_memcpy(r->ptr, src, size);
+			r->hash = hash;
+		}
+		vgl_client_arrays_cache_misses++;
+		return r->ptr;
+	}
+
+	vgl_client_arrays_cache_hits++;
+	vgl_client_arrays_cache_saved += size;
+	return r->ptr;
+}
+#endif
+
+#ifndef DRAW_SPEEDHACK
+/*
+ * Copies client arrays into GPU mapped memory with a single allocation.
+ * Arrays sharing the same stride whose vertices overlap (interleaved arrays) are
+ * copied only once with their streams pointing at their offset in the staged range.
+ */
+static void stage_client_arrays(void **ptrs, uint8_t **srcs, uint32_t *strides, int num, uint32_t num_vertices) {
+	uint8_t *range_start[FFP_VERTEX_ATTRIBS_NUM];
+	uint8_t *range_end[FFP_VERTEX_ATTRIBS_NUM];
+	uint8_t *range_ref[FFP_VERTEX_ATTRIBS_NUM];
+	uint32_t range_stride[FFP_VERTEX_ATTRIBS_NUM];
+	uint32_t range_offs[FFP_VERTEX_ATTRIBS_NUM];
+	int range_idx[FFP_VERTEX_ATTRIBS_NUM];
+	int ranges = 0;
+
+	// Grouping interleaved arrays into shared ranges
+	for (int i = 0; i < num; i++) {
+		if (!srcs[i])
+			continue;
+		uint8_t *start = srcs[i];
+		uint8_t *end = start + num_vertices * strides[i];
+		int r;
+		for (r = 0; r < ranges; r++) {
+			if (range_stride[r] == strides[i] && start < range_ref[r] + strides[i] && range_ref[r] < start + strides[i]) {
+				if (start < range_start[r])
+					range_start[r] = start;
+				if (end > range_end[r])
+					range_end[r] = end;
+				break;
+			}
+		}
+		if (r == ranges) {
+			range_start[r] = start;
+			range_end[r] = end;
+			range_ref[r] = start;
+			range_stride[r] = strides[i];
+			ranges++;
+		}
+		range_idx[i] = r;
 	}
-#ifdef HAVE_PROFILING
-	ffp_reload_profiler_cnt += sceKernelGetProcessTimeLow() - reload_ffp_shaders_start;
+	if (!ranges)
+		return;
+
+#ifdef HAVE_CLIENT_ARRAYS_CACHE
+	// Reusing copies of ranges that didn't change since last time they got used
+	uint8_t *range_ptr[FFP_VERTEX_ATTRIBS_NUM];
+	for (int r = 0; r < ranges; r++) {
+		uint32_t range_size = range_end[r] - range_start[r];
+		if (range_size >= vgl_client_arrays_cache_threshold && range_size >= CLIENT_ARRAYS_SAMPLE_SIZE)
+			range_ptr[r] = get_cached_client_range(range_start[r], range_size);
+		else
+			range_ptr[r] = NULL;
+	}
+#endif
+
+	// Packing all the ranges in a single staging block
+	uint32_t size = 0;
+	for (int r = 0; r < ranges; r++) {
+		range_offs[r] = size;
+#ifdef HAVE_CLIENT_ARRAYS_CACHE
+		if (range_ptr[r])
+			continue;
+#endif
+		size += VGL_ALIGN(range_end[r] - range_start[r], 4);
+	}
+	uint8_t *staging = size ? (uint8_t *)gpu_alloc_mapped_temp(size) : NULL;
+	for (int r = 0; r < ranges; r++) {
+#ifdef HAVE_CLIENT_ARRAYS_CACHE
+		if (range_ptr[r])
+			continue;
+#endif
+		vgl_fast_memcpy(staging + range_offs[r], range_start[r], range_end[r] - range_start[r]);
+	}
+	for (int i = 0; i < num; i++) {
+		if (srcs[i]) {
+			int r = range_idx[i];
+#ifdef HAVE_CLIENT_ARRAYS_CACHE
+			if (range_ptr[r]) {
+				ptrs[i] = range_ptr[r] + (srcs[i] - range_start[r]);
+				continue;
+			}
 #endif
-	return draw_mask_state;
+			ptrs[i] = staging + range_offs[r] + (srcs[i] - range_start[r]);
+		}
+	}
 }
+#endif
 
 void _glDrawArrays_FixedFunctionIMPL(GLint first, GLsizei count) {
+	PROFILER_SCOPE(PROF_FFP_DRAW)
+	vgl_perf_counters.ffp_draws++;
 	uint8_t mask_state = reload_ffp_shaders(NULL, NULL, SCE_GXM_INDEX_SOURCE_INDEX_16BIT);
 #ifdef HAVE_PROFILING
 	uint32_t draw_start = sceKernelGetProcessTimeLow();
@@ -1177,6 +1852,11 @@ void _glDrawArrays_FixedFunctionIMPL(GLint first, GLsizei count) {
 
 	// Uploading vertex streams
 	int j = 0;
+	void *ptrs[FFP_VERTEX_ATTRIBS_NUM];
+#ifndef DRAW_SPEEDHACK
+	uint8_t *srcs[FFP_VERTEX_ATTRIBS_NUM] = {NULL};
+	uint32_t src_strides[FFP_VERTEX_ATTRIBS_NUM];
+#endif
 	for (int i = 0; i < FFP_VERTEX_ATTRIBS_NUM; i++) {
 		if (mask_state & (1 << i)) {
 			int id;
@@ -1226,8 +1906,9 @@ void _glDrawArrays_FixedFunctionIMPL(GLint first, GLsizei count) {
 							} else
 #endif
 							{
-								ptr = gpu_alloc_mapped_temp(size);
-								vgl_fast_memcpy(ptr, (void *)ffp_vertex_attrib_offsets[FFP_ATTRIB_COLOR] + first * ffp_vertex_stream_config[FFP_ATTRIB_COLOR].stride, size);
+								ptr = NULL;
+								srcs[j] = (uint8_t *)ffp_vertex_attrib_offsets[FFP_ATTRIB_COLOR] + first * ffp_vertex_stream_config[FFP_ATTRIB_COLOR].stride;
+								src_strides[j] = ffp_vertex_stream_config[FFP_ATTRIB_COLOR].stride;
 							}
 						} else {
 							uint32_t size = count * ffp_vertex_stream_config[FFP_ATTRIB_NORMAL].stride;
@@ -1237,8 +1918,9 @@ void _glDrawArrays_FixedFunctionIMPL(GLint first, GLsizei count) {
 							} else
 #endif
 							{
-								ptr = gpu_alloc_mapped_temp(size);
-								vgl_fast_memcpy(ptr, (void *)ffp_vertex_attrib_offsets[FFP_ATTRIB_NORMAL] + first * ffp_vertex_stream_config[FFP_ATTRIB_NORMAL].stride, size);
+								ptr = NULL;
+								srcs[j] = (uint8_t *)ffp_vertex_attrib_offsets[FFP_ATTRIB_NORMAL] + first * ffp_vertex_stream_config[FFP_ATTRIB_NORMAL].stride;
+								src_strides[j] = ffp_vertex_stream_config[FFP_ATTRIB_NORMAL].stride;
 							}
 						}
 #endif
@@ -1254,22 +1936,59 @@ void _glDrawArrays_FixedFunctionIMPL(GLint first, GLsizei count) {
 					} else
 #endif
 					{
-						ptr = gpu_alloc_mapped_temp(size);
-						vgl_fast_memcpy(ptr, (void *)ffp_vertex_attrib_offsets[id] + first * ffp_vertex_stream_config[id].stride, size);
+						ptr = NULL;
+						srcs[j] = (uint8_t *)ffp_vertex_attrib_offsets[id] + first * ffp_vertex_stream_config[id].stride;
+						src_strides[j] = ffp_vertex_stream_config[id].stride;
 					}
 #endif
 				}
 			}
-			sceGxmSetVertexStream(gxm_context, j++, ptr);
+			ptrs[j++] = ptr;
 		}
 	}
+#ifndef DRAW_SPEEDHACK
+	stage_client_arrays(ptrs, srcs, src_strides, j, count);
+#endif
+	for (int i = 0; i < j; i++) {
+		sceGxmSetVertexStream(gxm_context, i, ptrs[i]);
+	}
 #ifdef HAVE_PROFILING
 	ffp_draw_profiler_cnt += sceKernelGetProcessTimeLow() - draw_start;
 	ffp_draw_cnt++;
 #endif
 }
 
+// Uploads the vertex uniforms of a draw of vglMultiDrawArraysMatrices, matrices products are written straight into the reserved buffer
+static void upload_ffp_palette_matrix(const GLfloat *m) {
+	PROFILER_SCOPE(PROF_UNIFORMS_UPLOAD)
+	matrix4x4 model, mv;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			model[i][j] = m[j * 4 + i];
+		}
+	}
+	uint8_t model_kind = matrix4x4_get_kind(model);
+	uint8_t kind = matrix_kind_combine(modelview_kind, model_kind);
+	matrix4x4_multiply_kind(mv, modelview_matrix, modelview_kind, model, model_kind);
+
+	uint8_t *buffer = vglReserveVertexUniformBuffer(ffp_vertex_unif_buf_size);
+	sceClibMemcpy(buffer, ffp_vertex_unif_buf, ffp_vertex_unif_buf_size);
+	if (ffp_vertex_params[MODELVIEW_MATRIX_UNIF] >= 0) {
+		vglSetUniformData(buffer + ffp_vertex_params[MODELVIEW_MATRIX_UNIF], SCE_GXM_PARAMETER_TYPE_F32, 0, 4, 4, (const float *)mv, SCE_GXM_PARAMETER_TYPE_F32);
+	}
+#ifndef HAVE_WVP_ON_GPU
+	matrix4x4_multiply_kind(*(matrix4x4 *)(buffer + ffp_vertex_params[WVP_MATRIX_UNIF]), projection_matrix, projection_kind, mv, kind);
+#endif
+	if (ffp_vertex_params[NORMAL_MATRIX_UNIF] >= 0) {
+		matrix3x3 normal;
+		matrix4x4_normal_matrix_kind(normal, mv, kind);
+		vglSetUniformData(buffer + ffp_vertex_params[NORMAL_MATRIX_UNIF], SCE_GXM_PARAMETER_TYPE_F32, 0, 3, 3, (const float *)normal, SCE_GXM_PARAMETER_TYPE_F32);
+	}
+}
+
 void _glMultiDrawArrays_FixedFunctionIMPL(SceGxmPrimitiveType gxm_p, uint16_t *idx_ptr, const GLint *first, const GLsizei *count, GLint lowest, GLsizei highest, GLsizei drawcount) {
+	PROFILER_SCOPE(PROF_FFP_DRAW)
+	vgl_perf_counters.ffp_draws++;
 	uint8_t mask_state = reload_ffp_shaders(NULL, NULL, SCE_GXM_INDEX_SOURCE_INDEX_16BIT);
 #ifdef HAVE_PROFILING
 	uint32_t draw_start = sceKernelGetProcessTimeLow();
@@ -1312,6 +2031,9 @@ void _glMultiDrawArrays_FixedFunctionIMPL(SceGxmPrimitiveType gxm_p, uint16_t *i
 	int j = 0;
 	void *ptrs[FFP_VERTEX_ATTRIBS_NUM];
 	uint32_t strides[FFP_VERTEX_ATTRIBS_NUM];
+#ifndef DRAW_SPEEDHACK
+	uint8_t *srcs[FFP_VERTEX_ATTRIBS_NUM] = {NULL};
+#endif
 	for (int i = 0; i < FFP_VERTEX_ATTRIBS_NUM; i++) {
 		if (mask_state & (1 << i)) {
 			int id;
@@ -1366,8 +2088,8 @@ void _glMultiDrawArrays_FixedFunctionIMPL(SceGxmPrimitiveType gxm_p, uint16_t *i
 							} else
 #endif
 							{
-								ptrs[j] = gpu_alloc_mapped_temp(size);
-								vgl_fast_memcpy(ptrs[j], (void *)ffp_vertex_attrib_offsets[FFP_ATTRIB_COLOR] + lowest * ffp_vertex_stream_config[FFP_ATTRIB_COLOR].stride, size);
+								ptrs[j] = NULL;
+								srcs[j] = (uint8_t *)ffp_vertex_attrib_offsets[FFP_ATTRIB_COLOR] + lowest * ffp_vertex_stream_config[FFP_ATTRIB_COLOR].stride;
 							}
 							strides[j] = ffp_vertex_stream_config[FFP_ATTRIB_COLOR].stride;
 						} else {
@@ -1378,8 +2100,8 @@ void _glMultiDrawArrays_FixedFunctionIMPL(SceGxmPrimitiveType gxm_p, uint16_t *i
 							} else
 #endif
 							{
-								ptrs[j] = gpu_alloc_mapped_temp(size);
-								vgl_fast_memcpy(ptrs[j], (void *)ffp_vertex_attrib_offsets[FFP_ATTRIB_NORMAL] + lowest * ffp_vertex_stream_config[FFP_ATTRIB_NORMAL].stride, size);
+								ptrs[j] = NULL;
+								srcs[j] = (uint8_t *)ffp_vertex_attrib_offsets[FFP_ATTRIB_NORMAL] + lowest * ffp_vertex_stream_config[FFP_ATTRIB_NORMAL].stride;
 							}
 							strides[j] = ffp_vertex_stream_config[FFP_ATTRIB_NORMAL].stride;
 						}
@@ -1397,8 +2119,8 @@ void _glMultiDrawArrays_FixedFunctionIMPL(SceGxmPrimitiveType gxm_p, uint16_t *i
 					} else
 #endif
 					{
-						ptrs[j] = gpu_alloc_mapped_temp(size);
-						vgl_fast_memcpy(ptrs[j], (void *)ffp_vertex_attrib_offsets[id] + lowest * ffp_vertex_stream_config[id].stride, size);
+						ptrs[j] = NULL;
+						srcs[j] = (uint8_t *)ffp_vertex_attrib_offsets[id] + lowest * ffp_vertex_stream_config[id].stride;
 					}
 #endif
 				}
@@ -1406,13 +2128,24 @@ void _glMultiDrawArrays_FixedFunctionIMPL(SceGxmPrimitiveType gxm_p, uint16_t *i
 			j++;
 		}
 	}
+#ifndef DRAW_SPEEDHACK
+	stage_client_arrays(ptrs, srcs, strides, j, highest - lowest);
+#endif
 	
 	for (int i = 0; i < drawcount; i++) {
+		if (matrix_palette) {
+			upload_ffp_palette_matrix(&matrix_palette[i * 16]);
+		}
 		for (int z = 0; z < j; z++) {
 			sceGxmSetVertexStream(gxm_context, z, ptrs[z] + (first[i] - lowest) * strides[z]);
 		}
 		sceGxmDraw(gxm_context, gxm_p, SCE_GXM_INDEX_FORMAT_U16, idx_ptr, count[i]);
 	}
+
+	// Bound vertex uniforms buffer holds the last draw matrices, so it needs to be uploaded again on next draw
+	if (matrix_palette) {
+		flag_dirty_vert_unif(WVP_MATRIX_UNIF)
+	}
 #ifdef HAVE_PROFILING
 	ffp_draw_profiler_cnt += sceKernelGetProcessTimeLow() - draw_start;
 	ffp_draw_cnt++;
@@ -1420,6 +2153,8 @@ void _glMultiDrawArrays_FixedFunctionIMPL(SceGxmPrimitiveType gxm_p, uint16_t *i
 }
 
 void _glDrawElements_FixedFunctionIMPL(uint16_t *idx_buf, GLsizei count, uint32_t top_idx, uint32_t base_idx, SceGxmIndexSource index_type) {
+	PROFILER_SCOPE(PROF_FFP_DRAW)
+	vgl_perf_counters.ffp_draws++;
 	uint8_t mask_state = reload_ffp_shaders(NULL, NULL, index_type);
 #ifdef HAVE_PROFILING
 	uint32_t draw_start = sceKernelGetProcessTimeLow();
@@ -1516,6 +2251,11 @@ void _glDrawElements_FixedFunctionIMPL(uint16_t *idx_buf, GLsizei count, uint32_
 	}
 
 	// Uploading vertex streams
+	void *ptrs[FFP_VERTEX_ATTRIBS_NUM];
+#ifndef DRAW_SPEEDHACK
+	uint8_t *srcs[FFP_VERTEX_ATTRIBS_NUM] = {NULL};
+	uint32_t src_strides[FFP_VERTEX_ATTRIBS_NUM];
+#endif
 	for (int i = 0; i < attr_num; i++) {
 		void *ptr;
 		int attr_idx = attr_idxs[i];
@@ -1549,8 +2289,9 @@ void _glDrawElements_FixedFunctionIMPL(uint16_t *idx_buf, GLsizei count, uint32_
 						} else
 #endif
 						{
-							ptr = gpu_alloc_mapped_temp(size);
-							vgl_fast_memcpy(ptr, (void *)ffp_vertex_attrib_offsets[FFP_ATTRIB_COLOR], size);
+							ptr = NULL;
+							srcs[i] = (uint8_t *)ffp_vertex_attrib_offsets[FFP_ATTRIB_COLOR];
+							src_strides[i] = ffp_vertex_stream_config[FFP_ATTRIB_COLOR].stride;
 						}
 					} else {
 						uint32_t size = top_idx * ffp_vertex_stream_config[FFP_ATTRIB_NORMAL].stride;
@@ -1560,8 +2301,9 @@ void _glDrawElements_FixedFunctionIMPL(uint16_t *idx_buf, GLsizei count, uint32_
 						} else
 #endif
 						{
-							ptr = gpu_alloc_mapped_temp(size);
-							vgl_fast_memcpy(ptr, (void *)ffp_vertex_attrib_offsets[FFP_ATTRIB_NORMAL], size);
+							ptr = NULL;
+							srcs[i] = (uint8_t *)ffp_vertex_attrib_offsets[FFP_ATTRIB_NORMAL];
+							src_strides[i] = ffp_vertex_stream_config[FFP_ATTRIB_NORMAL].stride;
 						}
 					}
 #endif
@@ -1577,13 +2319,20 @@ void _glDrawElements_FixedFunctionIMPL(uint16_t *idx_buf, GLsizei count, uint32_
 				} else
 #endif
 				{
-					ptr = gpu_alloc_mapped_temp(size);
-					vgl_fast_memcpy(ptr, (void *)ffp_vertex_attrib_offsets[attr_idx], size);
+					ptr = NULL;
+					srcs[i] = (uint8_t *)ffp_vertex_attrib_offsets[attr_idx];
+					src_strides[i] = ffp_vertex_stream_config[attr_idx].stride;
 				}
 #endif
 			}
 		}
-		sceGxmSetVertexStream(gxm_context, i, ptr);
+		ptrs[i] = ptr;
+	}
+#ifndef DRAW_SPEEDHACK
+	stage_client_arrays(ptrs, srcs, src_strides, attr_num, top_idx);
+#endif
+	for (int i = 0; i < attr_num; i++) {
+		sceGxmSetVertexStream(gxm_context, i, ptrs[i]);
 	}
 #ifdef HAVE_PROFILING
 	ffp_draw_profiler_cnt += sceKernelGetProcessTimeLow() - draw_start;
@@ -1592,7 +2341,7 @@ void _glDrawElements_FixedFunctionIMPL(uint16_t *idx_buf, GLsizei count, uint32_
 }
 
 void update_fogging_state() {
-	ffp_dirty_frag = GL_TRUE;
+	ffp_dirty_mask = GL_TRUE;
 	if (fogging) {
 		switch (fog_mode) {
 		case GL_LINEAR:
@@ -1624,8 +2373,7 @@ void glEnableClientState(GLenum array) {
 	if (_vgl_enqueue_list_func(glEnableClientState, DLIST_FUNC_U32, array))
 		return;
 #endif
-	ffp_dirty_vert = GL_TRUE;
-	ffp_dirty_frag = GL_TRUE;
+	ffp_dirty_mask = GL_TRUE;
 	switch (array) {
 	case GL_VERTEX_ARRAY:
 		ffp_vertex_attrib_state |= (1 << FFP_ATTRIB_POSITION);
@@ -1656,8 +2404,7 @@ void glDisableClientState(GLenum array) {
 	if (_vgl_enqueue_list_func(glEnableClientState, DLIST_FUNC_U32, array))
 		return;
 #endif
-	ffp_dirty_vert = GL_TRUE;
-	ffp_dirty_frag = GL_TRUE;
+	ffp_dirty_mask = GL_TRUE;
 	switch (array) {
 	case GL_VERTEX_ARRAY:
 		ffp_vertex_attrib_state &= ~(1 << FFP_ATTRIB_POSITION);
@@ -1701,6 +2448,7 @@ void glVertexPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *poin
 	SceGxmVertexStream *streams = &ffp_vertex_stream_config[FFP_ATTRIB_POSITION];
 	ffp_dirty_vert_attr |= (1 << FFP_ATTRIB_POSITION);
 
+	uint8_t orig_fixed_mask = ffp_vertex_attrib_fixed_pos_mask;
 	unsigned short bpe;
 	switch (type) {
 	case GL_FLOAT:
@@ -1721,6 +2469,8 @@ void glVertexPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *poin
 	default:
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_ENUM, type)
 	}
+	if (orig_fixed_mask != ffp_vertex_attrib_fixed_pos_mask)
+		ffp_dirty_mask = GL_TRUE;
 	attributes->componentCount = size;
 	streams->stride = stride ? stride : bpe * size;
 }
@@ -1796,6 +2546,7 @@ void glNormalPointer(GLenum type, GLsizei stride, const void *pointer) {
 	SceGxmVertexStream *streams = &ffp_vertex_stream_config[FFP_ATTRIB_NORMAL];
 	ffp_dirty_vert_attr |= (1 << FFP_ATTRIB_NORMAL);
 
+	uint8_t orig_fixed_mask = ffp_vertex_attrib_fixed_mask;
 	unsigned short bpe;
 	switch (type) {
 	case GL_FLOAT:
@@ -1821,6 +2572,8 @@ void glNormalPointer(GLenum type, GLsizei stride, const void *pointer) {
 	default:
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_ENUM, type)
 	}
+	if (orig_fixed_mask != ffp_vertex_attrib_fixed_mask)
+		ffp_dirty_mask = GL_TRUE;
 	attributes->componentCount = 3;
 	streams->stride = stride ? stride : bpe * 3;
 }
@@ -1846,6 +2599,7 @@ void glTexCoordPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *po
 	SceGxmVertexStream *streams = &ffp_vertex_stream_config[FFP_ATTRIB_TEX(client_texture_unit)];
 	ffp_dirty_vert_attr |= (1 << FFP_ATTRIB_TEX(client_texture_unit));
 
+	uint8_t orig_fixed_mask = ffp_vertex_attrib_fixed_mask;
 	unsigned short bpe;
 	switch (type) {
 	case GL_FLOAT:
@@ -1866,6 +2620,8 @@ void glTexCoordPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *po
 	default:
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_ENUM, type)
 	}
+	if (orig_fixed_mask != ffp_vertex_attrib_fixed_mask)
+		ffp_dirty_mask = GL_TRUE;
 	attributes->componentCount = size;
 	streams->stride = stride ? stride : bpe * size;
 }
@@ -1923,6 +2679,44 @@ void glInterleavedArrays(GLenum format, GLsizei stride, const void *pointer) {
 	}
 }
 
+static void legacy_lit_promote_attr(int attr) {
+	// Expanding already emitted vertices so that they carry the attribute value they got emitted with
+	uint8_t size = legacy_lit_attr_size[attr];
+	uint8_t new_stride = legacy_lit_stride + size;
+	uint8_t ins = legacy_lit_base;
+	for (int i = 0; i < attr; i++) {
+		if (legacy_lit_varying & (1 << i))
+			ins += legacy_lit_attr_size[i];
+	}
+	float *val = &current_vtx.amb.x + legacy_lit_attr_offs[attr];
+	for (int i = vertex_count - 1; i >= 0; i--) {
+		float *src = legacy_pool + i * legacy_lit_stride;
+		float *dst = legacy_pool + i * new_stride;
+		sceClibMemmove(dst + ins + size, src + ins, sizeof(float) * (legacy_lit_stride - ins));
+		vgl_fast_memcpy(dst + ins, val, sizeof(float) * size);
+		if (dst != src)
+			sceClibMemmove(dst, src, sizeof(float) * ins);
+	}
+	legacy_lit_varying |= (1 << attr);
+	legacy_lit_stride = new_stride;
+	legacy_pool_ptr = legacy_pool + vertex_count * new_stride;
+}
+
+static void legacy_lit_set_attr(int attr, const float *v) {
+	float *dst = &current_vtx.amb.x + legacy_lit_attr_offs[attr];
+
+	// Attributes are stored per-vertex only once they change inside a glBegin/glEnd block
+	if (legacy_lit_tracking && vertex_count && !(legacy_lit_varying & (1 << attr))) {
+		for (int i = 0; i < legacy_lit_attr_size[attr]; i++) {
+			if (dst[i] != v[i]) {
+				legacy_lit_promote_attr(attr);
+				break;
+			}
+		}
+	}
+	vgl_fast_memcpy(dst, v, sizeof(float) * legacy_lit_attr_size[attr]);
+}
+
 inline void glVertex3f(GLfloat x, GLfloat y, GLfloat z) {
 	THREAD_SAFE()
 
@@ -1941,29 +2735,33 @@ inline void glVertex3f(GLfloat x, GLfloat y, GLfloat z) {
 	legacy_pool_ptr[0] = x;
 	legacy_pool_ptr[1] = y;
 	legacy_pool_ptr[2] = z;
-	if (texture_units[1].state) { // Multitexturing enabled
+	if (legacy_lit_tracking) { // Lighting enabled, only texcoords and lighting attributes changed since glBegin are stored per-vertex
+		if (texture_units[1].state) {
+			vgl_fast_memcpy(legacy_pool_ptr + 3, &current_vtx.uv.x, sizeof(float) * 2);
+			vgl_fast_memcpy(legacy_pool_ptr + 5, &current_vtx.uv2.x, sizeof(float) * 2);
+		} else if (texture_units[0].state) {
+			vgl_fast_memcpy(legacy_pool_ptr + 3, &current_vtx.uv.x, sizeof(float) * 2);
+		}
+		if (legacy_lit_varying) {
+			float *dst = legacy_pool_ptr + legacy_lit_base;
+			for (int i = 0; i < LEGACY_LIT_ATTRIBS_NUM; i++) {
+				if (legacy_lit_varying & (1 << i)) {
+					vgl_fast_memcpy(dst, &current_vtx.amb.x + legacy_lit_attr_offs[i], sizeof(float) * legacy_lit_attr_size[i]);
+					dst += legacy_lit_attr_size[i];
+				}
+			}
+		}
+		legacy_pool_ptr += legacy_lit_stride;
+	} else if (texture_units[1].state) { // Multitexturing enabled
 		vgl_fast_memcpy(legacy_pool_ptr + 3, &current_vtx.uv.x, sizeof(float) * 2);
 		vgl_fast_memcpy(legacy_pool_ptr + 5, &current_vtx.uv2.x, sizeof(float) * 2);
-		if (lighting_state) {
-			vgl_fast_memcpy(legacy_pool_ptr + 7, &current_vtx.amb.x, sizeof(float) * 19);
-		} else {
-			vgl_fast_memcpy(legacy_pool_ptr + 7, &current_vtx.clr.x, sizeof(float) * 4);
-		}
+		vgl_fast_memcpy(legacy_pool_ptr + 7, &current_vtx.clr.x, sizeof(float) * 4);
 		legacy_pool_ptr += LEGACY_MT_VERTEX_STRIDE;
 	} else if (texture_units[0].state) { // Texturing enabled
-		if (lighting_state) {
-			vgl_fast_memcpy(legacy_pool_ptr + 3, &current_vtx.uv.x, sizeof(float) * 2);
-			vgl_fast_memcpy(legacy_pool_ptr + 5, &current_vtx.amb.x, sizeof(float) * 19);
-		} else {
-			vgl_fast_memcpy(legacy_pool_ptr + 3, &current_vtx.uv.x, sizeof(float) * 6);
-		}
+		vgl_fast_memcpy(legacy_pool_ptr + 3, &current_vtx.uv.x, sizeof(float) * 6);
 		legacy_pool_ptr += LEGACY_VERTEX_STRIDE;
 	} else { // Texturing disabled
-		if (lighting_state) {
-			vgl_fast_memcpy(legacy_pool_ptr + 3, &current_vtx.amb.x, sizeof(float) * 19);
-		} else {
-			vgl_fast_memcpy(legacy_pool_ptr + 3, &current_vtx.clr.x, sizeof(float) * 4);
-		}
+		vgl_fast_memcpy(legacy_pool_ptr + 3, &current_vtx.clr.x, sizeof(float) * 4);
 		legacy_pool_ptr += LEGACY_NT_VERTEX_STRIDE;
 	}
 
@@ -2036,20 +2834,20 @@ void glMaterialfv(GLenum face, GLenum pname, const GLfloat *params) {
 #endif
 	switch (pname) {
 	case GL_AMBIENT:
-		vgl_fast_memcpy(&current_vtx.amb.x, params, sizeof(float) * 4);
+		legacy_lit_set_attr(LEGACY_LIT_AMBIENT, params);
 		break;
 	case GL_DIFFUSE:
-		vgl_fast_memcpy(&current_vtx.diff.x, params, sizeof(float) * 4);
+		legacy_lit_set_attr(LEGACY_LIT_DIFFUSE, params);
 		break;
 	case GL_SPECULAR:
-		vgl_fast_memcpy(&current_vtx.spec.x, params, sizeof(float) * 4);
+		legacy_lit_set_attr(LEGACY_LIT_SPECULAR, params);
 		break;
 	case GL_EMISSION:
-		vgl_fast_memcpy(&current_vtx.emiss.x, params, sizeof(float) * 4);
+		legacy_lit_set_attr(LEGACY_LIT_EMISSION, params);
 		break;
 	case GL_AMBIENT_AND_DIFFUSE:
-		vgl_fast_memcpy(&current_vtx.amb.x, params, sizeof(float) * 4);
-		vgl_fast_memcpy(&current_vtx.diff.x, params, sizeof(float) * 4);
+		legacy_lit_set_attr(LEGACY_LIT_AMBIENT, params);
+		legacy_lit_set_attr(LEGACY_LIT_DIFFUSE, params);
 		break;
 	case GL_SHININESS:
 		current_shininess = params[0];
@@ -2090,37 +2888,30 @@ void glMaterialxv(GLenum face, GLenum pname, const GLfixed *params) {
 	if (_vgl_enqueue_list_func(glMaterialxv, DLIST_FUNC_U32_U32_U32, face, pname, params))
 		return;
 #endif
+	float v[4];
+	if (pname != GL_SHININESS) {
+		v[0] = (float)params[0] / 65536.0f;
+		v[1] = (float)params[1] / 65536.0f;
+		v[2] = (float)params[2] / 65536.0f;
+		v[3] = (float)params[3] / 65536.0f;
+	}
+
 	switch (pname) {
 	case GL_AMBIENT:
-		current_vtx.amb.x = (float)params[0] / 65536.0f;
-		current_vtx.amb.y = (float)params[1] / 65536.0f;
-		current_vtx.amb.z = (float)params[2] / 65536.0f;
-		current_vtx.amb.w = (float)params[3] / 65536.0f;
+		legacy_lit_set_attr(LEGACY_LIT_AMBIENT, v);
 		break;
 	case GL_DIFFUSE:
-		current_vtx.diff.x = (float)params[0] / 65536.0f;
-		current_vtx.diff.y = (float)params[1] / 65536.0f;
-		current_vtx.diff.z = (float)params[2] / 65536.0f;
-		current_vtx.diff.w = (float)params[3] / 65536.0f;
+		legacy_lit_set_attr(LEGACY_LIT_DIFFUSE, v);
 		break;
 	case GL_SPECULAR:
-		current_vtx.spec.x = (float)params[0] / 65536.0f;
-		current_vtx.spec.y = (float)params[1] / 65536.0f;
-		current_vtx.spec.z = (float)params[2] / 65536.0f;
-		current_vtx.spec.w = (float)params[3] / 65536.0f;
+		legacy_lit_set_attr(LEGACY_LIT_SPECULAR, v);
 		break;
 	case GL_EMISSION:
-		current_vtx.emiss.x = (float)params[0] / 65536.0f;
-		current_vtx.emiss.y = (float)params[1] / 65536.0f;
-		current_vtx.emiss.z = (float)params[2] / 65536.0f;
-		current_vtx.emiss.w = (float)params[3] / 65536.0f;
+		legacy_lit_set_attr(LEGACY_LIT_EMISSION, v);
 		break;
 	case GL_AMBIENT_AND_DIFFUSE:
-		current_vtx.amb.x = (float)params[0] / 65536.0f;
-		current_vtx.amb.y = (float)params[1] / 65536.0f;
-		current_vtx.amb.z = (float)params[2] / 65536.0f;
-		current_vtx.amb.w = (float)params[3] / 65536.0f;
-		vgl_fast_memcpy(&current_vtx.diff.x, &current_vtx.amb.x, sizeof(float) * 4);
+		legacy_lit_set_attr(LEGACY_LIT_AMBIENT, v);
+		legacy_lit_set_attr(LEGACY_LIT_DIFFUSE, v);
 		break;
 	case GL_SHININESS:
 		current_shininess = (float)params[0] / 65536.0f;
@@ -2340,9 +3131,8 @@ void glNormal3f(GLfloat x, GLfloat y, GLfloat z) {
 	}
 #endif
 
-	current_vtx.nor.x = x;
-	current_vtx.nor.y = y;
-	current_vtx.nor.z = z;
+	float v[3] = {x, y, z};
+	legacy_lit_set_attr(LEGACY_LIT_NORMAL, v);
 }
 
 void glNormal3s(GLshort x, GLshort y, GLshort z) {
@@ -2368,9 +3158,7 @@ void glNormal3fv(const GLfloat *v) {
 	}
 #endif
 
-	current_vtx.nor.x = v[0];
-	current_vtx.nor.y = v[1];
-	current_vtx.nor.z = v[2];
+	legacy_lit_set_attr(LEGACY_LIT_NORMAL, v);
 }
 
 void glTexCoord2f(GLfloat s, GLfloat t) {
@@ -2441,63 +3229,76 @@ void glMultiTexCoord2i(GLenum target, GLint s, GLint t) {
 	glMultiTexCoord2f(target, s, t);
 }
 
-void glBegin(GLenum mode) {
-	THREAD_SAFE()
-
-#ifdef HAVE_DLISTS
-	// Enqueueing function to a display list if one is being compiled
-	if (_vgl_enqueue_list_func(glBegin, DLIST_FUNC_U32, mode))
-		return;
-#endif
-#ifndef SKIP_ERROR_HANDLING
-	// Error handling
-	if (phase == MODEL_CREATION) {
-		SET_GL_ERROR(GL_INVALID_OPERATION)
+static void setup_legacy_lit_layout(float *verts) {
+	// Uploading lighting attributes that didn't change during the primitive building as constant streams
+	float *consts = NULL;
+	if (legacy_lit_varying != (1 << LEGACY_LIT_ATTRIBS_NUM) - 1) {
+		consts = (float *)gpu_alloc_mapped_temp(sizeof(float) * 19);
+		vgl_fast_memcpy(consts, &current_vtx.amb.x, sizeof(float) * 19);
 	}
 
-	// Changing current openGL machine state
-	phase = MODEL_CREATION;
-#endif
-
-	// Performing a scene reset if necessary
-	scene_reset();
-
-	// Tracking desired primitive
-	ffp_mode = mode;
-
-	// Resetting vertex count
-	vertex_count = 0;
-}
-
-void glEnd(void) {
-	THREAD_SAFE()
+	// Position and texcoords
+	uint8_t n = (legacy_lit_base - 1) / 2;
+	for (int i = 0; i < n; i++) {
+		legacy_lit_streams[i] = verts;
+	}
 
-#ifdef HAVE_DLISTS
-	// Enqueueing function to a display list if one is being compiled
-	if (_vgl_enqueue_list_func(glEnd, DLIST_FUNC_VOID))
-		return;
-#endif
-#ifndef SKIP_ERROR_HANDLING
-	// Error handling
-	if (phase != MODEL_CREATION) {
-		SET_GL_ERROR(GL_INVALID_OPERATION)
+	// Lighting attributes
+	uint8_t offs = legacy_lit_base;
+	for (int i = 0; i < LEGACY_LIT_ATTRIBS_NUM; i++) {
+		if (legacy_lit_varying & (1 << i)) {
+			legacy_lit_vertex_attrib_config[n + i].offset = sizeof(float) * offs;
+			legacy_lit_streams[n + i] = verts;
+			offs += legacy_lit_attr_size[i];
+		} else {
+			legacy_lit_vertex_attrib_config[n + i].offset = 0;
+			legacy_lit_streams[n + i] = consts + legacy_lit_attr_offs[i];
+		}
 	}
 
-	// Changing current openGL machine state
-	phase = NONE;
-#endif
+	// Patching the vertex program only when the layout actually changed
+	uint8_t layout = legacy_lit_varying | (legacy_lit_base << LEGACY_LIT_ATTRIBS_NUM);
+	if (layout != legacy_lit_layout) {
+		for (int i = 0; i < n + LEGACY_LIT_ATTRIBS_NUM; i++) {
+			legacy_lit_vertex_attrib_config[i].streamIndex = i;
+			legacy_lit_vertex_attrib_config[i].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+			legacy_lit_vertex_stream_config[i].indexSource = SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
+			legacy_lit_vertex_stream_config[i].stride = sizeof(float) * legacy_lit_stride;
+		}
+		legacy_lit_vertex_attrib_config[0].offset = 0;
+		legacy_lit_vertex_attrib_config[0].componentCount = 3;
+		for (int i = 1; i < n; i++) {
+			legacy_lit_vertex_attrib_config[i].offset = sizeof(float) * (1 + i * 2);
+			legacy_lit_vertex_attrib_config[i].componentCount = 2;
+		}
+		for (int i = 0; i < LEGACY_LIT_ATTRIBS_NUM; i++) {
+			legacy_lit_vertex_attrib_config[n + i].componentCount = legacy_lit_attr_size[i];
+			if (!(legacy_lit_varying & (1 << i)))
+				legacy_lit_vertex_stream_config[n + i].stride = 0;
+		}
+		legacy_lit_layout = layout;
+		ffp_dirty_vert_attr = 0xFFFF;
+	}
+}
 
-	// Translating primitive to sceGxm one
-	gl_primitive_to_gxm(ffp_mode, prim, vertex_count);
+// Draws the immediate mode primitive built with the passed vertices
+static void draw_legacy_primitive(float *verts) {
+	vgl_perf_counters.immediate_draws++;
 
 	// Invalidating current attributes state settings
 	uint16_t orig_state = ffp_vertex_attrib_state;
 
-	ffp_dirty_frag = GL_TRUE;
-	ffp_dirty_vert = GL_TRUE;
+	// Setting up compacted vertices layout for lighting enabled primitives
+	if (legacy_lit_tracking)
+		setup_legacy_lit_layout(verts);
+
+	ffp_dirty_mask = GL_TRUE;
 	if (texture_units[1].state) { // Multitexture usage
 		ffp_vertex_attrib_state = FFP_ATTRIB_MASK_ALL;
-		reload_ffp_shaders(legacy_mt_vertex_attrib_config, legacy_mt_vertex_stream_config, SCE_GXM_INDEX_SOURCE_INDEX_16BIT);
+		if (legacy_lit_tracking)
+			reload_ffp_shaders(legacy_lit_vertex_attrib_config, legacy_lit_vertex_stream_config, SCE_GXM_INDEX_SOURCE_INDEX_16BIT);
+		else
+			reload_ffp_shaders(legacy_mt_vertex_attrib_config, legacy_mt_vertex_stream_config, SCE_GXM_INDEX_SOURCE_INDEX_16BIT);
 		for (int i = 0; i < 2; i++) {
 			texture *tex = &texture_slots[texture_units[i].tex_id[texture_units[i].state > 1 ? 0 : 1]];
 #ifdef HAVE_TEX_CACHE
@@ -2526,7 +3327,10 @@ void glEnd(void) {
 		}
 	} else if (texture_units[0].state) { // Texturing usage
 		ffp_vertex_attrib_state = (1 << FFP_ATTRIB_POSITION) | (1 << FFP_ATTRIB_TEX0) | (1 << FFP_ATTRIB_COLOR);
-		reload_ffp_shaders(legacy_vertex_attrib_config, legacy_vertex_stream_config, SCE_GXM_INDEX_SOURCE_INDEX_16BIT);
+		if (legacy_lit_tracking)
+			reload_ffp_shaders(legacy_lit_vertex_attrib_config, legacy_lit_vertex_stream_config, SCE_GXM_INDEX_SOURCE_INDEX_16BIT);
+		else
+			reload_ffp_shaders(legacy_vertex_attrib_config, legacy_vertex_stream_config, SCE_GXM_INDEX_SOURCE_INDEX_16BIT);
 		texture *tex = &texture_slots[texture_units[0].tex_id[texture_units[0].state > 1 ? 0 : 1]];
 #ifdef HAVE_TEX_CACHE
 		restore_tex_cache(tex);
@@ -2553,15 +3357,25 @@ void glEnd(void) {
 		sceGxmSetFragmentTexture(gxm_context, 0, &tex->gxm_tex);
 	} else { // No texturing usage
 		ffp_vertex_attrib_state = (1 << FFP_ATTRIB_POSITION) | (1 << FFP_ATTRIB_COLOR);
-		reload_ffp_shaders(legacy_nt_vertex_attrib_config, legacy_nt_vertex_stream_config, SCE_GXM_INDEX_SOURCE_INDEX_16BIT);
+		if (legacy_lit_tracking)
+			reload_ffp_shaders(legacy_lit_vertex_attrib_config, legacy_lit_vertex_stream_config, SCE_GXM_INDEX_SOURCE_INDEX_16BIT);
+		else
+			reload_ffp_shaders(legacy_nt_vertex_attrib_config, legacy_nt_vertex_stream_config, SCE_GXM_INDEX_SOURCE_INDEX_16BIT);
 	}
 
 	// Restoring original attributes state settings
 	ffp_vertex_attrib_state = orig_state;
+	ffp_dirty_mask = GL_TRUE;
 
 	// Uploading vertex streams and performing the draw
-	for (int i = 0; i < ffp_vertex_num_params; i++) {
-		sceGxmSetVertexStream(gxm_context, i, legacy_pool);
+	if (legacy_lit_tracking) {
+		for (int i = 0; i < ffp_vertex_num_params; i++) {
+			sceGxmSetVertexStream(gxm_context, i, legacy_lit_streams[i]);
+		}
+	} else {
+		for (int i = 0; i < ffp_vertex_num_params; i++) {
+			sceGxmSetVertexStream(gxm_context, i, verts);
+		}
 	}
 
 	uint16_t *ptr;
@@ -2592,14 +3406,127 @@ void glEnd(void) {
 	}
 
 	sceGxmDraw(gxm_context, prim, SCE_GXM_INDEX_FORMAT_U16, ptr, index_count);
+}
 
-	// Moving legacy pool address offset
-	if (texture_units[1].state)
-		legacy_pool += vertex_count * LEGACY_MT_VERTEX_STRIDE;
-	else if (texture_units[0].state)
-		legacy_pool += vertex_count * LEGACY_VERTEX_STRIDE;
+void glBegin(GLenum mode) {
+	THREAD_SAFE()
+
+#ifdef HAVE_DLISTS
+	// Enqueueing function to a display list if one is being compiled
+	if (_vgl_enqueue_list_func(glBegin, DLIST_FUNC_U32, mode))
+		return;
+#endif
+#ifndef SKIP_ERROR_HANDLING
+	// Error handling
+	if (phase == MODEL_CREATION) {
+		SET_GL_ERROR(GL_INVALID_OPERATION)
+	}
+
+	// Changing current openGL machine state
+	phase = MODEL_CREATION;
+#endif
+
+	// Performing a scene reset if necessary
+	scene_reset();
+
+	// Tracking desired primitive
+	ffp_mode = mode;
+
+	// Resetting vertex count
+	vertex_count = 0;
+
+	// Resetting lighting attributes tracking (lighting attributes are stored per-vertex only if they change before glEnd)
+	legacy_lit_tracking = lighting_state;
+	if (legacy_lit_tracking) {
+		legacy_lit_varying = 0;
+		legacy_lit_base = texture_units[1].state ? 7 : (texture_units[0].state ? 5 : 3);
+		legacy_lit_stride = legacy_lit_base;
+	}
+}
+
+#ifdef HAVE_FRAME_CAPTURE
+static void ffp_capture_matrix(uint8_t slot, GLenum mode, uint32_t unit, matrix4x4 *mat) {
+	// Matrices are stored in the layout glLoadMatrixf expects
+	GLfloat m[16];
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			m[j * 4 + i] = (*mat)[i][j];
+		}
+	}
+	capture_update_state(slot, CAPTURE_LOAD_MATRIX, CAPTURE_ARGS(mode, unit), m, sizeof(m));
+}
+
+static void ffp_capture_array(capture_vertex_array *a, uint8_t index, uint8_t attrib, GLboolean is_fixed, uint32_t vertices_num) {
+	capture_fill_vertex_array(a, index, &ffp_vertex_attrib_config[attrib], &ffp_vertex_stream_config[attrib], ffp_vertex_attrib_vbo[attrib], ffp_vertex_attrib_offsets[attrib], is_fixed ? GL_FIXED : 0, vertices_num);
+}
+
+void ffp_capture_state(uint32_t vertices_num) {
+	ffp_capture_matrix(CAPTURE_SLOT_MODELVIEW, GL_MODELVIEW, 0, &modelview_matrix);
+	ffp_capture_matrix(CAPTURE_SLOT_PROJECTION, GL_PROJECTION, 0, &projection_matrix);
+	for (int i = 0; i < TEXTURE_COORDS_NUM; i++) {
+		ffp_capture_matrix(CAPTURE_SLOT_TEXTURE + i, GL_TEXTURE, i, &texture_matrix[i]);
+	}
+	if (!vertices_num)
+		return;
+
+	capture_vertex_array *a = (capture_vertex_array *)capture_scratch((CAPTURE_FFP_TEXCOORD + TEXTURE_COORDS_NUM) * sizeof(capture_vertex_array));
+	if (!a)
+		return;
+	uint32_t n = 0;
+	if (ffp_vertex_attrib_state & (1 << FFP_ATTRIB_POSITION))
+		ffp_capture_array(&a[n++], CAPTURE_FFP_VERTEX, FFP_ATTRIB_POSITION, ffp_vertex_attrib_fixed_pos_mask != 0, vertices_num);
+	if (ffp_vertex_attrib_state & (1 << FFP_ATTRIB_COLOR))
+		ffp_capture_array(&a[n++], CAPTURE_FFP_COLOR, FFP_ATTRIB_COLOR, GL_FALSE, vertices_num);
+	if (ffp_vertex_attrib_state & (1 << FFP_ATTRIB_NORMAL))
+		ffp_capture_array(&a[n++], CAPTURE_FFP_NORMAL, FFP_ATTRIB_NORMAL, ffp_vertex_attrib_fixed_mask & 1, vertices_num);
+	for (int i = 0; i < TEXTURE_COORDS_NUM; i++) {
+		if (ffp_vertex_attrib_state & (1 << FFP_ATTRIB_TEX(i)))
+			ffp_capture_array(&a[n++], CAPTURE_FFP_TEXCOORD + i, FFP_ATTRIB_TEX(i), (ffp_vertex_attrib_fixed_mask >> (i + 1)) & 1, vertices_num);
+	}
+	capture_buffer(cur_vao->index_array_unit);
+	capture_update_state(CAPTURE_SLOT_VERTEX_ARRAYS, CAPTURE_VERTEX_ARRAYS, CAPTURE_ARGS(GL_TRUE, cur_vao->index_array_unit), a, n * sizeof(capture_vertex_array));
+}
+#endif
+
+void glEnd(void) {
+	THREAD_SAFE()
+
+#ifdef HAVE_DLISTS
+	// Enqueueing function to a display list if one is being compiled
+	if (_vgl_enqueue_list_func(glEnd, DLIST_FUNC_VOID))
+		return;
+#endif
+#ifndef SKIP_ERROR_HANDLING
+	// Error handling
+	if (phase != MODEL_CREATION) {
+		SET_GL_ERROR(GL_INVALID_OPERATION)
+	}
+
+	// Changing current openGL machine state
+	phase = NONE;
+#endif
+	// Immediate mode vertices are laid out as position, texcoords sets and, if lighting is disabled, color
+	uint8_t texcoords_num = texture_units[1].state ? 2 : (texture_units[0].state ? 1 : 0);
+	uint32_t stride;
+	if (legacy_lit_tracking)
+		stride = legacy_lit_stride;
+	else if (texcoords_num == 2)
+		stride = LEGACY_MT_VERTEX_STRIDE;
+	else if (texcoords_num == 1)
+		stride = LEGACY_VERTEX_STRIDE;
 	else
-		legacy_pool += vertex_count * LEGACY_NT_VERTEX_STRIDE;
+		stride = LEGACY_NT_VERTEX_STRIDE;
+	CAPTURE_OBJECT(ffp_capture_state, 0)
+	CAPTURE_CALL_WITH_DATA(CAPTURE_END, legacy_pool, vertex_count * stride * sizeof(float), ffp_mode, vertex_count, stride, texcoords_num, legacy_lit_tracking)
+
+	// Translating primitive to sceGxm one
+	gl_primitive_to_gxm(ffp_mode, prim, vertex_count);
+
+	draw_legacy_primitive(legacy_pool);
+
+	// Moving legacy pool address offset
+	legacy_pool += vertex_count * stride;
+	legacy_lit_tracking = GL_FALSE;
 
 #ifndef SKIP_ERROR_HANDLING
 	// Checking for out of bounds of the immediate mode vertex pool
@@ -2612,6 +3539,85 @@ void glEnd(void) {
 	restore_polygon_mode(prim);
 }
 
+#ifdef HAVE_DLISTS
+void ffp_bake_geometry(baked_geometry *g, float *verts, const legacy_vtx_attachment *start_vtx) {
+	if (!vertex_count)
+		return;
+
+	// Copying the vertices built by glBegin/glEnd into a static buffer
+	uint32_t stride;
+	if (lighting_state)
+		stride = legacy_lit_stride;
+	else if (texture_units[1].state)
+		stride = LEGACY_MT_VERTEX_STRIDE;
+	else if (texture_units[0].state)
+		stride = LEGACY_VERTEX_STRIDE;
+	else
+		stride = LEGACY_NT_VERTEX_STRIDE;
+	ffp_free_baked_geometry(g);
+	g->verts = (float *)gpu_alloc_mapped_for_gpu(vertex_count * stride * sizeof(float));
+	if (!g->verts)
+		return;
+	vgl_fast_memcpy(g->verts, verts, vertex_count * stride * sizeof(float));
+	g->vertex_count = vertex_count;
+	g->mode = ffp_mode;
+	g->last_frame = OBJ_NOT_USED;
+
+	// Storing the state the vertices layout depends on
+	g->tex_state[0] = texture_units[0].state;
+	g->tex_state[1] = texture_units[1].state;
+	g->lighting = lighting_state;
+	g->lit_varying = legacy_lit_varying;
+	g->lit_base = legacy_lit_base;
+	g->lit_stride = legacy_lit_stride;
+	vgl_fast_memcpy(&g->start_vtx, start_vtx, sizeof(legacy_vtx_attachment));
+	vgl_fast_memcpy(&g->end_vtx, &current_vtx, sizeof(legacy_vtx_attachment));
+}
+
+void ffp_free_baked_geometry(baked_geometry *g) {
+	if (g->verts) {
+		if (g->last_frame != OBJ_NOT_USED && (vgl_framecount - g->last_frame <= FRAME_PURGE_FREQ)) {
+			mark_as_dirty(g->verts);
+		} else {
+			vgl_free(g->verts);
+		}
+		g->verts = NULL;
+	}
+}
+
+static void draw_baked_primitive(baked_geometry *g) {
+	// Replicating glBegin/glEnd side effects
+	scene_reset();
+	ffp_mode = g->mode;
+	vertex_count = g->vertex_count;
+	legacy_lit_tracking = g->lighting;
+	if (legacy_lit_tracking) {
+		legacy_lit_varying = g->lit_varying;
+		legacy_lit_base = g->lit_base;
+		legacy_lit_stride = g->lit_stride;
+	}
+	vgl_fast_memcpy(&current_vtx, &g->end_vtx, sizeof(legacy_vtx_attachment));
+	flag_dirty_frag_unif(TINT_COLOR_UNIF)
+	g->last_frame = vgl_framecount;
+
+	gl_primitive_to_gxm(ffp_mode, prim, vertex_count);
+	draw_legacy_primitive(g->verts);
+	legacy_lit_tracking = GL_FALSE;
+	restore_polygon_mode(prim);
+}
+
+GLboolean ffp_draw_baked_geometry(baked_geometry *g) {
+	// Baked vertices can be used only if built with the same layout and starting attributes
+	if (g->tex_state[0] != texture_units[0].state || g->tex_state[1] != texture_units[1].state || g->lighting != lighting_state)
+		return GL_FALSE;
+	if (sceClibMemcmp(&g->start_vtx, &current_vtx, sizeof(legacy_vtx_attachment)))
+		return GL_FALSE;
+
+	draw_baked_primitive(g);
+	return GL_TRUE;
+}
+#endif
+
 void glTexEnvfv(GLenum target, GLenum pname, GLfloat *param) {
 #ifdef HAVE_DLISTS
 	// Enqueueing function to a display list if one is being compiled
@@ -2739,7 +3745,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			break;
 #endif
 		case GL_TEXTURE_ENV_MODE:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_MODULATE:
 				tex_unit->env_mode = MODULATE;
@@ -2765,7 +3771,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			break;
 #ifndef DISABLE_TEXTURE_COMBINER
 		case GL_COMBINE_RGB:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_REPLACE:
 				tex_unit->combiner.rgb_func = REPLACE;
@@ -2788,7 +3794,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_COMBINE_ALPHA:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_REPLACE:
 				tex_unit->combiner.a_func = REPLACE;
@@ -2811,7 +3817,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_SRC0_RGB:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_TEXTURE:
 				tex_unit->combiner.op_rgb_0 = TEXTURE;
@@ -2828,7 +3834,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_SRC1_RGB:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_TEXTURE:
 				tex_unit->combiner.op_rgb_1 = TEXTURE;
@@ -2845,7 +3851,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_SRC2_RGB:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_TEXTURE:
 				tex_unit->combiner.op_rgb_2 = TEXTURE;
@@ -2862,7 +3868,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_SRC0_ALPHA:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_TEXTURE:
 				tex_unit->combiner.op_a_0 = TEXTURE;
@@ -2879,7 +3885,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_SRC1_ALPHA:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_TEXTURE:
 				tex_unit->combiner.op_a_1 = TEXTURE;
@@ -2896,7 +3902,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_SRC2_ALPHA:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_TEXTURE:
 				tex_unit->combiner.op_a_2 = TEXTURE;
@@ -2913,7 +3919,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_OPERAND0_RGB:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_SRC_COLOR:
 				tex_unit->combiner.op_mode_rgb_0 = SRC_COLOR;
@@ -2930,7 +3936,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_OPERAND1_RGB:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_SRC_COLOR:
 				tex_unit->combiner.op_mode_rgb_1 = SRC_COLOR;
@@ -2947,7 +3953,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_OPERAND2_RGB:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_SRC_COLOR:
 				tex_unit->combiner.op_mode_rgb_2 = SRC_COLOR;
@@ -2964,7 +3970,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_OPERAND0_ALPHA:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_SRC_ALPHA:
 				tex_unit->combiner.op_mode_a_0 = SRC_ALPHA;
@@ -2975,7 +3981,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_OPERAND1_ALPHA:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_SRC_ALPHA:
 				tex_unit->combiner.op_mode_a_1 = SRC_ALPHA;
@@ -2986,7 +3992,7 @@ inline void glTexEnvi(GLenum target, GLenum pname, GLint param) {
 			}
 			break;
 		case GL_OPERAND2_ALPHA:
-			ffp_dirty_frag = GL_TRUE;
+			ffp_dirty_mask = GL_TRUE;
 			switch (param) {
 			case GL_SRC_ALPHA:
 				tex_unit->combiner.op_mode_a_2 = SRC_ALPHA;
@@ -3647,12 +4653,13 @@ void glClipPlane(GLenum plane, const GLdouble *equation) {
 	clip_planes_eq[idx].z = equation[2];
 	clip_planes_eq[idx].w = equation[3];
 	matrix4x4 inverted, inverted_transposed;
-	matrix4x4_invert(inverted, modelview_matrix);
+	matrix4x4_invert_kind(inverted, modelview_matrix, modelview_kind);
 	matrix4x4_transpose(inverted_transposed, inverted);
 	vector4f temp;
 	vector4f_matrix4x4_mult(&temp, inverted_transposed, &clip_planes_eq[idx]);
 	vgl_fast_memcpy(&clip_planes_eq[idx].x, &temp.x, sizeof(vector4f));
 	flag_dirty_frag_unif(CLIP_PLANES_EQUATION_UNIF)
+	ffp_dirty_mask = GL_TRUE;
 }
 
 void glClipPlanef(GLenum plane, const GLfloat *equation) {
@@ -3672,12 +4679,13 @@ void glClipPlanef(GLenum plane, const GLfloat *equation) {
 	clip_planes_eq[idx].z = equation[2];
 	clip_planes_eq[idx].w = equation[3];
 	matrix4x4 inverted, inverted_transposed;
-	matrix4x4_invert(inverted, modelview_matrix);
+	matrix4x4_invert_kind(inverted, modelview_matrix, modelview_kind);
 	matrix4x4_transpose(inverted_transposed, inverted);
 	vector4f temp;
 	vector4f_matrix4x4_mult(&temp, inverted_transposed, &clip_planes_eq[idx]);
 	vgl_fast_memcpy(&clip_planes_eq[idx].x, &temp.x, sizeof(vector4f));
 	flag_dirty_frag_unif(CLIP_PLANES_EQUATION_UNIF)
+	ffp_dirty_mask = GL_TRUE;
 }
 
 void glClipPlanex(GLenum plane, const GLfixed *equation) {
@@ -3699,12 +4707,13 @@ void glClipPlanex(GLenum plane, const GLfixed *equation) {
 	clip_planes_eq[idx].z = (float)equation[2] / 65536.0f;
 	clip_planes_eq[idx].w = (float)equation[3] / 65536.0f;
 	matrix4x4 inverted, inverted_transposed;
-	matrix4x4_invert(inverted, modelview_matrix);
+	matrix4x4_invert_kind(inverted, modelview_matrix, modelview_kind);
 	matrix4x4_transpose(inverted_transposed, inverted);
 	vector4f temp;
 	vector4f_matrix4x4_mult(&temp, inverted_transposed, &clip_planes_eq[idx]);
 	vgl_fast_memcpy(&clip_planes_eq[idx].x, &temp.x, sizeof(vector4f));
 	flag_dirty_frag_unif(CLIP_PLANES_EQUATION_UNIF)
+	ffp_dirty_mask = GL_TRUE;
 }
 
 void glShadeModel(GLenum mode) {
@@ -3738,8 +4747,7 @@ void glShadeModel(GLenum mode) {
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_ENUM, mode)
 	}
 
-	ffp_dirty_frag = GL_TRUE;
-	ffp_dirty_vert = GL_TRUE;
+	ffp_dirty_mask = GL_TRUE;
 }
 
 void glColorMaterial(GLenum face, GLenum mode) {
@@ -3814,3 +4822,46 @@ void glRecti(GLint x1, GLint y1, GLint x2, GLint y2) {
 	glVertex2i(x1, y2);
 	glEnd();
 }
+
+GLboolean vglPrecompileFixedFunctionShaders(const char *manifest, GLboolean async) {
+	// Only one precompilation job can run at a time
+	if (ffp_precompile_queue)
+		return GL_FALSE;
+
+	uint32_t num;
+	ffp_manifest_entry *entries = read_ffp_manifest(manifest ? manifest : FFP_MANIFEST_PATH, &num);
+	if (!entries)
+		return GL_FALSE;
+
+	// Skipping entries recorded with a different shader sources revision
+	ffp_precompile_num = 0;
+	ffp_precompile_queue = (ffp_precompile_entry *)vglMalloc(num * sizeof(ffp_precompile_entry));
+	for (uint32_t i = 0; i < num; i++) {
+		if (entries[i].magic == FFP_SHADER_CACHE_MAGIC && entries[i].type <= FFP_MANIFEST_FRAGMENT_SHADER) {
+			ffp_precompile_queue[ffp_precompile_num].info = entries[i];
+			ffp_precompile_queue[ffp_precompile_num++].prog = NULL;
+		}
+	}
+	vgl_free(entries);
+	ffp_precompile_ready = 0;
+	ffp_precompile_registered = 0;
+
+	acquire_shader_compiler_sema();
+	if (async) {
+		SceUID thd = sceKernelCreateThread("vitaGL FFP Precompiler", &ffp_precompile_thread, 0x10000100, 0x40000, 0, SCE_KERNEL_CPU_MASK_USER_ALL, NULL);
+		if (thd >= 0) {
+			sceKernelStartThread(thd, 0, NULL);
+			return GL_TRUE;
+		}
+	}
+
+	precompile_ffp_shaders();
+	register_precompiled_ffp_shaders();
+	return GL_TRUE;
+}
+
+GLboolean vglIsPrecompilingFixedFunctionShaders(void) {
+	if (ffp_precompile_queue)
+		register_precompiled_ffp_shaders();
+	return ffp_precompile_queue ? GL_TRUE : GL_FALSE;
+}
@@ -62,6 +62,7 @@ static GLubyte *extensions[] = {
 	"GL_EXT_Cg_shader",
 	"GL_IMG_texture_compression_pvrtc",
 	"GL_IMG_user_clip_plane",
+	"GL_KHR_parallel_shader_compile",
 	"GL_NVX_gpu_memory_info",
 	"GL_NV_fbo_color_attachments",
 	"GL_OES_compressed_ETC1_RGB8_texture",
@@ -674,6 +675,9 @@ void glGetIntegerv(GLenum pname, GLint *data) {
 	case GL_MAX_VERTEX_ATTRIBS:
 		*data = VERTEX_ATTRIBS_NUM;
 		break;
+	case GL_MAX_SHADER_COMPILER_THREADS_KHR:
+		*data = shader_compiler_threads;
+		break;
 	case GL_MAX_VERTEX_UNIFORM_VECTORS:
 		*data = 128;
 		break;
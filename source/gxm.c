@@ -275,11 +275,14 @@ int garbage_collector(unsigned int args, void *arg) {
 		// Waiting for garbage collection request
 		sceKernelWaitSema(gc_mutex[0], 1, NULL);
 #endif
+		PROFILER_SCOPE(PROF_GC)
+
 		// Purging all elements marked for deletion
 		for (int i = 0; i < FRAME_PURGE_LIST_SIZE; i++) {
 			if (frame_purge_list[frame_purge_clean_idx][i]) {
 				vgl_free(frame_purge_list[frame_purge_clean_idx][i]);
 				frame_purge_list[frame_purge_clean_idx][i] = NULL;
+				vgl_perf_counters.gc_retirements++;
 			} else
 				break;
 		}
@@ -287,6 +290,7 @@ int garbage_collector(unsigned int args, void *arg) {
 			if (frame_rt_purge_list[frame_purge_clean_idx][i]) {
 				sceGxmDestroyRenderTarget(frame_rt_purge_list[frame_purge_clean_idx][i]);
 				frame_rt_purge_list[frame_purge_clean_idx][i] = NULL;
+				vgl_perf_counters.gc_retirements++;
 			} else
 				break;
 		}
@@ -772,8 +776,20 @@ void vglSwapBuffers(GLboolean has_commondialog) {
 		gpu_stall_cnt = 0;
 	}
 	frame_start_profiler_cnt = tick;
+	profiler_mark_frame();
+#endif
+#ifdef HAVE_FRAME_CAPTURE
+	capture_mark_frame();
+#endif
+#ifdef HAVE_CLIENT_ARRAYS_CACHE
+	age_client_arrays_cache();
 #endif
 
+#if !defined(DISABLE_CIRCULAR_POOL) && !defined(CIRCULAR_POOL_SPEEDHACK)
+	vgl_perf_end_frame((uint32_t)circular_data_pool_ptr[vgl_circular_idx] - (uint32_t)circular_data_pool[vgl_circular_idx]);
+#else
+	vgl_perf_end_frame(0);
+#endif
 	vgl_framecount++;
 #if !defined(DISABLE_CIRCULAR_POOL) && !defined(CIRCULAR_POOL_SPEEDHACK)
 #ifdef HAVE_DEBUG_INTERFACE
@@ -919,7 +935,10 @@ void vglSwapBuffers(GLboolean has_commondialog) {
 #endif
 		sceGxmDisplayQueueAddEntry(gxm_sync_objects[gxm_front_buffer_index], gxm_sync_objects[gxm_back_buffer_index], &queue_cb_data);
 #ifdef HAVE_PROFILING
-		gpu_stall_cnt += sceKernelGetProcessTimeLow() - tick;
+		uint32_t stall = sceKernelGetProcessTimeLow() - tick;
+		gpu_stall_cnt += stall;
+		if (vgl_profiler_enabled)
+			profiler_record(PROF_GPU_STALL, tick, stall);
 #endif
 #ifdef HAVE_CPU_TRACER
 		sceRazorCpuSync();
@@ -953,7 +972,10 @@ void vglSwapBuffers(GLboolean has_commondialog) {
 #ifdef HAVE_SINGLE_THREADED_GC
 	garbage_collector(0, NULL);
 #else
-	sceKernelWaitSema(gc_mutex[1], 1, NULL);
+	{
+		PROFILER_SCOPE(PROF_GC_WAIT)
+		sceKernelWaitSema(gc_mutex[1], 1, NULL);
+	}
 	sceKernelSignalSema(gc_mutex[0], 1);
 #endif
 }
@@ -970,10 +992,12 @@ void glFinish(void) {
 void glReleaseShaderCompiler(void) {
 	THREAD_SAFE()
 
+	lock_shader_compiler()
 	if (is_shark_online) {
 		shark_end();
 		is_shark_online = GL_FALSE;
 	}
+	unlock_shader_compiler()
 }
 
 void glFlush(void) {
@@ -26,10 +26,35 @@
 
 //#define FAKE_UNRESOLVED_FUNCS // Define this to enable fake bogus mapping in vglGetProcAddress for unimplemented functions
 
+// Entries must be kept sorted by strcmp order (uppercase letters before lowercase ones) for binary search to work
 static const struct {
 	const char *name;
 	void *proc;
 } vgl_proctable[] = {
+	// *egl
+	{"eglBindAPI", (void *)eglBindAPI},
+	{"eglChooseConfig", (void *)eglChooseConfig},
+	{"eglCreateContext", (void *)eglCreateContext},
+	{"eglCreateWindowSurface", (void *)eglCreateWindowSurface},
+	{"eglDestroyContext", (void *)eglDestroyContext},
+	{"eglDestroySurface", (void *)eglDestroySurface},
+	{"eglGetConfigAttrib", (void *)eglGetConfigAttrib},
+	{"eglGetConfigs", (void *)eglGetConfigs},
+	{"eglGetCurrentContext", (void *)eglGetCurrentContext},
+	{"eglGetDisplay", (void *)eglGetDisplay},
+	{"eglGetError", (void *)eglGetError},
+	{"eglGetProcAddress", (void *)eglGetProcAddress},
+	{"eglGetSystemTimeFrequencyNV", (void *)eglGetSystemTimeFrequencyNV},
+	{"eglGetSystemTimeNV", (void *)eglGetSystemTimeNV},
+	{"eglInitialize", (void *)eglInitialize},
+	{"eglMakeCurrent", (void *)eglMakeCurrent},
+	{"eglQueryAPI", (void *)eglQueryAPI},
+	{"eglQueryContext", (void *)eglQueryContext},
+	{"eglQueryString", (void *)eglQueryString},
+	{"eglQuerySurface", (void *)eglQuerySurface},
+	{"eglSwapBuffers", (void *)eglSwapBuffers},
+	{"eglSwapInterval", (void *)eglSwapInterval},
+	{"eglTerminate", (void *)eglTerminate},
 	// *gl
 	{"glActiveTexture", (void *)glActiveTexture},
 	{"glAlphaFunc", (void *)glAlphaFunc},
@@ -132,8 +157,8 @@ static const struct {
 	{"glEnableClientState", (void *)glEnableClientState},
 	{"glEnableVertexAttribArray", (void *)glEnableVertexAttribArray},
 	{"glEnd", (void *)glEnd},
-	{"glEndQuery", (void *)glEndQuery},
 	{"glEndList", (void *)glEndList},
+	{"glEndQuery", (void *)glEndQuery},
 	{"glFinish", (void *)glFinish},
 	{"glFlush", (void *)glFlush},
 	{"glFlushMappedBufferRange", (void *)glFlushMappedBufferRange},
@@ -150,8 +175,6 @@ static const struct {
 	{"glFrustumf", (void *)glFrustumf},
 	{"glFrustumx", (void *)glFrustumx},
 	{"glGenBuffers", (void *)glGenBuffers},
-	{"glGenerateMipmap", (void *)glGenerateMipmap},
-	{"glGenerateTextureMipmap", (void *)glGenerateTextureMipmap},
 	{"glGenFramebuffers", (void *)glGenFramebuffers},
 	{"glGenLists", (void *)glGenLists},
 	{"glGenQueries", (void *)glGenQueries},
@@ -159,6 +182,8 @@ static const struct {
 	{"glGenSamplers", (void *)glGenSamplers},
 	{"glGenTextures", (void *)glGenTextures},
 	{"glGenVertexArrays", (void *)glGenVertexArrays},
+	{"glGenerateMipmap", (void *)glGenerateMipmap},
+	{"glGenerateTextureMipmap", (void *)glGenerateTextureMipmap},
 	{"glGetActiveAttrib", (void *)glGetActiveAttrib},
 	{"glGetActiveUniform", (void *)glGetActiveUniform},
 	{"glGetAttachedShaders", (void *)glGetAttachedShaders},
@@ -177,16 +202,16 @@ static const struct {
 	{"glGetQueryObjectiv", (void *)glGetQueryObjectiv},
 	{"glGetQueryObjectuiv", (void *)glGetQueryObjectuiv},
 	{"glGetShaderInfoLog", (void *)glGetShaderInfoLog},
-	{"glGetShaderiv", (void *)glGetShaderiv},
 	{"glGetShaderSource", (void *)glGetShaderSource},
+	{"glGetShaderiv", (void *)glGetShaderiv},
 	{"glGetString", (void *)glGetString},
 	{"glGetStringi", (void *)glGetStringi},
 	{"glGetTexEnviv", (void *)glGetTexEnviv},
 	{"glGetUniformBlockIndex", (void *)glGetUniformBlockIndex},
 	{"glGetUniformLocation", (void *)glGetUniformLocation},
+	{"glGetVertexAttribPointerv", (void *)glGetVertexAttribPointerv},
 	{"glGetVertexAttribfv", (void *)glGetVertexAttribfv},
 	{"glGetVertexAttribiv", (void *)glGetVertexAttribiv},
-	{"glGetVertexAttribPointerv", (void *)glGetVertexAttribPointerv},
 	{"glHint", (void *)glHint},
 	{"glInterleavedArrays", (void *)glInterleavedArrays},
 	{"glIsEnabled", (void *)glIsEnabled},
@@ -194,9 +219,9 @@ static const struct {
 	{"glIsProgram", (void *)glIsProgram},
 	{"glIsRenderbuffer", (void *)glIsRenderbuffer},
 	{"glIsTexture", (void *)glIsTexture},
-	{"glLightfv", (void *)glLightfv},
 	{"glLightModelfv", (void *)glLightModelfv},
 	{"glLightModelxv", (void *)glLightModelxv},
+	{"glLightfv", (void *)glLightfv},
 	{"glLightxv", (void *)glLightxv},
 	{"glLineWidth", (void *)glLineWidth},
 	{"glLineWidthx", (void *)glLineWidthx},
@@ -216,9 +241,9 @@ static const struct {
 	{"glMaterialx", (void *)glMaterialx},
 	{"glMaterialxv", (void *)glMaterialxv},
 	{"glMatrixFrustum", (void *)glMatrixFrustum},
+	{"glMatrixLoadIdentity", (void *)glMatrixLoadIdentity},
 	{"glMatrixLoadd", (void *)glMatrixLoadd},
 	{"glMatrixLoadf", (void *)glMatrixLoadf},
-	{"glMatrixLoadIdentity", (void *)glMatrixLoadIdentity},
 	{"glMatrixMode", (void *)glMatrixMode},
 	{"glMatrixMultd", (void *)glMatrixMultd},
 	{"glMatrixMultf", (void *)glMatrixMultf},
@@ -231,16 +256,19 @@ static const struct {
 	{"glMatrixScalef", (void *)glMatrixScalef},
 	{"glMatrixTranslated", (void *)glMatrixTranslated},
 	{"glMatrixTranslatef", (void *)glMatrixTranslatef},
-	{"glMultiDrawArrays", (void *)glMultiDrawArrays},
-	{"glMultiTexCoord2f", (void *)glMultiTexCoord2f},
-	{"glMultiTexCoord2fv", (void *)glMultiTexCoord2fv},
-	{"glMultiTexCoord2i", (void *)glMultiTexCoord2i},
+	{"glMaxShaderCompilerThreadsKHR", (void *)glMaxShaderCompilerThreadsKHR},
 	{"glMultMatrixd", (void *)glMultMatrixd},
 	{"glMultMatrixf", (void *)glMultMatrixf},
 	{"glMultMatrixx", (void *)glMultMatrixx},
 	{"glMultTransposeMatrixd", (void *)glMultTransposeMatrixd},
 	{"glMultTransposeMatrixf", (void *)glMultTransposeMatrixf},
 	{"glMultTransposeMatrixx", (void *)glMultTransposeMatrixx},
+	{"glMultiDrawArrays", (void *)glMultiDrawArrays},
+	{"glMultiDrawElements", (void *)glMultiDrawElements},
+	{"glMultiDrawElementsBaseVertex", (void *)glMultiDrawElementsBaseVertex},
+	{"glMultiTexCoord2f", (void *)glMultiTexCoord2f},
+	{"glMultiTexCoord2fv", (void *)glMultiTexCoord2fv},
+	{"glMultiTexCoord2i", (void *)glMultiTexCoord2i},
 	{"glNamedFramebufferRenderbuffer", (void *)glNamedFramebufferRenderbuffer},
 	{"glNamedFramebufferTexture", (void *)glNamedFramebufferTexture},
 	{"glNamedFramebufferTexture2D", (void *)glNamedFramebufferTexture2D},
@@ -363,13 +391,13 @@ static const struct {
 	{"glUnmapBuffer", (void *)glUnmapBuffer},
 	{"glUseProgram", (void *)glUseProgram},
 	{"glVertex2d", (void *)glVertex2d},
-	{"glVertex2f", (void *)glVertex2f},
-	{"glVertex2i", (void *)glVertex2i},
 	{"glVertex2dv", (void *)glVertex2dv},
+	{"glVertex2f", (void *)glVertex2f},
 	{"glVertex2fv", (void *)glVertex2fv},
+	{"glVertex2i", (void *)glVertex2i},
 	{"glVertex3d", (void *)glVertex3d},
-	{"glVertex3f", (void *)glVertex3f},
 	{"glVertex3dv", (void *)glVertex3dv},
+	{"glVertex3f", (void *)glVertex3f},
 	{"glVertex3fv", (void *)glVertex3fv},
 	{"glVertex3i", (void *)glVertex3i},
 	{"glVertexAttrib1f", (void *)glVertexAttrib1f},
@@ -389,30 +417,6 @@ static const struct {
 	{"gluLookAt", (void *)gluLookAt},
 	{"gluPerspective", (void *)gluPerspective},
 	{"gluScaleImage", (void *)gluScaleImage},
-	// *egl
-	{"eglBindAPI", (void *)eglBindAPI},
-	{"eglChooseConfig", (void *)eglChooseConfig},
-	{"eglCreateContext", (void *)eglCreateContext},
-	{"eglCreateWindowSurface", (void *)eglCreateWindowSurface},
-	{"eglDestroyContext", (void *)eglDestroyContext},
-	{"eglDestroySurface", (void *)eglDestroySurface},
-	{"eglGetConfigAttrib", (void *)eglGetConfigAttrib},
-	{"eglGetConfigs", (void *)eglGetConfigs},
-	{"eglGetCurrentContext", (void *)eglGetCurrentContext},
-	{"eglGetDisplay", (void *)eglGetDisplay},
-	{"eglGetError", (void *)eglGetError},
-	{"eglGetProcAddress", (void *)eglGetProcAddress},
-	{"eglGetSystemTimeFrequencyNV", (void *)eglGetSystemTimeFrequencyNV},
-	{"eglGetSystemTimeNV", (void *)eglGetSystemTimeNV},
-	{"eglInitialize", (void *)eglInitialize},
-	{"eglMakeCurrent", (void *)eglMakeCurrent},
-	{"eglQueryAPI", (void *)eglQueryAPI},
-	{"eglQueryContext", (void *)eglQueryContext},
-	{"eglQueryString", (void *)eglQueryString},
-	{"eglQuerySurface", (void *)eglQuerySurface},
-	{"eglSwapInterval", (void *)eglSwapInterval},
-	{"eglSwapBuffers", (void *)eglSwapBuffers},
-	{"eglTerminate", (void *)eglTerminate},
 };
 
 static const size_t vgl_numproc = sizeof(vgl_proctable) / sizeof(*vgl_proctable);
@@ -431,15 +435,21 @@ void *vglGetProcAddress(const char *name) {
 	const int len = strlen(name);
 	char tmpname[len + 1];
 	vgl_fast_memcpy(tmpname, name, len + 1);
-	if (!strcmp(tmpname + len - 3, "EXT") || !strcmp(tmpname + len - 3, "ARB") || !strcmp(tmpname + len - 3, "OES")) {
+	if (len > 3 && (!strcmp(tmpname + len - 3, "EXT") || !strcmp(tmpname + len - 3, "ARB") || !strcmp(tmpname + len - 3, "OES"))) {
 		tmpname[len - 3] = 0;
 	}
 
 	// search for stripped name
-	for (size_t i = 0; i < vgl_numproc; ++i) {
-		if (!strcmp(tmpname, vgl_proctable[i].name)) {
-			return vgl_proctable[i].proc;
-		}
+	size_t lo = 0, hi = vgl_numproc;
+	while (lo < hi) {
+		size_t mid = (lo + hi) >> 1;
+		int res = strcmp(tmpname, vgl_proctable[mid].name);
+		if (!res)
+			return vgl_proctable[mid].proc;
+		if (res < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
 	}
 
 #ifdef FAKE_UNRESOLVED_FUNCS
@@ -456,11 +466,35 @@ void *vglGetProcAddress(const char *name) {
 #endif
 }
 
+static int procs_by_addr_cmp(const void *a, const void *b) {
+	uint32_t pa = (uint32_t)vgl_proctable[*(const uint16_t *)a].proc;
+	uint32_t pb = (uint32_t)vgl_proctable[*(const uint16_t *)b].proc;
+	return pa < pb ? -1 : (pa > pb ? 1 : 0);
+}
+
 char *vglGetFuncName(uint32_t func) {
+	// Building the index of the table entries sorted by address on first usage
+	static uint16_t procs_by_addr[sizeof(vgl_proctable) / sizeof(*vgl_proctable)];
+	static GLboolean procs_by_addr_ready = GL_FALSE;
+	if (!procs_by_addr_ready) {
+		for (size_t i = 0; i < vgl_numproc; ++i) {
+			procs_by_addr[i] = i;
+		}
+		qsort(procs_by_addr, vgl_numproc, sizeof(uint16_t), procs_by_addr_cmp);
+		procs_by_addr_ready = GL_TRUE;
+	}
+
 	// search for function name
-	for (size_t i = 0; i < vgl_numproc; ++i) {
-		if ((void *)func == vgl_proctable[i].proc)
-			return (char *)vgl_proctable[i].name;
+	size_t lo = 0, hi = vgl_numproc;
+	while (lo < hi) {
+		size_t mid = (lo + hi) >> 1;
+		uint32_t proc = (uint32_t)vgl_proctable[procs_by_addr[mid]].proc;
+		if (proc == func)
+			return (char *)vgl_proctable[procs_by_addr[mid]].name;
+		if (proc > func)
+			hi = mid;
+		else
+			lo = mid + 1;
 	}
 	
 #ifndef SKIP_ERROR_HANDLING
@@ -36,8 +36,10 @@
 	}
 
 matrix4x4 modelview_matrix_stack[MODELVIEW_STACK_DEPTH]; // Modelview matrices stack
+static uint8_t modelview_kind_stack[MODELVIEW_STACK_DEPTH]; // Modelview matrices kinds stack
 static uint8_t modelview_stack_counter = 1; // Modelview matrices stack counter
 matrix4x4 projection_matrix_stack[GENERIC_STACK_DEPTH]; // Projection matrices stack
+static uint8_t projection_kind_stack[GENERIC_STACK_DEPTH]; // Projection matrices kinds stack
 static uint8_t projection_stack_counter = 1; // Projection matrices stack counter
 GLboolean mvp_modified = GL_TRUE; // Check if ModelViewProjection matrix needs to be recreated
 
@@ -47,6 +49,9 @@ matrix4x4 modelview_matrix; // ModelView Matrix
 matrix3x3 normal_matrix; // Normal Matrix
 matrix4x4 texture_matrix[TEXTURE_COORDS_NUM]; // Texture Matrix
 matrix4x4 *matrix = &modelview_matrix; // Current in-use matrix mode
+uint8_t modelview_kind = MATRIX_IDENTITY; // ModelView matrix kind
+uint8_t projection_kind = MATRIX_IDENTITY; // Projection matrix kind
+uint8_t texture_matrix_kind[TEXTURE_COORDS_NUM]; // Texture matrices kinds
 
 GLint get_gl_matrix_mode() {
 	if (matrix == &texture_matrix[server_texture_unit]) {
@@ -57,6 +62,28 @@ GLint get_gl_matrix_mode() {
 	return GL_MODELVIEW;
 }
 
+static inline __attribute__((always_inline)) uint8_t *get_matrix_kind(matrix4x4 *m) {
+	if (m == &modelview_matrix)
+		return &modelview_kind;
+	else if (m == &projection_matrix)
+		return &projection_kind;
+	return &texture_matrix_kind[m - texture_matrix];
+}
+
+// Multiply a matrix of known kind by another one in place
+static inline __attribute__((always_inline)) void multiply_matrix(matrix4x4 *m, uint8_t *kind, const matrix4x4 src, uint8_t src_kind) {
+	if (src_kind == MATRIX_IDENTITY)
+		return;
+	if (*kind == MATRIX_IDENTITY) {
+		matrix4x4_copy(*m, src);
+	} else {
+		matrix4x4 res;
+		matrix4x4_multiply(res, *m, src);
+		matrix4x4_copy(*m, res);
+	}
+	*kind = matrix_kind_combine(*kind, src_kind);
+}
+
 /*
  * ------------------------------
  * - IMPLEMENTATION STARTS HERE -
@@ -119,6 +146,7 @@ void glMatrixLoadf(GLenum mode, const GLfloat *m) {
 			(*mat)[i][j] = m[j * 4 + i];
 		}
 	}
+	*get_matrix_kind(mat) = matrix4x4_get_kind(*mat);
 }
 
 void glMatrixLoadd(GLenum mode, const GLdouble *m) {
@@ -153,6 +181,7 @@ void glMatrixLoadd(GLenum mode, const GLdouble *m) {
 			(*mat)[i][j] = m[j * 4 + i];
 		}
 	}
+	*get_matrix_kind(mat) = matrix4x4_get_kind(*mat);
 }
 
 inline void glOrthof(GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat nearVal, GLfloat farVal) {
@@ -170,11 +199,11 @@ inline void glOrthof(GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, G
 #ifdef MATH_SPEEDHACK
 	// Initializing ortho matrix with requested parameters
 	matrix4x4_init_orthographic(*matrix, left, right, bottom, top, nearVal, farVal);
+	*get_matrix_kind(matrix) = MATRIX_SCALE;
 #else
-	matrix4x4 res, ortho_matrix;
+	matrix4x4 ortho_matrix;
 	matrix4x4_init_orthographic(ortho_matrix, left, right, bottom, top, nearVal, farVal);
-	matrix4x4_multiply(res, *matrix, ortho_matrix);
-	matrix4x4_copy(*matrix, res);
+	multiply_matrix(matrix, get_matrix_kind(matrix), ortho_matrix, MATRIX_SCALE);
 #endif
 
 	flag_dirty_matrix_unif()
@@ -203,11 +232,11 @@ inline void glFrustumf(GLfloat left, GLfloat right, GLfloat bottom, GLfloat top,
 #ifdef MATH_SPEEDHACK
 	// Initializing frustum matrix with requested parameters
 	matrix4x4_init_frustum(*matrix, left, right, bottom, top, nearVal, farVal);
+	*get_matrix_kind(matrix) = MATRIX_PROJECTIVE;
 #else
-	matrix4x4 res, frustum_matrix;
+	matrix4x4 frustum_matrix;
 	matrix4x4_init_frustum(frustum_matrix, left, right, bottom, top, nearVal, farVal);
-	matrix4x4_multiply(res, *matrix, frustum_matrix);
-	matrix4x4_copy(*matrix, res);
+	multiply_matrix(matrix, get_matrix_kind(matrix), frustum_matrix, MATRIX_PROJECTIVE);
 #endif
 
 	flag_dirty_matrix_unif()
@@ -228,11 +257,11 @@ void glFrustumx(GLfixed left, GLfixed right, GLfixed bottom, GLfixed top, GLfixe
 #ifdef MATH_SPEEDHACK
 	// Initializing frustum matrix with requested parameters
 	matrix4x4_init_frustum(*matrix, (float)left / 65536.0f, (float)right / 65536.0f, (float)bottom / 65536.0f, (float)top / 65536.0f, (float)nearVal / 65536.0f, (float)farVal / 65536.0f);
+	*get_matrix_kind(matrix) = MATRIX_PROJECTIVE;
 #else
-	matrix4x4 res, frustum_matrix;
+	matrix4x4 frustum_matrix;
 	matrix4x4_init_frustum(frustum_matrix, (float)left / 65536.0f, (float)right / 65536.0f, (float)bottom / 65536.0f, (float)top / 65536.0f, (float)nearVal / 65536.0f, (float)farVal / 65536.0f);
-	matrix4x4_multiply(res, *matrix, frustum_matrix);
-	matrix4x4_copy(*matrix, res);
+	multiply_matrix(matrix, get_matrix_kind(matrix), frustum_matrix, MATRIX_PROJECTIVE);
 #endif
 
 	flag_dirty_matrix_unif()
@@ -245,22 +274,31 @@ void glFrustum(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top, GLd
 void glMatrixLoadIdentity(GLenum mode) {
 	THREAD_SAFE()
 
-	// Setting requested matrix
+	// Setting requested matrix (Nothing to do if it is already an identity one)
 	switch (mode) {
 	case GL_MODELVIEW: // Modelview matrix
-		matrix4x4_identity(modelview_matrix);
-		flag_dirty_vert_unif(MODELVIEW_MATRIX_UNIF)
-		flag_dirty_vert_unif(WVP_MATRIX_UNIF)
-		mvp_modified = GL_TRUE;
+		if (modelview_kind != MATRIX_IDENTITY) {
+			matrix4x4_identity(modelview_matrix);
+			modelview_kind = MATRIX_IDENTITY;
+			flag_dirty_vert_unif(MODELVIEW_MATRIX_UNIF)
+			flag_dirty_vert_unif(WVP_MATRIX_UNIF)
+			mvp_modified = GL_TRUE;
+		}
 		break;
 	case GL_PROJECTION: // Projection matrix
-		matrix4x4_identity(projection_matrix);
-		flag_dirty_vert_unif(WVP_MATRIX_UNIF)
-		mvp_modified = GL_TRUE;
+		if (projection_kind != MATRIX_IDENTITY) {
+			matrix4x4_identity(projection_matrix);
+			projection_kind = MATRIX_IDENTITY;
+			flag_dirty_vert_unif(WVP_MATRIX_UNIF)
+			mvp_modified = GL_TRUE;
+		}
 		break;
 	case GL_TEXTURE: // Texture matrix
-		matrix4x4_identity(texture_matrix[server_texture_unit]);
-		flag_dirty_vert_unif(TEX_MATRIX_UNIF)
+		if (texture_matrix_kind[server_texture_unit] != MATRIX_IDENTITY) {
+			matrix4x4_identity(texture_matrix[server_texture_unit]);
+			texture_matrix_kind[server_texture_unit] = MATRIX_IDENTITY;
+			flag_dirty_vert_unif(TEX_MATRIX_UNIF)
+		}
 		break;
 	default:
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_ENUM, mode)
@@ -275,14 +313,18 @@ void glLoadIdentity(void) {
 	if (_vgl_enqueue_list_func(glLoadIdentity, DLIST_FUNC_VOID))
 		return;
 #endif
-	// Set current in use matrix to identity one
+	// Set current in use matrix to identity one (Nothing to do if it is already an identity one)
+	uint8_t *kind = get_matrix_kind(matrix);
+	if (*kind == MATRIX_IDENTITY)
+		return;
 	matrix4x4_identity(*matrix);
+	*kind = MATRIX_IDENTITY;
 	flag_dirty_matrix_unif()
 }
 
 void glMultMatrixf(const GLfloat *m) {
 	// Properly ordering matrix
-	matrix4x4 res, src;
+	matrix4x4 src;
 	int i, j;
 	for (i = 0; i < 4; i++) {
 		for (j = 0; j < 4; j++) {
@@ -291,17 +333,14 @@ void glMultMatrixf(const GLfloat *m) {
 	}
 
 	// Multiplicating passed matrix with in use one
-	matrix4x4_multiply(res, *matrix, src);
-
-	// Copying result to in use matrix
-	matrix4x4_copy(*matrix, res);
+	multiply_matrix(matrix, get_matrix_kind(matrix), src, matrix4x4_get_kind(src));
 
 	flag_dirty_matrix_unif()
 }
 
 void glMultMatrixd(const GLdouble *m) {
 	// Properly ordering matrix
-	matrix4x4 res, src;
+	matrix4x4 src;
 	int i, j;
 	for (i = 0; i < 4; i++) {
 		for (j = 0; j < 4; j++) {
@@ -310,10 +349,7 @@ void glMultMatrixd(const GLdouble *m) {
 	}
 
 	// Multiplicating passed matrix with in use one
-	matrix4x4_multiply(res, *matrix, src);
-
-	// Copying result to in use matrix
-	matrix4x4_copy(*matrix, res);
+	multiply_matrix(matrix, get_matrix_kind(matrix), src, matrix4x4_get_kind(src));
 
 	flag_dirty_matrix_unif()
 }
@@ -344,7 +380,7 @@ void glMatrixMultd(GLenum mode, const GLdouble *m) {
 	}
 	
 	// Properly ordering matrix
-	matrix4x4 res, src;
+	matrix4x4 src;
 	int i, j;
 	for (i = 0; i < 4; i++) {
 		for (j = 0; j < 4; j++) {
@@ -353,10 +389,7 @@ void glMatrixMultd(GLenum mode, const GLdouble *m) {
 	}
 
 	// Multiplicating passed matrix with in use one
-	matrix4x4_multiply(res, *mat, src);
-
-	// Copying result to in use matrix
-	matrix4x4_copy(*mat, res);
+	multiply_matrix(mat, get_matrix_kind(mat), src, matrix4x4_get_kind(src));
 }
 
 void glMatrixMultf(GLenum mode, const GLfloat *m) {
@@ -385,7 +418,7 @@ void glMatrixMultf(GLenum mode, const GLfloat *m) {
 	}
 	
 	// Properly ordering matrix
-	matrix4x4 res, src;
+	matrix4x4 src;
 	int i, j;
 	for (i = 0; i < 4; i++) {
 		for (j = 0; j < 4; j++) {
@@ -394,17 +427,14 @@ void glMatrixMultf(GLenum mode, const GLfloat *m) {
 	}
 
 	// Multiplicating passed matrix with in use one
-	matrix4x4_multiply(res, *mat, src);
-
-	// Copying result to in use matrix
-	matrix4x4_copy(*mat, res);
+	multiply_matrix(mat, get_matrix_kind(mat), src, matrix4x4_get_kind(src));
 }
 
 void glMultTransposeMatrixd(const GLdouble *m) {
 	THREAD_SAFE()
 
 	// Properly ordering matrix
-	matrix4x4 res, src;
+	matrix4x4 src;
 	int i, j;
 	for (i = 0; i < 4; i++) {
 		for (j = 0; j < 4; j++) {
@@ -413,10 +443,7 @@ void glMultTransposeMatrixd(const GLdouble *m) {
 	}
 
 	// Multiplicating passed matrix with in use one
-	matrix4x4_multiply(res, *matrix, src);
-
-	// Copying result to in use matrix
-	matrix4x4_copy(*matrix, res);
+	multiply_matrix(matrix, get_matrix_kind(matrix), src, matrix4x4_get_kind(src));
 
 	flag_dirty_matrix_unif()
 }
@@ -425,7 +452,7 @@ void glMultTransposeMatrixf(const GLfloat *m) {
 	THREAD_SAFE()
 
 	// Properly ordering matrix
-	matrix4x4 res, src;
+	matrix4x4 src;
 	int i, j;
 	for (i = 0; i < 4; i++) {
 		for (j = 0; j < 4; j++) {
@@ -434,10 +461,7 @@ void glMultTransposeMatrixf(const GLfloat *m) {
 	}
 
 	// Multiplicating passed matrix with in use one
-	matrix4x4_multiply(res, *matrix, src);
-
-	// Copying result to in use matrix
-	matrix4x4_copy(*matrix, res);
+	multiply_matrix(matrix, get_matrix_kind(matrix), src, matrix4x4_get_kind(src));
 
 	flag_dirty_matrix_unif()
 }
@@ -446,7 +470,7 @@ void glMultMatrixx(const GLfixed *m) {
 	THREAD_SAFE()
 
 	// Properly ordering matrix
-	matrix4x4 res, src;
+	matrix4x4 src;
 	int i, j;
 	for (i = 0; i < 4; i++) {
 		for (j = 0; j < 4; j++) {
@@ -455,10 +479,7 @@ void glMultMatrixx(const GLfixed *m) {
 	}
 
 	// Multiplicating passed matrix with in use one
-	matrix4x4_multiply(res, *matrix, src);
-
-	// Copying result to in use matrix
-	matrix4x4_copy(*matrix, res);
+	multiply_matrix(matrix, get_matrix_kind(matrix), src, matrix4x4_get_kind(src));
 
 	flag_dirty_matrix_unif()
 }
@@ -467,7 +488,7 @@ void glMultTransposeMatrixx(const GLfixed *m) {
 	THREAD_SAFE()
 
 	// Properly ordering matrix
-	matrix4x4 res, src;
+	matrix4x4 src;
 	int i, j;
 	for (i = 0; i < 4; i++) {
 		for (j = 0; j < 4; j++) {
@@ -476,10 +497,7 @@ void glMultTransposeMatrixx(const GLfixed *m) {
 	}
 
 	// Multiplicating passed matrix with in use one
-	matrix4x4_multiply(res, *matrix, src);
-
-	// Copying result to in use matrix
-	matrix4x4_copy(*matrix, res);
+	multiply_matrix(matrix, get_matrix_kind(matrix), src, matrix4x4_get_kind(src));
 
 	flag_dirty_matrix_unif()
 }
@@ -494,6 +512,7 @@ void glLoadMatrixf(const GLfloat *m) {
 			(*matrix)[i][j] = m[j * 4 + i];
 		}
 	}
+	*get_matrix_kind(matrix) = matrix4x4_get_kind(*matrix);
 
 	flag_dirty_matrix_unif()
 }
@@ -508,6 +527,7 @@ void glLoadMatrixd(const GLdouble *m) {
 			(*matrix)[i][j] = m[j * 4 + i];
 		}
 	}
+	*get_matrix_kind(matrix) = matrix4x4_get_kind(*matrix);
 
 	flag_dirty_matrix_unif()
 }
@@ -522,6 +542,7 @@ void glLoadTransposeMatrixf(const GLfloat *m) {
 			(*matrix)[i][j] = m[i * 4 + j];
 		}
 	}
+	*get_matrix_kind(matrix) = matrix4x4_get_kind(*matrix);
 
 	flag_dirty_matrix_unif()
 }
@@ -536,6 +557,7 @@ void glLoadMatrixx(const GLfixed *m) {
 			(*matrix)[i][j] = (float)m[j * 4 + i] / 65536.0f;
 		}
 	}
+	*get_matrix_kind(matrix) = matrix4x4_get_kind(*matrix);
 
 	flag_dirty_matrix_unif()
 }
@@ -550,6 +572,7 @@ void glLoadTransposeMatrixx(const GLfixed *m) {
 			(*matrix)[i][j] = (float)m[i * 4 + j] / 65536.0f;
 		}
 	}
+	*get_matrix_kind(matrix) = matrix4x4_get_kind(*matrix);
 
 	flag_dirty_matrix_unif()
 }
@@ -581,7 +604,8 @@ void glMatrixRotatef(GLenum mode, GLfloat angle, GLfloat x, GLfloat y, GLfloat z
 	
 	// Performing rotation on in use matrix depending on user call
 	float rad = DEG_TO_RAD(angle);
-	matrix4x4_rotate(*mat, rad, x, y, z);
+	uint8_t *kind = get_matrix_kind(mat);
+	*kind = matrix4x4_rotate_kind(*mat, *kind, rad, x, y, z);
 }
 
 void glMatrixRotated(GLenum matrixMode, GLdouble angle, GLdouble x, GLdouble y, GLdouble z) {
@@ -614,7 +638,8 @@ void glMatrixScalef(GLenum mode, GLfloat x, GLfloat y, GLfloat z) {
 	}
 	
 	// Scaling in use matrix
-	matrix4x4_scale(*mat, x, y, z);
+	uint8_t *kind = get_matrix_kind(mat);
+	*kind = matrix4x4_scale_kind(*mat, *kind, x, y, z);
 }
 
 void glMatrixScaled(GLenum matrixMode, GLdouble x, GLdouble y, GLdouble z) {
@@ -647,7 +672,8 @@ void glMatrixTranslatef(GLenum mode, GLfloat x, GLfloat y, GLfloat z) {
 	}
 	
 	// Translating in use matrix
-	matrix4x4_translate(*mat, x, y, z);
+	uint8_t *kind = get_matrix_kind(mat);
+	*kind = matrix4x4_translate_kind(*mat, *kind, x, y, z);
 }
 
 void glMatrixTranslated(GLenum matrixMode, GLdouble x, GLdouble y, GLdouble z) {
@@ -682,11 +708,11 @@ void glMatrixOrtho(GLenum mode, GLdouble left, GLdouble right, GLdouble bottom,
 #ifdef MATH_SPEEDHACK
 	// Initializing ortho matrix with requested parameters
 	matrix4x4_init_orthographic(*mat, left, right, bottom, top, nearVal, farVal);
+	*get_matrix_kind(mat) = MATRIX_SCALE;
 #else
-	matrix4x4 res, ortho_matrix;
+	matrix4x4 ortho_matrix;
 	matrix4x4_init_orthographic(ortho_matrix, left, right, bottom, top, nearVal, farVal);
-	matrix4x4_multiply(res, *mat, ortho_matrix);
-	matrix4x4_copy(*mat, res);
+	multiply_matrix(mat, get_matrix_kind(mat), ortho_matrix, MATRIX_SCALE);
 #endif
 }
 
@@ -718,11 +744,11 @@ void glMatrixFrustum(GLenum mode, GLdouble left, GLdouble right, GLdouble bottom
 #ifdef MATH_SPEEDHACK
 	// Initializing frustum matrix with requested parameters
 	matrix4x4_init_frustum(*mat, left, right, bottom, top, nearVal, farVal);
+	*get_matrix_kind(mat) = MATRIX_PROJECTIVE;
 #else
-	matrix4x4 res, frustum_matrix;
+	matrix4x4 frustum_matrix;
 	matrix4x4_init_frustum(frustum_matrix, left, right, bottom, top, nearVal, farVal);
-	matrix4x4_multiply(res, *mat, frustum_matrix);
-	matrix4x4_copy(*mat, res);
+	multiply_matrix(mat, get_matrix_kind(mat), frustum_matrix, MATRIX_PROJECTIVE);
 #endif
 }
 
@@ -741,6 +767,7 @@ void glMatrixPush(GLenum mode) {
 			}
 #endif
 			// Copying current matrix into the matrix stack and increasing stack counter
+			modelview_kind_stack[modelview_stack_counter] = modelview_kind;
 			matrix4x4_copy(modelview_matrix_stack[modelview_stack_counter++], modelview_matrix);
 		}
 		break;
@@ -753,6 +780,7 @@ void glMatrixPush(GLenum mode) {
 			}
 #endif
 			// Copying current matrix into the matrix stack and increasing stack counter
+			projection_kind_stack[projection_stack_counter] = projection_kind;
 			matrix4x4_copy(projection_matrix_stack[projection_stack_counter++], projection_matrix);
 		}
 		break;
@@ -766,6 +794,7 @@ void glMatrixPush(GLenum mode) {
 			}
 #endif
 			// Copying current matrix into the matrix stack and increasing stack counter
+			tex_unit->texture_kind_stack[tex_unit->texture_stack_counter] = texture_matrix_kind[server_texture_unit];
 			matrix4x4_copy(tex_unit->texture_matrix_stack[tex_unit->texture_stack_counter++], texture_matrix[server_texture_unit]);
 		}
 		break;
@@ -790,6 +819,7 @@ void glMatrixPop(GLenum mode) {
 #endif
 			// Copying last matrix on stack into current matrix and decreasing stack counter
 			matrix4x4_copy(modelview_matrix, modelview_matrix_stack[--modelview_stack_counter]);
+			modelview_kind = modelview_kind_stack[modelview_stack_counter];
 			mvp_modified = GL_TRUE;
 			flag_dirty_vert_unif(MODELVIEW_MATRIX_UNIF)
 			flag_dirty_vert_unif(WVP_MATRIX_UNIF)
@@ -805,6 +835,7 @@ void glMatrixPop(GLenum mode) {
 #endif
 			// Copying last matrix on stack into current matrix and decreasing stack counter
 			matrix4x4_copy(projection_matrix, projection_matrix_stack[--projection_stack_counter]);
+			projection_kind = projection_kind_stack[projection_stack_counter];
 			mvp_modified = GL_TRUE;
 			flag_dirty_vert_unif(WVP_MATRIX_UNIF)
 		}
@@ -821,6 +852,7 @@ void glMatrixPop(GLenum mode) {
 #endif
 			// Copying last matrix on stack into current matrix and decreasing stack counter
 			matrix4x4_copy(texture_matrix[server_texture_unit], tex_unit->texture_matrix_stack[--tex_unit->texture_stack_counter]);
+			texture_matrix_kind[server_texture_unit] = tex_unit->texture_kind_stack[tex_unit->texture_stack_counter];
 			flag_dirty_vert_unif(TEX_MATRIX_UNIF)
 		}
 		break;
@@ -845,7 +877,8 @@ void glTranslatef(GLfloat x, GLfloat y, GLfloat z) {
 #endif
 
 	// Translating in use matrix
-	matrix4x4_translate(*matrix, x, y, z);
+	uint8_t *kind = get_matrix_kind(matrix);
+	*kind = matrix4x4_translate_kind(*matrix, *kind, x, y, z);
 	flag_dirty_matrix_unif()
 }
 
@@ -857,7 +890,8 @@ void glTranslatex(GLfixed x, GLfixed y, GLfixed z) {
 	THREAD_SAFE()
 
 	// Translating in use matrix
-	matrix4x4_translate(*matrix, (float)x / 65536.0f, (float)y / 65536.0f, (float)z / 65536.0f);
+	uint8_t *kind = get_matrix_kind(matrix);
+	*kind = matrix4x4_translate_kind(*matrix, *kind, (float)x / 65536.0f, (float)y / 65536.0f, (float)z / 65536.0f);
 	flag_dirty_matrix_unif()
 }
 
@@ -877,7 +911,8 @@ void glScalef(GLfloat x, GLfloat y, GLfloat z) {
 #endif
 
 	// Scaling in use matrix
-	matrix4x4_scale(*matrix, x, y, z);
+	uint8_t *kind = get_matrix_kind(matrix);
+	*kind = matrix4x4_scale_kind(*matrix, *kind, x, y, z);
 	flag_dirty_matrix_unif()
 }
 
@@ -889,7 +924,8 @@ void glScalex(GLfixed x, GLfixed y, GLfixed z) {
 	THREAD_SAFE()
 
 	// Scaling in use matrix
-	matrix4x4_scale(*matrix, (float)x / 65536.0f, (float)y / 65536.0f, (float)z / 65536.0f);
+	uint8_t *kind = get_matrix_kind(matrix);
+	*kind = matrix4x4_scale_kind(*matrix, *kind, (float)x / 65536.0f, (float)y / 65536.0f, (float)z / 65536.0f);
 	flag_dirty_matrix_unif()
 }
 
@@ -910,7 +946,8 @@ inline void glRotatef(GLfloat angle, GLfloat x, GLfloat y, GLfloat z) {
 
 	// Performing rotation on in use matrix depending on user call
 	float rad = DEG_TO_RAD(angle);
-	matrix4x4_rotate(*matrix, rad, x, y, z);
+	uint8_t *kind = get_matrix_kind(matrix);
+	*kind = matrix4x4_rotate_kind(*matrix, *kind, rad, x, y, z);
 	flag_dirty_matrix_unif()
 }
 
@@ -930,7 +967,8 @@ void glRotatex(GLfixed angle, GLfixed x, GLfixed y, GLfixed z) {
 
 	// Performing rotation on in use matrix depending on user call
 	float rad = DEG_TO_RAD((float)angle / 65536.0f);
-	matrix4x4_rotate(*matrix, rad, (float)x / 65536.0f, (float)y / 65536.0f, (float)z / 65536.0f);
+	uint8_t *kind = get_matrix_kind(matrix);
+	*kind = matrix4x4_rotate_kind(*matrix, *kind, rad, (float)x / 65536.0f, (float)y / 65536.0f, (float)z / 65536.0f);
 
 	flag_dirty_matrix_unif()
 }
@@ -956,6 +994,7 @@ void glPushMatrix(void) {
 		}
 #endif
 		// Copying current matrix into the matrix stack and increasing stack counter
+		modelview_kind_stack[modelview_stack_counter] = modelview_kind;
 		matrix4x4_copy(modelview_matrix_stack[modelview_stack_counter++], *matrix);
 	} else if (matrix == &projection_matrix) {
 #ifndef SKIP_ERROR_HANDLING
@@ -965,6 +1004,7 @@ void glPushMatrix(void) {
 		}
 #endif
 		// Copying current matrix into the matrix stack and increasing stack counter
+		projection_kind_stack[projection_stack_counter] = projection_kind;
 		matrix4x4_copy(projection_matrix_stack[projection_stack_counter++], *matrix);
 	} else if (matrix == &texture_matrix[server_texture_unit]) {
 		texture_unit *tex_unit = &texture_units[server_texture_unit];
@@ -976,6 +1016,7 @@ void glPushMatrix(void) {
 		}
 #endif
 		// Copying current matrix into the matrix stack and increasing stack counter
+		tex_unit->texture_kind_stack[tex_unit->texture_stack_counter] = texture_matrix_kind[server_texture_unit];
 		matrix4x4_copy(tex_unit->texture_matrix_stack[tex_unit->texture_stack_counter++], *matrix);
 	}
 }
@@ -1004,6 +1045,7 @@ void glPopMatrix(void) {
 #endif
 		// Copying last matrix on stack into current matrix and decreasing stack counter
 		matrix4x4_copy(*matrix, modelview_matrix_stack[--modelview_stack_counter]);
+		modelview_kind = modelview_kind_stack[modelview_stack_counter];
 
 		// MVP matrix will have to be updated
 		mvp_modified = GL_TRUE;
@@ -1018,6 +1060,7 @@ void glPopMatrix(void) {
 #endif
 		// Copying last matrix on stack into current matrix and decreasing stack counter
 		matrix4x4_copy(*matrix, projection_matrix_stack[--projection_stack_counter]);
+		projection_kind = projection_kind_stack[projection_stack_counter];
 
 		// MVP matrix will have to be updated
 		mvp_modified = GL_TRUE;
@@ -1033,6 +1076,7 @@ void glPopMatrix(void) {
 #endif
 		// Copying last matrix on stack into current matrix and decreasing stack counter
 		matrix4x4_copy(*matrix, tex_unit->texture_matrix_stack[--tex_unit->texture_stack_counter]);
+		texture_matrix_kind[server_texture_unit] = tex_unit->texture_kind_stack[tex_unit->texture_stack_counter];
 		flag_dirty_vert_unif(TEX_MATRIX_UNIF)
 	}
 }
@@ -1049,6 +1093,7 @@ void gluPerspective(GLdouble fovy, GLdouble aspect, GLdouble zNear, GLdouble zFa
 
 	// Initializing perspective matrix with requested parameters
 	matrix4x4_init_perspective(*matrix, fovy, aspect, zNear, zFar);
+	*get_matrix_kind(matrix) = MATRIX_PROJECTIVE;
 
 	flag_dirty_matrix_unif()
 }
@@ -1094,7 +1139,8 @@ void gluLookAt(GLdouble eyeX, GLdouble eyeY, GLdouble eyeZ, GLdouble centerX, GL
 
 	matrix4x4_multiply(res, m, *matrix);
 	matrix4x4_copy(*matrix, res);
-	matrix4x4_translate(*matrix, -eyeX, -eyeY, -eyeZ);
+	uint8_t *kind = get_matrix_kind(matrix);
+	*kind = matrix4x4_translate_kind(*matrix, matrix_kind_combine(MATRIX_AFFINE, *kind), -eyeX, -eyeY, -eyeZ);
 
 	flag_dirty_matrix_unif()
 }
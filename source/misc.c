@@ -387,17 +387,18 @@ void glEnable(GLenum cap) {
 		SET_GL_ERROR(GL_INVALID_OPERATION)
 	}
 #endif
+	CAPTURE_CALL(CAPTURE_ENABLE, cap)
 	switch (cap) {
 	case GL_FRAMEBUFFER_SRGB:
-		ffp_dirty_frag = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		srgb_mode = GL_TRUE;
 		break;
 	case GL_POINT_SPRITE:
-		ffp_dirty_frag = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		point_sprite_state = GL_TRUE;
 		break;
 	case GL_LIGHTING:
-		ffp_dirty_vert = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		lighting_state = GL_TRUE;
 		break;
 	case GL_DEPTH_TEST:
@@ -438,13 +439,11 @@ void glEnable(GLenum cap) {
 		update_polygon_offset();
 		break;
 	case GL_TEXTURE_1D:
-		ffp_dirty_vert = GL_TRUE;
-		ffp_dirty_frag = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		texture_units[server_texture_unit].state |= (1 << 0);
 		break;
 	case GL_TEXTURE_2D:
-		ffp_dirty_vert = GL_TRUE;
-		ffp_dirty_frag = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		texture_units[server_texture_unit].state |= (1 << 1);
 		break;
 	case GL_ALPHA_TEST:
@@ -452,7 +451,7 @@ void glEnable(GLenum cap) {
 		update_alpha_test_settings();
 		break;
 	case GL_NORMALIZE:
-		ffp_dirty_vert = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		normalize = GL_TRUE;
 		break;
 	case GL_FOG:
@@ -466,7 +465,7 @@ void glEnable(GLenum cap) {
 	case GL_CLIP_PLANE4:
 	case GL_CLIP_PLANE5:
 	case GL_CLIP_PLANE6:
-		ffp_dirty_vert = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		clip_planes_mask |= (1 << (cap - GL_CLIP_PLANE0));
 		clip_plane_range[0] = clip_planes_mask ? __builtin_ctz(clip_planes_mask) : 0; // Get the lowest enabled clip plane
 		clip_plane_range[1] = clip_planes_mask ? 8 - (__builtin_clz(clip_planes_mask) - 24) : 0; // Get the highest enabled clip plane
@@ -486,7 +485,7 @@ void glEnable(GLenum cap) {
 	case GL_LIGHT5:
 	case GL_LIGHT6:
 	case GL_LIGHT7:
-		ffp_dirty_vert = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		light_mask |= (1 << (cap - GL_LIGHT0));
 
 		light_range[0] = light_mask ? __builtin_ctz(light_mask) : 0; // Get the lowest enabled light
@@ -517,19 +516,18 @@ void glDisable(GLenum cap) {
 		SET_GL_ERROR(GL_INVALID_OPERATION)
 	}
 #endif
+	CAPTURE_CALL(CAPTURE_DISABLE, cap)
 	switch (cap) {
 	case GL_FRAMEBUFFER_SRGB:
-		ffp_dirty_frag = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		srgb_mode = GL_FALSE;
 		break;
 	case GL_POINT_SPRITE:
-		ffp_dirty_frag = GL_TRUE;
-		ffp_dirty_vert = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		point_sprite_state = GL_FALSE;
 		break;
 	case GL_LIGHTING:
-		ffp_dirty_vert = GL_TRUE;
-		ffp_dirty_frag = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		lighting_state = GL_FALSE;
 		break;
 	case GL_COLOR_MATERIAL:
@@ -570,13 +568,11 @@ void glDisable(GLenum cap) {
 		update_polygon_offset();
 		break;
 	case GL_TEXTURE_1D:
-		ffp_dirty_vert = GL_TRUE;
-		ffp_dirty_frag = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		texture_units[server_texture_unit].state &= ~(1 << 0);
 		break;
 	case GL_TEXTURE_2D:
-		ffp_dirty_vert = GL_TRUE;
-		ffp_dirty_frag = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		texture_units[server_texture_unit].state &= ~(1 << 1);
 		break;
 	case GL_ALPHA_TEST:
@@ -584,7 +580,7 @@ void glDisable(GLenum cap) {
 		update_alpha_test_settings();
 		break;
 	case GL_NORMALIZE:
-		ffp_dirty_vert = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		normalize = GL_FALSE;
 		break;
 	case GL_FOG:
@@ -598,7 +594,7 @@ void glDisable(GLenum cap) {
 	case GL_CLIP_PLANE4:
 	case GL_CLIP_PLANE5:
 	case GL_CLIP_PLANE6:
-		ffp_dirty_vert = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		clip_planes_mask &= ~(1 << (cap - GL_CLIP_PLANE0));
 
 		clip_plane_range[0] = clip_planes_mask ? __builtin_ctz(clip_planes_mask) : 0; // Get the lowest enabled clip plane
@@ -619,7 +615,7 @@ void glDisable(GLenum cap) {
 	case GL_LIGHT5:
 	case GL_LIGHT6:
 	case GL_LIGHT7:
-		ffp_dirty_vert = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 		light_mask &= ~(1 << (cap - GL_LIGHT0));
 
 		light_range[0] = light_mask ? __builtin_ctz(light_mask) : 0; // Get the lowest enabled clip plane
@@ -645,6 +641,7 @@ void glClear(GLbitfield mask) {
 		SET_GL_ERROR(GL_INVALID_VALUE);
 	}
 #endif
+	CAPTURE_CALL(CAPTURE_CLEAR, mask)
 	scene_reset();
 
 	// Invalidating viewport and culling
@@ -820,6 +817,7 @@ void glHint(GLenum target, GLenum mode) {
 		break;
 	case GL_PERSPECTIVE_CORRECTION_HINT:
 		fast_perspective_correction_hint = GL_FASTEST ? GL_TRUE: GL_FALSE;
+		ffp_dirty_mask = GL_TRUE;
 		break;
 	default:
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_ENUM, target)
@@ -1014,8 +1012,7 @@ void glPopAttrib(void) {
 		update_fogging_state();
 		clip_planes_mask = setup->clip_planes_mask;
 		light_mask = setup->light_mask;
-		ffp_dirty_vert = GL_TRUE;
-		ffp_dirty_frag = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 	}
 	if (setup->enabled_bits & (1 << FOG_BIT)) {
 		fogging = setup->fogging;
@@ -1079,7 +1076,7 @@ void glPopAttrib(void) {
 		for (int i = 0; i < MAX_CLIP_PLANES_NUM; i++) {
 			clip_planes_eq[i] = setup->clip_planes_eq[i];
 		}
-		ffp_dirty_vert = GL_TRUE;
+		ffp_dirty_mask = GL_TRUE;
 	}
 	if (setup->enabled_bits & (1 << VIEWPORT_BIT)) {
 		gl_viewport = setup->gl_viewport;
@@ -287,26 +287,42 @@ extern int NEW_DISPLAY_HEIGHT; // Requested new display height in pixels
 #include <psp2/sysmodule.h>
 
 #include "utils/atitc_utils.h"
+#include "utils/capture_utils.h"
 #include "utils/eac_utils.h"
 #include "utils/etc1_utils.h"
 #include "utils/gpu_utils.h"
 #include "utils/gxm_utils.h"
 #include "utils/math_utils.h"
 #include "utils/mem_utils.h"
+#include "utils/profiler_utils.h"
+#include "utils/shader_pack.h"
 
 #include "texture_callbacks.h"
 
 // Fixed-function pipeline shader cache settings
 #define FFP_SHADER_CACHE_MAGIC 28 // This must be increased whenever ffp shader sources or shader mask/combiner mask changes
+#define FFP_MANIFEST_PATH "ux0:data/shader_cache/ffp_manifest.bin" // Warm-up manifest listing every ffp shader seen at runtime
+extern shader_pack ffp_shader_pack; // Packed filesystem cache for ffp shaders
+
+// Shader compiler serialization, only enforced while a background compilation job is running
+#define lock_shader_compiler() \
+	if (shark_sema >= 0) \
+		sceKernelWaitSema(shark_sema, 1, NULL);
+#define unlock_shader_compiler() \
+	if (shark_sema >= 0) \
+		sceKernelSignalSema(shark_sema, 1);
 //#define DUMP_SHADER_SOURCES // Enable this flag to dump shader sources inside shader cache
 
 // Custom shaders pipeline shader cache settings
 #ifdef HAVE_SHADER_CACHE
 #define SHADER_CACHE_MAGIC 1
 extern char vgl_shader_cache_path[256];
+extern shader_pack glsl_shader_pack; // Packed filesystem cache for custom shaders
+extern shader_pack glsl_translation_pack; // Packed filesystem cache for translated GLSL shaders sources
 #endif
 
 extern GLboolean prim_is_non_native; // Flag for when a primitive not supported natively by sceGxm is used
+extern const GLfloat *matrix_palette; // Model matrices of the draws of the vglMultiDrawArraysMatrices call being processed
 
 // Translates a GL primitive enum to its sceGxm equivalent
 #ifndef SKIP_ERROR_HANDLING
@@ -468,20 +484,20 @@ extern GLboolean prim_is_non_native; // Flag for when a primitive not supported
 #define patch_fragment_program sceGxmShaderPatcherCreateFragmentProgram
 #endif
 
-#define recalculate_normal_matrix() \
-	matrix3x3 inverted; \
-	matrix3x3 top_modelview_matrix; \
-	vgl_fast_memcpy(top_modelview_matrix[0], modelview_matrix[0], sizeof(float) * 3); \
-	vgl_fast_memcpy(top_modelview_matrix[1], modelview_matrix[1], sizeof(float) * 3); \
-	vgl_fast_memcpy(top_modelview_matrix[2], modelview_matrix[2], sizeof(float) * 3); \
-	matrix3x3_invert(inverted, top_modelview_matrix); \
-	matrix3x3_transpose(normal_matrix, inverted);
+#define recalculate_normal_matrix() matrix4x4_normal_matrix_kind(normal_matrix, modelview_matrix, modelview_kind)
+#define recalculate_mvp_matrix() matrix4x4_multiply_kind(vgl_mvp_matrix, projection_matrix, projection_kind, modelview_matrix, modelview_kind)
 
-#define rebuild_frag_shader(x, y, z, w) patch_fragment_program(gxm_shader_patcher, x, w, msaa_mode, &blend_info.info, z, y) // Creates a new patched fragment program with proper blend settings
+// Creates a new patched fragment program with proper blend settings
+#define rebuild_frag_shader(x, y, z, w) \
+	(vgl_perf_counters.fragment_program_patches++, patch_fragment_program(gxm_shader_patcher, x, w, msaa_mode, &blend_info.info, z, y))
 
 #ifdef HAVE_SOFTFP_ABI
 extern __attribute__((naked)) void sceGxmSetViewport_sfp(SceGxmContext *context, float xOffset, float xScale, float yOffset, float yScale, float zOffset, float zScale);
+#ifdef HAVE_DEFERRED_DRAWS
+#define vglSetViewport(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetViewport_sfp(ctx, __VA_ARGS__))
+#else
 #define vglSetViewport sceGxmSetViewport_sfp
+#endif
 #else
 #define vglSetViewport sceGxmSetViewport
 #endif
@@ -571,6 +587,7 @@ typedef struct {
 	uint8_t texture_stack_counter;
 	uint8_t env_mode;
 	matrix4x4 texture_matrix_stack[GENERIC_STACK_DEPTH];
+	uint8_t texture_kind_stack[GENERIC_STACK_DEPTH];
 	combiner_state combiner;
 	vector4f env_color;
 	float rgb_scale;
@@ -753,19 +770,45 @@ typedef enum {
 	PHONG
 } shad_mode;
 
-// Display list function call internal struct
+// Display list function call internal struct, followed by its packed arguments
 typedef struct {
 	void (*func)();
-	uint8_t args[16];
 	uint32_t type;
-	void *next;
-} list_chain;
+	uint32_t size; // Size of the command including its arguments
+} dlist_cmd;
+
+// Immediate mode primitive baked from a display list
+typedef struct {
+	float *verts; // Static copy of the primitive vertices
+	uint32_t vertex_count;
+	uint32_t last_frame;
+	GLenum mode;
+	uint8_t tex_state[2]; // Texture units states the vertices got built with
+	GLboolean lighting; // Lighting state the vertices got built with
+	uint8_t lit_varying;
+	uint8_t lit_base;
+	uint8_t lit_stride;
+	legacy_vtx_attachment start_vtx; // Current vertex attributes before the primitive got built
+	legacy_vtx_attachment end_vtx; // Current vertex attributes after the primitive got built
+} baked_geometry;
+
+// Display list glBegin/glEnd block made only of vertex attributes calls
+typedef struct {
+	uint32_t begin; // Offset of the glBegin call
+	uint32_t end_call; // Offset of the glEnd call
+	uint32_t end; // Offset of the first call after the block
+	uint8_t misses; // Number of times the block got baked again due to a different state
+	baked_geometry geom;
+} dlist_run;
 
 // Display list internal struct
 typedef struct {
 	GLboolean used;
-	list_chain *head;
-	list_chain *tail;
+	uint8_t *code; // Recorded commands stream
+	uint32_t size; // Size of the recorded commands stream
+	uint32_t capacity; // Allocated size of the recorded commands stream
+	dlist_run *runs; // Bakeable glBegin/glEnd blocks
+	uint32_t runs_num;
 } display_list;
 
 // Matrix uniform struct
@@ -796,6 +839,21 @@ typedef struct {
 } glsl_samplers_info;
 #endif
 
+// Compiled shader program shared between identical shaders
+typedef struct shader_bin {
+	uint64_t src_hash; // Hash of the translated source and compiler settings (0 if unknown)
+	uint64_t prog_hash; // Hash of the compiled program
+	const SceGxmProgram *prog;
+	SceGxmShaderPatcherId id;
+	uint32_t size;
+	uint32_t unif_buf_size;
+	matrix_uniform *mat;
+	block_uniform *unif_blk;
+	uint32_t ref_counter;
+	struct shader_bin *src_chain;
+	struct shader_bin *prog_chain;
+} shader_bin;
+
 // Generic shader struct
 typedef struct {
 	GLenum type;
@@ -815,6 +873,8 @@ typedef struct {
 	char *source;
 	matrix_uniform *mat;
 	block_uniform *unif_blk;
+	shader_bin *bin; // Compiled program backing the shader (NULL if not compiled)
+	uint32_t compile_job; // Background compilation job processing the shader (0 if none)
 #ifdef HAVE_SHARK_LOG
 	char *log;
 #endif
@@ -871,6 +931,7 @@ extern float *legacy_pool_ptr; // Current address for vertices population for GL
 extern float *legacy_pool_end; // Address of the end of the GL1 immediate draw pipeline vertex pool
 #endif
 extern uint32_t vgl_framecount; // Current frame number since application started
+extern vglPerfCounters vgl_perf_counters; // Cumulative performance counters since vitaGL got initialized
 extern SceGxmVertexAttribute legacy_vertex_attrib_config[FFP_VERTEX_ATTRIBS_NUM - 1];
 extern SceGxmVertexStream legacy_vertex_stream_config[FFP_VERTEX_ATTRIBS_NUM - 1];
 extern SceGxmVertexAttribute legacy_mt_vertex_attrib_config[FFP_VERTEX_ATTRIBS_NUM];
@@ -879,6 +940,16 @@ extern SceGxmVertexAttribute legacy_nt_vertex_attrib_config[FFP_VERTEX_ATTRIBS_N
 extern SceGxmVertexStream legacy_nt_vertex_stream_config[FFP_VERTEX_ATTRIBS_NUM - 2];
 extern SceGxmVertexAttribute ffp_vertex_attrib_config[FFP_VERTEX_ATTRIBS_NUM];
 extern SceGxmVertexStream ffp_vertex_stream_config[FFP_VERTEX_ATTRIBS_NUM];
+extern uint32_t vgl_ffp_shader_cache_size; // Max number of fixed function shaders per stage kept in the RAM cache
+extern uint32_t vgl_ffp_shader_cache_hits; // Number of fixed function shaders switches served by the RAM cache
+extern uint32_t vgl_ffp_shader_cache_misses; // Number of fixed function shaders switches not served by the RAM cache
+extern uint32_t vgl_ffp_shader_cache_evictions; // Number of fixed function shaders evicted from the RAM cache
+#ifdef HAVE_CLIENT_ARRAYS_CACHE
+extern uint32_t vgl_client_arrays_cache_threshold; // Minimum size in bytes for a client array range to be cacheable
+extern uint32_t vgl_client_arrays_cache_hits; // Number of copies avoided thanks to the client arrays cache
+extern uint32_t vgl_client_arrays_cache_misses; // Number of cacheable ranges that required a copy
+extern uint64_t vgl_client_arrays_cache_saved; // Number of bytes not copied thanks to the client arrays cache
+#endif
 
 // Fixed function pipeline attribute masks
 enum {
@@ -979,14 +1050,18 @@ extern GLboolean has_razor_live; // Flag for live metrics support with sceRazor
 #endif
 
 extern GLboolean is_shark_online; // Current vitaShaRK status
+extern SceUID shark_sema; // Semaphore guarding vitaShaRK usage during background compilation jobs
+extern GLuint shader_compiler_threads; // Number of threads requested with glMaxShaderCompilerThreadsKHR
 extern uint32_t dirty_frag_unifs;
 extern uint16_t dirty_vert_unifs;
 extern GLboolean dirty_shader_frag_unifs;
 extern GLboolean dirty_shader_vert_unifs;
+extern uint32_t vgl_unif_buffers_uploads; // Number of custom shaders default uniform buffers copied to GPU memory
+extern uint32_t vgl_unif_buffers_reuses; // Number of custom shaders default uniform buffers copies avoided by binding an unchanged copy
+extern uint64_t vgl_unif_buffers_saved; // Number of bytes not copied thanks to default uniform buffers reuses
 
 // Internal fixed function pipeline dirty flags and variables
-extern GLboolean ffp_dirty_frag;
-extern GLboolean ffp_dirty_vert;
+extern GLboolean ffp_dirty_mask;
 extern uint16_t ffp_vertex_attrib_state;
 extern uint8_t ffp_vertex_num_params;
 
@@ -1161,6 +1236,9 @@ extern matrix4x4 texture_matrix[TEXTURE_COORDS_NUM]; // Texture Matrix
 extern matrix3x3 normal_matrix; // Normal Matrix
 extern matrix4x4 modelview_matrix_stack[MODELVIEW_STACK_DEPTH]; // Modelview matrices stack
 extern matrix4x4 projection_matrix_stack[GENERIC_STACK_DEPTH]; // Projection matrices stack
+extern uint8_t modelview_kind; // ModelView matrix kind
+extern uint8_t projection_kind; // Projection matrix kind
+extern uint8_t texture_matrix_kind[TEXTURE_COORDS_NUM]; // Texture matrices kinds
 extern GLboolean mvp_modified; // Check if ModelViewProjection matrix needs to be recreated
 
 extern GLuint cur_program; // Current in use custom program (0 = No custom program)
@@ -1230,11 +1308,16 @@ GLenum gxm_blend_eq_to_gl(SceGxmBlendFunc factor); // Converts SceGxmBlendFunc t
 
 /* custom_shaders.c */
 void reset_custom_shaders(void); // Resets custom shaders
+void setup_glsl_shader_pack(void); // Opens the packed filesystem cache for custom shaders
+void acquire_shader_compiler_sema(void); // Enables vitaShaRK serialization for a background compilation user
+void release_shader_compiler_sema(void); // Disables vitaShaRK serialization once no background compilation user is left
+void finish_shader_jobs(void); // Waits for any queued background custom shader compilation job to complete
 float *reserve_attrib_pool(uint8_t count);
 void _vglDrawObjects_CustomShadersIMPL(); // vglDrawObjects implementation for rendering with custom shaders
 GLboolean _glDrawElements_CustomShadersIMPL(uint16_t *idx_buf, GLsizei count, uint32_t top_idx, uint32_t base_idx, GLboolean is_short); // glDrawElements implementation for rendering with custom shaders
 GLboolean _glDrawArrays_CustomShadersIMPL(GLint first, GLsizei count, GLboolean instanced); // glDrawArrays implementation for rendering with custom shaders
 void _glMultiDrawArrays_CustomShadersIMPL(SceGxmPrimitiveType gxm_p, uint16_t *idx_buf, const GLint *first, const GLsizei *count, GLint lowest, GLsizei highest, GLsizei drawcount); // glMultiDrawArrays implementation for rendering with custom shaders
+void _glMultiDrawElements_CustomShadersIMPL(SceGxmPrimitiveType gxm_p, SceGxmIndexFormat idx_fmt, uint16_t **idx_bufs, const GLsizei *count, const GLint *base_vertex, uint32_t top_idx, SceGxmIndexSource index_type, GLsizei drawcount); // glMultiDrawElements implementation for rendering with custom shaders
 
 /* ffp.c */
 void _glDrawElements_FixedFunctionIMPL(uint16_t *idx_buf, GLsizei count, uint32_t top_idx, uint32_t base_idx, GLboolean is_short); // glDrawElements implementation for rendering with ffp
@@ -1244,6 +1327,15 @@ uint8_t reload_ffp_shaders(SceGxmVertexAttribute *attrs, SceGxmVertexStream *str
 void upload_ffp_uniforms(); // Uploads required uniforms for the in use ffp shaders
 void update_fogging_state(); // Updates current setup for fogging
 void adjust_color_material_state(); // Updates internal settings for GL_COLOR_MATERIAL
+void setup_ffp_shader_pack(void); // Opens the packed filesystem cache for ffp shaders
+#ifdef HAVE_CLIENT_ARRAYS_CACHE
+void age_client_arrays_cache(void); // Releases client arrays ranges not used since a lot of frames
+#endif
+#ifdef HAVE_DLISTS
+void ffp_bake_geometry(baked_geometry *g, float *verts, const legacy_vtx_attachment *start_vtx); // Stores the last immediate mode primitive into a baked geometry
+void ffp_free_baked_geometry(baked_geometry *g); // Frees the vertices of a baked geometry
+GLboolean ffp_draw_baked_geometry(baked_geometry *g); // Draws a baked geometry if compatible with the current state
+#endif
 
 /* buffers.c */
 void reset_vao(vao *v); // Reset vao state
@@ -1281,6 +1373,7 @@ void vgl_debugger_draw(uint32_t *fb); // Draws CPU rendered debugger window
 
 /* vitaGL.c */
 uint8_t *vgl_reserve_data_pool(uint32_t size);
+void vgl_perf_end_frame(uint32_t circular_pool_usage); // Closes the performance counters of the frame being presented
 
 // Taken from here: https://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
 static inline __attribute__((always_inline)) uint32_t nearest_po2(uint32_t val) {
@@ -945,6 +945,7 @@ static inline __attribute__((always_inline)) void _glTexImage2D_FlatIMPL(texture
 }
 
 static inline __attribute__((always_inline)) void _glTexSubImage2D(texture *tex, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels) {
+	PROFILER_SCOPE(PROF_TEXTURE_UPLOAD)
 #ifdef HAVE_UNPURE_TEXTURES
 	level -= tex->mip_start;
 #endif
@@ -1237,6 +1238,7 @@ static inline __attribute__((always_inline)) void _glTexSubImage2D(texture *tex,
 			mip_stride = VGL_ALIGN(orig_w, 8) * bpp;
 		}
 		ptr += xoffset * bpp + yoffset * mip_stride;
+		vgl_perf_counters.texture_bytes_uploaded += width * height * bpp;
 		if (fast_store) { // Internal format and input format are the same, we can take advantage of this
 			uint8_t *data = (uint8_t *)pixels;
 			uint32_t line_size = width * bpp;
@@ -1251,6 +1253,7 @@ static inline __attribute__((always_inline)) void _glTexSubImage2D(texture *tex,
 				}
 			}
 		} else { // Executing texture modification via callbacks
+			vgl_perf_counters.texture_bytes_converted += width * height * bpp;
 			uint8_t *ptr_line = ptr;
 			uint8_t *data = (uint8_t *)pixels;
 			for (int i = 0; i < height; i++) {
@@ -1779,6 +1782,8 @@ void glBindTexture(GLenum target, GLuint texture) {
 		SET_GL_ERROR_WITH_VALUE(GL_INVALID_VALUE, texture)
 	}
 #endif
+	CAPTURE_OBJECT(capture_texture, target, texture)
+	CAPTURE_CALL(CAPTURE_BIND_TEXTURE, target, texture)
 
 	// Setting current in use texture id for the in use server texture unit
 	switch (target) {
@@ -1881,6 +1886,7 @@ void glTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei widt
 		SET_GL_ERROR(GL_INVALID_VALUE)
 	}
 #endif
+	CAPTURE_CALL_WITH_DATA(CAPTURE_TEX_IMAGE_2D, data, capture_pixels_size(format, type, width, height), target, level, internalFormat, width, height, format, type)
 
 #ifdef HAVE_UNPURE_TEXTURES
 	if (tex->mip_start < 0)
@@ -1984,6 +1990,7 @@ void glTextureImage1D(GLuint tex_id, GLint level, GLint internalFormat, GLsizei
 
 void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels) {	
 	THREAD_SAFE()
+	CAPTURE_CALL_WITH_DATA(CAPTURE_TEX_SUB_IMAGE_2D, pixels, capture_pixels_size(format, type, width, height), target, level, xoffset, yoffset, width, height, format, type)
 
 	// Setting some aliases to make code more readable
 	texture_unit *tex_unit = &texture_units[server_texture_unit];
@@ -2025,6 +2032,7 @@ void glTextureSubImage1D(GLuint tex_id, GLint level, GLint xoffset, GLsizei widt
 
 void glCompressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void *data) {
 	THREAD_SAFE()
+	CAPTURE_CALL_WITH_DATA(CAPTURE_COMPRESSED_TEX_IMAGE_2D, data, imageSize, target, level, internalFormat, width, height, imageSize)
 
 	// Setting some aliases to make code more readable
 	texture_unit *tex_unit = &texture_units[server_texture_unit];
@@ -2159,6 +2167,7 @@ void glTextureParameteriv(GLuint tex_id, GLenum pname, GLint *param) {
 
 void glActiveTexture(GLenum texture) {
 	THREAD_SAFE()
+	CAPTURE_CALL(CAPTURE_ACTIVE_TEXTURE, texture)
 
 	// Changing current in use server texture unit
 #ifndef SKIP_ERROR_HANDLING
@@ -0,0 +1,592 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * capture_utils.c:
+ * Frame capture layer serializing the GL calls stream of a given number of frames
+ *
+ * Every captured call is stored with its arguments and the CPU time spent in it.
+ * Data referenced by a call (buffers content, texture pixels, client indices) is
+ * hashed and stored once as a blob record, later calls referencing the same data
+ * only store its hash. Hashing and blobs writing happen before the call gets timed
+ * so that captured durations are not inflated by the capture layer itself.
+ * Captures are stored in a compact binary format (see capture_header) that
+ * tools/vgl_capture.py summarizes per call category and compares between builds.
+ */
+#include "../shared.h"
+#define XXH_STATIC_LINKING_ONLY
+#define XXH_NAMESPACE VITAGL_
+#include "xxhash_utils.h"
+
+#define CAPTURE_BUFFER_SIZE (64 * 1024) // Size of the buffer used to batch file writes
+#define CAPTURE_INITIAL_SET_SIZE 1024 // Initial size of the stored blobs and described objects hash sets
+
+#ifdef HAVE_FRAME_CAPTURE
+// Categories the captured calls get grouped into when reporting CPU time
+enum {
+	CAPTURE_CAT_INTERNAL,
+	CAPTURE_CAT_FRAME,
+	CAPTURE_CAT_DRAW,
+	CAPTURE_CAT_IMMEDIATE,
+	CAPTURE_CAT_CLEAR,
+	CAPTURE_CAT_BUFFER_UPLOAD,
+	CAPTURE_CAT_TEXTURE_UPLOAD,
+	CAPTURE_CAT_STATE,
+	CAPTURE_CAT_UNIFORM,
+	CAPTURE_CAT_SHADER,
+	CAPTURE_CATS_NUM
+};
+
+static const char *capture_category_names[CAPTURE_CATS_NUM] = {
+	"Internal",
+	"Frame",
+	"Draw",
+	"Immediate",
+	"Clear",
+	"Buffer Upload",
+	"Texture Upload",
+	"State",
+	"Uniform",
+	"Shader",
+};
+
+typedef struct {
+	const char *name;
+	uint8_t category;
+	GLboolean has_data; // Does the call reference data through a hash stored as its last two arguments?
+} capture_call_info;
+
+static const capture_call_info capture_calls[CAPTURE_CALLS_NUM] = {
+	{"Blob", CAPTURE_CAT_INTERNAL, GL_FALSE},
+	{"vglSwapBuffers", CAPTURE_CAT_FRAME, GL_FALSE},
+	{"State", CAPTURE_CAT_INTERNAL, GL_TRUE},
+	{"Buffer", CAPTURE_CAT_INTERNAL, GL_TRUE},
+	{"Texture", CAPTURE_CAT_INTERNAL, GL_FALSE},
+	{"Shader", CAPTURE_CAT_INTERNAL, GL_TRUE},
+	{"Program", CAPTURE_CAT_INTERNAL, GL_TRUE},
+	{"Uniform Location", CAPTURE_CAT_INTERNAL, GL_TRUE},
+	{"Vertex Arrays", CAPTURE_CAT_INTERNAL, GL_TRUE},
+	{"Matrix", CAPTURE_CAT_INTERNAL, GL_TRUE},
+	{"glDrawArrays", CAPTURE_CAT_DRAW, GL_FALSE},
+	{"glDrawArraysInstanced", CAPTURE_CAT_DRAW, GL_FALSE},
+	{"glMultiDrawArrays", CAPTURE_CAT_DRAW, GL_TRUE},
+	{"glDrawElements", CAPTURE_CAT_DRAW, GL_TRUE},
+	{"glDrawElementsBaseVertex", CAPTURE_CAT_DRAW, GL_TRUE},
+	{"glDrawRangeElements", CAPTURE_CAT_DRAW, GL_TRUE},
+	{"glDrawElementsInstanced", CAPTURE_CAT_DRAW, GL_TRUE},
+	{"glMultiDrawElements", CAPTURE_CAT_DRAW, GL_TRUE},
+	{"vglMultiDrawElementsIndirect", CAPTURE_CAT_DRAW, GL_TRUE},
+	{"glEnd", CAPTURE_CAT_IMMEDIATE, GL_TRUE},
+	{"glClear", CAPTURE_CAT_CLEAR, GL_FALSE},
+	{"glBufferData", CAPTURE_CAT_BUFFER_UPLOAD, GL_TRUE},
+	{"glBufferSubData", CAPTURE_CAT_BUFFER_UPLOAD, GL_TRUE},
+	{"glTexImage2D", CAPTURE_CAT_TEXTURE_UPLOAD, GL_TRUE},
+	{"glTexSubImage2D", CAPTURE_CAT_TEXTURE_UPLOAD, GL_TRUE},
+	{"glCompressedTexImage2D", CAPTURE_CAT_TEXTURE_UPLOAD, GL_TRUE},
+	{"glBindBuffer", CAPTURE_CAT_STATE, GL_FALSE},
+	{"glBindTexture", CAPTURE_CAT_STATE, GL_FALSE},
+	{"glActiveTexture", CAPTURE_CAT_STATE, GL_FALSE},
+	{"glEnable", CAPTURE_CAT_STATE, GL_FALSE},
+	{"glDisable", CAPTURE_CAT_STATE, GL_FALSE},
+	{"glUseProgram", CAPTURE_CAT_STATE, GL_FALSE},
+	{"glUniform", CAPTURE_CAT_UNIFORM, GL_TRUE},
+	{"glShaderSource", CAPTURE_CAT_SHADER, GL_TRUE},
+	{"glCompileShader", CAPTURE_CAT_SHADER, GL_FALSE},
+	{"glAttachShader", CAPTURE_CAT_SHADER, GL_FALSE},
+	{"glBindAttribLocation", CAPTURE_CAT_SHADER, GL_TRUE},
+	{"glLinkProgram", CAPTURE_CAT_SHADER, GL_FALSE},
+};
+
+// Capabilities whose state gets stored at capture start
+static const GLenum capture_caps[] = {
+	GL_ALPHA_TEST,
+	GL_BLEND,
+	GL_CULL_FACE,
+	GL_DEPTH_TEST,
+	GL_LIGHTING,
+	GL_NORMALIZE,
+	GL_POLYGON_OFFSET_FILL,
+	GL_SCISSOR_TEST,
+	GL_STENCIL_TEST,
+	GL_LIGHT0,
+	GL_LIGHT1,
+	GL_LIGHT2,
+	GL_LIGHT3,
+	GL_LIGHT4,
+	GL_LIGHT5,
+	GL_LIGHT6,
+	GL_LIGHT7,
+};
+
+// Data of a CAPTURE_STATE record
+typedef struct {
+	capture_texture_unit units[COMBINED_TEXTURE_IMAGE_UNITS_NUM];
+	uint32_t caps[sizeof(capture_caps) / sizeof(GLenum)][2]; // {capability, enabled}
+} capture_state;
+
+// Open addressing hash set of 64 bit keys (0 being reserved for empty entries)
+typedef struct {
+	uint64_t *keys;
+	uint32_t size;
+	uint32_t num;
+} capture_set;
+
+GLboolean vgl_capture_active = GL_FALSE; // Is the frame capture layer recording?
+static SceUID capture_fd = -1; // Capture file, valid from the capture request to its end
+static uint32_t capture_frames_left = 0; // Number of frames still to capture
+static uint32_t capture_frame_idx = 0; // Index of the frame being captured
+static uint32_t capture_frame_start = 0; // Process time in microseconds at last buffer swap
+static uint32_t capture_depth = 0; // Number of captured calls in progress, calls performed inside another captured call are skipped
+static uint8_t *capture_buf = NULL; // Buffer used to batch file writes
+static uint32_t capture_buf_pos = 0; // Number of bytes queued in the writes buffer
+static capture_set capture_blobs = {0}; // Hashes of the stored blobs
+static capture_set capture_objects = {0}; // Objects described since capture start
+static uint64_t capture_slots[CAPTURE_SLOTS_NUM]; // Hashes of the last records written per state slot
+static void *capture_scratch_buf = NULL; // Scratch buffer used to pack the data of captured calls
+static uint32_t capture_scratch_size = 0; // Size of the scratch buffer
+
+static void capture_flush(void) {
+	if (capture_buf_pos) {
+		sceIoWrite(capture_fd, capture_buf, capture_buf_pos);
+		capture_buf_pos = 0;
+	}
+}
+
+static void capture_write(const void *data, uint32_t size) {
+	if (capture_buf_pos + size > CAPTURE_BUFFER_SIZE) {
+		capture_flush();
+		// Big blobs are written straight to the file
+		if (size > CAPTURE_BUFFER_SIZE) {
+			sceIoWrite(capture_fd, data, size);
+			return;
+		}
+	}
+	vgl_fast_memcpy(&capture_buf[capture_buf_pos], data, size);
+	capture_buf_pos += size;
+}
+
+static void capture_write_record(uint8_t call, uint32_t duration, const uint32_t *args, uint8_t args_num) {
+	capture_record r;
+	r.call = call;
+	r.args_num = args_num;
+	r.frame = capture_frame_idx;
+	r.duration = duration;
+	capture_write(&r, sizeof(capture_record));
+	capture_write(args, args_num * sizeof(uint32_t));
+}
+
+static GLboolean capture_set_insert(capture_set *set, uint64_t key) {
+	// Growing the hash set when half full to keep probe sequences short
+	if ((set->num + 1) * 2 > set->size) {
+		uint32_t size = set->size ? set->size * 2 : CAPTURE_INITIAL_SET_SIZE;
+		uint64_t *keys = (uint64_t *)vgl_calloc(size, sizeof(uint64_t), VGL_MEM_EXTERNAL);
+		if (!keys) {
+			// Without room for the key, it gets reported as new every time it's inserted
+			if (set->num + 1 >= set->size)
+				return GL_TRUE;
+		} else {
+			for (uint32_t i = 0; i < set->size; i++) {
+				if (set->keys[i]) {
+					uint32_t j = (uint32_t)set->keys[i] & (size - 1);
+					while (keys[j])
+						j = (j + 1) & (size - 1);
+					keys[j] = set->keys[i];
+				}
+			}
+			vgl_free(set->keys);
+			set->keys = keys;
+			set->size = size;
+		}
+	}
+
+	uint32_t mask = set->size - 1;
+	uint32_t i = (uint32_t)key & mask;
+	while (set->keys[i]) {
+		if (set->keys[i] == key)
+			return GL_FALSE;
+		i = (i + 1) & mask;
+	}
+	set->keys[i] = key;
+	set->num++;
+	return GL_TRUE;
+}
+
+static void capture_set_free(capture_set *set) {
+	vgl_free(set->keys);
+	set->keys = NULL;
+	set->size = 0;
+	set->num = 0;
+}
+
+uint64_t capture_store_blob(const void *data, uint32_t size) {
+	if (!data || !size)
+		return 0;
+
+	// Hash 0 is reserved for calls not referencing any data
+	uint64_t hash = XXH3_64bits(data, size);
+	if (!hash)
+		hash = 1;
+	if (capture_set_insert(&capture_blobs, hash)) {
+		uint32_t args[3] = {(uint32_t)hash, (uint32_t)(hash >> 32), size};
+		capture_write_record(CAPTURE_BLOB, 0, args, 3);
+		capture_write(data, size);
+		uint32_t pad = 0;
+		capture_write(&pad, (4 - (size & 3)) & 3);
+	}
+	return hash;
+}
+
+static void capture_write_snapshot(void) {
+	// Describing the objects the bindings reference before the bindings themselves
+	for (int i = 0; i < COMBINED_TEXTURE_IMAGE_UNITS_NUM; i++) {
+		capture_texture(GL_TEXTURE_2D, texture_units[i].tex_id[0]);
+		capture_texture(GL_TEXTURE_1D, texture_units[i].tex_id[1]);
+		capture_texture(GL_TEXTURE_CUBE_MAP, texture_units[i].tex_id[2]);
+	}
+	if (cur_program)
+		capture_program(cur_program);
+	capture_buffer(vertex_array_unit);
+
+	capture_state *st = (capture_state *)capture_scratch(sizeof(capture_state));
+	if (!st)
+		return;
+	for (int i = 0; i < COMBINED_TEXTURE_IMAGE_UNITS_NUM; i++) {
+		st->units[i].state = texture_units[i].state;
+		for (int j = 0; j < 3; j++)
+			st->units[i].tex_id[j] = texture_units[i].tex_id[j];
+	}
+	for (int i = 0; i < sizeof(capture_caps) / sizeof(GLenum); i++) {
+		st->caps[i][0] = capture_caps[i];
+		st->caps[i][1] = glIsEnabled(capture_caps[i]);
+	}
+	capture_write_state(CAPTURE_STATE, CAPTURE_ARGS(cur_program, server_texture_unit, client_texture_unit, vertex_array_unit), st, sizeof(capture_state));
+}
+
+static void capture_stop(void) {
+	capture_flush();
+	sceIoClose(capture_fd);
+	capture_fd = -1;
+	vgl_capture_active = GL_FALSE;
+	vgl_free(capture_buf);
+	capture_buf = NULL;
+	vgl_free(capture_scratch_buf);
+	capture_scratch_buf = NULL;
+	capture_scratch_size = 0;
+	capture_set_free(&capture_blobs);
+	capture_set_free(&capture_objects);
+}
+
+capture_scope capture_scope_begin(uint8_t call, const uint32_t *args, uint8_t args_num, const void *data, uint32_t size) {
+	capture_scope s;
+	s.active = capture_depth == 0;
+	if (!s.active)
+		return s;
+	capture_depth++;
+	s.call = call;
+	s.args_num = args_num;
+	vgl_fast_memcpy(s.args, args, args_num * sizeof(uint32_t));
+	if (capture_calls[call].has_data) {
+		uint64_t hash = capture_store_blob(data, size);
+		s.args[s.args_num++] = (uint32_t)hash;
+		s.args[s.args_num++] = (uint32_t)(hash >> 32);
+	}
+	s.start = sceKernelGetProcessTimeLow();
+	return s;
+}
+
+void capture_write_call(capture_scope *s) {
+	uint32_t duration = sceKernelGetProcessTimeLow() - s->start;
+	capture_depth--;
+	if (vgl_capture_active)
+		capture_write_record(s->call, duration, s->args, s->args_num);
+}
+
+void capture_write_state(uint8_t call, const uint32_t *args, uint8_t args_num, const void *data, uint32_t size) {
+	// State changed inside a captured call is reproduced by replaying the call itself
+	if (!vgl_capture_active || capture_depth)
+		return;
+	uint32_t r[CAPTURE_MAX_ARGS];
+	vgl_fast_memcpy(r, args, args_num * sizeof(uint32_t));
+	if (capture_calls[call].has_data) {
+		uint64_t hash = capture_store_blob(data, size);
+		r[args_num++] = (uint32_t)hash;
+		r[args_num++] = (uint32_t)(hash >> 32);
+	}
+	capture_write_record(call, 0, r, args_num);
+}
+
+void capture_update_state(uint8_t slot, uint8_t call, const uint32_t *args, uint8_t args_num, const void *data, uint32_t size) {
+	if (!vgl_capture_active || capture_depth)
+		return;
+	uint64_t hash = XXH3_64bits_withSeed(data, size, XXH3_64bits(args, args_num * sizeof(uint32_t)));
+	if (capture_slots[slot] != hash) {
+		capture_slots[slot] = hash;
+		capture_write_state(call, args, args_num, data, size);
+	}
+}
+
+GLboolean capture_object_is_new(uint8_t kind, uint32_t name) {
+	if (!vgl_capture_active || capture_depth)
+		return GL_FALSE;
+	return capture_set_insert(&capture_objects, ((uint64_t)kind << 32) | name);
+}
+
+void *capture_scratch(uint32_t size) {
+	if (size > capture_scratch_size) {
+		void *buf = vgl_realloc(capture_scratch_buf, size);
+		if (!buf)
+			return NULL;
+		capture_scratch_buf = buf;
+		capture_scratch_size = size;
+	}
+	return capture_scratch_buf;
+}
+
+void capture_buffer(uint32_t buffer) {
+	if (!buffer || !capture_object_is_new(CAPTURE_OBJ_BUFFER, buffer))
+		return;
+	vbo *gpu_buf = (vbo *)buffer;
+	capture_write_state(CAPTURE_BUFFER, CAPTURE_ARGS(buffer, gpu_buf->size), gpu_buf->ptr, gpu_buf->ptr ? gpu_buf->size : 0);
+}
+
+void capture_texture(GLenum target, GLuint tex_id) {
+	if (!tex_id || !capture_object_is_new(CAPTURE_OBJ_TEXTURE, tex_id))
+		return;
+	texture *tex = &texture_slots[tex_id];
+	uint32_t width = 0, height = 0;
+	if (tex->status == TEX_VALID) {
+		width = sceGxmTextureGetWidth(&tex->gxm_tex);
+		height = sceGxmTextureGetHeight(&tex->gxm_tex);
+	}
+	capture_write_state(CAPTURE_TEXTURE, CAPTURE_ARGS(tex_id, target, width, height, tex->format, tex->mip_count), NULL, 0);
+}
+
+void capture_draw_state(uint32_t vertices_num) {
+	if (capture_depth)
+		return;
+	// Matrices are always described as custom programs can make use of them through fixed function pipeline uniforms
+	if (cur_program) {
+		ffp_capture_state(0);
+		capture_program_state(vertices_num);
+	} else
+		ffp_capture_state(vertices_num);
+}
+
+uint32_t capture_indices_range(GLenum type, const void *indices, GLsizei count) {
+	vbo *gpu_buf = (vbo *)cur_vao->index_array_unit;
+	const uint8_t *src = gpu_buf ? (const uint8_t *)gpu_buf->ptr + (uint32_t)indices : (const uint8_t *)indices;
+	if (!src)
+		return 0;
+	uint32_t highest = 0;
+	for (GLsizei i = 0; i < count; i++) {
+		uint32_t idx = type == GL_UNSIGNED_INT ? ((const uint32_t *)src)[i] : (type == GL_UNSIGNED_SHORT ? ((const uint16_t *)src)[i] : src[i]);
+		if (idx >= highest)
+			highest = idx + 1;
+	}
+	return highest;
+}
+
+void capture_fill_vertex_array(capture_vertex_array *a, uint8_t index, const SceGxmVertexAttribute *attr, const SceGxmVertexStream *stream, uint32_t buffer, uint32_t offset, GLenum type, uint32_t vertices_num) {
+	uint32_t bpe;
+	a->normalized = GL_FALSE;
+	switch (attr->format) {
+	case SCE_GXM_ATTRIBUTE_FORMAT_U8N:
+		a->normalized = GL_TRUE;
+	case SCE_GXM_ATTRIBUTE_FORMAT_U8:
+		a->type = GL_UNSIGNED_BYTE;
+		bpe = 1;
+		break;
+	case SCE_GXM_ATTRIBUTE_FORMAT_S8N:
+		a->normalized = GL_TRUE;
+	case SCE_GXM_ATTRIBUTE_FORMAT_S8:
+		a->type = GL_BYTE;
+		bpe = 1;
+		break;
+	case SCE_GXM_ATTRIBUTE_FORMAT_U16N:
+		a->normalized = GL_TRUE;
+	case SCE_GXM_ATTRIBUTE_FORMAT_U16:
+		a->type = GL_UNSIGNED_SHORT;
+		bpe = 2;
+		break;
+	case SCE_GXM_ATTRIBUTE_FORMAT_S16N:
+		a->normalized = GL_TRUE;
+	case SCE_GXM_ATTRIBUTE_FORMAT_S16:
+		a->type = GL_SHORT;
+		bpe = 2;
+		break;
+	case SCE_GXM_ATTRIBUTE_FORMAT_F16:
+		a->type = GL_HALF_FLOAT;
+		bpe = 2;
+		break;
+	default:
+		a->type = GL_FLOAT;
+		bpe = 4;
+		break;
+	}
+	// Formats shared by several GL types (eg. GL_FIXED arrays) are disambiguated by the caller
+	if (type)
+		a->type = type;
+	a->index = index;
+	a->size = attr->componentCount;
+	a->stride = stream->stride;
+	a->divisor = 0;
+	a->buffer = buffer;
+	a->offset = offset;
+	uint64_t hash = 0;
+	if (buffer)
+		capture_buffer(buffer);
+	else if (offset && vertices_num)
+		hash = capture_store_blob((const void *)offset, (vertices_num - 1) * a->stride + a->size * bpe);
+	a->hash[0] = (uint32_t)hash;
+	a->hash[1] = (uint32_t)(hash >> 32);
+}
+
+void capture_mark_frame(void) {
+	if (capture_fd < 0)
+		return;
+
+	// Captures always start at a buffer swap so that every captured frame is complete
+	uint32_t tick = sceKernelGetProcessTimeLow();
+	if (vgl_capture_active) {
+		capture_write_record(CAPTURE_FRAME, tick - capture_frame_start, &vgl_framecount, 1);
+		capture_frame_idx++;
+		if (--capture_frames_left == 0)
+			capture_stop();
+	} else {
+		vgl_capture_active = GL_TRUE;
+		sceClibMemset(capture_slots, 0, sizeof(capture_slots));
+		capture_write_snapshot();
+	}
+	capture_frame_start = sceKernelGetProcessTimeLow();
+}
+
+uint32_t capture_pixels_size(GLenum format, GLenum type, GLsizei width, GLsizei height) {
+	// Rows padding requested through GL_UNPACK_ALIGNMENT is not accounted, so the returned size never exceeds the real one.
+	// Unknown format and type pairs report no size, so that no data gets stored for them
+	uint32_t channels;
+	switch (format) {
+	case GL_RED:
+	case GL_ALPHA:
+	case GL_LUMINANCE:
+	case GL_DEPTH_COMPONENT:
+	case GL_COLOR_INDEX8_EXT:
+	case GL_R8:
+		channels = 1;
+		break;
+	case GL_RG:
+	case GL_LUMINANCE_ALPHA:
+	case GL_RG8:
+		channels = 2;
+		break;
+	case GL_RGB:
+	case GL_BGR:
+		channels = 3;
+		break;
+	case GL_RGBA:
+	case GL_BGRA:
+		channels = 4;
+		break;
+	default:
+		return 0;
+	}
+
+	uint32_t bpp;
+	switch (type) {
+	case GL_UNSIGNED_BYTE:
+	case GL_BYTE:
+		bpp = channels;
+		break;
+	case GL_UNSIGNED_SHORT:
+	case GL_SHORT:
+	case GL_HALF_FLOAT:
+	case GL_HALF_FLOAT_OES:
+		bpp = channels * 2;
+		break;
+	case GL_UNSIGNED_SHORT_5_6_5:
+	case GL_UNSIGNED_SHORT_4_4_4_4:
+	case GL_UNSIGNED_SHORT_5_5_5_1:
+	case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+		bpp = 2;
+		break;
+	case GL_UNSIGNED_INT_8_8_8_8:
+	case GL_UNSIGNED_INT_8_8_8_8_REV:
+		bpp = 4;
+		break;
+	case GL_UNSIGNED_INT:
+	case GL_INT:
+	case GL_FLOAT:
+		bpp = channels * 4;
+		break;
+	default:
+		return 0;
+	}
+	return width * height * bpp;
+}
+#endif
+
+GLboolean vglCaptureFrames(const char *path, uint32_t frames) {
+#ifdef HAVE_FRAME_CAPTURE
+	if (capture_fd >= 0 || !frames) {
+#ifdef LOG_ERRORS
+		vgl_log("%s:%d Frame capture requested while another one is in progress or with no frames to capture.\n", __FILE__, __LINE__);
+#endif
+		return GL_FALSE;
+	}
+
+	capture_buf = (uint8_t *)vgl_malloc(CAPTURE_BUFFER_SIZE, VGL_MEM_EXTERNAL);
+	if (!capture_buf)
+		return GL_FALSE;
+	capture_fd = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+	if (capture_fd < 0) {
+#ifdef LOG_ERRORS
+		vgl_log("%s:%d Failed to open %s for frame capture.\n", __FILE__, __LINE__, path);
+#endif
+		vgl_free(capture_buf);
+		capture_buf = NULL;
+		return GL_FALSE;
+	}
+
+	capture_header hdr;
+	hdr.magic = CAPTURE_MAGIC;
+	hdr.version = CAPTURE_VERSION;
+	hdr.frames_num = frames;
+	hdr.calls_num = CAPTURE_CALLS_NUM;
+	hdr.categories_num = CAPTURE_CATS_NUM;
+	capture_write(&hdr, sizeof(capture_header));
+	for (int i = 0; i < CAPTURE_CALLS_NUM; i++) {
+		capture_header_call c = {0};
+		strncpy(c.name, capture_calls[i].name, CAPTURE_NAME_SIZE - 1);
+		c.category = capture_calls[i].category;
+		c.has_data = capture_calls[i].has_data;
+		capture_write(&c, sizeof(capture_header_call));
+	}
+	for (int i = 0; i < CAPTURE_CATS_NUM; i++) {
+		char name[CAPTURE_NAME_SIZE] = {0};
+		strncpy(name, capture_category_names[i], CAPTURE_NAME_SIZE - 1);
+		capture_write(name, CAPTURE_NAME_SIZE);
+	}
+
+	// Recording starts at the next buffer swap
+	capture_frames_left = frames;
+	capture_frame_idx = 0;
+	capture_depth = 0;
+	return GL_TRUE;
+#else
+	return GL_FALSE;
+#endif
+}
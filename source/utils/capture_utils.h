@@ -0,0 +1,232 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * capture_utils.h:
+ * Header file for the frame capture layer exposed by capture_utils.c
+ */
+
+#ifndef _CAPTURE_UTILS_H_
+#define _CAPTURE_UTILS_H_
+
+#define CAPTURE_MAGIC 0x434C4756 // VGLC
+#define CAPTURE_VERSION 2
+#define CAPTURE_MAX_ARGS 12 // Maximum number of arguments of a captured call, data hash included
+#define CAPTURE_NAME_SIZE 32 // Size of the call and category names in the capture header
+
+// Calls recorded by the frame capture layer, names and categories are listed in capture_utils.c
+enum {
+	CAPTURE_BLOB, // Referenced data, stored once per hash
+	CAPTURE_FRAME, // Buffer swap
+	CAPTURE_STATE, // Bindings and enabled capabilities at capture start
+	CAPTURE_BUFFER, // Buffer content at its first reference
+	CAPTURE_TEXTURE, // Texture info at its first reference
+	CAPTURE_SHADER, // Shader binary or source at its first reference
+	CAPTURE_PROGRAM, // Program shaders and bindings at its first reference
+	CAPTURE_UNIFORM_LOCATION, // Uniform name at its location first reference
+	CAPTURE_VERTEX_ARRAYS, // Vertex arrays used by the following draws
+	CAPTURE_LOAD_MATRIX, // Fixed function pipeline matrix used by the following draws
+	CAPTURE_DRAW_ARRAYS,
+	CAPTURE_DRAW_ARRAYS_INSTANCED,
+	CAPTURE_MULTI_DRAW_ARRAYS,
+	CAPTURE_DRAW_ELEMENTS,
+	CAPTURE_DRAW_ELEMENTS_BASE_VERTEX,
+	CAPTURE_DRAW_RANGE_ELEMENTS,
+	CAPTURE_DRAW_ELEMENTS_INSTANCED,
+	CAPTURE_MULTI_DRAW_ELEMENTS,
+	CAPTURE_MULTI_DRAW_ELEMENTS_INDIRECT,
+	CAPTURE_END,
+	CAPTURE_CLEAR,
+	CAPTURE_BUFFER_DATA,
+	CAPTURE_BUFFER_SUB_DATA,
+	CAPTURE_TEX_IMAGE_2D,
+	CAPTURE_TEX_SUB_IMAGE_2D,
+	CAPTURE_COMPRESSED_TEX_IMAGE_2D,
+	CAPTURE_BIND_BUFFER,
+	CAPTURE_BIND_TEXTURE,
+	CAPTURE_ACTIVE_TEXTURE,
+	CAPTURE_ENABLE,
+	CAPTURE_DISABLE,
+	CAPTURE_USE_PROGRAM,
+	CAPTURE_UNIFORM,
+	CAPTURE_SHADER_SOURCE,
+	CAPTURE_COMPILE_SHADER,
+	CAPTURE_ATTACH_SHADER,
+	CAPTURE_BIND_ATTRIB_LOCATION,
+	CAPTURE_LINK_PROGRAM,
+	CAPTURE_CALLS_NUM
+};
+
+// Objects described to the capture the first time a captured call references them
+enum {
+	CAPTURE_OBJ_BUFFER = 1,
+	CAPTURE_OBJ_TEXTURE,
+	CAPTURE_OBJ_SHADER,
+	CAPTURE_OBJ_PROGRAM,
+	CAPTURE_OBJ_UNIFORM
+};
+
+// State slots whose records are only written when their content changes
+enum {
+	CAPTURE_SLOT_VERTEX_ARRAYS,
+	CAPTURE_SLOT_MODELVIEW,
+	CAPTURE_SLOT_PROJECTION,
+	CAPTURE_SLOT_TEXTURE, // One slot per texture coordinates set
+	CAPTURE_SLOTS_NUM = CAPTURE_SLOT_TEXTURE + TEXTURE_COORDS_NUM
+};
+
+// Kinds of the entries of a CAPTURE_PROGRAM record data
+enum {
+	CAPTURE_PROG_ATTRIB, // Attribute bound to the given index
+	CAPTURE_PROG_SAMPLER, // Sampler bound to the given texture unit
+	CAPTURE_PROG_PALETTE // Uniform receiving vglMultiDrawArraysMatrices model matrices
+};
+
+// Indices of the fixed function pipeline entries of a CAPTURE_VERTEX_ARRAYS record data
+enum {
+	CAPTURE_FFP_VERTEX,
+	CAPTURE_FFP_COLOR,
+	CAPTURE_FFP_NORMAL,
+	CAPTURE_FFP_TEXCOORD // One entry per texture coordinates set
+};
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t frames_num; // Number of requested frames
+	uint32_t calls_num; // Number of capture_header_call entries following the header
+	uint32_t categories_num; // Number of category names following the calls entries
+} capture_header;
+
+typedef struct {
+	char name[CAPTURE_NAME_SIZE];
+	uint32_t category; // Category the call is reported into
+	uint32_t has_data; // Does the call reference data through a hash stored as its last two arguments?
+} capture_header_call;
+
+typedef struct {
+	uint8_t call; // Captured call
+	uint8_t args_num; // Number of arguments following the record
+	uint16_t frame; // Index of the captured frame the call belongs to
+	uint32_t duration; // CPU time in microseconds spent in the call (frame time for buffer swaps)
+} capture_record;
+
+// Vertex array entry of a CAPTURE_VERTEX_ARRAYS record data
+typedef struct {
+	uint32_t buffer; // Vertex buffer the array is sourced from (0 for client memory)
+	uint32_t offset; // Offset in the vertex buffer or client memory address
+	uint32_t hash[2]; // Hash of the array content if sourced from client memory
+	uint16_t type; // GL type of the array components
+	uint8_t index; // Generic attribute index or fixed function pipeline attribute
+	uint8_t size; // Number of components
+	uint16_t stride;
+	uint8_t normalized;
+	uint8_t divisor;
+} capture_vertex_array;
+
+// Texture unit entry of a CAPTURE_STATE record data, followed by {capability, enabled} pairs
+typedef struct {
+	uint32_t state; // Enabled texture targets
+	uint32_t tex_id[3]; // Bound textures {2D, 1D, CUBE_MAP}
+} capture_texture_unit;
+
+// Entry of a CAPTURE_PROGRAM record data
+typedef struct {
+	uint32_t kind;
+	uint32_t value; // Attribute index or texture unit
+	char name[CAPTURE_NAME_SIZE * 2 - 8];
+} capture_program_entry;
+
+#ifdef HAVE_FRAME_CAPTURE
+typedef struct {
+	uint32_t start; // Process time in microseconds at call begin
+	uint8_t call; // Call being captured
+	uint8_t args_num; // Number of arguments of the call
+	uint8_t active; // Is this call being captured?
+	uint32_t args[CAPTURE_MAX_ARGS]; // Arguments of the call
+} capture_scope;
+
+extern GLboolean vgl_capture_active; // Is the frame capture layer recording?
+
+// Starts capturing a call, data (if any) gets stored once and referenced by its hash in the last two arguments
+capture_scope capture_scope_begin(uint8_t call, const uint32_t *args, uint8_t args_num, const void *data, uint32_t size);
+// Writes a captured call together with its duration
+void capture_write_call(capture_scope *s);
+// Marks the end of a frame, starting or stopping a requested capture
+void capture_mark_frame(void);
+// Returns the size in bytes of an uncompressed pixels array
+uint32_t capture_pixels_size(GLenum format, GLenum type, GLsizei width, GLsizei height);
+
+// Writes a record describing state the following captured calls depend on, data (if any) gets referenced as in capture_scope_begin
+void capture_write_state(uint8_t call, const uint32_t *args, uint8_t args_num, const void *data, uint32_t size);
+// Writes a state record unless the given slot already holds one with the same arguments and data
+void capture_update_state(uint8_t slot, uint8_t call, const uint32_t *args, uint8_t args_num, const void *data, uint32_t size);
+// Stores data once, returning the hash referencing it (0 for no data)
+uint64_t capture_store_blob(const void *data, uint32_t size);
+// Returns GL_TRUE the first time an object gets referenced while recording
+GLboolean capture_object_is_new(uint8_t kind, uint32_t name);
+// Returns a scratch buffer of at least size bytes, valid until the next call
+void *capture_scratch(uint32_t size);
+// Describes a buffer content the first time it gets referenced
+void capture_buffer(uint32_t buffer);
+// Describes a texture the first time it gets referenced
+void capture_texture(GLenum target, GLuint tex_id);
+// Describes the state the draw about to be captured depends on, vertices_num being the highest referenced vertex plus one
+void capture_draw_state(uint32_t vertices_num);
+// Returns the highest vertex referenced by the given indices plus one
+uint32_t capture_indices_range(GLenum type, const void *indices, GLsizei count);
+// Fills a vertex array entry, storing the array content if sourced from client memory
+void capture_fill_vertex_array(capture_vertex_array *a, uint8_t index, const SceGxmVertexAttribute *attr, const SceGxmVertexStream *stream, uint32_t buffer, uint32_t offset, GLenum type, uint32_t vertices_num);
+
+// Describes a program and its shaders the first time it gets referenced (custom_shaders.c)
+void capture_program(GLuint prog);
+// Describes a shader the first time it gets referenced (custom_shaders.c)
+void capture_shader(GLuint shad);
+// Describes the current program vertex arrays (custom_shaders.c)
+void capture_program_state(uint32_t vertices_num);
+// Describes the fixed function pipeline matrices and, if vertices_num is not zero, vertex arrays (ffp.c)
+void ffp_capture_state(uint32_t vertices_num);
+
+static inline __attribute__((always_inline)) void capture_scope_end(capture_scope *s) {
+	if (s->active)
+		capture_write_call(s);
+}
+
+#define CAPTURE_ARGS(...) (const uint32_t[]){__VA_ARGS__}, sizeof((const uint32_t[]){__VA_ARGS__}) / sizeof(uint32_t)
+
+// Captures the enclosing scope as the given call
+#define CAPTURE_CALL(call, ...) CAPTURE_CALL_WITH_DATA(call, NULL, 0, __VA_ARGS__)
+// Captures the enclosing scope as the given call referencing size bytes of data
+#define CAPTURE_CALL_WITH_DATA(call, data, size, ...) \
+	capture_scope __attribute__((cleanup(capture_scope_end))) capture_call_scope = vgl_capture_active ? capture_scope_begin(call, CAPTURE_ARGS(__VA_ARGS__), data, size) : (capture_scope){.active = GL_FALSE};
+// Describes an object the call about to be captured references
+#define CAPTURE_OBJECT(func, ...) \
+	if (vgl_capture_active) \
+		func(__VA_ARGS__);
+// Describes the state a draw depends on before capturing it
+#define CAPTURE_DRAW_STATE(vertices_num) \
+	if (vgl_capture_active) \
+		capture_draw_state(vertices_num);
+#else
+#define CAPTURE_CALL(call, ...)
+#define CAPTURE_CALL_WITH_DATA(call, data, size, ...)
+#define CAPTURE_OBJECT(func, ...)
+#define CAPTURE_DRAW_STATE(vertices_num)
+#endif
+
+#endif
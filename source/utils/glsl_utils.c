@@ -26,6 +26,9 @@
 #include "../shared.h"
 #include "glsl_utils.h"
 #include "preprocessor/preprocessor_c.h"
+#define XXH_STATIC_LINKING_ONLY
+#define XXH_NAMESPACE VITAGL_
+#include "xxhash_utils.h"
 
 #define MEM_ENLARGER_SIZE (1024 * 1024) // FIXME: Check if this is too big/small
 
@@ -65,36 +68,7 @@
 		} \
 	}
 
-#define glsl_replace_marker(m, r) \
-	type = strstr(txt + preamble_size, m); \
-	while (type) { \
-		char *res = (char *)vglMalloc(MEM_ENLARGER_SIZE); \
-		type[0] = 0; \
-		strcpy(res, txt); \
-		strcat(res, r); \
-		strcat(res, type + 1); \
-		strcpy(out, res); \
-		vgl_free(res); \
-		txt = out; \
-		type = strstr(txt + preamble_size, m); \
-	}
-	
-#define glsl_replace_marker_progressive(m, r1, r2) \
-	type = strstr(txt + preamble_size, m); \
-	uint8_t idx = 1; \
-	while (type) { \
-		char line[32]; \
-		sprintf(line, "%s%u%s", r1, idx++, r2); \
-		char *res = (char *)vglMalloc(MEM_ENLARGER_SIZE); \
-		type[0] = 0; \
-		strcpy(res, txt); \
-		strcat(res, line); \
-		strcat(res, type + 1); \
-		strcpy(out, res); \
-		vgl_free(res); \
-		txt = out; \
-		type = strstr(txt + preamble_size, m); \
-	}	
+#define glsl_is_ident_char(c) (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') || ((c) >= '0' && (c) <= '9') || (c) == '_')
 
 #ifdef HAVE_FFP_SHADER_SUPPORT
 const char *ffp_bind_defines[FFP_BINDS_NUM] = {
@@ -104,31 +78,176 @@ const char *ffp_bind_defines[FFP_BINDS_NUM] = {
 };
 #endif
 
+enum {
+	GLSL_POINT_SIZE,
+	GLSL_INSTANCE_ID,
+	GLSL_VERTEX_ID,
+	GLSL_FRONT_COLOR,
+	GLSL_POINT_COORD,
+	GLSL_FRONT_FACING,
+	GLSL_FRAG_COORD,
+	GLSL_FRAG_DEPTH,
+	GLSL_COLOR,
+	GLSL_FFP_BINDS
+};
+
+#ifdef HAVE_FFP_SHADER_SUPPORT
+#define GLSL_BUILTINS_NUM (GLSL_FFP_BINDS + FFP_BINDS_NUM)
+#else
+#define GLSL_BUILTINS_NUM GLSL_FFP_BINDS
+#endif
+
+// Built-in variables looked up by the translator, fixed function binds follow them with the names listed in ffp_bind_names
+static const char *glsl_builtin_names[GLSL_FFP_BINDS] = {
+	"gl_PointSize",
+	"gl_InstanceID",
+	"gl_VertexID",
+	"gl_FrontColor",
+	"gl_PointCoord",
+	"gl_FrontFacing",
+	"gl_FragCoord",
+	"gl_FragDepth",
+	"gl_Color",
+};
+
+static inline __attribute__((always_inline)) const char *glsl_get_builtin_name(int i) {
+#ifdef HAVE_FFP_SHADER_SUPPORT
+	if (i >= GLSL_FFP_BINDS)
+		return ffp_bind_names[i - GLSL_FFP_BINDS];
+#endif
+	return glsl_builtin_names[i];
+}
+
 glsl_sema_bind glsl_custom_bindings[MAX_CUSTOM_BINDINGS];
 int glsl_custom_bindings_num = 0;
 int glsl_current_ref_idx = 0;
 GLboolean glsl_is_first_shader = GL_TRUE;
 GLboolean glsl_precision_low = GL_FALSE;
 GLenum glsl_sema_mode = VGL_MODE_POSTPONED;
+static GLboolean glsl_pair_translation = GL_FALSE; // Set while translating a shader pair for a program linked with VGL_MODE_POSTPONED
 binds_map glsl_bindings_map;
 #ifdef HAVE_FIXED_ATTRIBUTES
 char glsl_attributes[VERTEX_ATTRIBS_NUM][128];
 int glsl_attributes_num = 0;
 #endif
 
+/*
+ * GLSL tokenizer:
+ * Sources are walked one identifier at a time, skipping comments, so that every lookup
+ * is a single forward pass and never matches keywords inside comments or longer identifiers.
+ */
+static char *glsl_next_ident(char *str, size_t *len) {
+	while (*str) {
+		if (str[0] == '/' && str[1] == '/') {
+			str = strchr(str, '\n');
+			if (!str)
+				return NULL;
+		} else if (str[0] == '/' && str[1] == '*') {
+			str = strstr(str + 2, "*/");
+			if (!str)
+				return NULL;
+			str += 2;
+		} else if (glsl_is_ident_char(*str)) {
+			char *start = str;
+			while (glsl_is_ident_char(*str)) {
+				str++;
+			}
+			*len = str - start;
+			return start;
+		} else {
+			str++;
+		}
+	}
+	return NULL;
+}
+
+static char *glsl_find_token(char *str, const char *token, GLboolean ignore_case) {
+	size_t len = strlen(token);
+	size_t ident_len;
+	while ((str = glsl_next_ident(str, &ident_len))) {
+		if (ident_len == len && !(ignore_case ? strncasecmp(str, token, len) : strncmp(str, token, len)))
+			return str;
+		str += ident_len;
+	}
+	return NULL;
+}
+
+// Flags which built-in variables looked up by the translator are referenced in a GLSL source
+static void glsl_scan_builtins(char *str, GLboolean *found) {
+	size_t len;
+	vgl_memset(found, 0, sizeof(GLboolean) * GLSL_BUILTINS_NUM);
+	while ((str = glsl_next_ident(str, &len))) {
+		if (len > 3 && str[0] == 'g' && str[1] == 'l' && str[2] == '_') {
+			for (int i = 0; i < GLSL_BUILTINS_NUM; i++) {
+				const char *name = glsl_get_builtin_name(i);
+				if (!found[i] && !strncmp(str, name, len) && name[len] == 0) {
+					found[i] = GL_TRUE;
+					break;
+				}
+			}
+		}
+		str += len;
+	}
+}
+
+// Finds the next "texture" or "Texture" named uniform or function argument, which are reserved keywords in CG
+static char *glsl_find_texture_uniform(char *str) {
+	str = glsl_find_token(str, "texture", GL_TRUE);
+	while (str) {
+		char *str_end = str + 7;
+		if (*(str - 1) == ' ' || *(str - 1) == '\t' || *(str - 1) == '(') {
+			while (*str_end == ' ' || *str_end == '\t') {
+				str_end++;
+			}
+			if (*str_end == ',' || *str_end == ';')
+				break;
+		}
+		str = glsl_find_token(str_end, "texture", GL_TRUE);
+	}
+	return str;
+}
+
+/*
+ * Replaces every marker character in a GLSL source with a replacement string in a single pass.
+ * The replacement is picked by matching the characters that follow the marker against a list of
+ * suffixes (NULL list to replace any marker), numbering the replacements if requested.
+ */
+static void glsl_expand_markers(char *txt, char *out, GLsizei preamble_size, char marker, const char **suffixes, const char **replacements, int num, GLboolean progressive) {
+	uint8_t idx = 1;
+	vgl_fast_memcpy(out, txt, preamble_size);
+	char *dst = out + preamble_size;
+	char *src = txt + preamble_size;
+	char *m = strchr(src, marker);
+	while (m) {
+		vgl_fast_memcpy(dst, src, m - src);
+		dst += m - src;
+		src = m + 1;
+		if (progressive) {
+			dst += sprintf(dst, replacements[0], idx++);
+		} else {
+			int i;
+			for (i = 0; i < num; i++) {
+				if (!strncmp(src, suffixes[i], strlen(suffixes[i]))) {
+					dst += sprintf(dst, "%s", replacements[i]);
+					break;
+				}
+			}
+			// Unknown markers are left untouched
+			if (i == num)
+				*dst++ = marker;
+		}
+		m = strchr(src, marker);
+	}
+	strcpy(dst, src);
+}
+
 void glsl_translate_with_shader_pair(char *text, GLenum type, GLboolean hasFrontFacing) {
 	char newline[128];
 	int idx;
 	if (type == GL_VERTEX_SHADER) {
 		// Manually patching attributes and varyings
-		char *str = strstr(text, "attribute");
-		while (str && !(str[9] == ' ' || str[9] == '\t')) {
-			str = strstr(str + 9, "attribute");
-		}
-		char *str2 = strstr(text, "varying");
-		while (str2 && !(str2[7] == ' ' || str2[7] == '\t')) {
-			str2 = strstr(str2 + 7, "varying");
-		}
+		char *str = glsl_find_token(text, "attribute", GL_FALSE);
+		char *str2 = glsl_find_token(text, "varying", GL_FALSE);
 		while (str || str2) {
 			char *t;
 			if (!str)
@@ -152,10 +271,7 @@ void glsl_translate_with_shader_pair(char *text, GLenum type, GLboolean hasFront
 				sceClibMemcpy(glsl_attributes[glsl_attributes_num], attr_name, attr_end - attr_name);
 				glsl_attributes[glsl_attributes_num++][attr_end - attr_name] = 0;
 #endif
-				str = strstr(t, "attribute");
-				while (str && !(str[9] == ' ' || str[9] == '\t')) {
-					str = strstr(str + 9, "attribute");
-				}
+				str = glsl_find_token(t, "attribute", GL_FALSE);
 			} else { // Varying
 				char *end = strstr(t, ";");
 				GLboolean name_started = GL_FALSE;
@@ -308,38 +424,21 @@ HINT_DETECTION_PAIR:
 				if (extra_chars) {
 					vgl_memset(str2 + strlen(newline), ' ', extra_chars);
 				}
-				str2 = strstr(t, "varying");
-				while (str2 && !(str2[7] == ' ' || str2[7] == '\t')) {
-					str2 = strstr(str2 + 7, "varying");
-				}
+				str2 = glsl_find_token(t, "varying", GL_FALSE);
 			}
 		}
 	} else {
 		// Manually patching gl_FrontFacing usage
 		if (hasFrontFacing) {
-			char *str = strstr(text, "gl_FrontFacing");
+			char *str = glsl_find_token(text, "gl_FrontFacing", GL_FALSE);
 			while (str) {
 				vgl_fast_memcpy(str, "(vgl_Face > 0)", 14);
-				str = strstr(str, "gl_FrontFacing");
+				str = glsl_find_token(str + 14, "gl_FrontFacing", GL_FALSE);
 			}
 		}
 		// Manually patching varyings and "texture" uniforms
-		char *str = strstr(text, "varying");
-		while (str && !(str[7] == ' ' || str[7] == '\t')) {
-			str = strstr(str + 1, "varying");
-		}
-		char *str2 = strcasestr(text, "texture");
-		while (str2) {
-			char *str2_end = str2 + 7;
-			if (*(str2 - 1) == ' ' || *(str2 - 1) == '\t' || *(str2 - 1) == '(') {
-				while (*str2_end == ' ' || *str2_end == '\t') {
-					str2_end++;
-				}
-				if (*str2_end == ',' || *str2_end == ';')
-					break;
-			}
-			str2 = strcasestr(str2_end, "texture");
-		}
+		char *str = glsl_find_token(text, "varying", GL_FALSE);
+		char *str2 = glsl_find_texture_uniform(text);
 		while (str || str2) {
 			char *t;
 			if (!str)
@@ -588,27 +687,13 @@ HINT_DETECTION_PAIR_2:
 				if (extra_chars > 0) {
 					vgl_memset(str + strlen(newline), ' ', extra_chars);
 				}
-				str = strstr(str, "varying");
-				while (str && !(str[7] == ' ' || str[7] == '\t')) {
-					str = strstr(str + 7, "varying");
-				}
+				str = glsl_find_token(str, "varying", GL_FALSE);
 			} else { // "texture" Uniform
 				if (t[0] == 't')
 					vgl_fast_memcpy(t, "vgl_tex", 7);
 				else
 					vgl_fast_memcpy(t, "Vgl_tex", 7);
-				str2 = strcasestr(t, "texture");
-				while (str2) {
-					char *str2_end = str2 + 7;
-					if (*(str2 - 1) == ' ' || *(str2 - 1) == '\t' || *(str2 - 1) == '(') {
-						while (*str2_end == ' ' || *str2_end == '\t') {
-							str2_end++;
-						}
-						if (*str2_end == ',' || *str2_end == ';')
-							break;
-					}
-					str2 = strcasestr(str2_end, "texture");
-				}
+				str2 = glsl_find_texture_uniform(t);
 			}
 		}
 	}
@@ -619,14 +704,8 @@ void glsl_translate_with_global(char *text, GLenum type, GLboolean hasFrontFacin
 	int idx;
 	if (type == GL_VERTEX_SHADER) {
 		// Manually patching attributes and varyings
-		char *str = strstr(text, "attribute");
-		while (str && !(str[9] == ' ' || str[9] == '\t')) {
-			str = strstr(str + 9, "attribute");
-		}
-		char *str2 = strstr(text, "varying");
-		while (str2 && !(str2[7] == ' ' || str2[7] == '\t')) {
-			str2 = strstr(str2 + 7, "varying");
-		}
+		char *str = glsl_find_token(text, "attribute", GL_FALSE);
+		char *str2 = glsl_find_token(text, "varying", GL_FALSE);
 		while (str || str2) {
 			char *t;
 			if (!str)
@@ -650,10 +729,7 @@ void glsl_translate_with_global(char *text, GLenum type, GLboolean hasFrontFacin
 				sceClibMemcpy(glsl_attributes[glsl_attributes_num], attr_name, attr_end - attr_name);
 				glsl_attributes[glsl_attributes_num++][attr_end - attr_name] = 0;
 #endif
-				str = strstr(t, "attribute");
-				while (str && !(str[9] == ' ' || str[9] == '\t')) {
-					str = strstr(str + 9, "attribute");
-				}
+				str = glsl_find_token(t, "attribute", GL_FALSE);
 			} else { // Varying
 				char *end = strstr(t, ";");
 				GLboolean name_started = GL_FALSE;
@@ -720,38 +796,21 @@ void glsl_translate_with_global(char *text, GLenum type, GLboolean hasFrontFacin
 				if (extra_chars > 0) {
 					vgl_memset(str2 + strlen(newline), ' ', extra_chars);
 				}
-				str2 = strstr(t, "varying");
-				while (str2 && !(str2[7] == ' ' || str2[7] == '\t')) {
-					str2 = strstr(str2 + 7, "varying");
-				}
+				str2 = glsl_find_token(t, "varying", GL_FALSE);
 			}
 		}
 	} else {
 		// Manually patching gl_FrontFacing usage
 		if (hasFrontFacing) {
-			char *str = strstr(text, "gl_FrontFacing");
+			char *str = glsl_find_token(text, "gl_FrontFacing", GL_FALSE);
 			while (str) {
 				vgl_fast_memcpy(str, "(vgl_Face > 0)", 14);
-				str = strstr(str, "gl_FrontFacing");
+				str = glsl_find_token(str + 14, "gl_FrontFacing", GL_FALSE);
 			}
 		}
 		// Manually patching varyings and "texture" uniforms
-		char *str = strstr(text, "varying");
-		while (str && !(str[7] == ' ' || str[7] == '\t')) {
-			str = strstr(str + 1, "varying");
-		}
-		char *str2 = strcasestr(text, "texture");
-		while (str2) {
-			char *str2_end = str2 + 7;
-			if (*(str2 - 1) == ' ' || *(str2 - 1) == '\t' || *(str2 - 1) == '(') {
-				while (*str2_end == ' ' || *str2_end == '\t') {
-					str2_end++;
-				}
-				if (*str2_end == ',' || *str2_end == ';')
-					break;
-			}
-			str2 = strcasestr(str2_end, "texture");
-		}
+		char *str = glsl_find_token(text, "varying", GL_FALSE);
+		char *str2 = glsl_find_texture_uniform(text);
 		while (str || str2) {
 			char *t;
 			if (!str)
@@ -864,27 +923,13 @@ void glsl_translate_with_global(char *text, GLenum type, GLboolean hasFrontFacin
 				if (extra_chars > 0) {
 					vgl_memset(str + strlen(newline), ' ', extra_chars);
 				}
-				str = strstr(str, "varying");
-				while (str && !(str[7] == ' ' || str[7] == '\t')) {
-					str = strstr(str + 7, "varying");
-				}
+				str = glsl_find_token(str, "varying", GL_FALSE);
 			} else { // "texture" Uniform
 				if (t[0] == 't')
 					vgl_fast_memcpy(t, "vgl_tex", 7);
 				else
 					vgl_fast_memcpy(t, "Vgl_tex", 7);
-				str2 = strcasestr(t, "texture");
-				while (str2) {
-					char *str2_end = str2 + 7;
-					if (*(str2 - 1) == ' ' || *(str2 - 1) == '\t' || *(str2 - 1) == '(') {
-						while (*str2_end == ' ' || *str2_end == '\t') {
-							str2_end++;
-						}
-						if (*str2_end == ',' || *str2_end == ';')
-							break;
-					}
-					str2 = strcasestr(str2_end, "texture");
-				}
+				str2 = glsl_find_texture_uniform(t);
 			}
 		}
 	}
@@ -915,7 +960,8 @@ void glsl_handle_ubos(char *txt, char *out, GLsizei preamble_size) {
 	}
 	// Second pass: replacing all marked variables
 	if (has_ubos) {
-		glsl_replace_marker_progressive("\v", ": BUFFER[", "];");
+		const char *buffer_binding = ": BUFFER[%u];";
+		glsl_expand_markers(txt, out, preamble_size, '\v', NULL, &buffer_binding, 1, GL_TRUE);
 	} else {
 		strcpy(out, src);
 	}
@@ -988,15 +1034,9 @@ HANDLE_VAR:
 	}
 	// Second pass: replacing all marked variables
 	if (has_globals) {
-		glsl_replace_marker("\vloat", "static f");
-		glsl_replace_marker("\vnt", "static i");
-		glsl_replace_marker("\vec", "static v");
-		glsl_replace_marker("\vvec", "static i");
-		glsl_replace_marker("\vat", "static m");
-		glsl_replace_marker("\vonst", "static c");
-		glsl_replace_marker("\vowp", "static l");
-		glsl_replace_marker("\vediump", "static m");
-		glsl_replace_marker("\vighp", "static h");
+		static const char *globals_suffixes[] = {"loat", "nt", "ec", "vec", "at", "onst", "owp", "ediump", "ighp"};
+		static const char *globals_replacements[] = {"static f", "static i", "static v", "static i", "static m", "static c", "static l", "static m", "static h"};
+		glsl_expand_markers(txt, out, preamble_size, '\v', globals_suffixes, globals_replacements, 9, GL_FALSE);
 	} else {
 		strcpy(out, src);
 	}
@@ -1011,7 +1051,7 @@ HANDLE_VAR:
  */
 void glsl_handle_tex_size(char *txt, GLsizei preamble_size, glsl_samplers_info *info, uint8_t *num) {
 	*num = 0;	
-	char *s = strstr(txt + preamble_size, "textureSize");
+	char *s = glsl_find_token(txt + preamble_size, "textureSize", GL_FALSE);
 	while (s && *num <= SCE_GXM_MAX_TEXTURE_UNITS) {
 		char *str_start = s;
 		s += 11;
@@ -1048,7 +1088,7 @@ void glsl_handle_tex_size(char *txt, GLsizei preamble_size, glsl_samplers_info *
 			end++;
 		*(end - 1) = '*';
 		*end = '/';
-		s = strstr(s, "textureSize");
+		s = glsl_find_token(s, "textureSize", GL_FALSE);
 	}
 }
 #endif
@@ -1059,19 +1099,22 @@ void glsl_handle_tex_size(char *txt, GLsizei preamble_size, glsl_samplers_info *
  * which is an overloaded inlined function properly adding support for matrix * vector
  * and vector * matrix operations. This implementation is very likely non exhaustive
  * since, for a proper implementation, ideally we'd want a proper GLSL parser.
+ * Replacements are performed in place on the output buffer, resuming the lookup for the
+ * next operator right after the last processed one.
  */
 void glsl_inject_mul(char *txt, char *out, GLsizei preamble_size) {
-	char *star = strstr(txt + preamble_size, "*");
+	size_t len = strlen(txt);
+	vgl_fast_memcpy(out, txt, len + 1);
+	txt = out;
+	char *star = strchr(txt + preamble_size, '*');
 	while (star) {
 		if (star[1] == '=') // FIXME: *= still not handled
-			star = strstr(star + 1, "*");
+			star = strchr(star + 1, '*');
 		else
 			break;
 	}
-	if (!star) {
-		strcpy(out, txt);
+	if (!star)
 		return;
-	}
 	char *left;
 LOOP_START:
 	left = star - 1;
@@ -1184,41 +1227,199 @@ LOOP_START:
 		else
 			right++;
 	}
-	char *res = (char *)vglMalloc(MEM_ENLARGER_SIZE);
 	if (found < 2) { // Standard match
-		char tmp = *left;
-		left[0] = 0;
-		strcpy(res, txt);
-		left[0] = tmp;
-		strcat(res, " vglMul(");
-		tmp = *right;
-		right[0] = 0;
+		size_t mul_len = strlen(" vglMul(");
 		*star = ',';
-		strcat(res, left);
-		strcat(res, ")");
-		right[0] = tmp;
-		strcat(res, right);
-		strcpy(out, res);
-		vgl_free(res);
-		txt = out;
-		star = strstr(txt + preamble_size, "*");
+		memmove(right + mul_len + 1, right, len + 1 - (right - txt));
+		memmove(left + mul_len, left, right - left);
+		vgl_fast_memcpy(left, " vglMul(", mul_len);
+		right[mul_len] = ')';
+		len += mul_len + 1;
+		star = strchr(star + mul_len + 1, '*');
 	} else { // [ bracket match, we assume a matrix is not involved
-		uint32_t jump = right - txt;
-		strcpy(res, txt);
-		strcpy(out, res);
-		vgl_free(res);
-		txt = out;
-		star = strstr(txt + jump, "*");
+		star = strchr(right, '*');
 	}
 	while (star) {
 		if (star[1] == '=') // FIXME: *= still not handled
-			star = strstr(star + 1, "*");
+			star = strchr(star + 1, '*');
 		else
 			goto LOOP_START;
 	}
 }
 
+/*
+ * Translations memoization:
+ * Translated sources are stored together with their semantic bindings, keyed by the original source and by
+ * the translator state they depend on, so that every unique shader goes through the text passes only once.
+ * Global mode translations are not memoized since they alter the custom bindings list.
+ */
+#define GLSL_TRANSLATIONS_HASH_SIZE 64 // Number of buckets of the memoized translations hash table (must be a power of two)
+#define GLSL_TRANSLATIONS_MAX_SIZE (512 * 1024) // Maximum size of the memoized translations kept in memory
+
+typedef struct glsl_translation {
+	uint64_t key[SHADER_PACK_KEY_WORDS]; // Key identifying the translation
+	uint8_t *data; // Serialized translation
+	uint32_t size; // Size of the serialized translation
+	struct glsl_translation *chain; // Next translation in the same bucket
+	struct glsl_translation *next; // Next translation in insertion order
+} glsl_translation;
+
+static glsl_translation *glsl_translations[GLSL_TRANSLATIONS_HASH_SIZE];
+static glsl_translation *glsl_translations_first = NULL; // Oldest memoized translation
+static glsl_translation *glsl_translations_last = NULL; // Newest memoized translation
+static uint32_t glsl_translations_size = 0; // Size of the memoized translations kept in memory
+
+static void glsl_get_translation_key(shader *s, uint64_t *key) {
+	static const char unused_bind = 1;
+	XXH3_state_t state;
+	key[0] = XXH3_64bits(s->source, strlen(s->source));
+
+	// Only the names of the bindings in use affect the translation
+	XXH3_64bits_reset_withSeed(&state, ((uint64_t)s->type << 32) | (glsl_precision_low ? 2 : 0) | (glsl_is_first_shader ? 1 : 0));
+	for (int i = 0; i < MAX_CG_TEXCOORD_ID; i++) {
+		if (glsl_bindings_map.texcoord_used[i])
+			XXH3_64bits_update(&state, glsl_bindings_map.texcoord_names[i], strlen(glsl_bindings_map.texcoord_names[i]) + 1);
+		else
+			XXH3_64bits_update(&state, &unused_bind, 1);
+	}
+	for (int i = 0; i < MAX_CG_COLOR_ID; i++) {
+		if (glsl_bindings_map.color_used[i])
+			XXH3_64bits_update(&state, glsl_bindings_map.color_names[i], strlen(glsl_bindings_map.color_names[i]) + 1);
+		else
+			XXH3_64bits_update(&state, &unused_bind, 1);
+	}
+	key[1] = XXH3_64bits_digest(&state);
+
+	XXH3_64bits_reset(&state);
+	for (int i = 0; i < glsl_custom_bindings_num; i++) {
+		XXH3_64bits_update(&state, glsl_custom_bindings[i].name, strlen(glsl_custom_bindings[i].name) + 1);
+		XXH3_64bits_update(&state, &glsl_custom_bindings[i].idx, sizeof(int));
+		XXH3_64bits_update(&state, &glsl_custom_bindings[i].type, sizeof(GLenum));
+	}
+	key[2] = XXH3_64bits_digest(&state);
+}
+
+static void glsl_add_translation(const uint64_t *key, uint8_t *data, uint32_t size) {
+	glsl_translation *t = (glsl_translation *)vglMalloc(sizeof(glsl_translation));
+	vgl_fast_memcpy(t->key, key, sizeof(uint64_t) * SHADER_PACK_KEY_WORDS);
+	t->data = data;
+	t->size = size;
+	t->next = NULL;
+	glsl_translation **bucket = &glsl_translations[key[0] & (GLSL_TRANSLATIONS_HASH_SIZE - 1)];
+	t->chain = *bucket;
+	*bucket = t;
+	if (glsl_translations_last)
+		glsl_translations_last->next = t;
+	else
+		glsl_translations_first = t;
+	glsl_translations_last = t;
+	glsl_translations_size += size;
+
+	// Dropping the oldest translations when exceeding the memory budget
+	while (glsl_translations_size > GLSL_TRANSLATIONS_MAX_SIZE && glsl_translations_first != t) {
+		glsl_translation *old = glsl_translations_first;
+		glsl_translations_first = old->next;
+		bucket = &glsl_translations[old->key[0] & (GLSL_TRANSLATIONS_HASH_SIZE - 1)];
+		while (*bucket != old) {
+			bucket = &(*bucket)->chain;
+		}
+		*bucket = old->chain;
+		glsl_translations_size -= old->size;
+		vgl_free(old->data);
+		vgl_free(old);
+	}
+}
+
+static glsl_translation *glsl_get_translation(const uint64_t *key) {
+	glsl_translation *t = glsl_translations[key[0] & (GLSL_TRANSLATIONS_HASH_SIZE - 1)];
+	while (t) {
+		if (!sceClibMemcmp(t->key, key, sizeof(uint64_t) * SHADER_PACK_KEY_WORDS))
+			return t;
+		t = t->chain;
+	}
+#ifdef HAVE_SHADER_CACHE
+	uint32_t size;
+	uint8_t *data = (uint8_t *)shader_pack_read(&glsl_translation_pack, key, &size);
+	if (data) {
+		glsl_add_translation(key, data, size);
+		return glsl_translations_last;
+	}
+#endif
+	return NULL;
+}
+
+// Stores a translated shader, serialized as semantic bindings, sized samplers and source
+static void glsl_store_translation(shader *s, const uint64_t *key) {
+	uint32_t size = sizeof(binds_map) + s->size;
+#ifdef HAVE_GLSL_TEXTURE_SIZE
+	size += sizeof(uint8_t) + sizeof(glsl_samplers_info) * s->sized_samplers_num;
+#endif
+	uint8_t *data = (uint8_t *)vglMalloc(size);
+	uint8_t *buf = data;
+	vgl_fast_memcpy(buf, &s->semantics, sizeof(binds_map));
+	buf += sizeof(binds_map);
+#ifdef HAVE_GLSL_TEXTURE_SIZE
+	*buf = s->sized_samplers_num;
+	buf++;
+	vgl_fast_memcpy(buf, s->sized_samplers, sizeof(glsl_samplers_info) * s->sized_samplers_num);
+	buf += sizeof(glsl_samplers_info) * s->sized_samplers_num;
+#endif
+	vgl_fast_memcpy(buf, s->source, s->size);
+#ifdef HAVE_SHADER_CACHE
+	shader_pack_write(&glsl_translation_pack, key, data, size);
+#endif
+	glsl_add_translation(key, data, size);
+}
+
+// Replaces the source of a shader with a memoized translation
+static void glsl_load_translation(shader *s, glsl_translation *t) {
+	uint8_t *buf = t->data;
+	vgl_fast_memcpy(&s->semantics, buf, sizeof(binds_map));
+	buf += sizeof(binds_map);
+#ifdef HAVE_GLSL_TEXTURE_SIZE
+	s->sized_samplers_num = *buf;
+	buf++;
+	vgl_fast_memcpy(s->sized_samplers, buf, sizeof(glsl_samplers_info) * s->sized_samplers_num);
+	buf += sizeof(glsl_samplers_info) * s->sized_samplers_num;
+#endif
+	vgl_free(s->source);
+	s->size = t->size - (buf - t->data);
+	s->source = (char *)vglMalloc(s->size + 1);
+	vgl_fast_memcpy(s->source, buf, s->size);
+	s->source[s->size] = 0;
+}
+
+// Updates the translator state after a shader got translated
+static void glsl_end_translation(shader *s, GLenum sema_mode) {
+	if (sema_mode == VGL_MODE_SHADER_PAIR) {
+		glsl_is_first_shader = !glsl_is_first_shader;
+		if (glsl_is_first_shader) {
+			vgl_memset(glsl_bindings_map.texcoord_used, GL_FALSE, sizeof(GLboolean) * MAX_CG_TEXCOORD_ID);
+			vgl_memset(glsl_bindings_map.color_used, GL_FALSE, sizeof(GLboolean) * MAX_CG_COLOR_ID);
+		}
+	}
+	s->is_glsl = GL_FALSE;
+}
+
 void glsl_translator_process(shader *s) {
+	// Shaders processed by glsl_translator_set_process are always translated as a pair
+	GLenum sema_mode = glsl_pair_translation ? VGL_MODE_SHADER_PAIR : glsl_sema_mode;
+
+	// Reusing any previous translation of the same source performed with the same translator state
+	uint64_t translation_key[SHADER_PACK_KEY_WORDS];
+	if (sema_mode == VGL_MODE_SHADER_PAIR) {
+		glsl_get_translation_key(s, translation_key);
+		glsl_translation *t = glsl_get_translation(translation_key);
+		if (t) {
+			glsl_load_translation(s, t);
+			vgl_fast_memcpy(&glsl_bindings_map, &s->semantics, sizeof(binds_map));
+#ifdef DEBUG_GLSL_TRANSLATOR
+			vgl_log("%s:%d %s: Reusing memoized GLSL translation (%s shader).\n", __FILE__, __LINE__, __func__, glsl_is_first_shader ? "first" : "second");
+#endif
+			glsl_end_translation(s, sema_mode);
+			return;
+		}
+	}
 #ifdef HAVE_FIXED_ATTRIBUTES
 	glsl_attributes_num = 0;
 #endif
@@ -1234,7 +1435,7 @@ void glsl_translator_process(shader *s) {
 	size += strlen(glsl_ffp_hdr);
 #endif
 #ifndef SKIP_ERROR_HANDLING
-	if (glsl_sema_mode == VGL_MODE_GLOBAL)
+	if (sema_mode == VGL_MODE_GLOBAL)
 		glsl_current_ref_idx++;
 #endif
 	if (s->type == GL_VERTEX_SHADER)
@@ -1269,41 +1470,46 @@ void glsl_translator_process(shader *s) {
 	size += strlen(out);
 	
 	// Nukeing precision directives
-	str = strstr(out, "precision ");
+	str = glsl_find_token(out, "precision", GL_FALSE);
 	while (str) {
-		str[0] = ' ';
-		str++;
-		if (str[0] == ';') {
-			str[0] = ' ';
-			str = strstr(str, "precision ");
+		while (*str && *str != ';') {
+			*str++ = ' ';
 		}
+		if (*str)
+			*str++ = ' ';
+		str = glsl_find_token(str, "precision", GL_FALSE);
 	}
 	
 	// Replacing any gl_FragData[0] reference to gl_FragColor
-	str = strstr(out, "gl_FragData[0]");
+	str = glsl_find_token(out, "gl_FragData", GL_FALSE);
 	while (str) {
-		strcpy(str, "gl_FragColor");
-		str[12] = str[13] = ' ';
-		str = strstr(str, "gl_FragData[0]");
-	}	
+		if (!strncmp(str + 11, "[0]", 3)) {
+			strcpy(str, "gl_FragColor");
+			str[12] = str[13] = ' ';
+		}
+		str = glsl_find_token(str + 11, "gl_FragData", GL_FALSE);
+	}
 	
+	// Looking up all the built-in variables we care about in a single pass
+	GLboolean has_builtin[GLSL_BUILTINS_NUM];
+	glsl_scan_builtins(out, has_builtin);
 	if (s->type == GL_VERTEX_SHADER) {
-		hasPointSize = strstr(out, "gl_PointSize") ? GL_TRUE : GL_FALSE;
-		hasInstanceID = strstr(out, "gl_InstanceID") ? GL_TRUE : GL_FALSE;
-		hasVertexID = strstr(out, "gl_VertexID") ? GL_TRUE : GL_FALSE;
-		hasFrontColor = strstr(out, "gl_FrontColor") ? GL_TRUE : GL_FALSE;
+		hasPointSize = has_builtin[GLSL_POINT_SIZE];
+		hasInstanceID = has_builtin[GLSL_INSTANCE_ID];
+		hasVertexID = has_builtin[GLSL_VERTEX_ID];
+		hasFrontColor = has_builtin[GLSL_FRONT_COLOR];
 	} else {
-		hasPointCoord = strstr(out, "gl_PointCoord") ? GL_TRUE : GL_FALSE;
-		hasFrontFacing = strstr(out, "gl_FrontFacing") ? GL_TRUE : GL_FALSE;
-		hasFragCoord = strstr(out, "gl_FragCoord") ? GL_TRUE : GL_FALSE;
-		hasFragDepth = strstr(out, "gl_FragDepth") ? GL_TRUE : GL_FALSE;
-		hasColor = strstr(out, "gl_Color") ? GL_TRUE : GL_FALSE;
+		hasPointCoord = has_builtin[GLSL_POINT_COORD];
+		hasFrontFacing = has_builtin[GLSL_FRONT_FACING];
+		hasFragCoord = has_builtin[GLSL_FRAG_COORD];
+		hasFragDepth = has_builtin[GLSL_FRAG_DEPTH];
+		hasColor = has_builtin[GLSL_COLOR];
 	}
 
 #ifdef HAVE_FFP_SHADER_SUPPORT
 	GLboolean has_ffp_bind[FFP_BINDS_NUM];
 	for (int i = 0; i < FFP_BINDS_NUM; i++) {
-		has_ffp_bind[i] = strstr(out, ffp_bind_names[i]) ? GL_TRUE : GL_FALSE;
+		has_ffp_bind[i] = has_builtin[GLSL_FFP_BINDS + i];
 		if (has_ffp_bind[i])
 			size += strlen(ffp_bind_defines[i]);
 	}
@@ -1375,7 +1581,7 @@ void glsl_translator_process(shader *s) {
 	strcat(s->source, out);
 	glsl_preprocessor_clean();
 
-	switch (glsl_sema_mode) {
+	switch (sema_mode) {
 		case VGL_MODE_SHADER_PAIR:
 			glsl_translate_with_shader_pair(text, s->type, hasFrontFacing);
 			break;
@@ -1388,7 +1594,7 @@ void glsl_translator_process(shader *s) {
 	}
 	
 	// Replacing all marked varying with actual bindings if custom bindings are used
-	if (glsl_custom_bindings_num > 0 || glsl_sema_mode == VGL_MODE_GLOBAL) {
+	if (glsl_custom_bindings_num > 0 || sema_mode == VGL_MODE_GLOBAL) {
 		// Texcoords
 		char *str = strstr(s->source, "\v");
 		while (str) {
@@ -1403,7 +1609,7 @@ void glsl_translator_process(shader *s) {
 			start++;
 			int idx = -1;
 			*end = 0;
-			if (glsl_sema_mode == VGL_MODE_GLOBAL) {
+			if (sema_mode == VGL_MODE_GLOBAL) {
 				for (int j = 0; j < MAX_CG_TEXCOORD_ID; j++) {
 					idx = j;
 					for (int i = 0; i < glsl_custom_bindings_num; i++) {
@@ -1424,7 +1630,7 @@ void glsl_translator_process(shader *s) {
 							break;
 						}
 					}
-					vglAddSemanticBinding(start, idx, binding_type);
+					glsl_add_custom_binding(start, idx, binding_type);
 				}
 			} else {
 				glsl_reserve_texcoord_bind(idx, start);
@@ -1453,7 +1659,7 @@ void glsl_translator_process(shader *s) {
 			start++;
 			int idx = -1;
 			*end = 0;
-			if (glsl_sema_mode == VGL_MODE_GLOBAL) {
+			if (sema_mode == VGL_MODE_GLOBAL) {
 				for (int j = 0; j < MAX_CG_COLOR_ID; j++) {
 					idx = j;
 					for (int i = 0; i < glsl_custom_bindings_num; i++) {
@@ -1474,7 +1680,7 @@ void glsl_translator_process(shader *s) {
 							break;
 						}
 					}
-					vglAddSemanticBinding(start, idx, binding_type);
+					glsl_add_custom_binding(start, idx, binding_type);
 				}
 			} else {
 				glsl_reserve_color_bind(idx, start);
@@ -1556,15 +1762,10 @@ void glsl_translator_process(shader *s) {
 #endif
 
 	vgl_fast_memcpy(&s->semantics, &glsl_bindings_map, sizeof(binds_map));
-	if (glsl_sema_mode == VGL_MODE_SHADER_PAIR) {
-		glsl_is_first_shader = !glsl_is_first_shader;
-		if (glsl_is_first_shader) {
-			vgl_memset(glsl_bindings_map.texcoord_used, GL_FALSE, sizeof(GLboolean) * MAX_CG_TEXCOORD_ID);
-			vgl_memset(glsl_bindings_map.color_used, GL_FALSE, sizeof(GLboolean) * MAX_CG_COLOR_ID);
-		}
-	}
 	s->size = strlen(s->source);
-	s->is_glsl = GL_FALSE;
+	if (sema_mode == VGL_MODE_SHADER_PAIR)
+		glsl_store_translation(s, translation_key);
+	glsl_end_translation(s, sema_mode);
 }
 
 void glsl_translator_set_process(shader *vs, shader *fs) {
@@ -1582,10 +1783,25 @@ void glsl_translator_set_process(shader *vs, shader *fs) {
 #endif
 		}
 	}
+	glsl_pair_translation = GL_TRUE;
 	if (!vs->prog) {
 		glsl_translator_process(vs);
 	}
 	if (!fs->prog) {
 		glsl_translator_process(fs);
 	}
+	glsl_pair_translation = GL_FALSE;
+}
+
+void glsl_add_custom_binding(const char *name, int idx, GLenum type) {
+#ifndef SKIP_ERROR_HANDLING
+	if (glsl_custom_bindings_num >= MAX_CUSTOM_BINDINGS) {
+		vgl_log("%s:%d %s: Too many custom bindings supplied. Consider increasing MAX_CUSTOM_BINDINGS.\n", __FILE__, __LINE__, __func__);
+		return;
+	}
+#endif
+	strcpy(glsl_custom_bindings[glsl_custom_bindings_num].name, name);
+	glsl_custom_bindings[glsl_custom_bindings_num].idx = idx;
+	glsl_custom_bindings[glsl_custom_bindings_num].type = type;
+	glsl_custom_bindings[glsl_custom_bindings_num++].ref_idx = glsl_current_ref_idx;
 }
@@ -49,5 +49,6 @@ void glsl_nuke_comments(char *txt);
 
 void glsl_translator_process(shader *s);
 void glsl_translator_set_process(shader *vs, shader *fs);
+void glsl_add_custom_binding(const char *name, int idx, GLenum type);
 
 #endif
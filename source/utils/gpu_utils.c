@@ -154,6 +154,7 @@ static inline __attribute__((always_inline)) uint32_t vgl_cache_old_textures(siz
 
 int unsafe_allocator_counter = 0;
 void *gpu_alloc_mapped_aligned_unsafe_for_cpu(size_t alignment, size_t size) {
+	PROFILER_SCOPE(PROF_GC_WAIT)
 	// Performing a garbage collection cycle prior to attempting to allocate the memory again
 	unsafe_allocator_counter++;
 	if (unsafe_allocator_counter == 1) {
@@ -179,6 +180,7 @@ void *gpu_alloc_mapped_aligned_unsafe_for_cpu(size_t alignment, size_t size) {
 }
 
 void *gpu_alloc_mapped_aligned_unsafe_for_gpu(size_t alignment, size_t size) {
+	PROFILER_SCOPE(PROF_GC_WAIT)
 	// Performing a garbage collection cycle prior to attempting to allocate the memory again
 	unsafe_allocator_counter++;
 	if (unsafe_allocator_counter == 1) {
@@ -205,6 +207,7 @@ void *gpu_alloc_mapped_aligned_unsafe_for_gpu(size_t alignment, size_t size) {
 }
 
 void *gpu_alloc_mapped_aligned_for_cpu(size_t alignment, size_t size) {
+	PROFILER_SCOPE(PROF_ALLOC)
 	void *res = gpu_alloc_mapped_aligned_for_cpu_inner(alignment, size);
 	if (res)
 		return res;
@@ -234,6 +237,7 @@ void *gpu_alloc_mapped_aligned_for_cpu(size_t alignment, size_t size) {
 }
 
 void *gpu_alloc_mapped_aligned_for_gpu(size_t alignment, size_t size) {
+	PROFILER_SCOPE(PROF_ALLOC)
 	void *res = gpu_alloc_mapped_aligned_for_gpu_inner(alignment, size);
 	if (res)
 		return res;
@@ -335,6 +339,7 @@ void *gpu_alloc_palette(const void *data, uint32_t w, uint32_t bpe) {
 }
 
 void gpu_alloc_cube_texture(uint32_t w, uint32_t h, SceGxmTextureFormat format, SceGxmTransferFormat src_format, const void *data, texture *tex, uint8_t src_bpp, int index) {
+	PROFILER_SCOPE(PROF_TEXTURE_UPLOAD)
 	// If there's already a texture in passed texture object we first dealloc it
 	if (tex->status == TEX_VALID && tex->faces_counter >= 6) {
 		gpu_free_texture_data(tex);
@@ -355,6 +360,7 @@ void gpu_alloc_cube_texture(uint32_t w, uint32_t h, SceGxmTextureFormat format,
 
 		if (data) {
 			const int tex_size = w * h * bpp;
+			vgl_perf_counters.texture_bytes_uploaded += tex_size;
 			void *mapped_data = gpu_alloc_mapped_temp(tex_size);
 			vgl_fast_memcpy(mapped_data, data, tex_size);
 			SceGxmTransferFormat dst_fmt = tex_format_to_transfer(format);
@@ -384,6 +390,7 @@ void gpu_alloc_cube_texture(uint32_t w, uint32_t h, SceGxmTextureFormat format,
 }
 
 void gpu_alloc_texture(uint32_t w, uint32_t h, SceGxmTextureFormat format, const void *data, texture *tex, uint8_t src_bpp, uint32_t (*read_cb)(void *), void (*write_cb)(void *, uint32_t), GLboolean fast_store) {
+	PROFILER_SCOPE(PROF_TEXTURE_UPLOAD)
 	// If there's already a texture in passed texture object we first dealloc it
 	if (tex->status == TEX_VALID)
 		gpu_free_texture_data(tex);
@@ -401,6 +408,7 @@ void gpu_alloc_texture(uint32_t w, uint32_t h, SceGxmTextureFormat format, const
 		if (data) {
 			uint8_t *src = (uint8_t *)data;
 			uint8_t *dst;
+			vgl_perf_counters.texture_bytes_uploaded += w * h * bpp;
 			if (fast_store) { // Internal Format and Data Format are the same, we can just use vgl_fast_memcpy for better performance
 				if (aligned_w == w) // Texture size is already aligned, we can use a single vgl_fast_memcpy for better performance
 					vgl_fast_memcpy(texture_data, src, tex_size);
@@ -413,6 +421,7 @@ void gpu_alloc_texture(uint32_t w, uint32_t h, SceGxmTextureFormat format, const
 					}
 				}
 			} else { // Different internal and data formats, we need to go with slower callbacks system
+				vgl_perf_counters.texture_bytes_converted += w * h * bpp;
 				for (int i = 0; i < h; i++) {
 					dst = ((uint8_t *)texture_data) + (aligned_w * bpp) * i;
 					for (int j = 0; j < w; j++) {
@@ -445,6 +454,7 @@ void gpu_alloc_texture(uint32_t w, uint32_t h, SceGxmTextureFormat format, const
 }
 
 void gpu_alloc_paletted_texture(int32_t level, uint32_t w, uint32_t h, SceGxmTextureFormat format, const void *data, texture *tex, uint8_t src_bpp, uint32_t (*read_cb)(void *)) {
+	PROFILER_SCOPE(PROF_TEXTURE_UPLOAD)
 	// If there's already a texture in passed texture object we first dealloc it
 	if (tex->status == TEX_VALID)
 		gpu_free_texture_data(tex);
@@ -547,6 +557,7 @@ static inline __attribute__((always_inline)) int gpu_get_compressed_mip_offset(i
 }
 
 void gpu_alloc_compressed_cube_texture(uint32_t w, uint32_t h, SceGxmTextureFormat format, uint32_t image_size, const void *data, texture *tex, uint8_t src_bpp, GLboolean uncompressed, int index) {
+	PROFILER_SCOPE(PROF_TEXTURE_UPLOAD)
 	// If there's already a texture in passed texture object we first dealloc it
 	if (tex->status == TEX_VALID && tex->faces_counter >= 6) {
 		gpu_free_texture_data(tex);
@@ -577,8 +588,10 @@ void gpu_alloc_compressed_cube_texture(uint32_t w, uint32_t h, SceGxmTextureForm
 	if (texture_data) {
 		void *mip_data = (void *)((uint8_t *)texture_data + mip_offset);
 		if (data) {
+			vgl_perf_counters.texture_bytes_uploaded += image_size;
 			if (uncompressed) {
 				// Performing swizzling and DXT compression
+				vgl_perf_counters.texture_bytes_converted += image_size;
 				uint8_t alignment = tex_format_to_alignment(format);
 				dxt_compress(mip_data, (uint8_t *)data, aligned_width, aligned_height, alignment == 16);
 			} else {
@@ -661,6 +674,7 @@ void gpu_alloc_compressed_cube_texture(uint32_t w, uint32_t h, SceGxmTextureForm
 }
 
 void gpu_alloc_compressed_texture(int32_t mip_level, uint32_t w, uint32_t h, SceGxmTextureFormat format, uint32_t image_size, const void *data, texture *tex, uint8_t src_bpp, GLboolean uncompressed) {
+	PROFILER_SCOPE(PROF_TEXTURE_UPLOAD)
 	// If there's already a texture in passed texture object we first dealloc it
 	if (tex->status == TEX_VALID && !mip_level)
 		gpu_free_texture_data(tex);
@@ -721,8 +735,10 @@ void gpu_alloc_compressed_texture(int32_t mip_level, uint32_t w, uint32_t h, Sce
 	if (texture_data) {
 		void *mip_data = (void *)((uint8_t *)texture_data + mip_offset);
 		if (data) {
+			vgl_perf_counters.texture_bytes_uploaded += image_size;
 			if (uncompressed) {
 				// Performing swizzling and DXT compression
+				vgl_perf_counters.texture_bytes_converted += image_size;
 				uint8_t alignment = tex_format_to_alignment(format);
 				dxt_compress(mip_data, (uint8_t *)data, aligned_width, aligned_height, alignment == 16);
 			} else {
@@ -806,6 +822,7 @@ void gpu_alloc_compressed_texture(int32_t mip_level, uint32_t w, uint32_t h, Sce
 }
 
 void gpu_alloc_mipmaps(int level, texture *tex) {
+	PROFILER_SCOPE(PROF_TEXTURE_UPLOAD)
 	// Getting current mipmap count in passed texture
 	int count = tex->mip_count - 1;
 
@@ -917,6 +934,7 @@ void gpu_free_palette(void *pal) {
 }
 
 void gpu_alloc_planar_texture(uint32_t w, uint32_t h, SceGxmTextureFormat format, const void *data, texture *tex) {
+	PROFILER_SCOPE(PROF_TEXTURE_UPLOAD)
 	// If there's already a texture in passed texture object we first dealloc it
 	if (tex->status == TEX_VALID)
 		gpu_free_texture_data(tex);
@@ -22,6 +22,7 @@
  */
 #include "../shared.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 #define UNIFORM_CIRCULAR_POOL_SIZE (2 * 1024 * 1024)
 
@@ -29,6 +30,7 @@ void *vgl_def_frag_buf = NULL;
 void *vgl_def_vert_buf = NULL;
 static uint8_t *unif_pool = NULL;
 static uint32_t unif_idx = 0;
+uint32_t vgl_unif_pool_cycle = 0;
 
 void vglSetupUniformCircularPool() {
 	if (!unif_pool) {
@@ -48,6 +50,7 @@ void *vglReserveUniformCircularPoolBuffer(uint32_t size) {
 #endif
 		r = unif_pool;
 		unif_idx = size;
+		vgl_unif_pool_cycle++;
 	} else {
 		r = (unif_pool + unif_idx);
 		unif_idx += size;
@@ -235,3 +238,375 @@ void vglSetUniformData(uint8_t *uniformBuffer, const SceGxmParameterType t, cons
 		}
 	}
 }
+
+#ifdef HAVE_DEFERRED_DRAWS
+#define DEFERRED_DRAWS_NUM 1024 // Maximum number of draws recorded before a forced submission
+#define DEFERRED_TEXSETS_NUM 256 // Maximum number of unique fragment texture sets recorded before a forced submission
+#define DEFERRED_STREAMS_NUM 16 // Number of vertex streams tracked per draw
+
+typedef struct {
+	SceGxmTexture tex[SCE_GXM_MAX_TEXTURE_UNITS];
+	uint32_t mask;
+	uint32_t hash;
+} deferred_texset;
+
+typedef struct {
+	const SceGxmVertexProgram *vprog;
+	const SceGxmFragmentProgram *fprog;
+	const void *vbuf;
+	const void *fbuf;
+	const void *streams[DEFERRED_STREAMS_NUM];
+	const void *idx_data;
+	SceGxmPrimitiveType prim_type;
+	SceGxmIndexFormat idx_type;
+	uint32_t idx_count;
+	uint32_t idx_wrap;
+	uint16_t texset;
+	uint8_t streams_num;
+	uint8_t sortable;
+} deferred_draw;
+
+GLboolean vgl_deferred_draws = GL_FALSE;
+uint32_t vgl_deferred_draws_num = 0;
+uint32_t vgl_deferred_draws_stats[3] = {0};
+
+static deferred_draw deferred_draws[DEFERRED_DRAWS_NUM];
+static uint16_t deferred_order[DEFERRED_DRAWS_NUM];
+static deferred_texset deferred_texsets[DEFERRED_TEXSETS_NUM];
+static uint32_t deferred_texsets_num = 0;
+static int deferred_cur_texset = -1;
+
+// Latest state requested for gxm_context, kept up to date even when recording is disabled
+static struct {
+	const SceGxmVertexProgram *vprog;
+	const SceGxmFragmentProgram *fprog;
+	const void *vbuf;
+	const void *fbuf;
+	const void *streams[DEFERRED_STREAMS_NUM];
+	uint8_t streams_num;
+	deferred_texset texset;
+} deferred_state;
+
+/*
+ * NOTE: Inside this file, real sceGxm functions must be invoked with their name between parenthesis
+ * in order to not be redirected to the recording functions
+ */
+
+static GLboolean deferred_tex_equals(const SceGxmTexture *a, const SceGxmTexture *b) {
+	const uint32_t *wa = (const uint32_t *)a;
+	const uint32_t *wb = (const uint32_t *)b;
+	return wa[0] == wb[0] && wa[1] == wb[1] && wa[2] == wb[2] && wa[3] == wb[3];
+}
+
+static int deferred_get_texset(void) {
+	deferred_texset *cur = &deferred_state.texset;
+	uint32_t mask = cur->mask;
+	uint32_t hash = mask;
+	while (mask) {
+		int i = __builtin_ctz(mask);
+		const uint32_t *w = (const uint32_t *)&cur->tex[i];
+		hash = (hash * 31) ^ w[0] ^ (w[2] << 1);
+		mask &= mask - 1;
+	}
+	cur->hash = hash;
+
+	// Draws sharing the same textures must share the same set in order to be sorted together
+	for (int i = 0; i < deferred_texsets_num; i++) {
+		deferred_texset *s = &deferred_texsets[i];
+		if (s->hash == hash && s->mask == cur->mask) {
+			GLboolean match = GL_TRUE;
+			mask = cur->mask;
+			while (mask && match) {
+				int j = __builtin_ctz(mask);
+				match = deferred_tex_equals(&s->tex[j], &cur->tex[j]);
+				mask &= mask - 1;
+			}
+			if (match)
+				return i;
+		}
+	}
+	if (deferred_texsets_num == DEFERRED_TEXSETS_NUM)
+		return -1;
+	vgl_fast_memcpy(&deferred_texsets[deferred_texsets_num], cur, sizeof(deferred_texset));
+	return deferred_texsets_num++;
+}
+
+static int deferred_draws_cmp(const void *a, const void *b) {
+	uint16_t ia = *(const uint16_t *)a;
+	uint16_t ib = *(const uint16_t *)b;
+	deferred_draw *da = &deferred_draws[ia];
+	deferred_draw *db = &deferred_draws[ib];
+
+	// Fragment programs first since they carry blending setup as well, then vertex programs and textures
+	if (da->fprog != db->fprog)
+		return (uintptr_t)da->fprog < (uintptr_t)db->fprog ? -1 : 1;
+	if (da->vprog != db->vprog)
+		return (uintptr_t)da->vprog < (uintptr_t)db->vprog ? -1 : 1;
+	if (da->texset != db->texset)
+		return da->texset < db->texset ? -1 : 1;
+	return ia < ib ? -1 : 1; // Keeps the sort stable
+}
+
+static uint32_t deferred_draws_replay(uint32_t num, GLboolean emit) {
+	const SceGxmVertexProgram *vprog = NULL;
+	const SceGxmFragmentProgram *fprog = NULL;
+	const void *vbuf = NULL;
+	const void *fbuf = NULL;
+	const void *streams[DEFERRED_STREAMS_NUM] = {NULL};
+	const SceGxmTexture *textures[SCE_GXM_MAX_TEXTURE_UNITS] = {NULL};
+	int texset = -1;
+	uint32_t changes = 0;
+
+	for (int i = 0; i < num; i++) {
+		deferred_draw *d = &deferred_draws[deferred_order[i]];
+		if (d->vprog != vprog) {
+			vprog = d->vprog;
+			if (emit)
+				(sceGxmSetVertexProgram)(gxm_context, vprog);
+			changes++;
+		}
+		if (d->fprog != fprog) {
+			fprog = d->fprog;
+			if (emit)
+				(sceGxmSetFragmentProgram)(gxm_context, fprog);
+			changes++;
+		}
+		if (d->texset != texset) {
+			texset = d->texset;
+			deferred_texset *s = &deferred_texsets[texset];
+			uint32_t mask = s->mask;
+			while (mask) {
+				int j = __builtin_ctz(mask);
+				if (!textures[j] || !deferred_tex_equals(textures[j], &s->tex[j])) {
+					textures[j] = &s->tex[j];
+					if (emit)
+						(sceGxmSetFragmentTexture)(gxm_context, j, textures[j]);
+					changes++;
+				}
+				mask &= mask - 1;
+			}
+		}
+		for (int j = 0; j < d->streams_num; j++) {
+			if (d->streams[j] && d->streams[j] != streams[j]) {
+				streams[j] = d->streams[j];
+				if (emit)
+					(sceGxmSetVertexStream)(gxm_context, j, streams[j]);
+				changes++;
+			}
+		}
+		if (d->vbuf && d->vbuf != vbuf) {
+			vbuf = d->vbuf;
+			if (emit)
+				(sceGxmSetVertexDefaultUniformBuffer)(gxm_context, vbuf);
+			changes++;
+		}
+		if (d->fbuf && d->fbuf != fbuf) {
+			fbuf = d->fbuf;
+			if (emit)
+				(sceGxmSetFragmentDefaultUniformBuffer)(gxm_context, fbuf);
+			changes++;
+		}
+		if (emit) {
+			if (d->idx_wrap)
+				(sceGxmDrawInstanced)(gxm_context, d->prim_type, d->idx_type, d->idx_data, d->idx_count, d->idx_wrap);
+			else
+				(sceGxmDraw)(gxm_context, d->prim_type, d->idx_type, d->idx_data, d->idx_count);
+		}
+	}
+	return changes;
+}
+
+void vglFlushDeferredDrawsIMPL(void) {
+	uint32_t num = vgl_deferred_draws_num;
+	vgl_deferred_draws_num = 0;
+	for (int i = 0; i < num; i++) {
+		deferred_order[i] = i;
+	}
+	uint32_t unsorted_changes = deferred_draws_replay(num, GL_FALSE);
+
+	// Opaque draws are sorted in runs, any draw that depends on submission order acts as a barrier
+	GLboolean sorted = GL_FALSE;
+	int i = 0;
+	while (i < num) {
+		if (!deferred_draws[i].sortable) {
+			i++;
+			continue;
+		}
+		int j = i + 1;
+		while (j < num && deferred_draws[j].sortable) {
+			j++;
+		}
+		if (j - i > 1) {
+			qsort(&deferred_order[i], j - i, sizeof(uint16_t), deferred_draws_cmp);
+			sorted = GL_TRUE;
+		}
+		i = j;
+	}
+
+	uint32_t changes = unsorted_changes;
+	if (sorted) {
+		changes = deferred_draws_replay(num, GL_FALSE);
+		if (changes >= unsorted_changes) {
+			for (i = 0; i < num; i++) {
+				deferred_order[i] = i;
+			}
+			changes = unsorted_changes;
+		}
+	}
+	deferred_draws_replay(num, GL_TRUE);
+
+	vgl_deferred_draws_stats[0] += num;
+	vgl_deferred_draws_stats[1] += changes;
+	vgl_deferred_draws_stats[2] += unsorted_changes - changes;
+	deferred_texsets_num = 0;
+	deferred_cur_texset = -1;
+}
+
+void vglSyncDeferredDrawsState(void) {
+	// Real state is left as per the last submitted draw, so we restore what was last requested
+	if (deferred_state.vprog)
+		(sceGxmSetVertexProgram)(gxm_context, deferred_state.vprog);
+	if (deferred_state.fprog)
+		(sceGxmSetFragmentProgram)(gxm_context, deferred_state.fprog);
+	uint32_t mask = deferred_state.texset.mask;
+	while (mask) {
+		int i = __builtin_ctz(mask);
+		(sceGxmSetFragmentTexture)(gxm_context, i, &deferred_state.texset.tex[i]);
+		mask &= mask - 1;
+	}
+	for (int i = 0; i < deferred_state.streams_num; i++) {
+		if (deferred_state.streams[i])
+			(sceGxmSetVertexStream)(gxm_context, i, deferred_state.streams[i]);
+	}
+	if (deferred_state.vbuf)
+		(sceGxmSetVertexDefaultUniformBuffer)(gxm_context, deferred_state.vbuf);
+	if (deferred_state.fbuf)
+		(sceGxmSetFragmentDefaultUniformBuffer)(gxm_context, deferred_state.fbuf);
+}
+
+void vglRecordVertexProgram(SceGxmContext *context, const SceGxmVertexProgram *vertexProgram) {
+	if (context == gxm_context) {
+		deferred_state.vprog = vertexProgram;
+		if (vgl_deferred_draws)
+			return;
+	}
+	(sceGxmSetVertexProgram)(context, vertexProgram);
+}
+
+void vglRecordFragmentProgram(SceGxmContext *context, const SceGxmFragmentProgram *fragmentProgram) {
+	if (context == gxm_context) {
+		deferred_state.fprog = fragmentProgram;
+		if (vgl_deferred_draws)
+			return;
+	}
+	(sceGxmSetFragmentProgram)(context, fragmentProgram);
+}
+
+int vglRecordVertexStream(SceGxmContext *context, unsigned int streamIndex, const void *streamData) {
+	if (context == gxm_context && streamIndex < DEFERRED_STREAMS_NUM) {
+		deferred_state.streams[streamIndex] = streamData;
+		if (streamIndex >= deferred_state.streams_num)
+			deferred_state.streams_num = streamIndex + 1;
+		if (vgl_deferred_draws)
+			return 0;
+	}
+	return (sceGxmSetVertexStream)(context, streamIndex, streamData);
+}
+
+int vglRecordFragmentTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture) {
+	if (context == gxm_context && textureIndex < SCE_GXM_MAX_TEXTURE_UNITS) {
+		// sceGxm copies the texture control words at bind time, so we do the same
+		vgl_fast_memcpy(&deferred_state.texset.tex[textureIndex], texture, sizeof(SceGxmTexture));
+		deferred_state.texset.mask |= (1 << textureIndex);
+		deferred_cur_texset = -1;
+		if (vgl_deferred_draws)
+			return 0;
+	}
+	return (sceGxmSetFragmentTexture)(context, textureIndex, texture);
+}
+
+int vglRecordVertexDefaultUniformBuffer(SceGxmContext *context, const void *bufferData) {
+	if (context == gxm_context) {
+		deferred_state.vbuf = bufferData;
+		if (vgl_deferred_draws)
+			return 0;
+	}
+	return (sceGxmSetVertexDefaultUniformBuffer)(context, bufferData);
+}
+
+int vglRecordFragmentDefaultUniformBuffer(SceGxmContext *context, const void *bufferData) {
+	if (context == gxm_context) {
+		deferred_state.fbuf = bufferData;
+		if (vgl_deferred_draws)
+			return 0;
+	}
+	return (sceGxmSetFragmentDefaultUniformBuffer)(context, bufferData);
+}
+
+int vglRecordReserveVertexDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer) {
+	if (context == gxm_context) {
+		// sceGxm reserved buffers are only valid until the next draw, so we use our own pool when recording
+		if (vgl_deferred_draws && deferred_state.vprog) {
+			*uniformBuffer = vglReserveUniformCircularPoolBuffer(sceGxmProgramGetDefaultUniformBufferSize(sceGxmVertexProgramGetProgram(deferred_state.vprog)));
+			deferred_state.vbuf = *uniformBuffer;
+			return 0;
+		}
+		vglFlushDeferredDraws(context);
+		int r = (sceGxmReserveVertexDefaultUniformBuffer)(context, uniformBuffer);
+		deferred_state.vbuf = *uniformBuffer;
+		return r;
+	}
+	return (sceGxmReserveVertexDefaultUniformBuffer)(context, uniformBuffer);
+}
+
+int vglRecordReserveFragmentDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer) {
+	if (context == gxm_context) {
+		if (vgl_deferred_draws && deferred_state.fprog) {
+			*uniformBuffer = vglReserveUniformCircularPoolBuffer(sceGxmProgramGetDefaultUniformBufferSize(sceGxmFragmentProgramGetProgram(deferred_state.fprog)));
+			deferred_state.fbuf = *uniformBuffer;
+			return 0;
+		}
+		vglFlushDeferredDraws(context);
+		int r = (sceGxmReserveFragmentDefaultUniformBuffer)(context, uniformBuffer);
+		deferred_state.fbuf = *uniformBuffer;
+		return r;
+	}
+	return (sceGxmReserveFragmentDefaultUniformBuffer)(context, uniformBuffer);
+}
+
+int vglRecordDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount, unsigned int indexWrap) {
+	if (context != gxm_context || !vgl_deferred_draws) {
+		if (indexWrap)
+			return (sceGxmDrawInstanced)(context, primType, indexType, indexData, indexCount, indexWrap);
+		return (sceGxmDraw)(context, primType, indexType, indexData, indexCount);
+	}
+
+	if (vgl_deferred_draws_num == DEFERRED_DRAWS_NUM)
+		vglFlushDeferredDrawsIMPL();
+	if (deferred_cur_texset < 0) {
+		deferred_cur_texset = deferred_get_texset();
+		if (deferred_cur_texset < 0) {
+			vglFlushDeferredDrawsIMPL();
+			deferred_cur_texset = deferred_get_texset();
+		}
+	}
+
+	deferred_draw *d = &deferred_draws[vgl_deferred_draws_num++];
+	d->vprog = deferred_state.vprog;
+	d->fprog = deferred_state.fprog;
+	d->vbuf = deferred_state.vbuf;
+	d->fbuf = deferred_state.fbuf;
+	d->streams_num = deferred_state.streams_num;
+	vgl_fast_memcpy(d->streams, deferred_state.streams, sizeof(void *) * d->streams_num);
+	d->texset = deferred_cur_texset;
+	d->prim_type = primType;
+	d->idx_type = indexType;
+	d->idx_data = indexData;
+	d->idx_count = indexCount;
+	d->idx_wrap = indexWrap;
+
+	// Only opaque GL_LESS draws get reordered, GL_LEQUAL draws are kept in order since multipass rendering over the same geometry relies on it
+	d->sortable = !blend_state && !stencil_test_state && depth_test_state && depth_mask_state && depth_func == SCE_GXM_DEPTH_FUNC_LESS;
+	return 0;
+}
+#endif
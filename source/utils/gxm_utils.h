@@ -26,6 +26,7 @@
 
 extern void *vgl_def_frag_buf;
 extern void *vgl_def_vert_buf;
+extern uint32_t vgl_unif_pool_cycle; // Number of times the uniform circular pool wrapped around
 extern SceGxmContext *gxm_context;
 
 void vglSetupUniformCircularPool(void);
@@ -33,6 +34,78 @@ void *vglReserveUniformCircularPoolBuffer(uint32_t size);
 
 void vglSetUniformData(uint8_t *uniformBuffer, const SceGxmParameterType t, const int offset, const uint32_t count, const uint32_t componentCount, const void *sourceData, const SceGxmParameterType input_type);
 
+#ifdef HAVE_DEFERRED_DRAWS
+extern GLboolean vgl_deferred_draws; // Current state for deferred draws recording
+extern uint32_t vgl_deferred_draws_num; // Number of draws currently recorded and not yet submitted
+extern uint32_t vgl_deferred_draws_stats[3]; // Submitted draws, emitted state changes and saved state changes since last reset
+
+void vglFlushDeferredDrawsIMPL(void);
+void vglSyncDeferredDrawsState(void);
+void vglRecordVertexProgram(SceGxmContext *context, const SceGxmVertexProgram *vertexProgram);
+void vglRecordFragmentProgram(SceGxmContext *context, const SceGxmFragmentProgram *fragmentProgram);
+int vglRecordVertexStream(SceGxmContext *context, unsigned int streamIndex, const void *streamData);
+int vglRecordFragmentTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture);
+int vglRecordVertexDefaultUniformBuffer(SceGxmContext *context, const void *bufferData);
+int vglRecordFragmentDefaultUniformBuffer(SceGxmContext *context, const void *bufferData);
+int vglRecordReserveVertexDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer);
+int vglRecordReserveFragmentDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer);
+int vglRecordDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount, unsigned int indexWrap);
+
+static inline __attribute__((always_inline)) void vglFlushDeferredDraws(SceGxmContext *context) {
+	if (vgl_deferred_draws_num && context == gxm_context)
+		vglFlushDeferredDrawsIMPL();
+}
+
+// State that draws are sorted on is recorded, everything else submits pending draws before being applied
+#define sceGxmSetVertexProgram(ctx, prog) vglRecordVertexProgram(ctx, prog)
+#define sceGxmSetFragmentProgram(ctx, prog) vglRecordFragmentProgram(ctx, prog)
+#define sceGxmSetVertexStream(ctx, idx, ptr) vglRecordVertexStream(ctx, idx, ptr)
+#define sceGxmSetFragmentTexture(ctx, idx, tex) vglRecordFragmentTexture(ctx, idx, tex)
+#define sceGxmSetVertexDefaultUniformBuffer(ctx, ptr) vglRecordVertexDefaultUniformBuffer(ctx, ptr)
+#define sceGxmSetFragmentDefaultUniformBuffer(ctx, ptr) vglRecordFragmentDefaultUniformBuffer(ctx, ptr)
+#define sceGxmReserveVertexDefaultUniformBuffer(ctx, ptr) vglRecordReserveVertexDefaultUniformBuffer(ctx, ptr)
+#define sceGxmReserveFragmentDefaultUniformBuffer(ctx, ptr) vglRecordReserveFragmentDefaultUniformBuffer(ctx, ptr)
+#define sceGxmDraw(ctx, type, idx_type, idx, count) vglRecordDraw(ctx, type, idx_type, idx, count, 0)
+#define sceGxmDrawInstanced(ctx, type, idx_type, idx, count, wrap) vglRecordDraw(ctx, type, idx_type, idx, count, wrap)
+
+#define DEFERRED_DRAWS_BARRIER(ctx, x) (vglFlushDeferredDraws(ctx), x)
+#define sceGxmBeginScene(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmBeginScene(ctx, __VA_ARGS__))
+#define sceGxmEndScene(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmEndScene(ctx, __VA_ARGS__))
+#define sceGxmFinish(ctx) DEFERRED_DRAWS_BARRIER(ctx, sceGxmFinish(ctx))
+#define sceGxmPushUserMarker(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmPushUserMarker(ctx, __VA_ARGS__))
+#define sceGxmPopUserMarker(ctx) DEFERRED_DRAWS_BARRIER(ctx, sceGxmPopUserMarker(ctx))
+#define sceGxmSetViewport(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetViewport(ctx, __VA_ARGS__))
+#define sceGxmSetRegionClip(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetRegionClip(ctx, __VA_ARGS__))
+#define sceGxmSetCullMode(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetCullMode(ctx, __VA_ARGS__))
+#define sceGxmSetTwoSidedEnable(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetTwoSidedEnable(ctx, __VA_ARGS__))
+#define sceGxmSetVisibilityBuffer(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetVisibilityBuffer(ctx, __VA_ARGS__))
+#define sceGxmSetVertexTexture(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetVertexTexture(ctx, __VA_ARGS__))
+#define sceGxmSetVertexUniformBuffer(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetVertexUniformBuffer(ctx, __VA_ARGS__))
+#define sceGxmSetFragmentUniformBuffer(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFragmentUniformBuffer(ctx, __VA_ARGS__))
+#define sceGxmSetFrontPolygonMode(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFrontPolygonMode(ctx, __VA_ARGS__))
+#define sceGxmSetBackPolygonMode(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetBackPolygonMode(ctx, __VA_ARGS__))
+#define sceGxmSetFrontPointLineWidth(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFrontPointLineWidth(ctx, __VA_ARGS__))
+#define sceGxmSetBackPointLineWidth(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetBackPointLineWidth(ctx, __VA_ARGS__))
+#define sceGxmSetFrontDepthBias(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFrontDepthBias(ctx, __VA_ARGS__))
+#define sceGxmSetBackDepthBias(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetBackDepthBias(ctx, __VA_ARGS__))
+#define sceGxmSetFrontDepthFunc(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFrontDepthFunc(ctx, __VA_ARGS__))
+#define sceGxmSetBackDepthFunc(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetBackDepthFunc(ctx, __VA_ARGS__))
+#define sceGxmSetFrontDepthWriteEnable(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFrontDepthWriteEnable(ctx, __VA_ARGS__))
+#define sceGxmSetBackDepthWriteEnable(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetBackDepthWriteEnable(ctx, __VA_ARGS__))
+#define sceGxmSetFrontFragmentProgramEnable(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFrontFragmentProgramEnable(ctx, __VA_ARGS__))
+#define sceGxmSetBackFragmentProgramEnable(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetBackFragmentProgramEnable(ctx, __VA_ARGS__))
+#define sceGxmSetFrontStencilFunc(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFrontStencilFunc(ctx, __VA_ARGS__))
+#define sceGxmSetBackStencilFunc(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetBackStencilFunc(ctx, __VA_ARGS__))
+#define sceGxmSetFrontStencilRef(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFrontStencilRef(ctx, __VA_ARGS__))
+#define sceGxmSetBackStencilRef(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetBackStencilRef(ctx, __VA_ARGS__))
+#define sceGxmSetFrontVisibilityTestEnable(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFrontVisibilityTestEnable(ctx, __VA_ARGS__))
+#define sceGxmSetBackVisibilityTestEnable(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetBackVisibilityTestEnable(ctx, __VA_ARGS__))
+#define sceGxmSetFrontVisibilityTestIndex(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFrontVisibilityTestIndex(ctx, __VA_ARGS__))
+#define sceGxmSetBackVisibilityTestIndex(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetBackVisibilityTestIndex(ctx, __VA_ARGS__))
+#define sceGxmSetFrontVisibilityTestOp(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetFrontVisibilityTestOp(ctx, __VA_ARGS__))
+#define sceGxmSetBackVisibilityTestOp(ctx, ...) DEFERRED_DRAWS_BARRIER(ctx, sceGxmSetBackVisibilityTestOp(ctx, __VA_ARGS__))
+#endif
+
 static inline __attribute__((always_inline)) void vglRestoreFragmentUniformBuffer(void) {
 	if (vgl_def_frag_buf)
 		sceGxmSetFragmentDefaultUniformBuffer(gxm_context, vgl_def_frag_buf);	
@@ -41,6 +114,14 @@ static inline __attribute__((always_inline)) void vglRestoreVertexUniformBuffer(
 	if (vgl_def_vert_buf)
 		sceGxmSetVertexDefaultUniformBuffer(gxm_context, vgl_def_vert_buf);
 }
+static inline __attribute__((always_inline)) void vglBindFragmentUniformBuffer(void *buf) {
+	vgl_def_frag_buf = buf;
+	sceGxmSetFragmentDefaultUniformBuffer(gxm_context, buf);
+}
+static inline __attribute__((always_inline)) void vglBindVertexUniformBuffer(void *buf) {
+	vgl_def_vert_buf = buf;
+	sceGxmSetVertexDefaultUniformBuffer(gxm_context, buf);
+}
 static inline __attribute__((always_inline)) void *vglReserveFragmentUniformBuffer(uint32_t size) {
 	vgl_def_frag_buf = vglReserveUniformCircularPoolBuffer(size);
 	sceGxmSetFragmentDefaultUniformBuffer(gxm_context, vgl_def_frag_buf);
@@ -138,14 +219,13 @@ static inline __attribute__((always_inline)) uint32_t *vglProgramGetParameterBas
 	return (uint32_t *)((uint32_t)ptr + *ptr);
 }
 static inline __attribute__((always_inline)) int vglDepthStencilSurfaceInit(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilFormat depthStencilFormat, SceGxmDepthStencilSurfaceType surfaceType, unsigned int strideInSamples, void *depthData, void *stencilData) {
-	uint32_t *s = (uint32_t *)surface;
-	s[0] = surfaceType & 0x11000 | 0x100000 | depthStencilFormat & 0x7EEE000 | 8 * ((strideInSamples >> 5) - 1) & 0x7F8;
+	surface->zlsControl = surfaceType & 0x11000 | 0x100000 | depthStencilFormat & 0x7EEE000 | 8 * ((strideInSamples >> 5) - 1) & 0x7F8;
 #ifndef DEPTH_STENCIL_HACK
-	s[1] = (uint32_t)depthData;
-	s[2] = (uint32_t)stencilData;
+	surface->depthData = depthData;
+	surface->stencilData = stencilData;
 #endif
-	s[3] = 0x3F800000;
-	s[4] = 0x300;
+	surface->backgroundDepth = 1.0f;
+	surface->backgroundControl = 0x300;
 	return 0;
 }
 #endif
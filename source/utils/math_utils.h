@@ -58,6 +58,23 @@ typedef float matrix2x2[2][2];
 typedef float matrix3x3[3][3];
 typedef float matrix4x4[4][4];
 
+// Matrix kinds, sorted by generality
+enum {
+	MATRIX_IDENTITY,
+	MATRIX_TRANSLATION, // Translation only
+	MATRIX_SCALE, // Axis aligned scale plus translation
+	MATRIX_RIGID, // Rotation plus translation
+	MATRIX_AFFINE, // Generic transform with a (0, 0, 0, 1) last row
+	MATRIX_PROJECTIVE
+};
+
+// Get the kind of the product of two matrices of known kinds
+static inline __attribute__((always_inline)) uint8_t matrix_kind_combine(uint8_t a, uint8_t b) {
+	if ((a == MATRIX_SCALE && b == MATRIX_RIGID) || (a == MATRIX_RIGID && b == MATRIX_SCALE))
+		return MATRIX_AFFINE;
+	return a > b ? a : b;
+}
+
 // Creates an identity matrix
 static inline __attribute__((always_inline)) void matrix4x4_identity(matrix4x4 m) {
 	vgl_memset(m, 0, sizeof(matrix4x4));
@@ -128,6 +145,77 @@ static inline __attribute__((always_inline)) void matrix4x4_scale(matrix4x4 m, f
 	matrix4x4_copy(m, m2);
 }
 
+// Get the kind of a generic matrix
+static inline __attribute__((always_inline)) uint8_t matrix4x4_get_kind(const matrix4x4 m) {
+	if (m[3][0] != 0.0f || m[3][1] != 0.0f || m[3][2] != 0.0f || m[3][3] != 1.0f)
+		return MATRIX_PROJECTIVE;
+	if (m[0][1] != 0.0f || m[0][2] != 0.0f || m[1][0] != 0.0f || m[1][2] != 0.0f || m[2][0] != 0.0f || m[2][1] != 0.0f)
+		return MATRIX_AFFINE;
+	if (m[0][0] != 1.0f || m[1][1] != 1.0f || m[2][2] != 1.0f)
+		return MATRIX_SCALE;
+	if (m[0][3] != 0.0f || m[1][3] != 0.0f || m[2][3] != 0.0f)
+		return MATRIX_TRANSLATION;
+	return MATRIX_IDENTITY;
+}
+
+// Perform a matrix per matrix moltiplication skipping identity operands
+static inline __attribute__((always_inline)) void matrix4x4_multiply_kind(matrix4x4 dst, const matrix4x4 src1, uint8_t kind1, const matrix4x4 src2, uint8_t kind2) {
+	if (kind1 == MATRIX_IDENTITY)
+		matrix4x4_copy(dst, src2);
+	else if (kind2 == MATRIX_IDENTITY)
+		matrix4x4_copy(dst, src1);
+	else
+		matrix4x4_multiply(dst, src1, src2);
+}
+
+// Translate, scale or rotate a matrix of known kind in place, returning the resulting kind
+static inline __attribute__((always_inline)) uint8_t matrix4x4_translate_kind(matrix4x4 m, uint8_t kind, float x, float y, float z) {
+	int rows = kind == MATRIX_PROJECTIVE ? 4 : 3;
+	for (int i = 0; i < rows; i++) {
+		m[i][3] += m[i][0] * x + m[i][1] * y + m[i][2] * z;
+	}
+	return matrix_kind_combine(kind, MATRIX_TRANSLATION);
+}
+static inline __attribute__((always_inline)) uint8_t matrix4x4_scale_kind(matrix4x4 m, uint8_t kind, float x, float y, float z) {
+	int rows = kind == MATRIX_PROJECTIVE ? 4 : 3;
+	for (int i = 0; i < rows; i++) {
+		m[i][0] *= x;
+		m[i][1] *= y;
+		m[i][2] *= z;
+	}
+	return matrix_kind_combine(kind, MATRIX_SCALE);
+}
+static inline __attribute__((always_inline)) uint8_t matrix4x4_rotate_kind(matrix4x4 m, uint8_t kind, float rad, float x, float y, float z) {
+	float cs[2];
+	sincosf_c(rad, cs);
+
+	matrix3x3 r;
+	const float c = 1 - cs[1];
+	float axis[3] = {x, y, z};
+	normalize3_neon(axis, axis);
+	const float xc = axis[0] * c, yc = axis[1] * c, zc = axis[2] * c;
+	r[0][0] = axis[0] * xc + cs[1];
+	r[1][0] = axis[1] * xc + axis[2] * cs[0];
+	r[2][0] = axis[2] * xc - axis[1] * cs[0];
+
+	r[0][1] = axis[0] * yc - axis[2] * cs[0];
+	r[1][1] = axis[1] * yc + cs[1];
+	r[2][1] = axis[2] * yc + axis[0] * cs[0];
+
+	r[0][2] = axis[0] * zc + axis[1] * cs[0];
+	r[1][2] = axis[1] * zc - axis[0] * cs[0];
+	r[2][2] = axis[2] * zc + cs[1];
+
+	int rows = kind == MATRIX_PROJECTIVE ? 4 : 3;
+	for (int i = 0; i < rows; i++) {
+		const float m0 = m[i][0], m1 = m[i][1], m2 = m[i][2];
+		m[i][0] = m0 * r[0][0] + m1 * r[1][0] + m2 * r[2][0];
+		m[i][1] = m0 * r[0][1] + m1 * r[1][1] + m2 * r[2][1];
+		m[i][2] = m0 * r[0][2] + m1 * r[1][2] + m2 * r[2][2];
+	}
+	return matrix_kind_combine(kind, MATRIX_RIGID);
+}
+
 // Transpose a matrix
 static inline __attribute__((always_inline)) void matrix2x2_transpose(matrix2x2 out, const matrix2x2 m) {
 	for (int i = 0; i < 2; i++) {
@@ -243,6 +331,76 @@ static inline __attribute__((always_inline)) int matrix4x4_invert(matrix4x4 out,
 	return 1;
 }
 
+// Invert a matrix of known kind
+static inline __attribute__((always_inline)) int matrix4x4_invert_kind(matrix4x4 out, const matrix4x4 in, uint8_t kind) {
+	switch (kind) {
+	case MATRIX_IDENTITY:
+		matrix4x4_identity(out);
+		return 1;
+	case MATRIX_TRANSLATION:
+		matrix4x4_identity(out);
+		out[0][3] = -in[0][3];
+		out[1][3] = -in[1][3];
+		out[2][3] = -in[2][3];
+		return 1;
+	case MATRIX_SCALE:
+		if (in[0][0] == 0.0f || in[1][1] == 0.0f || in[2][2] == 0.0f)
+			return 0;
+		vgl_memset(out, 0, sizeof(matrix4x4));
+		for (int i = 0; i < 3; i++) {
+			out[i][i] = 1.0f / in[i][i];
+			out[i][3] = -in[i][3] * out[i][i];
+		}
+		out[3][3] = 1.0f;
+		return 1;
+	case MATRIX_RIGID:
+		// The inverse of a rotation is its transpose
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++)
+				out[i][j] = in[j][i];
+			out[i][3] = -(in[0][i] * in[0][3] + in[1][i] * in[1][3] + in[2][i] * in[2][3]);
+		}
+		out[3][0] = out[3][1] = out[3][2] = 0.0f;
+		out[3][3] = 1.0f;
+		return 1;
+	default:
+		return matrix4x4_invert(out, in);
+	}
+}
+
+// Calculate the normal matrix (inverse transpose of the top left 3x3 block) of a matrix of known kind
+static inline __attribute__((always_inline)) void matrix4x4_normal_matrix_kind(matrix3x3 out, const matrix4x4 m, uint8_t kind) {
+	switch (kind) {
+	case MATRIX_IDENTITY:
+	case MATRIX_TRANSLATION:
+		vgl_memset(out, 0, sizeof(matrix3x3));
+		out[0][0] = out[1][1] = out[2][2] = 1.0f;
+		break;
+	case MATRIX_SCALE:
+		vgl_memset(out, 0, sizeof(matrix3x3));
+		out[0][0] = 1.0f / m[0][0];
+		out[1][1] = 1.0f / m[1][1];
+		out[2][2] = 1.0f / m[2][2];
+		break;
+	case MATRIX_RIGID:
+		// The inverse transpose of a rotation is the rotation itself
+		for (int i = 0; i < 3; i++) {
+			vgl_fast_memcpy(out[i], m[i], sizeof(float) * 3);
+		}
+		break;
+	default:
+		{
+			matrix3x3 inverted, top;
+			for (int i = 0; i < 3; i++) {
+				vgl_fast_memcpy(top[i], m[i], sizeof(float) * 3);
+			}
+			matrix3x3_invert(inverted, top);
+			matrix3x3_transpose(out, inverted);
+		}
+		break;
+	}
+}
+
 // Perform a matrix per vector moltiplication
 static inline __attribute__((always_inline)) void vector4f_matrix4x4_mult(vector4f *u, const matrix4x4 m, const vector4f *v) {
 	u->x = m[0][0] * v->x + m[0][1] * v->y + m[0][2] * v->z + m[0][3] * v->w;
@@ -695,6 +695,7 @@ void vgl_free(void *ptr) {
 }
 
 void *vgl_malloc(size_t size, vglMemType type) {
+	__atomic_fetch_add(&vgl_perf_counters.heap_allocs[type], 1, __ATOMIC_RELAXED); // Internal allocations may happen on the garbage collector and shaders compiler threads too
 	if (type == VGL_MEM_EXTERNAL)
 #ifdef HAVE_WRAPPED_ALLOCATORS
 		return __real_malloc(size);
@@ -716,6 +717,7 @@ void *vgl_malloc(size_t size, vglMemType type) {
 }
 
 void *vgl_calloc(size_t num, size_t size, vglMemType type) {
+	__atomic_fetch_add(&vgl_perf_counters.heap_allocs[type], 1, __ATOMIC_RELAXED);
 	if (type == VGL_MEM_EXTERNAL)
 #ifdef HAVE_WRAPPED_ALLOCATORS
 		return __real_calloc(num, size);
@@ -747,6 +749,7 @@ void *vgl_calloc(size_t num, size_t size, vglMemType type) {
 }
 
 void *vgl_memalign(size_t alignment, size_t size, vglMemType type) {
+	__atomic_fetch_add(&vgl_perf_counters.heap_allocs[type], 1, __ATOMIC_RELAXED);
 	if (type == VGL_MEM_EXTERNAL)
 #ifdef HAVE_WRAPPED_ALLOCATORS
 		return __real_memalign(alignment, size);
@@ -30,9 +30,11 @@
 #include <string.h>
 #define vgl_memset memset
 #define vgl_fast_memcpy memcpy
+#define vgl_memmove memmove
 #else
 #define vgl_memset sceClibMemset
 #define vgl_fast_memcpy sceClibMemcpy
+#define vgl_memmove sceClibMemmove
 #endif
 
 extern vglMemType VGL_MEM_MAIN; // Flag for VRAM usage for allocations
@@ -2,7 +2,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
-#include <list>
+#include <vector>
 #include <string>
 #include <stack>
 #include <limits.h>
@@ -30,11 +30,11 @@ namespace expression
         Node* child2;
     };
 
-    std::list<Token>::iterator ptok, pEnd;
+    std::vector<Token>::iterator ptok, pEnd;
     long long int eax, ecx;
     std::stack<long long int> stack;
     int g_lineno;
-    std::string g_fname;
+    const char* g_fname;
 
     Node* parse_exp();
 
@@ -621,13 +621,14 @@ namespace expression
 
     // ######################################################################
 
-    long long int evaluate(std::list<Token> line, std::string fname, int lineno)
+    long long int evaluate(std::vector<Token> line, const char* fname, int lineno)
     {
         g_fname = fname;
         g_lineno = lineno;
 
         Token semi;
         semi.type = SEMICOLON;
+        semi.id = NULL;
         line.push_back(semi);
 
         ptok = line.begin();
@@ -1,14 +1,15 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 struct Token
 {
     int type;
-    std::string id;
+    const char* id;     // interned in the per-run arena, so equal strings share the same pointer
 };
 
 namespace expression
 {
-    long long int evaluate(std::list<Token> line, std::string fname, int lineno);
+    long long int evaluate(std::vector<Token> line, const char* fname, int lineno);
 }
@@ -8,8 +8,9 @@
 #include <list>
 #include <string>
 #include <assert.h>
+#include <stdint.h>
 #include <algorithm>
-#include <set>
+#include <vector>
 #include <map>
 #include <stack>
 #include <time.h>
@@ -137,26 +138,299 @@ const char* names[] = {
 
 struct Var
 {
-    string name;
-    list<string> args;
-    list<Token> val;
+    const char* name;
+    vector<const char*> args;
+    vector<Token> val;
     bool functionLike;
+    bool hasHash;           // true if val uses # or ## so that stringized actuals are needed
 };
 
+// ######################################################################
+
+// ----------------------------------------------------------------------
+// Per-run arena. Every string held by a Token is interned here, so two tokens
+// with the same text share the same pointer and can be compared without strcmp.
+// All the memory is released at once at the end of a preprocess run
+// ----------------------------------------------------------------------
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+struct Atom
+{
+    const char* str;
+    uint32_t len;
+    uint32_t hash;
+};
+
+struct Arena
+{
+    vector<char*> blocks;
+    char* cur = NULL;
+    size_t left = 0;
+    vector<Atom> atoms;     // open addressing hash table of interned strings
+    uint32_t numAtoms = 0;
+
+    char* alloc(size_t sz)
+    {
+        if (sz > ARENA_BLOCK_SIZE / 4)   // big strings (eg the whole source for __FILE__) get their own block
+        {
+            char* p = (char*)malloc(sz);
+            blocks.push_back(p);
+            return p;
+        }
+        if (sz > left)
+        {
+            cur = (char*)malloc(ARENA_BLOCK_SIZE);
+            blocks.push_back(cur);
+            left = ARENA_BLOCK_SIZE;
+        }
+        char* p = cur;
+        cur += sz;
+        left -= sz;
+        return p;
+    }
+
+    void clear()
+    {
+        for (char* p : blocks)
+            free(p);
+        blocks.clear();
+        cur = NULL;
+        left = 0;
+        atoms.clear();
+        atoms.shrink_to_fit();
+        numAtoms = 0;
+    }
+};
+
+Arena g_arena;
+
+uint32_t hashStr(const char* s, size_t len)
+{
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// ----------------------------------------------------------------------
+// Return the unique, NULL terminated, copy of s[0,len) held by the arena
+// ----------------------------------------------------------------------
+
+const char* intern(const char* s, size_t len)
+{
+    if ((g_arena.numAtoms + 1) * 4 > g_arena.atoms.size() * 3)
+    {
+        vector<Atom> old;
+        old.swap(g_arena.atoms);
+        g_arena.atoms.assign(old.empty() ? 1024 : old.size() * 2, Atom{ NULL, 0, 0 });
+        uint32_t mask = g_arena.atoms.size() - 1;
+        for (const Atom& a : old)
+        {
+            if (a.str == NULL) continue;
+            uint32_t i = a.hash & mask;
+            while (g_arena.atoms[i].str != NULL)
+                i = (i + 1) & mask;
+            g_arena.atoms[i] = a;
+        }
+    }
+
+    uint32_t hash = hashStr(s, len);
+    uint32_t mask = g_arena.atoms.size() - 1;
+    uint32_t i = hash & mask;
+    while (g_arena.atoms[i].str != NULL)
+    {
+        Atom& a = g_arena.atoms[i];
+        if (a.hash == hash && a.len == len && memcmp(a.str, s, len) == 0)
+            return a.str;
+        i = (i + 1) & mask;
+    }
+
+    char* str = g_arena.alloc(len + 1);
+    memcpy(str, s, len);
+    str[len] = '\0';
+    g_arena.atoms[i] = Atom{ str, (uint32_t)len, hash };
+    g_arena.numAtoms++;
+    return str;
+}
+
+const char* intern(const string& s)
+{
+    return intern(s.c_str(), s.size());
+}
+
+// ----------------------------------------------------------------------
+// Identifiers the preprocessor looks for, interned at the beginning of every run
+// ----------------------------------------------------------------------
+
+struct
+{
+    const char* empty;
+    const char* defined;
+    const char* vaArgs;
+    const char* file;
+    const char* line;
+    const char* date;
+    const char* time;
+    const char* hasInclude;
+    const char* hasCppAttribute;
+    const char* once;
+    const char* pushMacro;
+    const char* popMacro;
+} g_atoms;
+
+void internAtoms()
+{
+    g_atoms.empty = intern("", 0);
+    g_atoms.defined = intern("defined");
+    g_atoms.vaArgs = intern("__VA_ARGS__");
+    g_atoms.file = intern("__FILE__");
+    g_atoms.line = intern("__LINE__");
+    g_atoms.date = intern("__DATE__");
+    g_atoms.time = intern("__TIME__");
+    g_atoms.hasInclude = intern("__has_include");
+    g_atoms.hasCppAttribute = intern("__has_cpp_attribute");
+    g_atoms.once = intern("once");
+    g_atoms.pushMacro = intern("push_macro");
+    g_atoms.popMacro = intern("pop_macro");
+}
+
+// ######################################################################
+
+// ----------------------------------------------------------------------
+// Macros list: flat open addressing hash table keyed by interned name.
+// Slots are never removed, #undef simply detaches the macro from its slot
+// ----------------------------------------------------------------------
+
+struct MacroSlot
+{
+    const char* name;
+    int var;                // index in storage, -1 if the macro is not defined
+};
+
+struct Macros
+{
+    vector<MacroSlot> slots;
+    vector<Var> storage;
+    uint32_t numSlots = 0;
+
+    static uint32_t hashPtr(const char* p)
+    {
+        uintptr_t v = (uintptr_t)p;
+        return (uint32_t)((v >> 3) * 2654435761u);
+    }
+
+    MacroSlot* slot(const char* name, bool create)
+    {
+        if (name == NULL) return NULL;
+        if (create && (numSlots + 1) * 2 > slots.size())
+        {
+            vector<MacroSlot> old;
+            old.swap(slots);
+            slots.assign(old.empty() ? 256 : old.size() * 2, MacroSlot{ NULL, -1 });
+            uint32_t mask = slots.size() - 1;
+            for (const MacroSlot& s : old)
+            {
+                if (s.name == NULL) continue;
+                uint32_t i = hashPtr(s.name) & mask;
+                while (slots[i].name != NULL)
+                    i = (i + 1) & mask;
+                slots[i] = s;
+            }
+        }
+        if (slots.empty()) return NULL;
+
+        uint32_t mask = slots.size() - 1;
+        uint32_t i = hashPtr(name) & mask;
+        while (slots[i].name != NULL)
+        {
+            if (slots[i].name == name) return &slots[i];
+            i = (i + 1) & mask;
+        }
+        if (!create) return NULL;
+
+        slots[i].name = name;
+        slots[i].var = -1;
+        numSlots++;
+        return &slots[i];
+    }
+
+    Var* find(const char* name)
+    {
+        MacroSlot* s = slot(name, false);
+        return (s && s->var >= 0) ? &storage[s->var] : NULL;
+    }
+
+    bool count(const char* name)
+    {
+        return find(name) != NULL;
+    }
+
+    // Pointers returned by find are invalidated by set
+    void set(const Var& var)
+    {
+        MacroSlot* s = slot(var.name, true);
+        if (s->var < 0)
+        {
+            s->var = storage.size();
+            storage.push_back(var);
+        }
+        else
+        {
+            storage[s->var] = var;
+        }
+    }
+
+    void erase(const char* name)
+    {
+        MacroSlot* s = slot(name, false);
+        if (s) s->var = -1;
+    }
+};
+
+// ######################################################################
+
+// ----------------------------------------------------------------------
+// Tokenised source: the tokens of all the lines are stored contiguously in toks
+// and each line is a range of it
+// ----------------------------------------------------------------------
+
+struct Line
+{
+    uint32_t first;
+    uint32_t size;
+};
+
+struct Lines
+{
+    vector<Token> toks;
+    vector<Line> lines;
+
+    const Token* begin(size_t i) const { return toks.data() + lines[i].first; }
+    const Token* end(size_t i) const { return toks.data() + lines[i].first + lines[i].size; }
+    uint32_t size(size_t i) const { return lines[i].size; }
+};
+
+enum { MODE_FULL, MODE_FLATTEN, MODE_DEPENDENCIES, MODE_LEX };
+
 const bool g_debug=false;
-string g_mode;
+int g_mode;
 string g_outstring;
 FILE* g_outfile;
 int g_lineno;
-string g_fname;
+const char* g_fname;
 bool g_hasIncludeSupported;
+bool g_isRcFile;
 
-list<string> g_blacklist;
-map<string, stack<Var>> g_stacks;      // for push/pop_macro
-map<string, string> g_attributeMap;    // for __has_cpp_attribute
+list<const char*> g_blacklist;
+map<const char*, stack<Var>> g_stacks;   // for push/pop_macro
+map<string, string> g_attributeMap;      // for __has_cpp_attribute
 
 // forward declaration
-void processFile(string fname, map<string,Var>& vars, const list<string>& includePaths, list<string>& included);
+void processFile(const char* fname, Macros& vars, const list<string>& includePaths, list<string>& included);
 
 #include <vitasdk.h>
 #include "../debug_utils.h"
@@ -172,43 +446,39 @@ void wrtError(string msg)
 // ######################################################################
 
 // ----------------------------------------------------------------------
-// Replace tokens in list of tokens "mylist" (in situ). Tokens in range [st,ed) are replaced by "replacement"
+// Replace tokens in vector of tokens "myvec" (in situ). Tokens in range [st,ed) are replaced by "replacement"
+// Return the index just after the inserted tokens
 // ----------------------------------------------------------------------
 
-void replace(list<Token> &mylist, list<Token>::iterator st, list<Token>::iterator ed, list<Token> replacement)
+size_t replace(vector<Token>& myvec, size_t st, size_t ed, const Token* replacement, size_t n)
 {
-    mylist.erase(st, ed);
-
-    if (ed == mylist.end())
+    size_t removed = ed - st;
+    if (n > removed)
     {
-        for (Token tok : replacement)
-            mylist.push_back(tok);
+        myvec.insert(myvec.begin() + ed, replacement + removed, replacement + n);
     }
-    else
+    else if (n < removed)
     {
-        for (Token tok : replacement)
-            mylist.insert(ed, tok);
+        myvec.erase(myvec.begin() + st + n, myvec.begin() + ed);
     }
+    copy(replacement, replacement + min(n, removed), myvec.begin() + st);
+    return st + n;
 }
 
 // ######################################################################
 
 // ----------------------------------------------------------------------
-// As above but replace with a single token
+// As above but replace with a vector of tokens or a single token
 // ----------------------------------------------------------------------
 
-void replace(list<Token>& mylist, list<Token>::iterator st, list<Token>::iterator ed, Token replacement)
+size_t replace(vector<Token>& myvec, size_t st, size_t ed, const vector<Token>& replacement)
 {
-    mylist.erase(st, ed);
+    return replace(myvec, st, ed, replacement.data(), replacement.size());
+}
 
-    if (ed == mylist.end())
-    {
-        mylist.push_back(replacement);
-    }
-    else
-    {
-        mylist.insert(ed, replacement);
-    }
+size_t replace(vector<Token>& myvec, size_t st, size_t ed, Token replacement)
+{
+    return replace(myvec, st, ed, &replacement, 1);
 }
 
 // ######################################################################
@@ -223,11 +493,13 @@ void replace(list<Token>& mylist, list<Token>::iterator st, list<Token>::iterato
 // ----------------------------------------------------------------------
 
 bool incomment = false;
+size_t tokLens[sizeof(tokNames) / sizeof(char*)];
 
 Token getTok(char* st, char** ed, bool *skipped)
 {
     int i, j;
     Token tok;
+    tok.id = NULL;
     *skipped = false;
 
     // ----------------------------------------------------------------------
@@ -295,14 +567,15 @@ Token getTok(char* st, char** ed, bool *skipped)
     // so #iffy would not be identified as #if + fy
     // ----------------------------------------------------------------------
 
-    for (j = 0; j < numToks; j++) 
+    for (j = 0; j < numToks; j++)
     {
-        size_t lentok = strlen(tokNames[j]);
+        if (*st != tokNames[j][0]) continue;
+        size_t lentok = tokLens[j];
         int puncTok = j < DEFINE;          // all previous are punctuation
         bool good = true;
-        for (i = 0; i < lentok; i++) 
+        for (i = 1; i < lentok; i++)
         {
-            if (*(st + i) != tokNames[j][i]) 
+            if (*(st + i) != tokNames[j][i])
             {
                 good = false;
                 break;
@@ -344,7 +617,7 @@ Token getTok(char* st, char** ed, bool *skipped)
             if (*p == '"' && !(*(p - 1) == '\\' && *(p - 2) != '\\'))
             {
                 size_t sz = p - st;
-                tok.id = string(st, sz);
+                tok.id = intern(st, sz);
                 tok.type = WSTRING;
                 *ed = p + 1;
                 return tok;
@@ -362,7 +635,7 @@ Token getTok(char* st, char** ed, bool *skipped)
             if (*p == '\'' && !(*(p - 1) == '\\' && *(p - 2) != '\\'))
             {
                 size_t sz = p - st;
-                tok.id = string(st, sz);
+                tok.id = intern(st, sz);
                 tok.type = WCHAR;
                 *ed = p + 1;
                 return tok;
@@ -380,7 +653,7 @@ Token getTok(char* st, char** ed, bool *skipped)
             if (*p == '"' && !(*(p - 1) == '\\' && *(p - 2) != '\\'))
             {
                 size_t sz = p - st;
-                tok.id = string(st, sz);
+                tok.id = intern(st, sz);
                 tok.type = STRING;
                 *ed = p + 1;
                 return tok;
@@ -393,12 +666,12 @@ Token getTok(char* st, char** ed, bool *skipped)
     {
         st++;
         char* p = st;
-        while (*p != '\0') 
+        while (*p != '\0')
         {
             if (*p == '\'' && !(*(p - 1) == '\\' && *(p - 2) != '\\'))
             {
                 size_t sz = p - st;
-                tok.id = string(st, sz);
+                tok.id = intern(st, sz);
                 tok.type = CHAR;
                 *ed = p + 1;
                 return tok;
@@ -424,7 +697,7 @@ Token getTok(char* st, char** ed, bool *skipped)
         *ed = p;
         tok.type = IDENTIFIER;
         size_t sz = *ed - st;
-        tok.id = string(st, sz);
+        tok.id = intern(st, sz);
         return tok;
     }
     else if (isdigit(*st))  // number
@@ -451,24 +724,24 @@ Token getTok(char* st, char** ed, bool *skipped)
         *ed = p;
         tok.type = NUMBER;
         size_t sz = *ed - st;
-        tok.id = string(st, sz);
+        tok.id = intern(st, sz);
         return tok;
     }
     else
     {
         throw string("Error could not parse token, ") + st + " (line " + to_string(g_lineno) + ", file " + g_fname + ")";
     }
-	
+
 	return tok;
 }
 
 // ######################################################################
 
 // ----------------------------------------------------------------------
-// Given a char array "buff", corresponding to a source line, get a list of Tokens
+// Given a char array "buff", corresponding to a source line, append its Tokens to "lines"
 // ----------------------------------------------------------------------
 
-list<Token> getTokLine(char* buff)
+void getTokLine(char* buff, Lines& lines)
 {
     char* st = buff;
     char* ed;
@@ -499,12 +772,14 @@ list<Token> getTokLine(char* buff)
             }
             break;
         }
-        else if (!isspace(*st)) 
+        else if (!isspace(*st))
             break;
     }
 
     st = buff;
-    list<Token> line;
+    Line line;
+    line.first = lines.toks.size();
+    line.size = 0;
 
     // ----------------------------------------------------------------------
     // Get tokens from this line until none are left. Distinguish between
@@ -513,136 +788,107 @@ list<Token> getTokLine(char* buff)
     // ----------------------------------------------------------------------
 
     bool skipped;
-    while (true) 
+    while (true)
     {
         Token tok = getTok(st, &ed, &skipped);
         if (tok.type == -1) break;
-        line.push_back(tok);
+        lines.toks.push_back(tok);
+        line.size++;
         st = ed;
-        if (line.size() == 3 && line.begin()->type == DEFINE && tok.type == OPEN_BRACKET && !skipped)
-            line.begin()->type = DEFINE_FUNC;
+        if (line.size == 3 && lines.toks[line.first].type == DEFINE && tok.type == OPEN_BRACKET && !skipped)
+            lines.toks[line.first].type = DEFINE_FUNC;
     }
 
-    return line;
+    lines.lines.push_back(line);
 }
 
 // ######################################################################
 
 // ----------------------------------------------------------------------
-// Write out a token depending on its type. Write a space after the token
+// Append a token to a string depending on its type
 // ----------------------------------------------------------------------
 
-void writeTok(Token tok)
+void appendTok(string& str, const Token& tok)
 {
-    if (tok.type == IDENTIFIER || tok.type==NUMBER)
+    if (tok.type == IDENTIFIER || tok.type == NUMBER)
     {
-        fprintf(g_outfile, "%s", tok.id.c_str());
+        str += tok.id;
     }
     else if (tok.type == STRING)
     {
-        fprintf(g_outfile, "\"%s\"", tok.id.c_str());
+        str += '"';
+        str += tok.id;
+        str += '"';
     }
     else if (tok.type == CHAR)
     {
-        fprintf(g_outfile, "'%s'", tok.id.c_str());
+        str += '\'';
+        str += tok.id;
+        str += '\'';
     }
     else if (tok.type == WSTRING)
     {
-        fprintf(g_outfile, "L\"%s\"", tok.id.c_str());
+        str += "L\"";
+        str += tok.id;
+        str += '"';
     }
     else if (tok.type == WCHAR)
     {
-        fprintf(g_outfile, "L'%s'", tok.id.c_str());
+        str += "L'";
+        str += tok.id;
+        str += '\'';
     }
     else if (tok.type == HASH)
     {
-        fprintf(g_outfile, "#");
+        str += '#';
     }
     else if (tok.type == DEFINE_FUNC)
     {
-        fprintf(g_outfile, "#define");
+        str += "#define";
     }
     else
     {
-        fprintf(g_outfile, "%s", tokNames[tok.type]);
+        str += tokNames[tok.type];
     }
 }
 
 // ######################################################################
 
 // ----------------------------------------------------------------------
-// As writeTok but create a string from token
+// As appendTok but create a string from token
 // ----------------------------------------------------------------------
 
-string tok2Str(Token tok)
+string tok2Str(const Token& tok)
 {
-    if (tok.type == IDENTIFIER || tok.type == NUMBER)
-    {
-        return tok.id;
-    }
-    else if (tok.type == STRING)
-    {
-        return "\"" + tok.id + "\"";
-    }
-    else if (tok.type == CHAR)
-    {
-        return "'" + tok.id + "'";
-    }
-    else if (tok.type == WSTRING)
-    {
-        return "L\"" + tok.id + "\"";
-    }
-    else if (tok.type == WCHAR)
-    {
-        return "L'" + tok.id + "'";
-    }
-    else if (tok.type == HASH)
-    {
-        return "#";
-    }
-    else if (tok.type == DEFINE_FUNC)
-    {
-        return "#define";
-    }
-    else
-    {
-        return tokNames[tok.type];
-    }
+    string str;
+    appendTok(str, tok);
+    return str;
 }
 
 // ######################################################################
 
 // ----------------------------------------------------------------------
-// turn tok into string, including when token is an arg with actuals given as tokens of type STRING
+// turn tok into string, including when token is an arg with actuals given as stringized strings
 // eg with args "x","y"
-// and stringActuals "1","2", 
+// and stringActuals "1","2",
 // x is converted to "1"
-// If the token is not an arg, use tok2Str to convert
+// If the token is not an arg, use appendTok to convert
 // ----------------------------------------------------------------------
 
-string tok2StrArgs(Token tok, list<Token> stringActuals, list<string> args)
+void appendTokArgs(string& str, const Token& tok, const vector<const char*>& stringActuals, const vector<const char*>& args)
 {
-    bool found = false;
-    string str;
     if (tok.type == IDENTIFIER)
     {
-        auto itStringActuals = stringActuals.begin();
-        for (string arg : args)
+        for (size_t i = 0; i < args.size(); i++)
         {
-            if (tok.id == arg)
+            if (tok.id == args[i])
             {
-                str = itStringActuals->id;
-                found = true;
-                break;
+                str += stringActuals[i];
+                return;
             }
-            itStringActuals++;
         }
     }
-    if (!found)
-    {
-        str = tok2Str(tok);
-    }
-    return str;
+    appendTok(str, tok);
 }
 
 // ######################################################################
@@ -651,97 +897,88 @@ string tok2StrArgs(Token tok, list<Token> stringActuals, list<string> args)
 // Either write a line of tokens out to g_outfile or concat them to string g_outstring
 // ----------------------------------------------------------------------
 
-void writeLine(list<Token> line)
+void writeLine(const Token* line, size_t n)
 {
+    string local;
+    string& str = g_outfile == NULL ? g_outstring : local;
 
-    string str = "";
-
-    if (line.empty())
-    { 
+    if (n == 0)
+    {
     }
-    else if (line.front().type == DEFINE_FUNC)   // #define foo( x , y ) x + y
+    else if (line[0].type == DEFINE_FUNC)   // #define foo( x , y ) x + y
     {
-        auto it = line.begin();
-
         str += "#define ";
-        it++;
-
-        str += tok2Str(*it); // func name
-        it++;
+        appendTok(str, line[1]); // func name
+        appendTok(str, line[2]); // open bracket
 
-        str += tok2Str(*it); // open bracket
-        it++;
-
-        for (; it != line.end(); it++)
+        for (size_t i = 3; i < n; i++)
         {
-            str += (" " + tok2Str(*it));
+            str += ' ';
+            appendTok(str, line[i]);
         }
     }
     else
     {
-        Token prev;
-        prev.type = -1;
-        for (Token tok : line)
+        int prev = -1;
+        for (size_t i = 0; i < n; i++)
         {
-            if (!(tok.type < 52)) {
-                if (prev.type != -1 && (!(prev.type < 52)))
-                    str += " ";
+            if (!(line[i].type < 52)) {
+                if (prev != -1 && (!(prev < 52)))
+                    str += ' ';
             }
 
-            str += tok2Str(tok);
-            prev = tok;
+            appendTok(str, line[i]);
+            prev = line[i].type;
         }
     }
     str += '\n';
 
-    if (g_outfile == NULL)
-    {
-        g_outstring += str;
-    }
-    else
+    if (g_outfile != NULL)
     {
         fprintf(g_outfile, "%s", str.c_str());
     }
+}
 
-    /*
-    if (g_outfile == NULL)
-    {
-        Token prev;
-        prev.type = -1;
-        for (Token tok : line)
-        {
-            if (prev.type != -1)
-                g_outstring += " ";
+void writeLine(const vector<Token>& line)
+{
+    writeLine(line.data(), line.size());
+}
 
-            g_outstring += tok2Str(tok);
-            prev = tok;
-        }
-        g_outstring += '\n';
-    }
-    else
+// ######################################################################
+
+// ----------------------------------------------------------------------
+// Check if a macro is in the list of macros currently being expanded
+// ----------------------------------------------------------------------
+
+bool isUsed(const vector<const char*>& used, const char* name)
+{
+    for (const char* u : used)
     {
-        Token prev;
-        prev.type = -1;
-        for (Token tok : line)
-        {
-            if (prev.type != -1)
-                fprintf(g_outfile, " ");
+        if (u == name) return true;
+    }
+    return false;
+}
 
-            if (tok.type == DEFINE_FUNC)
-                fprintf(g_outfile, "#define");
-            else
-                writeTok(tok);
-            prev = tok;
-        }
-        fprintf(g_outfile, "\n");
+// ######################################################################
+
+// ----------------------------------------------------------------------
+// Check if a line of tokens references any macro, so that lines with nothing
+// to expand can be written out without being copied
+// ----------------------------------------------------------------------
+
+bool needsExpansion(const Token* st, const Token* ed, Macros& vars)
+{
+    for (const Token* tok = st; tok != ed; tok++)
+    {
+        if (tok->type == IDENTIFIER && vars.count(tok->id)) return true;
     }
-    */
+    return false;
 }
 
 // ######################################################################
 
 // ----------------------------------------------------------------------
-// Expand "line" (a list of tokens) in situ based on "vars", the list of macros (function and object-like) currently defined
+// Expand "line" (a vector of tokens) in situ based on "vars", the list of macros (function and object-like) currently defined
 // Eg a line might be:
 // int fib(int n) { qprint("%d%d%d",1,2,3); return min(n,1); }
 // and our vars list might contain:
@@ -749,47 +986,39 @@ void writeLine(list<Token> line)
 // foo := [(1 + 2 - 3)]
 // min(x,y) := (x)<(y) ? (x):(y)
 // qprint(format, __VA_ARGS__) := printf(format, __VA_ARGS__)
-// used is a set of macros which have already been expanded so can't be expanded again
-// (to avoid runaway recursion when this function calls itself)
+// used is a stack of macros which are being expanded so can't be expanded again
+// (to avoid runaway recursion when this function calls itself). It's restored before returning
 // return true if expansion succeeded or false if mismatched brackets when expanding a function-like macro
 // ----------------------------------------------------------------------
 
-bool expand(list<Token>& line, map<string,Var>& vars, set<string> used)
+bool expand(vector<Token>& line, Macros& vars, vector<const char*>& used)
 {
-    set<string> used2;
-    auto it_tok = line.begin();
-    while (it_tok != line.end())
+    size_t it_tok = 0;
+    while (it_tok < line.size())
     {
-        used2 = used;   // we will append on to the used list which was given to us
-
         // Get a tok out of the line (eg fib)
-        Token tok = *it_tok;
+        Token tok = line[it_tok];
 
         bool found = false;
 
         // Is this tok an identifier? If so we might be able to replace it
-        if (tok.type == IDENTIFIER && used.count(tok.id)==0)
+        if (tok.type == IDENTIFIER && !isUsed(used, tok.id))
         {
             // ----------------------------------------------------------------------
             // Search the vars list to find a macro (object or function) with the same name as the token
             // ----------------------------------------------------------------------
 
-            list<Token> lineReplace;
-            Var varToReplace;
-
-            auto pvar = vars.find(tok.id);
-            if (pvar != vars.end())
-            {
-                varToReplace = pvar->second;
-                lineReplace = varToReplace.val;
-                found = true;
-            }
+            Var* varToReplace = vars.find(tok.id);
+            found = varToReplace != NULL;
 
             if (found)
             {
-                auto st = it_tok;
-                auto ed = it_tok;
-                ed++;               // for object-like ed is just st+1. For function-like, ed could be higher
+                // The macro value is only copied when it has to be altered (arguments substitution or nested expansion)
+                const vector<Token>* replacement = &varToReplace->val;
+                vector<Token> lineReplace;
+
+                size_t st = it_tok;
+                size_t ed = it_tok + 1;     // for object-like ed is just st+1. For function-like, ed could be higher
 
                 // ----------------------------------------------------------------------
                 // Is the macro a function-like macro? Is it being called with an arg list in brackets eg fib(1,2,3)?
@@ -797,54 +1026,57 @@ bool expand(list<Token>& line, map<string,Var>& vars, set<string> used)
                 // ----------------------------------------------------------------------
 
                 bool functionLikeExpanded = false;
-                if (varToReplace.functionLike && ed != line.end() && ed->type == OPEN_BRACKET)
+                if (varToReplace->functionLike && ed < line.size() && line[ed].type == OPEN_BRACKET)
                 {
+                    const vector<const char*>& args = varToReplace->args;
+
                     // ----------------------------------------------------------------------
-                    // Prepare a list of actual arguments being used
+                    // Prepare a list of actual arguments being used, as ranges of line
                     // min(abc,1*(2+3))  actuals are abc and 1*(2+3)
                     // min(a)            actuals has one member: a
                     // min()             actuals is empty list
                     // ----------------------------------------------------------------------
 
-                    list<list<Token>> actuals;
-                    list<Token> actual;
+                    vector<Line> actuals;
                     ed++;
-                    if (ed == line.end()) return false;  // mismatched
+                    if (ed == line.size()) return false;  // mismatched
 
-                    if (ed->type == CLOSE_BRACKET)  // special case, no actual args, actuals is empty
+                    if (line[ed].type == CLOSE_BRACKET)  // special case, no actual args, actuals is empty
                     {
                         ed++;
                     }
                     else  // at least one actual arg
                     {
                         int level = 0;
-                        bool vararg = (varToReplace.args.back() == "__VA_ARGS__");
-                        size_t nargs = varToReplace.args.size();
-                        int iarg = 0;
+                        bool vararg = !args.empty() && args.back() == g_atoms.vaArgs;
+                        size_t nargs = args.size();
+                        size_t iarg = 0;
+                        Line actual = { (uint32_t)ed, 0 };
 
-                        while (!(ed->type == CLOSE_BRACKET && level == 0))
+                        while (!(line[ed].type == CLOSE_BRACKET && level == 0))
                         {
-                            if (ed->type == OPEN_BRACKET) level++;
-                            if (ed->type == CLOSE_BRACKET) level--;
+                            if (line[ed].type == OPEN_BRACKET) level++;
+                            if (line[ed].type == CLOSE_BRACKET) level--;
 
-                            if (ed->type == COMMA && level == 0 && !(vararg && iarg == nargs - 1))
+                            if (line[ed].type == COMMA && level == 0 && !(vararg && iarg == nargs - 1))
                             {
                                 actuals.push_back(actual);
-                                actual.clear();
+                                actual.first = ed + 1;
+                                actual.size = 0;
                                 iarg++;
                             }
                             else
                             {
-                                actual.push_back(*ed);
+                                actual.size++;
                             }
                             ed++;
-                            if (ed == line.end()) return false;
+                            if (ed == line.size()) return false;
                         }
                         actuals.push_back(actual);
                         ed++;
                     }
 
-                    if (actuals.size() != varToReplace.args.size())
+                    if (actuals.size() != args.size())
                     {
                         wrtError("Error: wrong number of arguments for function-like macro invocation");
                     }
@@ -855,90 +1087,90 @@ bool expand(list<Token>& line, map<string,Var>& vars, set<string> used)
                     // We will use expanded arguments except for stringization # or concatenation ##
                     // ----------------------------------------------------------------------
 
-                    list<list<Token>> expandedActuals;
-                    for (auto actual : actuals)
+                    vector<vector<Token>> expandedActuals(actuals.size());
+                    for (size_t i = 0; i < actuals.size(); i++)
                     {
-                        expandedActuals.push_back(actual);
+                        const Token* first = line.data() + actuals[i].first;
+                        expandedActuals[i].assign(first, first + actuals[i].size);
+                        expand(expandedActuals[i], vars, used);
                     }
 
-                    for (auto& expandedActual : expandedActuals)
-                        expand(expandedActual, vars, used2);
-
-                    list<Token> stringActuals;
-                    for (auto actual : actuals)
+                    vector<const char*> stringActuals;
+                    if (varToReplace->hasHash)
                     {
                         string str;
-                        Token prev; prev.type = -1;
-                        for (Token tok : actual)
+                        for (const Line& actual : actuals)
                         {
-                            if (prev.type != -1)
-                                str += " ";
-                            str += tok2Str(tok);
-                            prev = tok;
+                            str.clear();
+                            for (uint32_t i = 0; i < actual.size; i++)
+                            {
+                                if (i > 0)
+                                    str += ' ';
+                                appendTok(str, line[actual.first + i]);
+                            }
+                            stringActuals.push_back(intern(str));
                         }
-                        Token tok;
-                        tok.type = STRING;
-                        tok.id = str;
-                        stringActuals.push_back(tok);
                     }
 
                     // ----------------------------------------------------------------------
                     // go over lineReplace, eg (x)<(y) ? (x):(y) and replace args (eg x,y) with actual values
                     // ----------------------------------------------------------------------
 
-                    auto it = lineReplace.begin();
-                    while (it != lineReplace.end())
+                    lineReplace = varToReplace->val;
+                    replacement = &lineReplace;
+                    size_t it = 0;
+                    while (it < lineReplace.size())
                     {
-                        auto it1 = next(it);
-                        if (it1 != lineReplace.end() && it1->type == HASH2)
+                        size_t it1 = it + 1;
+                        if (it1 < lineReplace.size() && lineReplace[it1].type == HASH2)
                         {
                             // min(x,y) x##y##z  1##2 X_ ## x
                             // min(1,2)
 
-                            string str = tok2StrArgs(*it, stringActuals, varToReplace.args);
+                            string str;
+                            appendTokArgs(str, lineReplace[it], stringActuals, args);
                             do
                             {
                                 it1++;
-                                if (it1 == lineReplace.end()) wrtError("## cannot be at end of line");
-                                str += tok2StrArgs(*it1, stringActuals, varToReplace.args);
+                                if (it1 == lineReplace.size()) wrtError("## cannot be at end of line");
+                                appendTokArgs(str, lineReplace[it1], stringActuals, args);
                                 it1++;
-                            } while (it1 != lineReplace.end() && it1->type == HASH2);
+                            } while (it1 < lineReplace.size() && lineReplace[it1].type == HASH2);
 
                             char* ed;
                             bool skipped;
                             Token tok = getTok(const_cast<char*>(str.c_str()), &ed, &skipped);  // TODO: create multiple tokens for concated string?
-                            replace(lineReplace, it, it1, tok);
+                            it1 = replace(lineReplace, it, it1, tok);
                         }
-                        else if (it->type == IDENTIFIER)   // eg it points to the first x
+                        else if (lineReplace[it].type == IDENTIFIER)   // eg it points to the first x
                         {
-                            auto itExpandedActuals = expandedActuals.begin();
-                            for (auto arg : varToReplace.args)    // is x one of the args of function min?
+                            for (size_t i = 0; i < args.size(); i++)    // is x one of the args of function min?
                             {
-                                if (it->id == arg)
+                                if (lineReplace[it].id == args[i])
                                 {
-                                    replace(lineReplace, it, it1, *itExpandedActuals);
+                                    it1 = replace(lineReplace, it, it1, expandedActuals[i]);
                                     break;
                                 }
-                                itExpandedActuals++;
                             }
                         }
-                        else if (it->type == HASH)
+                        else if (lineReplace[it].type == HASH)
                         {
-                            if (it1->type != IDENTIFIER) wrtError("# must be followed by variable");
+                            if (it1 == lineReplace.size() || lineReplace[it1].type != IDENTIFIER) wrtError("# must be followed by variable");
 
-                            string name = it1->id;
+                            const char* name = lineReplace[it1].id;
                             it1++;
-                            auto itStringActuals = stringActuals.begin();
                             bool found = false;
-                            for (auto arg : varToReplace.args)    // is x one of the args of function min?
+                            for (size_t i = 0; i < args.size(); i++)    // is x one of the args of function min?
                             {
-                                if (name == arg)
+                                if (name == args[i])
                                 {
-                                    replace(lineReplace, it, it1, *itStringActuals);
+                                    Token str;
+                                    str.type = STRING;
+                                    str.id = stringActuals[i];
+                                    it1 = replace(lineReplace, it, it1, str);
                                     found = true;
                                     break;
                                 }
-                                itStringActuals++;
                             }
                             if (!found) wrtError("# must be followed by argument");
                         }
@@ -952,22 +1184,30 @@ bool expand(list<Token>& line, map<string,Var>& vars, set<string> used)
                 // But don't replace if functionLike macro being referenced without an argument list specified
                 // ----------------------------------------------------------------------
 
-                if (!(varToReplace.functionLike && !functionLikeExpanded))
+                if (!(varToReplace->functionLike && !functionLikeExpanded))
                 {
-                    used2.insert(varToReplace.name);    // we're about to use this var so don't use it again when calling recursively
-                    expand(lineReplace, vars, used2);   // recursive: get lineReplace fully expanded
-                    replace(line, st, ed, lineReplace); // macro replaced with its value
+                    if (needsExpansion(replacement->data(), replacement->data() + replacement->size(), vars))
+                    {
+                        if (replacement != &lineReplace)
+                        {
+                            lineReplace = *replacement;
+                            replacement = &lineReplace;
+                        }
+                        used.push_back(varToReplace->name);  // we're about to use this var so don't use it again when calling recursively
+                        expand(lineReplace, vars, used);     // recursive: get lineReplace fully expanded
+                        used.pop_back();
+                    }
+                    ed = replace(line, st, ed, *replacement); // macro replaced with its value
                 }
                 it_tok = ed;  // continue from just above where we inserted stuff
 
-                if (ed!=line.end() && ed->type == OPEN_BRACKET)  // ... there's one exception: If we paste in a function-like macro name
-                {                                                // and it's followed by an open bracket, then, expand as macro call
-                    auto prev = ed;
-                    prev--;
-                    if (prev->type == IDENTIFIER)
+                if (ed < line.size() && ed > 0 && line[ed].type == OPEN_BRACKET)  // ... there's one exception: If we paste in a function-like macro name
+                {                                                                  // and it's followed by an open bracket, then, expand as macro call
+                    size_t prev = ed - 1;
+                    if (line[prev].type == IDENTIFIER)
                     {
-                        auto p=vars.find(prev->id);
-                        if (p != vars.end() && p->second.functionLike) it_tok = prev;
+                        Var* p = vars.find(line[prev].id);
+                        if (p != NULL && p->functionLike) it_tok = prev;
                     }
                 }
             }
@@ -977,6 +1217,12 @@ bool expand(list<Token>& line, map<string,Var>& vars, set<string> used)
     return true;
 }
 
+bool expand(vector<Token>& line, Macros& vars)
+{
+    vector<const char*> used;
+    return expand(line, vars, used);
+}
+
 // ######################################################################
 
 // ----------------------------------------------------------------------
@@ -1026,128 +1272,122 @@ string findIncludeFile(string file, string include, const list<string>& includeP
 // ######################################################################
 
 // ----------------------------------------------------------------------
-// evaluate "defined", "__has_cpp_attribute" and "__has_include" to numbers 
+// evaluate "defined", "__has_cpp_attribute" and "__has_include" to numbers
 // (0, 1 or version) in an if expression
 // ----------------------------------------------------------------------
 
-void expandIfFuncs(list<Token>& line, map<string, Var>& vars, const list<string>& includePaths)
+void expandIfFuncs(vector<Token>& line, Macros& vars, const list<string>& includePaths)
 {
     Token tok;
     tok.type = NUMBER;
 
-    for (auto it = line.begin(); it != line.end();)
+    for (size_t it = 0; it < line.size();)
     {
-        if (it->type == IDENTIFIER && it->id == "defined")
+        if (line[it].type == IDENTIFIER && line[it].id == g_atoms.defined)
         {
-            auto ed = it;
-            ed++;
+            size_t ed = it + 1;
 
-            if (ed == line.end())
+            if (ed == line.size())
             {
                 wrtError("unexpected end of line when processing defined");
             }
 
-            string name;
-            if (ed->type == IDENTIFIER || ed->type==NOEXPAND)
+            const char* name = NULL;
+            if (line[ed].type == IDENTIFIER || line[ed].type==NOEXPAND)
             {
-                name = ed->id;
+                name = line[ed].id;
                 ed++;
             }
-            else if (ed->type == OPEN_BRACKET)
+            else if (line[ed].type == OPEN_BRACKET)
             {
                 ed++;
-                if (ed->type != IDENTIFIER && ed->type!=NOEXPAND) wrtError("defined bad, expecting identifier");
-                name = ed->id;
+                if (ed == line.size() || (line[ed].type != IDENTIFIER && line[ed].type!=NOEXPAND)) wrtError("defined bad, expecting identifier");
+                name = line[ed].id;
                 ed++;
-                if (ed->type != CLOSE_BRACKET) wrtError("expected ) on defined");
+                if (ed == line.size() || line[ed].type != CLOSE_BRACKET) wrtError("expected ) on defined");
                 ed++;
             }
             else
                 wrtError("defined must specify a macro");
 
-            tok.id = "0";
+            tok.id = intern("0", 1);
 
             // __has_cpp_attribute and __has_include flagged as defined if set
-            if ((name == "__has_cpp_attribute" && !g_attributeMap.empty()) || (name == "__has_include" && g_hasIncludeSupported) || vars.count(name) > 0)
+            if ((name == g_atoms.hasCppAttribute && !g_attributeMap.empty()) || (name == g_atoms.hasInclude && g_hasIncludeSupported) || vars.count(name))
             {
-                tok.id = "1";
+                tok.id = intern("1", 1);
             }
 
-            replace(line, it, ed, tok);
-            it = ed;
+            it = replace(line, it, ed, tok);
         }
-        else if (it->type == IDENTIFIER && it->id == "__has_include" && g_hasIncludeSupported)
+        else if (line[it].type == IDENTIFIER && line[it].id == g_atoms.hasInclude && g_hasIncludeSupported)
         {
-            auto ed = it;
-            ed++;
+            size_t ed = it + 1;
 
-            if (ed == line.end() || ed->type != OPEN_BRACKET)
+            if (ed == line.size() || line[ed].type != OPEN_BRACKET)
             {
                 wrtError("Malformed __has_include");
             }
             ed++;
 
-            if (ed->type != LESSTHAN)
+            if (ed == line.size() || line[ed].type != LESSTHAN)
             {
                 throw string("Weird __has_include, expected <");
             }
             ed++;
 
             string include;
-            while (ed->type != GREATERTHAN)
+            while (ed < line.size() && line[ed].type != GREATERTHAN)
             {
-                include += tok2Str(*ed);
+                appendTok(include, line[ed]);
                 ed++;
             }
             ed++;
 
-            if (ed->type != CLOSE_BRACKET)
+            if (ed >= line.size() || line[ed].type != CLOSE_BRACKET)
                 throw string("Weird __has_include, expected )");
             ed++;
 
-            tok.id = "1";
+            tok.id = intern("1", 1);
             try
             {
                 findIncludeFile("", include, includePaths, false);  // throws if include file not found
             }
             catch (string)
             {
-                tok.id = "0";   // include file not found
+                tok.id = intern("0", 1);   // include file not found
             }
 
-            replace(line, it, ed, tok);
-            it = ed;
+            it = replace(line, it, ed, tok);
         }
-        else if (it->type == IDENTIFIER && it->id == "__has_cpp_attribute" && !g_attributeMap.empty())
+        else if (line[it].type == IDENTIFIER && line[it].id == g_atoms.hasCppAttribute && !g_attributeMap.empty())
         {
-            auto ed = it;
-            ed++;
+            size_t ed = it + 1;
 
-            if (ed == line.end() || ed->type != OPEN_BRACKET)
+            if (ed == line.size() || line[ed].type != OPEN_BRACKET)
             {
                 wrtError("Malformed __has_cpp_attribute");
             }
             ed++;
 
-            if (ed == line.end() || ed->type != IDENTIFIER)
+            if (ed == line.size() || line[ed].type != IDENTIFIER)
             {
                 wrtError("Malformed __has_cpp_attribute, expected identifier");
             }
-            string id = ed->id;
+            string id = line[ed].id;
             ed++;
 
-            if (ed == line.end() || ed->type != CLOSE_BRACKET)
+            if (ed == line.size() || line[ed].type != CLOSE_BRACKET)
             {
                 wrtError("Malformed __has_cpp_attribute, expected )");
             }
             ed++;
 
-            tok.id = "0";
+            tok.id = intern("0", 1);
             if (g_attributeMap.find(id) != g_attributeMap.end())
-                tok.id = g_attributeMap[id];
+                tok.id = intern(g_attributeMap[id]);
 
-            replace(line, it, ed, tok);
-            it = ed;
+            it = replace(line, it, ed, tok);
         }
         else
             it++;
@@ -1164,10 +1404,10 @@ void expandIfFuncs(list<Token>& line, map<string, Var>& vars, const list<string>
 // Once this function has run we can use expression::evaluate to see if condition is true
 // ----------------------------------------------------------------------
 
-void expandIf(list<Token>& line, map<string,Var>& vars, const list<string>& includePaths)
+void expandIf(vector<Token>& line, Macros& vars, const list<string>& includePaths)
 {
     expandIfFuncs(line, vars, includePaths);
-    expand(line, vars, set<string>());
+    expand(line, vars);
     expandIfFuncs(line, vars, includePaths);
 
     for (Token& tok : line)
@@ -1175,7 +1415,7 @@ void expandIf(list<Token>& line, map<string,Var>& vars, const list<string>& incl
         if (tok.type == IDENTIFIER)   // not a macro, replace with 0
         {
             tok.type = NUMBER;
-            tok.id = "0";
+            tok.id = intern("0", 1);
         }
     }
 }
@@ -1189,32 +1429,35 @@ void expandIf(list<Token>& line, map<string,Var>& vars, const list<string>& incl
 // would be mismatched if add is a function-like macro (the first add is OK)
 // ----------------------------------------------------------------------
 
-bool mismatched(list<Token> &line, map<string,Var> &vars)
+bool mismatched(const vector<Token> &line, Macros &vars)
 {
     if (line.empty()) return false;
 
-    auto it = line.begin();
-    while (it != line.end())
+    size_t it = 0;
+    while (it < line.size())
     {
-        auto it2 = it;
-        it2++;
+        size_t it2 = it + 1;
 
-        if (it2 == line.end()) break;
+        if (it2 == line.size()) break;
 
-        if (it2->type == OPEN_BRACKET && it->type == IDENTIFIER && vars.count(it->id) > 0 && vars[it->id].functionLike)
+        if (line[it2].type == OPEN_BRACKET && line[it].type == IDENTIFIER)
         {
-            it2++;
-            if (it2 == line.end()) return true;
-
-            int level = 0;
-            while (!(it2->type == CLOSE_BRACKET && level==0))
+            Var* var = vars.find(line[it].id);
+            if (var != NULL && var->functionLike)
             {
-                if (it2->type == OPEN_BRACKET) level++;
-                if (it2->type == CLOSE_BRACKET) level--;
                 it2++;
-                if (it2 == line.end()) return true;
+                if (it2 == line.size()) return true;
+
+                int level = 0;
+                while (!(line[it2].type == CLOSE_BRACKET && level==0))
+                {
+                    if (line[it2].type == OPEN_BRACKET) level++;
+                    if (line[it2].type == CLOSE_BRACKET) level--;
+                    it2++;
+                    if (it2 == line.size()) return true;
+                }
+                it2++;
             }
-            it2++;
         }
         it = it2;
     }
@@ -1227,10 +1470,18 @@ bool mismatched(list<Token> &line, map<string,Var> &vars)
 // set __FILE__ and __LINE__ macros (and g_fname and g_lineno)
 // ----------------------------------------------------------------------
 
-void setLineFile(int lineno, string fname, map<string, Var>& vars)
+void setLineFile(int lineno, const char* fname, Macros& vars)
 {
-    vars["__FILE__"].val.front().id = fname;
-    vars["__LINE__"].val.front().id = to_string(lineno);
+    Var* var = vars.find(g_atoms.file);
+    if (var != NULL && !var->val.empty())
+        var->val.front().id = fname;
+
+    var = vars.find(g_atoms.line);
+    if (var != NULL && !var->val.empty())
+    {
+        char num[16];
+        var->val.front().id = intern(num, sprintf(num, "%d", lineno));
+    }
 
     g_lineno = lineno;
     g_fname = fname;
@@ -1240,57 +1491,71 @@ void setLineFile(int lineno, string fname, map<string, Var>& vars)
 
 // ----------------------------------------------------------------------
 // If a macro value contains the "defined" function, set its argument
-// to be type NOEXPAND. Eg 
+// to be type NOEXPAND. Eg
 // #define foo defined(bar) && version>0
 // #if foo...
 // When we expand the if, the "bar" argument of defined should be left alone
 // expandIfFuncs will then set the defined to 1 or 0
 // ----------------------------------------------------------------------
 
-void preventDefinedExpand(list<Token> &val)
+void preventDefinedExpand(vector<Token> &val)
 {
-    for (auto it = val.begin(); it != val.end(); it++)
+    for (size_t it = 0; it < val.size(); it++)
     {
-        if (it->type == IDENTIFIER && it->id == "defined")
+        if (val[it].type == IDENTIFIER && val[it].id == g_atoms.defined)
         {
-            auto it2 = it;
-            it2++;
-            if (it2 == val.end()) return;
-            if (it2->type == IDENTIFIER)
+            size_t it2 = it + 1;
+            if (it2 == val.size()) return;
+            if (val[it2].type == IDENTIFIER)
             {
-                it2->type = NOEXPAND;
+                val[it2].type = NOEXPAND;
             }
             it2++;
-            if (it2 == val.end()) return;
-            if (it2->type == IDENTIFIER)
+            if (it2 == val.size()) return;
+            if (val[it2].type == IDENTIFIER)
             {
-                it2->type = NOEXPAND;
+                val[it2].type = NOEXPAND;
             }
         }
     }
 }
 
+// ----------------------------------------------------------------------
+// Check if a macro value uses stringization # or concatenation ##
+// ----------------------------------------------------------------------
+
+bool hasHash(const vector<Token> &val)
+{
+    for (const Token& tok : val)
+    {
+        if (tok.type == HASH || tok.type == HASH2) return true;
+    }
+    return false;
+}
+
 // ######################################################################
 
 // ----------------------------------------------------------------------
 // Process a line of tokens and write the (expanded) line to g_outfile (or add to g_outstring if g_outfile="")
 // Note that a "line" might consist of an entire #if..#endif block (which is made of lines, hence recursive)
-// it_line points to the line to be written and we will increase this, normally by 1, but perhaps more in the case of if block
+// it_line is the index of the line to be written in "lines" and we will increase this, normally by 1, but perhaps more in the case of if block
 // vars is the macro list which we might alter (define, undef). Wrt tells us whether to actually write the line
 // (it will be false if we are in an inactive branch of an if)
 // This function also indirectly calls itself via processFile (in the case of include)
 // ----------------------------------------------------------------------
 
-void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, const list<string> &includePaths, list<string> &included, string fname, int &lineno, bool wrt)
+void processLine(const Lines &lines, size_t &it_line, Macros &vars, const list<string> &includePaths, list<string> &included, const char* fname, int &lineno, bool wrt)
 {
-    list<Token> line = *it_line;
+    const Token* line = lines.begin(it_line);
+    const Token* lineEnd = lines.end(it_line);
+    size_t lineSize = lines.size(it_line);
     setLineFile(lineno, fname, vars);  // set __FILE__ and __LINE__
 
     // ----------------------------------------------------------------------
     // print a blank for empty lines
     // ----------------------------------------------------------------------
 
-    if (line.size() == 0)
+    if (lineSize == 0)
     {
         it_line++;
         lineno++;
@@ -1301,17 +1566,15 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
     // Sanity check: #define etc must be the first token of the line
     // ----------------------------------------------------------------------
 
-    int ind = 0;
-    for (Token tok : line)
+    for (size_t ind = 1; ind < lineSize; ind++)
     {
-        if (ind > 0 && tok.type >= DEFINE && tok.type <= PRAGMA)
+        if (line[ind].type >= DEFINE && line[ind].type <= PRAGMA)
         {
             wrtError("Preprocessor directive must be first token in line");
         }
-        ind++;
     }
 
-    int type = line.front().type;
+    int type = line[0].type;
     if (type == ENDIF || type == ELSE || type == ELIF)
     {
         wrtError("Malformed if block");
@@ -1326,9 +1589,9 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
         if (wrt)
         {
             string err;
-            for (Token tok : line)
+            for (const Token* tok = line; tok != lineEnd; tok++)
             {
-                err += tok2Str(tok);
+                appendTok(err, *tok);
             }
             wrtError("Preprocessor terminated with #error: " + err);
         }
@@ -1341,9 +1604,9 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
         if (wrt)
         {
             string warn;
-            for (Token tok : line)
+            for (const Token* tok = line; tok != lineEnd; tok++)
             {
-                warn += tok2Str(tok);
+                appendTok(warn, *tok);
             }
             printf("Preprocessor WARNING: %s\n", warn.c_str());
         }
@@ -1361,60 +1624,59 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
     {
         if (wrt)
         {
-            auto it = line.begin();
-            it++;
-            if (it->type == IDENTIFIER && it->id == "once")
+            const Token* it = line + 1;
+            if (it != lineEnd && it->type == IDENTIFIER && it->id == g_atoms.once)
             {
                 g_blacklist.push_back(fname);
-                if (g_mode=="full" || g_mode=="flatten") writeLine(line);
+                if (g_mode == MODE_FULL || g_mode == MODE_FLATTEN) writeLine(line, lineSize);
             }
-            else if (it->type == IDENTIFIER && it->id == "push_macro")
+            else if (it != lineEnd && it->type == IDENTIFIER && (it->id == g_atoms.pushMacro || it->id == g_atoms.popMacro))
             {
-                it++;
-                if (it->type != OPEN_BRACKET) wrtError("Expected (");
-
-                it++;
-                if (it->type != STRING) wrtError("Expected string");
-                string name = it->id;
-
-                it++;
-                if (it->type != CLOSE_BRACKET) wrtError("Expected )");
-
-                if (vars.count(name) > 0)
-                    g_stacks[name].push(vars[name]);
+                bool push = it->id == g_atoms.pushMacro;
+                if (lineSize < 5) wrtError("Expected (");
 
-                if (g_mode == "flatten") writeLine(line);
-            }
-            else if (it->type == IDENTIFIER && it->id == "pop_macro")
-            {
                 it++;
                 if (it->type != OPEN_BRACKET) wrtError("Expected (");
 
                 it++;
                 if (it->type != STRING) wrtError("Expected string");
-                string name = it->id;
+                const char* name = it->id;   // the macro name is given as a string
 
                 it++;
                 if (it->type != CLOSE_BRACKET) wrtError("Expected )");
 
-                auto pstack = g_stacks.find(name);
-
-                if (pstack == g_stacks.end())
+                if (push)
                 {
-                    auto pvar = vars.find(name);
-                    if (pvar != vars.end()) vars.erase(pvar);
+                    Var* var = vars.find(name);
+                    if (var != NULL)
+                        g_stacks[name].push(*var);
                 }
                 else
                 {
-                    vars[name] = g_stacks[name].top();
-                    g_stacks[name].pop();
+                    auto pstack = g_stacks.find(name);
+
+                    if (pstack == g_stacks.end())
+                    {
+                        vars.erase(name);
+                    }
+                    else
+                    {
+                        vars.set(pstack->second.top());
+                        pstack->second.pop();
+                    }
                 }
-                if (g_mode == "flatten") writeLine(line);
+                if (g_mode == MODE_FLATTEN) writeLine(line, lineSize);
             }
             else
             {
-                if (g_mode=="full") expand(line, vars, set<string>());
-                if (g_mode == "full" || g_mode == "flatten") writeLine(line);
+                if (g_mode == MODE_FULL)
+                {
+                    vector<Token> expanded(line, lineEnd);
+                    expand(expanded, vars);
+                    writeLine(expanded);
+                }
+                else if (g_mode == MODE_FLATTEN)
+                    writeLine(line, lineSize);
             }
         }
         it_line++;
@@ -1427,19 +1689,18 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
 
     else if (type == LINE)
     {
-        auto it = line.begin();
-        it++;
-        if (it->type == NUMBER)
+        const Token* it = line + 1;
+        if (it != lineEnd && it->type == NUMBER)
         {
             char* endptr = NULL;
             errno = 0;
 
-            lineno = strtol(it->id.c_str(), &endptr, 0);
+            lineno = strtol(it->id, &endptr, 0);
             setLineFile(lineno, fname, vars);
 
             if (!(errno == 0 && *endptr == '\0'))
             {
-                wrtError("Error: failed to make sense of number. Integers must be used in #line statements: " + it->id);
+                wrtError(string("Error: failed to make sense of number. Integers must be used in #line statements: ") + it->id);
             }
         }
         it_line++;
@@ -1455,33 +1716,33 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
     {
         if (wrt)   // false if in an inactive block
         {
-            auto it = line.begin();
-            it++;
+            vector<Token> expanded(line, lineEnd);
+            if (expanded.size() < 2) wrtError("Weird INCLUDE, expected <");
+            size_t it = 1;
 
-            if (it->type != LESSTHAN && it->type != STRING)
+            if (expanded[it].type != LESSTHAN && expanded[it].type != STRING)
             {
-                expand(line, vars, set<string>());  // computed include
-                it = line.begin();
-                it++;
+                expand(expanded, vars);  // computed include
+                if (expanded.size() < 2) wrtError("Weird INCLUDE, expected <");
             }
 
             string includeFile;
-            if (it->type == STRING)   // #include "foo.h"
+            if (expanded[it].type == STRING)   // #include "foo.h"
             {
-                includeFile=findIncludeFile(fname, it->id, includePaths, true);
+                includeFile=findIncludeFile(fname, expanded[it].id, includePaths, true);
             }
             else                                // #include <foo.h>
             {
-                if (it->type != LESSTHAN)
+                if (expanded[it].type != LESSTHAN)
                 {
                     wrtError("Weird INCLUDE, expected <");
                 }
                 it++;
 
                 string include;
-                while (it != line.end() && it->type != GREATERTHAN)
+                while (it != expanded.size() && expanded[it].type != GREATERTHAN)
                 {
-                    Token tok = *it;
+                    const Token& tok = expanded[it];
                     if (tok.type == STRING || tok.type == CHAR)
                     {
                         wrtError("Weird Include: string or char literal found in <filename>");
@@ -1500,10 +1761,11 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
                 includeFile = findIncludeFile(fname, include, includePaths, false);
             }
 
-            if (find(g_blacklist.begin(), g_blacklist.end(), includeFile) == g_blacklist.end())
+            const char* includeAtom = intern(includeFile);
+            if (find(g_blacklist.begin(), g_blacklist.end(), includeAtom) == g_blacklist.end())
             {
-                processFile(includeFile, vars, includePaths, included);
-                if (g_debug) fprintf(g_outfile, "# %d \"%s\" 2\n", g_lineno, fname.c_str());
+                processFile(includeAtom, vars, includePaths, included);
+                if (g_debug) fprintf(g_outfile, "# %d \"%s\" 2\n", g_lineno, fname);
             }
 
             if (find(included.begin(), included.end(), includeFile) == included.end()) included.push_back(includeFile);
@@ -1522,29 +1784,24 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
     {
         if (wrt)
         {
-            auto it = line.begin();
-            it++;
+            if (lineSize < 2) wrtError("Expected macro name");
 
             Var var;
-            var.name = it->id;
+            var.name = line[1].id;
             var.functionLike = false;
-            it++;
-
-            if (it != line.end())
-            {
-                var.val = list<Token>(it, line.end());
-            }
+            var.val.assign(line + 2, lineEnd);
 
             preventDefinedExpand(var.val);
+            var.hasHash = hasHash(var.val);
 
-            if (vars.count(var.name) > 0)
+            if (vars.count(var.name))
             {
-                printf("Warning: redefining macro %s\n", var.name.c_str());
+                printf("Warning: redefining macro %s\n", var.name);
             }
 
-            vars[var.name] = var;
+            vars.set(var);
 
-            if (g_mode == "flatten") writeLine(line);
+            if (g_mode == MODE_FLATTEN) writeLine(line, lineSize);
         }
 
         it_line++;
@@ -1560,47 +1817,46 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
     {
         if (wrt)
         {
-            auto it = line.begin();
-            it++;
+            const Token* it = line + 1;
 
             Var var;
             var.name = it->id;
             var.functionLike = true;
             it++;
 
-            if (it == line.end() || it->type != OPEN_BRACKET) wrtError("Expected (");
+            if (it == lineEnd || it->type != OPEN_BRACKET) wrtError("Expected (");
 
             it++;
-            while (it->type != CLOSE_BRACKET)
+            while (it != lineEnd && it->type != CLOSE_BRACKET)
             {
                 if (it->type == DOT3)
-                    var.args.push_back("__VA_ARGS__");
+                    var.args.push_back(g_atoms.vaArgs);
                 else if (it->type == IDENTIFIER)
                     var.args.push_back(it->id);
                 else if (it->type != COMMA)
                     wrtError("Error in arg list");
                 it++;
             }
+            if (it == lineEnd) wrtError("Expected )");
             it++;
 
-            int ind = 0;
-            for (string arg : var.args)
+            for (size_t ind = 0; ind + 1 < var.args.size(); ind++)
             {
-                if (ind < var.args.size() - 1 && arg == "__VA_ARGS__") wrtError("... must be last argument");
-                ind++;
+                if (var.args[ind] == g_atoms.vaArgs) wrtError("... must be last argument");
             }
 
-            var.val = list<Token>(it, line.end());
+            var.val.assign(it, lineEnd);
             preventDefinedExpand(var.val);
+            var.hasHash = hasHash(var.val);
 
-            if (vars.count(var.name)>0)
-                printf("Warning: redefining macro %s\n", var.name.c_str());
+            if (vars.count(var.name))
+                printf("Warning: redefining macro %s\n", var.name);
 
-            vars[var.name] = var;
+            vars.set(var);
 
-            if (g_mode == "flatten")
+            if (g_mode == MODE_FLATTEN)
             {
-                writeLine(line);
+                writeLine(line, lineSize);
             }
 
         }
@@ -1617,20 +1873,18 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
     {
         if (wrt)
         {
-            auto itname = line.begin();
-            itname++;
-            string name = itname->id;
+            if (lineSize < 2) wrtError("Expected macro name");
+            const char* name = line[1].id;
 
-            auto pvar = vars.find(name);
-            if (pvar == vars.end())
+            if (!vars.count(name))
             {
-                printf("Warning: #undef used but macro not defined: %s\n", name.c_str());
+                printf("Warning: #undef used but macro not defined: %s\n", name ? name : "");
             }
             else
             {
-                vars.erase(pvar);
+                vars.erase(name);
             }
-            if (g_mode == "flatten") writeLine(line);
+            if (g_mode == MODE_FLATTEN) writeLine(line, lineSize);
         }
 
         it_line++;
@@ -1648,8 +1902,9 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
 
         if (type == IF)
         {
-            expandIf(line, vars, includePaths);
-            if (expression::evaluate(line, fname, lineno))   // if condition is true
+            vector<Token> cond(line, lineEnd);
+            expandIf(cond, vars, includePaths);
+            if (expression::evaluate(cond, fname, lineno))   // if condition is true
             {
                 shouldWrt = true;   // so write all lines under it unless suppressed by "wrt"
                 done = true;        // and make sure we don't write any elif or else clauses
@@ -1661,23 +1916,20 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
         }
         else if (type == IFDEF || type == IFNDEF)
         {
-            auto it = line.begin();
-            it++;
-
-            string name = it->id;
-            bool found = (name=="__has_include" && g_hasIncludeSupported) || (name=="__has_cpp_attribute" && !g_attributeMap.empty()) || vars.count(name) > 0;
+            const char* name = lineSize > 1 ? line[1].id : NULL;
+            bool found = (name == g_atoms.hasInclude && g_hasIncludeSupported) || (name == g_atoms.hasCppAttribute && !g_attributeMap.empty()) || vars.count(name);
 
-            if (type == IFDEF && found) 
+            if (type == IFDEF && found)
             {
                 shouldWrt = true;     // write the block
                 done = true;          // suppress further blocks being written
-            }            
+            }
             else if (type==IFNDEF && !found)
             {
                 shouldWrt = true;
                 done = true;
             }
-            else 
+            else
             {
                 shouldWrt = false;
             }
@@ -1686,16 +1938,24 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
         it_line++;
         lineno++;
 
-        while (it_line->size()==0 || it_line->front().type != ENDIF)
+        while (true)
         {
+            if (it_line >= lines.lines.size())
+            {
+                wrtError("Malformed if block, missing #endif");
+            }
+
+            const Token* first = lines.begin(it_line);
+            if (lines.size(it_line) != 0 && first->type == ENDIF) break;
+
             setLineFile(lineno, fname, vars);
 
-            if (it_line->size() == 0)
+            if (lines.size(it_line) == 0)
             {
                 it_line++;
                 lineno++;
             }
-            else if ((*it_line).front().type == ELSE)
+            else if (first->type == ELSE)
             {
                 it_line++;
                 lineno++;
@@ -1704,12 +1964,12 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
                 else
                     shouldWrt = false;  // the if or an elif was written so don't write this
             }
-            else if ((*it_line).front().type == ELIF)
+            else if (first->type == ELIF)
             {
-                list<Token> line2;
+                vector<Token> line2;
                 if (!done)
                 {
-                    line2 = *it_line;
+                    line2.assign(first, lines.end(it_line));
                     expandIf(line2, vars, includePaths);
                 }
 
@@ -1725,7 +1985,7 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
                 lineno++;
             }
             else
-                processLine(it_line, vars, includePaths, included, fname, lineno, wrt && shouldWrt);  // recursive
+                processLine(lines, it_line, vars, includePaths, included, fname, lineno, wrt && shouldWrt);  // recursive
         }
         it_line++;
         lineno++;
@@ -1734,36 +1994,39 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
     {
         if (wrt)
         {
-            if (g_mode == "full")
+            if (g_mode == MODE_FULL)
             {
-                while (true)
+                if (!needsExpansion(line, lineEnd, vars))   // nothing to expand, write it as is
                 {
-                    if (expand(line, vars, set<string>())) break;   // expanded successfully
-                    while (mismatched(line, vars))
+                    writeLine(line, lineSize);
+                }
+                else
+                {
+                    vector<Token> expanded(line, lineEnd);
+                    while (true)
                     {
-                        it_line++;
-                        lineno++;
-                        list<Token> line2 = *it_line;
-                        for (Token tok : line2)
+                        if (expand(expanded, vars)) break;   // expanded successfully
+                        while (mismatched(expanded, vars))
                         {
-                            line.push_back(tok);
+                            if (it_line + 1 >= lines.lines.size()) wrtError("Unterminated function-like macro invocation");
+                            it_line++;
+                            lineno++;
+                            expanded.insert(expanded.end(), lines.begin(it_line), lines.end(it_line));
                         }
                     }
-                }
 
-                writeLine(line);
+                    writeLine(expanded);
+                }
             }
-            else if (g_mode == "flatten")
+            else if (g_mode == MODE_FLATTEN)
             {
-                writeLine(line);
+                writeLine(line, lineSize);
             }
 
-            if (fname.rfind(".rc") == fname.size() - 3 && line.size() >= 3)
+            if (g_isRcFile && lineSize >= 3)
             {
-                auto it = line.begin();
-                it++;
-                string id = it->id;
-                if (it->type == IDENTIFIER && (id == "ICON" || id == "BITMAP" || id == "CURSOR" || id == "FONT" || id == "MESSAGETABLE"))
+                const Token* it = line + 1;
+                if (it->type == IDENTIFIER && (!strcmp(it->id, "ICON") || !strcmp(it->id, "BITMAP") || !strcmp(it->id, "CURSOR") || !strcmp(it->id, "FONT") || !strcmp(it->id, "MESSAGETABLE")))
                 {
                     it++;
                     if (it->type == STRING)
@@ -1788,33 +2051,36 @@ void processLine(list<list<Token>>::iterator &it_line, map<string,Var> &vars, co
 
 // ----------------------------------------------------------------------
 // process file fname appending to macro list "vars" as needed
-// Open the file, read in all the lines and tokenise them using getTokLine
+// Copy its contents in the arena and tokenise all its lines using getTokLine
 // Then call processLine to process all such lines
 // This function indirectly calls itself via processLine (in the case of include)
 // ----------------------------------------------------------------------
 
-void processFile(string fname, map<string,Var> &vars, const list<string> &includePaths, list<string> &included)
+void processFile(const char* fname, Macros &vars, const list<string> &includePaths, list<string> &included)
 {
     // ----------------------------------------------------------------------
-    // Open the file, read the whole contents into allocated char array "source" (NULL terminated)
+    // Copy the contents into a NULL terminated char array "source" we can freely alter
     // For Unix lines will be terminated with \n, for Windows with \r\n
     // ----------------------------------------------------------------------
 
-    char* source = (char *)fname.c_str();
+    size_t len = strlen(fname);
+    char* source = g_arena.alloc(len + 1);
+    memcpy(source, fname, len + 1);
+    bool isRcFile = len >= 3 && !strcmp(fname + len - 3, ".rc");
 
     if (g_debug)
     {
         printf("###%s###\n", source);
-        printf("source length=%llu\n", strlen(source));
+        printf("source length=%zu\n", len);
     }
 
     // ----------------------------------------------------------------------
-    // Process each line into a list of Tokens and add them to "lines"
+    // Process each line into a range of Tokens and add them to "lines"
     // Add in \0 to split the file into lines (account for Windows or Unix line endings)
     // When getTokLine is called:
     // st points to the beginning of the next line
     // ed points to the \0 which terminates this line
-    // if it's a blank line, the created line is an empty list of Tokens
+    // if it's a blank line, the created line is an empty range of Tokens
     // Also concatenate lines with backslash-newline, but add blank lines so number of lines is the same
     // ----------------------------------------------------------------------
 
@@ -1822,7 +2088,8 @@ void processFile(string fname, map<string,Var> &vars, const list<string> &includ
     char* st = source;
     bool done = false;
     g_lineno = 1;
-    list<list<Token> > lines;
+    Lines lines;
+    lines.toks.reserve(len / 4);
 
     g_fname = fname;
     while (!done)
@@ -1848,53 +2115,48 @@ void processFile(string fname, map<string,Var> &vars, const list<string> &includ
         }
 
         int skip;
-        if (*ed == '\0') 
+        if (*ed == '\0')
             done = true;
-        else if (*ed == '\r' && *(ed + 1) == '\n') 
+        else if (*ed == '\r' && *(ed + 1) == '\n')
             skip = 2;
-        else if (*ed == '\n') 
+        else if (*ed == '\n')
             skip = 1;
 
         *ed = '\0';  // insert end of line marker
 
-        lines.push_back(getTokLine(st));
+        getTokLine(st, lines);
         g_lineno++;
 
         for (int i = 0; i < extra; i++)
         {
-            lines.push_back(list<Token>());
+            lines.lines.push_back(Line{ (uint32_t)lines.toks.size(), 0 });
             g_lineno++;
         }
 
         if (!done) st = ed + skip;
     }
 
-    //free(source);
-
     if (incomment) wrtError("runaway multiline comment");
 
-    if (g_mode=="lex")
+    if (g_mode == MODE_LEX)
     {
-        for (auto line : lines)
+        for (size_t i = 0; i < lines.lines.size(); i++)
         {
-            writeLine(line);
+            writeLine(lines.begin(i), lines.size(i));
         }
         return;
     }
 
     if (g_debug)
     {
-        for (auto it_line = lines.begin(); it_line != lines.end(); it_line++)
+        for (size_t i = 0; i < lines.lines.size(); i++)
         {
-            list<Token> line = *it_line;
-
-            for (auto it_tok = line.begin(); it_tok != line.end(); it_tok++)
+            for (const Token* tok = lines.begin(i); tok != lines.end(i); tok++)
             {
-                Token tok = *it_tok;
-                printf("%s", names[tok.type]);
+                printf("%s", names[tok->type]);
 
-                if (tok.type == IDENTIFIER || tok.type == NUMBER || tok.type == STRING || tok.type == CHAR)
-                    printf(": '%s'\n", tok.id.c_str());
+                if (tok->type == IDENTIFIER || tok->type == NUMBER || tok->type == STRING || tok->type == CHAR)
+                    printf(": '%s'\n", tok->id);
                 else
                     printf("\n");
             }
@@ -1902,16 +2164,35 @@ void processFile(string fname, map<string,Var> &vars, const list<string> &includ
         }
     }
 
+    bool wasRcFile = g_isRcFile;
+    g_isRcFile = isRcFile;
     int lineno = 1;
-    auto it_line = lines.begin();
-    while (it_line != lines.end())
+    size_t it_line = 0;
+    while (it_line < lines.lines.size())
     {
-        processLine(it_line, vars, includePaths, included, fname, lineno, true);  // will increase it_line by 1 or more. True means write all lines
+        processLine(lines, it_line, vars, includePaths, included, fname, lineno, true);  // will increase it_line by 1 or more. True means write all lines
     }
+    g_isRcFile = wasRcFile;
 }
 
 // ######################################################################
 
+// ----------------------------------------------------------------------
+// Release all the memory owned by a preprocess run, even if it ended with an exception
+// ----------------------------------------------------------------------
+
+struct RunScope
+{
+    ~RunScope()
+    {
+        g_blacklist.clear();
+        g_stacks.clear();
+        g_arena.clear();
+    }
+};
+
+// ######################################################################
+
 // ----------------------------------------------------------------------
 // Preprocess file "infile". Write postprocessed output to file "outfile" or return as string if outname=""
 // (write to stdout if outname="stdout")
@@ -1920,7 +2201,7 @@ void processFile(string fname, map<string,Var> &vars, const list<string> &includ
 // * defines is a list of strings each of which is a regular #define statement
 // * includePaths is a list of include paths (strings) either absolute path or relative to pwd
 // * forceIncludes is a list of strings each of which is a regular #include statement
-// * attributeMap is a string-string map for __has_cpp_attributes eg attributeMap["nodiscard"] = "201907L" 
+// * attributeMap is a string-string map for __has_cpp_attributes eg attributeMap["nodiscard"] = "201907L"
 //   (pass an empty map to turn off this feature, then __has_cpp_attribute will be undefined and the function can't be used)
 // * hasIncludeSupported: set to true if __has_include should be supported. If false, __has_include is not defined and function can't be used
 //
@@ -1930,12 +2211,12 @@ void processFile(string fname, map<string,Var> &vars, const list<string> &includ
 // eg to achive the same as with this MSVC example:
 // cl /E foo.c -DFoo=2 -DBAR -DFUNC(X,Y)=X+Y -Ipath/to/headers -FIbar.h
 // you would specify:
-// 
+//
 // defines[0,1,...,n] = << MSVC specific defines >>
 // defines[n+1]="#define Foo 2"
 // defines[n+1]="#define BAR 1" (in -D, value defaults to "1" but we must specify this)
 // defines[n+2]="#define FUNC(X,Y) X+Y"
-// includePaths[0,1,..,m]= << MSVC specific includes >> 
+// includePaths[0,1,..,m]= << MSVC specific includes >>
 // includePaths[m+1]="path/to/headers" (forward or backslashes allowed)
 // forceIncludes[0]="#include \"bar.h\""
 //
@@ -1945,24 +2226,42 @@ void processFile(string fname, map<string,Var> &vars, const list<string> &includ
 // mode="dependencies": discover which files are included but don't write postprocessed output to file (or return as string)
 // mode="lex" (debug) only lex infile
 //
+// All tokens, macros and lines live in a per-run arena released when this function returns
 // The function throws std::string exceptions if an error occurs
 // ----------------------------------------------------------------------
 
-string preprocess(string mode, string infile, string outfile, list<string> defines, list<string> includePaths, list<string> forceIncludes, 
+string preprocess(string mode, string infile, string outfile, list<string> defines, list<string> includePaths, list<string> forceIncludes,
     list<string> &included, map<string, string> attributeMap, bool hasIncludeSupported)
 {
     // ----------------------------------------------------------------------
     // Sanity check. Set g_mode etc
     // ----------------------------------------------------------------------
 
-    if (mode != "full" && mode != "flatten" && mode != "dependencies" && mode!="lex")
+    if (mode == "full")
+        g_mode = MODE_FULL;
+    else if (mode == "flatten")
+        g_mode = MODE_FLATTEN;
+    else if (mode == "dependencies")
+        g_mode = MODE_DEPENDENCIES;
+    else if (mode == "lex")
+        g_mode = MODE_LEX;
+    else
     {
         throw string("Illegal preprocess mode: must be 'full', 'flatten', 'dependencies'");
     }
 
-    g_mode = mode;
     g_attributeMap = attributeMap;
     g_hasIncludeSupported = hasIncludeSupported;
+    g_isRcFile = false;
+
+    RunScope scope;
+    g_arena.clear();
+    internAtoms();
+    if (tokLens[0] == 0)
+    {
+        for (size_t j = 0; j < sizeof(tokNames) / sizeof(char*); j++)
+            tokLens[j] = strlen(tokNames[j]);
+    }
 
     // ----------------------------------------------------------------------
     // vars is the list of macros: add __LINE__ etc
@@ -1977,39 +2276,36 @@ string preprocess(string mode, string infile, string outfile, list<string> defin
     // Convert time to struct tm form
     newTime = localtime(&szClock);
 
-    map<string, Var> vars;    // global macros list
+    Macros vars;    // global macros list
 
     Token tok;
     Var var;
     var.functionLike = false;
+    var.hasHash = false;
 
     tok.type = STRING;
-    tok.id = "";
-    var.name = "__FILE__";
-    var.val.clear();
-    var.val.push_back(tok);
-    vars["__FILE__"] = var;
+    tok.id = g_atoms.empty;
+    var.name = g_atoms.file;
+    var.val.assign(1, tok);
+    vars.set(var);
 
     tok.type = NUMBER;
-    tok.id = "0";
-    var.name = "__LINE__";
-    var.val.clear();
-    var.val.push_back(tok);
-    vars["__LINE__"] = var;
+    tok.id = intern("0", 1);
+    var.name = g_atoms.line;
+    var.val.assign(1, tok);
+    vars.set(var);
 
     tok.type = STRING;
-    tok.id = asctime(newTime);
-    var.name = "__DATE__";
-    var.val.clear();
-    var.val.push_back(tok);
-    vars["__DATE__"] = var;
+    tok.id = intern(asctime(newTime));
+    var.name = g_atoms.date;
+    var.val.assign(1, tok);
+    vars.set(var);
 
     tok.type = STRING;
-    tok.id = asctime(newTime);
-    var.name = "__TIME__";
-    var.val.clear();
-    var.val.push_back(tok);
-    vars["__TIME__"] = var;
+    tok.id = intern(asctime(newTime));
+    var.name = g_atoms.time;
+    var.val.assign(1, tok);
+    vars.set(var);
 
     // ----------------------------------------------------------------------
     // Add user-specified defines provided into vars
@@ -2017,18 +2313,17 @@ string preprocess(string mode, string infile, string outfile, list<string> defin
 
     incomment = false;
 
-    list<list<Token>> lines;
+    Lines lines;
     for (string def : defines)
     {
         char* p = const_cast<char*>(def.c_str());
-        list<Token> line = getTokLine(p);
-        lines.push_back(line);
+        getTokLine(p, lines);
     }
 
     int lineno = 1;
-    for (auto it = lines.begin(); it != lines.end();)
+    for (size_t it = 0; it < lines.lines.size();)
     {
-        processLine(it, vars, includePaths, included, "", lineno, true);  // will append to vars and advance "it"
+        processLine(lines, it, vars, includePaths, included, g_atoms.empty, lineno, true);  // will append to vars and advance "it"
     }
 
     for (string &incl : includePaths)
@@ -2047,7 +2342,7 @@ string preprocess(string mode, string infile, string outfile, list<string> defin
     // ----------------------------------------------------------------------
 
     g_outfile = NULL;
-    if (g_mode == "full" || g_mode == "flatten" || g_mode=="lex")
+    if (g_mode == MODE_FULL || g_mode == MODE_FLATTEN || g_mode == MODE_LEX)
     {
         if (outfile == "stdout")
         {
@@ -2063,26 +2358,27 @@ string preprocess(string mode, string infile, string outfile, list<string> defin
         }
     }
 
-    g_outstring.reserve(1024);
-    g_outstring = "";
+    g_outstring.clear();
+    g_outstring.reserve(infile.size() + 1024);
 
     // ----------------------------------------------------------------------
     // Execute force includes
     // ----------------------------------------------------------------------
 
-    lines.clear();
+    const char* fname = intern(infile);
+    lines.toks.clear();
+    lines.lines.clear();
     incomment = false;
     for (string fi : forceIncludes)
     {
         char* p = const_cast<char*>(fi.c_str());
-        list<Token> line = getTokLine(p);
-        lines.push_back(line);
+        getTokLine(p, lines);
     }
 
     lineno = 1;
-    for (auto it = lines.begin(); it != lines.end();)
+    for (size_t it = 0; it < lines.lines.size();)
     {
-        processLine(it, vars, includePaths, included, infile, lineno, true);
+        processLine(lines, it, vars, includePaths, included, fname, lineno, true);
     }
 
     // ----------------------------------------------------------------------
@@ -2090,9 +2386,9 @@ string preprocess(string mode, string infile, string outfile, list<string> defin
     // output written to g_outstring if that was requested
     // ----------------------------------------------------------------------
 
-    processFile(infile, vars, includePaths, included);
+    processFile(fname, vars, includePaths, included);
 
-    if (g_mode == "full" || g_mode == "flatten" || g_mode == "lex")
+    if (g_mode == MODE_FULL || g_mode == MODE_FLATTEN || g_mode == MODE_LEX)
     {
         if (outfile != "stdout" && outfile != "")
         {
@@ -2107,21 +2403,22 @@ string preprocess(string mode, string infile, string outfile, list<string> defin
     if (g_debug)
     {
         printf("\nMacros defined:\n");
-        for (pair<string,Var> varpair : vars)
+        for (const MacroSlot& slot : vars.slots)
         {
-            Var var = varpair.second;
+            if (slot.name == NULL || slot.var < 0) continue;
+            const Var& var = vars.storage[slot.var];
 
-            printf("%s", var.name.c_str());
+            printf("%s", var.name);
             size_t nargs = var.args.size();
 
             if (var.functionLike)
             {
                 printf("(");
                 int n = 0;
-                for (string s : var.args)
+                for (const char* s : var.args)
                 {
                     n++;
-                    printf("%s%s", s.c_str(), n == nargs ? "" : ", ");
+                    printf("%s%s", s, n == nargs ? "" : ", ");
                 }
                 printf(")");
             }
@@ -2132,7 +2429,7 @@ string preprocess(string mode, string infile, string outfile, list<string> defin
         }
     }
 
-    return g_outstring;
+    return std::move(g_outstring);
 }
 }
 
@@ -0,0 +1,215 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * profiler_utils.c:
+ * CPU timeline profiler recording timed zones in per-thread ring buffers
+ *
+ * Every thread recording a zone claims its own ring buffer on first usage,
+ * so recording requires no locks: a ring is written only by its owner and the
+ * write index is published after the event so that dumps only see complete
+ * events (except the oldest ones if the owner wraps around during a dump).
+ * Traces are exported in a compact binary format (see profiler_trace_header)
+ * that tools/vgl_trace.py converts to Chrome trace JSON.
+ */
+#include "../shared.h"
+#include <psp2/kernel/threadmgr.h>
+
+#define PROFILER_TRACE_MAGIC 0x544C4756 // VGLT
+#define PROFILER_TRACE_VERSION 1
+#define PROFILER_MAX_THREADS 8 // Maximum number of threads that can record zones
+#define PROFILER_NAME_SIZE 32 // Size of the zone and thread names in the exported trace
+#define PROFILER_DEFAULT_RING_SIZE 16384 // Default number of events held by every thread ring buffer
+
+static uint32_t profiler_ring_size = PROFILER_DEFAULT_RING_SIZE; // Number of events held by every thread ring buffer
+
+#ifdef HAVE_PROFILING
+typedef struct {
+	uint32_t start; // Process time in microseconds at zone begin
+	uint32_t duration; // Zone duration in microseconds
+	uint16_t zone; // Recorded zone
+	uint16_t frame; // Lower 16 bits of the frame number the zone got recorded on
+} profiler_event;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t time; // Process time in microseconds at dump time, used to unwrap events timestamps
+	uint32_t zones_num; // Number of zone names following the header
+	uint32_t threads_num; // Number of threads sections following the zone names
+} profiler_trace_header;
+
+typedef struct {
+	uint32_t thid; // Thread identifier
+	char name[PROFILER_NAME_SIZE]; // Thread name
+	uint32_t events_num; // Number of events following the thread section header
+	uint32_t lost_num; // Number of events overwritten before the dump
+} profiler_trace_thread;
+
+typedef struct {
+	SceUID thid; // Owner thread identifier
+	char name[PROFILER_NAME_SIZE]; // Owner thread name
+	uint32_t head; // Number of events ever written in the ring buffer
+	uint32_t mask; // Size of the ring buffer - 1
+	profiler_event events[];
+} profiler_ring;
+
+static const char *profiler_zone_names[PROF_ZONES_NUM] = {
+	"Frame",
+	"FFP Draw",
+	"Shaders Draw",
+	"Shader Reload",
+	"Uniforms Upload",
+	"Index Conversion",
+	"Texture Upload",
+	"GPU Alloc",
+	"GC Wait",
+	"Garbage Collector",
+	"GPU Stall",
+};
+
+GLboolean vgl_profiler_enabled = GL_FALSE; // Is the CPU timeline profiler recording?
+static profiler_ring *volatile profiler_rings[PROFILER_MAX_THREADS]; // Ring buffers of the recording threads
+static uint32_t profiler_rings_num = 0; // Number of claimed ring buffers
+static uint32_t profiler_frame_start = 0; // Process time in microseconds at last buffer swap
+
+static profiler_ring *profiler_claim_ring(SceUID thid) {
+	uint32_t idx = __atomic_fetch_add(&profiler_rings_num, 1, __ATOMIC_RELAXED);
+	if (idx >= PROFILER_MAX_THREADS) {
+#ifdef LOG_ERRORS
+		vgl_log("%s:%d Profiler threads limit reached, zones recorded by thread 0x%08X will be discarded.\n", __FILE__, __LINE__, thid);
+#endif
+		return NULL;
+	}
+
+	uint32_t size = profiler_ring_size;
+	profiler_ring *r = (profiler_ring *)vgl_malloc(sizeof(profiler_ring) + size * sizeof(profiler_event), VGL_MEM_EXTERNAL);
+	if (!r)
+		return NULL;
+	r->thid = thid;
+	r->head = 0;
+	r->mask = size - 1;
+	SceKernelThreadInfo info;
+	info.size = sizeof(SceKernelThreadInfo);
+	if (sceKernelGetThreadInfo(thid, &info) < 0)
+		info.name[0] = 0;
+	strncpy(r->name, info.name, PROFILER_NAME_SIZE - 1);
+	r->name[PROFILER_NAME_SIZE - 1] = 0;
+	__atomic_store_n(&profiler_rings[idx], r, __ATOMIC_RELEASE);
+	return r;
+}
+
+static inline __attribute__((always_inline)) profiler_ring *profiler_get_ring(void) {
+	SceUID thid = sceKernelGetThreadId();
+	uint32_t num = min(__atomic_load_n(&profiler_rings_num, __ATOMIC_RELAXED), PROFILER_MAX_THREADS);
+	for (uint32_t i = 0; i < num; i++) {
+		profiler_ring *r = __atomic_load_n(&profiler_rings[i], __ATOMIC_ACQUIRE);
+		if (r && r->thid == thid)
+			return r;
+	}
+	return profiler_claim_ring(thid);
+}
+
+void profiler_record(uint8_t zone, uint32_t start, uint32_t duration) {
+	profiler_ring *r = profiler_get_ring();
+	if (!r)
+		return;
+	uint32_t head = r->head;
+	profiler_event *e = &r->events[head & r->mask];
+	e->start = start;
+	e->duration = duration;
+	e->zone = zone;
+	e->frame = vgl_framecount;
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void profiler_mark_frame(void) {
+	uint32_t tick = sceKernelGetProcessTimeLow();
+	if (vgl_profiler_enabled && profiler_frame_start)
+		profiler_record(PROF_FRAME, profiler_frame_start, tick - profiler_frame_start);
+	profiler_frame_start = tick;
+}
+#endif
+
+void vglUseProfiler(GLboolean usage) {
+#ifdef HAVE_PROFILING
+	vgl_profiler_enabled = usage;
+#endif
+}
+
+void vglSetProfilerBufferSize(uint32_t size) {
+	// Ring buffers are indexed with a mask, so we round up size to the next power of two
+	uint32_t pot = 1;
+	while (pot < size && pot < 0x80000000)
+		pot <<= 1;
+	profiler_ring_size = pot;
+}
+
+GLboolean vglDumpProfilerTrace(const char *path) {
+#ifdef HAVE_PROFILING
+	SceUID f = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+	if (f < 0) {
+#ifdef LOG_ERRORS
+		vgl_log("%s:%d Failed to open %s for profiler trace dump.\n", __FILE__, __LINE__, path);
+#endif
+		return GL_FALSE;
+	}
+
+	profiler_trace_header hdr;
+	hdr.magic = PROFILER_TRACE_MAGIC;
+	hdr.version = PROFILER_TRACE_VERSION;
+	hdr.time = sceKernelGetProcessTimeLow();
+	hdr.zones_num = PROF_ZONES_NUM;
+	hdr.threads_num = 0;
+	profiler_ring *rings[PROFILER_MAX_THREADS];
+	uint32_t num = min(__atomic_load_n(&profiler_rings_num, __ATOMIC_RELAXED), PROFILER_MAX_THREADS);
+	for (uint32_t i = 0; i < num; i++) {
+		profiler_ring *r = __atomic_load_n(&profiler_rings[i], __ATOMIC_ACQUIRE);
+		if (r)
+			rings[hdr.threads_num++] = r;
+	}
+	sceIoWrite(f, &hdr, sizeof(profiler_trace_header));
+	for (int i = 0; i < PROF_ZONES_NUM; i++) {
+		char name[PROFILER_NAME_SIZE] = {0};
+		strncpy(name, profiler_zone_names[i], PROFILER_NAME_SIZE - 1);
+		sceIoWrite(f, name, PROFILER_NAME_SIZE);
+	}
+
+	// Writing the events still held by every ring buffer from the oldest to the newest one
+	for (uint32_t i = 0; i < hdr.threads_num; i++) {
+		profiler_ring *r = rings[i];
+		uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		uint32_t events_num = min(head, r->mask + 1);
+		uint32_t first = (head - events_num) & r->mask;
+		profiler_trace_thread th;
+		th.thid = r->thid;
+		vgl_fast_memcpy(th.name, r->name, PROFILER_NAME_SIZE);
+		th.events_num = events_num;
+		th.lost_num = head - events_num;
+		sceIoWrite(f, &th, sizeof(profiler_trace_thread));
+		uint32_t chunk = min(events_num, r->mask + 1 - first);
+		sceIoWrite(f, &r->events[first], chunk * sizeof(profiler_event));
+		if (chunk < events_num)
+			sceIoWrite(f, r->events, (events_num - chunk) * sizeof(profiler_event));
+	}
+	sceIoClose(f);
+	return GL_TRUE;
+#else
+	return GL_FALSE;
+#endif
+}
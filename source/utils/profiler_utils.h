@@ -0,0 +1,76 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * profiler_utils.h:
+ * Header file for the CPU timeline profiler exposed by profiler_utils.c
+ */
+
+#ifndef _PROFILER_UTILS_H_
+#define _PROFILER_UTILS_H_
+
+// Zones tracked by the CPU timeline profiler, names are listed in profiler_utils.c
+enum {
+	PROF_FRAME, // Whole frame, recorded at buffer swap
+	PROF_FFP_DRAW, // Fixed function pipeline draw call
+	PROF_SHADERS_DRAW, // Shaders pipeline draw call
+	PROF_SHADER_RELOAD, // Fixed function shaders reload or shaders program repatching
+	PROF_UNIFORMS_UPLOAD, // Default uniform buffer copy to GPU memory
+	PROF_INDEX_CONVERSION, // Indices conversion for non native index types or primitives
+	PROF_TEXTURE_UPLOAD, // Texture data upload and conversion
+	PROF_ALLOC, // GPU memory allocation
+	PROF_GC_WAIT, // Wait for the garbage collector to be done with its job
+	PROF_GC, // Garbage collector job
+	PROF_GPU_STALL, // Wait for the GPU to release a display buffer
+	PROF_ZONES_NUM
+};
+
+#ifdef HAVE_PROFILING
+typedef struct {
+	uint32_t start; // Process time in microseconds at zone begin
+	uint8_t zone; // Zone being timed
+	uint8_t active; // Was the profiler enabled at zone begin?
+} profiler_scope;
+
+extern GLboolean vgl_profiler_enabled; // Is the CPU timeline profiler recording?
+
+// Records a zone in the ring buffer of the calling thread
+void profiler_record(uint8_t zone, uint32_t start, uint32_t duration);
+// Records the frame zone ending at the current buffer swap
+void profiler_mark_frame(void);
+
+static inline __attribute__((always_inline)) profiler_scope profiler_scope_begin(uint8_t zone) {
+	profiler_scope s;
+	s.zone = zone;
+	s.active = vgl_profiler_enabled;
+	s.start = s.active ? sceKernelGetProcessTimeLow() : 0;
+	return s;
+}
+
+static inline __attribute__((always_inline)) void profiler_scope_end(profiler_scope *s) {
+	if (s->active)
+		profiler_record(s->zone, s->start, sceKernelGetProcessTimeLow() - s->start);
+}
+
+// Times the enclosing scope as the given zone
+#define PROFILER_SCOPE(zone) profiler_scope __attribute__((cleanup(profiler_scope_end))) zone##_scope = profiler_scope_begin(zone);
+#else
+#define PROFILER_SCOPE(zone)
+#endif
+
+#endif
@@ -0,0 +1,397 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * shader_pack.c:
+ * Append-only single file archive for compiled shaders
+ *
+ * Layout: a header, a sequence of records (record header + shader binary) and,
+ * after a compaction, an index of every record written right after them.
+ * New shaders are appended as records after the index (journal) and
+ * recovered at load time by walking them, so a torn append only loses
+ * the record being written.
+ */
+#include "../shared.h"
+#include <stddef.h>
+
+#define SHADER_PACK_MAGIC 0x4B505356 // VSPK
+#define SHADER_PACK_VERSION 1
+#define SHADER_PACK_RECORD_MAGIC 0x44434552 // RECD
+#define SHADER_PACK_MAX_JOURNAL 64 // Number of journal records after which a pack gets compacted on load
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t index_offset; // Offset of the header index (0 if missing)
+	uint32_t index_num; // Number of entries in the header index
+} shader_pack_header;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t size; // Size of the shader binary following the record header
+	uint64_t key[SHADER_PACK_KEY_WORDS];
+	uint32_t checksum; // Checksum of the shader binary
+	uint32_t header_checksum; // Checksum of the record header fields above
+} shader_pack_record;
+
+typedef struct {
+	uint64_t key[SHADER_PACK_KEY_WORDS];
+	uint32_t offset;
+	uint32_t size;
+	uint32_t checksum;
+	uint32_t unused;
+} shader_pack_index_entry;
+
+static uint32_t shader_pack_checksum(const void *data, uint32_t size) {
+	// FNV-1a
+	const uint8_t *p = (const uint8_t *)data;
+	uint32_t h = 0x811C9DC5;
+	for (uint32_t i = 0; i < size; i++) {
+		h = (h ^ p[i]) * 0x01000193;
+	}
+	return h;
+}
+
+static inline uint32_t shader_pack_key_hash(const uint64_t *key) {
+	uint64_t h = key[0] * 0x9E3779B97F4A7C15ULL;
+	h = (h ^ key[1] ^ (h >> 29)) * 0xBF58476D1CE4E5B9ULL;
+	h = (h ^ key[2] ^ (h >> 32)) * 0x94D049BB133111EBULL;
+	return (uint32_t)(h ^ (h >> 32));
+}
+
+static inline GLboolean shader_pack_key_match(const uint64_t *a, const uint64_t *b) {
+	return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+static shader_pack_entry *shader_pack_find(shader_pack *p, const uint64_t *key, uint32_t hash) {
+	if (!p->table)
+		return NULL;
+	for (uint32_t i = hash & p->table_mask; p->table[i]; i = (i + 1) & p->table_mask) {
+		shader_pack_entry *e = &p->entries[p->table[i] - 1];
+		if (e->hash == hash && shader_pack_key_match(e->key, key))
+			return e;
+	}
+	return NULL;
+}
+
+static void shader_pack_rehash(shader_pack *p) {
+	uint32_t table_size = 64;
+	while (table_size < p->size * 2) {
+		table_size <<= 1;
+	}
+	vgl_free(p->table);
+	p->table = (uint32_t *)vglCalloc(table_size, sizeof(uint32_t));
+	p->table_mask = table_size - 1;
+	for (uint32_t i = 0; i < p->num; i++) {
+		uint32_t j = p->entries[i].hash & p->table_mask;
+		while (p->table[j]) {
+			j = (j + 1) & p->table_mask;
+		}
+		p->table[j] = i + 1;
+	}
+}
+
+static void shader_pack_add_entry(shader_pack *p, const uint64_t *key, uint32_t offset, uint32_t size, uint32_t checksum) {
+	uint32_t hash = shader_pack_key_hash(key);
+	shader_pack_entry *e = shader_pack_find(p, key, hash);
+	if (e) {
+		// Superseding the previous record with the same key
+		p->dead_size += e->size + sizeof(shader_pack_record);
+	} else {
+		if (p->num == p->size) {
+			p->size = p->size ? p->size * 2 : 64;
+			p->entries = (shader_pack_entry *)vglRealloc(p->entries, p->size * sizeof(shader_pack_entry));
+			shader_pack_rehash(p);
+		}
+		e = &p->entries[p->num++];
+		vgl_fast_memcpy(e->key, key, sizeof(e->key));
+		e->hash = hash;
+		uint32_t i = hash & p->table_mask;
+		while (p->table[i]) {
+			i = (i + 1) & p->table_mask;
+		}
+		p->table[i] = p->num;
+	}
+	e->offset = offset;
+	e->size = size;
+	e->checksum = checksum;
+}
+
+static void shader_pack_reset(shader_pack *p) {
+	vgl_free(p->entries);
+	vgl_free(p->table);
+	p->entries = NULL;
+	p->table = NULL;
+	p->num = 0;
+	p->size = 0;
+	p->dead_size = 0;
+	p->journal_num = 0;
+}
+
+static GLboolean shader_pack_create(shader_pack *p) {
+	shader_pack_reset(p);
+	p->fd = sceIoOpen(p->path, SCE_O_RDWR | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+	if (p->fd < 0)
+		return GL_FALSE;
+	shader_pack_header hdr = {SHADER_PACK_MAGIC, SHADER_PACK_VERSION, 0, 0};
+	sceIoWrite(p->fd, &hdr, sizeof(shader_pack_header));
+	p->end_offset = sizeof(shader_pack_header);
+	return GL_TRUE;
+}
+
+static GLboolean shader_pack_read_record(SceUID fd, uint32_t offset, uint32_t file_size, shader_pack_record *r) {
+	if (offset + sizeof(shader_pack_record) > file_size)
+		return GL_FALSE;
+	sceIoLseek(fd, offset, SCE_SEEK_SET);
+	if (sceIoRead(fd, r, sizeof(shader_pack_record)) != sizeof(shader_pack_record))
+		return GL_FALSE;
+	if (r->magic != SHADER_PACK_RECORD_MAGIC || r->header_checksum != shader_pack_checksum(r, offsetof(shader_pack_record, header_checksum)))
+		return GL_FALSE;
+	return offset + sizeof(shader_pack_record) + r->size <= file_size;
+}
+
+GLboolean shader_pack_open(shader_pack *p, const char *path) {
+	char tmp_path[256];
+	SceIoStat st;
+	vgl_memset(p, 0, sizeof(shader_pack));
+	strcpy(p->path, path);
+	sprintf(tmp_path, "%s.tmp", path);
+
+	// Finalizing an interrupted compaction, or discarding an incomplete one
+	if (sceIoGetstat(path, &st) < 0) {
+		if (sceIoGetstat(tmp_path, &st) >= 0)
+			sceIoRename(tmp_path, path);
+	} else
+		sceIoRemove(tmp_path);
+
+	p->fd = sceIoOpen(path, SCE_O_RDWR, 0777);
+	if (p->fd < 0)
+		return shader_pack_create(p);
+
+	uint32_t file_size = sceIoLseek(p->fd, 0, SCE_SEEK_END);
+	shader_pack_header hdr;
+	sceIoLseek(p->fd, 0, SCE_SEEK_SET);
+	if (sceIoRead(p->fd, &hdr, sizeof(shader_pack_header)) != sizeof(shader_pack_header) || hdr.magic != SHADER_PACK_MAGIC || hdr.version != SHADER_PACK_VERSION) {
+		sceIoClose(p->fd);
+		return shader_pack_create(p);
+	}
+
+	// Loading the header index
+	uint32_t offset = sizeof(shader_pack_header);
+	if (hdr.index_num) {
+		uint32_t index_size = hdr.index_num * sizeof(shader_pack_index_entry);
+		if (hdr.index_offset + index_size <= file_size) {
+			shader_pack_index_entry *index = (shader_pack_index_entry *)vglMalloc(index_size);
+			sceIoLseek(p->fd, hdr.index_offset, SCE_SEEK_SET);
+			sceIoRead(p->fd, index, index_size);
+			for (uint32_t i = 0; i < hdr.index_num; i++) {
+				shader_pack_add_entry(p, index[i].key, index[i].offset, index[i].size, index[i].checksum);
+			}
+			vgl_free(index);
+			offset = hdr.index_offset + index_size;
+		}
+	}
+
+	// Recovering records appended after the header index
+	shader_pack_record r;
+	while (shader_pack_read_record(p->fd, offset, file_size, &r)) {
+		shader_pack_add_entry(p, r.key, offset + sizeof(shader_pack_record), r.size, r.checksum);
+		offset += sizeof(shader_pack_record) + r.size;
+		p->journal_num++;
+	}
+
+	// Anything past the last valid record is a torn append and will be overwritten by the next one
+	p->end_offset = offset;
+	p->dead_size += file_size - offset;
+
+	if (p->journal_num >= SHADER_PACK_MAX_JOURNAL || p->dead_size > p->end_offset / 2)
+		shader_pack_compact(p);
+	return GL_TRUE;
+}
+
+void shader_pack_close(shader_pack *p) {
+	if (p->fd >= 0)
+		sceIoClose(p->fd);
+	p->fd = -1;
+	shader_pack_reset(p);
+}
+
+GLboolean shader_pack_contains(shader_pack *p, const uint64_t *key) {
+	shader_pack_entry *e = shader_pack_find(p, key, shader_pack_key_hash(key));
+	return e && e->size;
+}
+
+void *shader_pack_read(shader_pack *p, const uint64_t *key, uint32_t *size) {
+	shader_pack_entry *e = shader_pack_find(p, key, shader_pack_key_hash(key));
+	if (!e || !e->size)
+		return NULL;
+
+	void *res = vglMalloc(e->size);
+	sceIoLseek(p->fd, e->offset, SCE_SEEK_SET);
+	if (sceIoRead(p->fd, res, e->size) != e->size || shader_pack_checksum(res, e->size) != e->checksum) {
+		// Treating corrupted shaders as misses so that they get rebuilt and appended again
+		vgl_log("%s:%d: %s: Corrupted shader found in %s, discarding it.\n", __FILE__, __LINE__, __func__, p->path);
+		p->dead_size += e->size + sizeof(shader_pack_record);
+		e->size = 0;
+		vgl_free(res);
+		return NULL;
+	}
+	*size = e->size;
+	return res;
+}
+
+GLboolean shader_pack_write(shader_pack *p, const uint64_t *key, const void *data, uint32_t size) {
+	if (p->fd < 0 || !size)
+		return GL_FALSE;
+
+	// Record header and shader binary are written with a single request to minimize torn appends
+	uint8_t *buf = (uint8_t *)vglMalloc(sizeof(shader_pack_record) + size);
+	shader_pack_record *r = (shader_pack_record *)buf;
+	r->magic = SHADER_PACK_RECORD_MAGIC;
+	r->size = size;
+	vgl_fast_memcpy(r->key, key, sizeof(r->key));
+	r->checksum = shader_pack_checksum(data, size);
+	r->header_checksum = shader_pack_checksum(r, offsetof(shader_pack_record, header_checksum));
+	vgl_fast_memcpy(&buf[sizeof(shader_pack_record)], data, size);
+
+	sceIoLseek(p->fd, p->end_offset, SCE_SEEK_SET);
+	int written = sceIoWrite(p->fd, buf, sizeof(shader_pack_record) + size);
+	uint32_t checksum = r->checksum;
+	vgl_free(buf);
+	if (written != sizeof(shader_pack_record) + size)
+		return GL_FALSE;
+
+	shader_pack_add_entry(p, key, p->end_offset + sizeof(shader_pack_record), size, checksum);
+	p->end_offset += sizeof(shader_pack_record) + size;
+	p->journal_num++;
+	return GL_TRUE;
+}
+
+static inline GLboolean shader_pack_write_all(SceUID f, const void *data, uint32_t size) {
+	return sceIoWrite(f, data, size) == size;
+}
+
+GLboolean shader_pack_compact(shader_pack *p) {
+	if (p->fd < 0)
+		return GL_FALSE;
+	char tmp_path[256];
+	sprintf(tmp_path, "%s.tmp", p->path);
+	shader_pack_index_entry *index = (shader_pack_index_entry *)vglMalloc((p->num ? p->num : 1) * sizeof(shader_pack_index_entry));
+	if (!index)
+		return GL_FALSE;
+	SceUID f = sceIoOpen(tmp_path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+	if (f < 0) {
+		vgl_free(index);
+		return GL_FALSE;
+	}
+
+	// Copying every live record into the new pack file
+	shader_pack_header hdr = {SHADER_PACK_MAGIC, SHADER_PACK_VERSION, 0, 0};
+	GLboolean ok = shader_pack_write_all(f, &hdr, sizeof(shader_pack_header));
+	uint32_t offset = sizeof(shader_pack_header);
+	for (uint32_t i = 0; ok && i < p->num; i++) {
+		shader_pack_entry *e = &p->entries[i];
+		uint32_t size;
+		void *data = shader_pack_read(p, e->key, &size);
+		if (!data)
+			continue;
+		shader_pack_record r;
+		r.magic = SHADER_PACK_RECORD_MAGIC;
+		r.size = size;
+		vgl_fast_memcpy(r.key, e->key, sizeof(r.key));
+		r.checksum = e->checksum;
+		r.header_checksum = shader_pack_checksum(&r, offsetof(shader_pack_record, header_checksum));
+		ok = shader_pack_write_all(f, &r, sizeof(shader_pack_record)) && shader_pack_write_all(f, data, size);
+		vgl_free(data);
+		shader_pack_index_entry *idx = &index[hdr.index_num++];
+		vgl_fast_memcpy(idx->key, e->key, sizeof(idx->key));
+		idx->offset = offset + sizeof(shader_pack_record);
+		idx->size = size;
+		idx->checksum = r.checksum;
+		idx->unused = 0;
+		offset += sizeof(shader_pack_record) + size;
+	}
+
+	// Storing the header index after the records
+	hdr.index_offset = offset;
+	if (ok)
+		ok = shader_pack_write_all(f, index, hdr.index_num * sizeof(shader_pack_index_entry));
+	if (ok)
+		ok = sceIoLseek(f, 0, SCE_SEEK_SET) == 0 && shader_pack_write_all(f, &hdr, sizeof(shader_pack_header));
+	if (sceIoClose(f) < 0)
+		ok = GL_FALSE;
+
+	// Keeping the old pack file if the new one couldn't be fully written (eg. memory card full)
+	if (!ok) {
+		vgl_log("%s:%d: %s: Failed to compact %s, keeping the old pack file.\n", __FILE__, __LINE__, __func__, p->path);
+		sceIoRemove(tmp_path);
+		vgl_free(index);
+		return GL_FALSE;
+	}
+
+	// Swapping pack files, an interruption here is recovered by shader_pack_open
+	sceIoClose(p->fd);
+	if (sceIoRemove(p->path) < 0) {
+		sceIoRemove(tmp_path);
+		vgl_free(index);
+		p->fd = sceIoOpen(p->path, SCE_O_RDWR, 0777);
+		return GL_FALSE;
+	}
+	sceIoRename(tmp_path, p->path);
+	p->fd = sceIoOpen(p->path, SCE_O_RDWR, 0777);
+
+	shader_pack_reset(p);
+	for (uint32_t i = 0; i < hdr.index_num; i++) {
+		shader_pack_add_entry(p, index[i].key, index[i].offset, index[i].size, index[i].checksum);
+	}
+	vgl_free(index);
+	p->end_offset = hdr.index_offset + hdr.index_num * sizeof(shader_pack_index_entry);
+	return p->fd >= 0;
+}
+
+uint32_t shader_pack_import(shader_pack *p, const char *dir, GLboolean (*get_key)(const char *name, uint64_t *key)) {
+	SceUID d = sceIoDopen(dir);
+	if (d < 0)
+		return 0;
+
+	uint32_t res = 0;
+	SceIoDirent entry;
+	while (sceIoDread(d, &entry) > 0) {
+		uint64_t key[SHADER_PACK_KEY_WORDS];
+		if (SCE_S_ISDIR(entry.d_stat.st_mode) || !get_key(entry.d_name, key) || shader_pack_contains(p, key))
+			continue;
+		char fname[512];
+		sprintf(fname, "%s/%s", dir, entry.d_name);
+		SceUID f = sceIoOpen(fname, SCE_O_RDONLY, 0777);
+		if (f < 0)
+			continue;
+		uint32_t size = sceIoLseek(f, 0, SCE_SEEK_END);
+		sceIoLseek(f, 0, SCE_SEEK_SET);
+		void *buf = vglMalloc(size);
+		if (sceIoRead(f, buf, size) == size && shader_pack_write(p, key, buf, size))
+			res++;
+		sceIoClose(f);
+		vgl_free(buf);
+	}
+	sceIoDclose(d);
+
+	// Storing an up to date header index for the imported shaders
+	if (res)
+		shader_pack_compact(p);
+	return res;
+}
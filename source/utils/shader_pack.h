@@ -0,0 +1,65 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * shader_pack.h:
+ * Header file for the packed shader cache archive exposed by shader_pack.c
+ */
+
+#ifndef _SHADER_PACK_H_
+#define _SHADER_PACK_H_
+
+#define SHADER_PACK_KEY_WORDS 3 // Number of 64 bit words composing a shader pack key
+
+typedef struct {
+	uint64_t key[SHADER_PACK_KEY_WORDS]; // Key identifying the stored shader
+	uint32_t offset; // Offset of the shader binary inside the pack file
+	uint32_t size; // Size of the shader binary (0 if the stored binary got corrupted)
+	uint32_t checksum; // Checksum of the shader binary
+	uint32_t hash; // Hash of the key
+} shader_pack_entry;
+
+typedef struct {
+	char path[256]; // Path of the pack file
+	SceUID fd; // File descriptor of the pack file
+	shader_pack_entry *entries; // In-memory index of the pack file
+	uint32_t *table; // Open addressing hash table indexing entries (slot + 1, 0 for free buckets)
+	uint32_t table_mask; // Size of the hash table - 1
+	uint32_t num; // Number of entries in the in-memory index
+	uint32_t size; // Number of allocated entries for the in-memory index
+	uint32_t end_offset; // Offset past the last valid record of the pack file
+	uint32_t dead_size; // Size of superseded, corrupted or truncated records inside the pack file
+	uint32_t journal_num; // Number of records appended after the header index
+} shader_pack;
+
+// Opens a pack file, creating it if missing, and loads its index
+GLboolean shader_pack_open(shader_pack *p, const char *path);
+// Closes a pack file and releases its index
+void shader_pack_close(shader_pack *p);
+// Checks if a pack file holds a given shader
+GLboolean shader_pack_contains(shader_pack *p, const uint64_t *key);
+// Reads a shader from a pack file, returns NULL on misses
+void *shader_pack_read(shader_pack *p, const uint64_t *key, uint32_t *size);
+// Appends a shader to a pack file, superseding any previous entry with the same key
+GLboolean shader_pack_write(shader_pack *p, const uint64_t *key, const void *data, uint32_t size);
+// Rewrites a pack file dropping dead records and storing an up to date header index
+GLboolean shader_pack_compact(shader_pack *p);
+// Imports a directory of loose shader binaries in a pack file, returns the number of imported shaders
+uint32_t shader_pack_import(shader_pack *p, const char *dir, GLboolean (*get_key)(const char *name, uint64_t *key));
+
+#endif
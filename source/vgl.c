@@ -106,6 +106,10 @@ uint16_t *default_idx_ptr; // sceGxm mapped progressive indices buffer
 uint16_t *default_quads_idx_ptr; // sceGxm mapped progressive indices buffer for quads
 uint16_t *default_line_strips_idx_ptr; // sceGxm mapped progressive indices buffer for line strips
 
+vglPerfCounters vgl_perf_counters = {}; // Cumulative performance counters since vitaGL got initialized
+static vglPerfCounters vgl_perf_frame_start = {}; // Cumulative performance counters at the start of the last completed frame
+static vglPerfCounters vgl_perf_last_frame = {}; // Performance counters of the last completed frame
+
 // Internal functions
 #ifndef DISABLE_CIRCULAR_POOL
 #define CIRCULAR_POOL_SIZE_DEF (32 * 1024 * 1024) // Default size in bytes for the circular vertex pool
@@ -130,6 +134,7 @@ uint8_t *vgl_reserve_data_pool(uint32_t size) {
 	circular_data_pool_ptr[vgl_circular_idx] += size;
 	if (circular_data_pool_ptr[vgl_circular_idx] > circular_data_pool_limit[vgl_circular_idx]) {
 		res = (uint8_t *)gpu_alloc_mapped_for_cpu(size);
+		vgl_perf_counters.circular_pool_overflows++;
 #ifdef LOG_ERRORS
 		if (!res) {
 			vgl_log("%s:%d gpu_alloc_mapped_for_cpu failed with a requested size of %u bytes.\n", __FILE__, __LINE__, size);
@@ -141,6 +146,7 @@ uint8_t *vgl_reserve_data_pool(uint32_t size) {
 	uint8_t *res = circular_data_pool_ptr;
 	circular_data_pool_ptr += size;
 	if (circular_data_pool_ptr > circular_data_pool_limit) {
+		vgl_perf_counters.circular_pool_overflows++;
 		circular_data_pool_ptr = circular_data_pool + size;
 		return circular_data_pool;
 	}
@@ -149,6 +155,33 @@ uint8_t *vgl_reserve_data_pool(uint32_t size) {
 }
 #endif
 
+#define perf_frame_delta(x) vgl_perf_last_frame.x = vgl_perf_counters.x - vgl_perf_frame_start.x;
+void vgl_perf_end_frame(uint32_t circular_pool_usage) {
+	// Fixed function shaders RAM cache counters are shared with vglGetFixedFunctionShaderCacheStats
+	vgl_perf_counters.ffp_shader_cache_hits = vgl_ffp_shader_cache_hits;
+	vgl_perf_counters.ffp_shader_cache_misses = vgl_ffp_shader_cache_misses;
+	if (circular_pool_usage > vgl_perf_counters.circular_pool_usage)
+		vgl_perf_counters.circular_pool_usage = circular_pool_usage;
+
+	perf_frame_delta(ffp_draws)
+	perf_frame_delta(shaders_draws)
+	perf_frame_delta(immediate_draws)
+	perf_frame_delta(ffp_shader_cache_hits)
+	perf_frame_delta(ffp_shader_cache_misses)
+	perf_frame_delta(glsl_shader_cache_hits)
+	perf_frame_delta(glsl_shader_cache_misses)
+	perf_frame_delta(fragment_program_patches)
+	perf_frame_delta(texture_bytes_uploaded)
+	perf_frame_delta(texture_bytes_converted)
+	perf_frame_delta(circular_pool_overflows)
+	for (int i = 0; i < VGL_MEM_ALL; i++) {
+		perf_frame_delta(heap_allocs[i])
+	}
+	perf_frame_delta(gc_retirements)
+	vgl_perf_last_frame.circular_pool_usage = circular_pool_usage;
+	vgl_perf_frame_start = vgl_perf_counters;
+}
+
 /*
  * ------------------------------
  * - IMPLEMENTATION STARTS HERE -
@@ -183,20 +216,14 @@ GLboolean vglInitWithCustomSizes(int pool_size, int width, int height, int ram_p
 	char fname[256];
 	sprintf(fname, "ux0:data/shader_cache/v%d", FFP_SHADER_CACHE_MAGIC);
 	sceIoMkdir(fname, 0777);
-	sprintf(fname, "ux0:data/shader_cache/v%d/v", FFP_SHADER_CACHE_MAGIC);
-	sceIoMkdir(fname, 0777);
-	sprintf(fname, "ux0:data/shader_cache/v%d/f", FFP_SHADER_CACHE_MAGIC);
-	sceIoMkdir(fname, 0777);
+	setup_ffp_shader_pack();
 #ifdef HAVE_SHADER_CACHE
 	if (!shader_cache_root[0])
 		sprintf(shader_cache_root, "ux0:data/shader_cache/%s", titleid);
 	sceIoMkdir(shader_cache_root, 0777);
 	sprintf(vgl_shader_cache_path, "%s/v%d", shader_cache_root, SHADER_CACHE_MAGIC);
 	sceIoMkdir(vgl_shader_cache_path, 0777);
-	sprintf(fname, "%s/v", vgl_shader_cache_path);
-	sceIoMkdir(fname, 0777);
-	sprintf(fname, "%s/f", vgl_shader_cache_path);
-	sceIoMkdir(fname, 0777);
+	setup_glsl_shader_pack();
 #endif
 	// Check if framebuffer size is valid
 	GLboolean res_fallback = GL_FALSE;
@@ -542,11 +569,13 @@ GLboolean vglInitWithCustomSizes(int pool_size, int width, int height, int ram_p
 	matrix4x4_identity(projection_matrix);
 	matrix4x4_identity(modelview_matrix_stack[0]);
 	matrix4x4_identity(projection_matrix_stack[0]);
+	modelview_kind = projection_kind = MATRIX_IDENTITY;
 
 	// Init texture matrices as well as first stack entries to identity
 	for (int i = 0; i < TEXTURE_COORDS_NUM; i++) {
 		matrix4x4_identity(texture_matrix[i]);
 		matrix4x4_identity(texture_units[i].texture_matrix_stack[0]);
+		texture_matrix_kind[i] = texture_units[i].texture_kind_stack[0] = MATRIX_IDENTITY;
 		texture_units[i].texture_stack_counter = 1;
 	}
 
@@ -812,6 +841,90 @@ void vglSetTextureCacheFrequency(GLuint freq) {
 #endif
 }
 
+void vglSetClientArraysCacheThreshold(uint32_t size) {
+#ifdef HAVE_CLIENT_ARRAYS_CACHE
+	vgl_client_arrays_cache_threshold = size;
+#endif
+}
+
+void vglGetClientArraysCacheStats(uint32_t *hits, uint32_t *misses, uint64_t *bytes_saved) {
+#ifdef HAVE_CLIENT_ARRAYS_CACHE
+	if (hits)
+		*hits = vgl_client_arrays_cache_hits;
+	if (misses)
+		*misses = vgl_client_arrays_cache_misses;
+	if (bytes_saved)
+		*bytes_saved = vgl_client_arrays_cache_saved;
+#else
+	if (hits)
+		*hits = 0;
+	if (misses)
+		*misses = 0;
+	if (bytes_saved)
+		*bytes_saved = 0;
+#endif
+}
+
+void vglSetFixedFunctionShaderCacheSize(uint32_t size) {
+	vgl_ffp_shader_cache_size = size;
+}
+
+void vglGetFixedFunctionShaderCacheStats(uint32_t *hits, uint32_t *misses, uint32_t *evictions) {
+	if (hits)
+		*hits = vgl_ffp_shader_cache_hits;
+	if (misses)
+		*misses = vgl_ffp_shader_cache_misses;
+	if (evictions)
+		*evictions = vgl_ffp_shader_cache_evictions;
+}
+
+void vglGetUniformBuffersStats(uint32_t *uploads, uint32_t *reuses, uint64_t *bytes_saved) {
+	if (uploads)
+		*uploads = vgl_unif_buffers_uploads;
+	if (reuses)
+		*reuses = vgl_unif_buffers_reuses;
+	if (bytes_saved)
+		*bytes_saved = vgl_unif_buffers_saved;
+}
+
+void vglGetPerfCounters(vglPerfCounters *frame, vglPerfCounters *total) {
+	if (frame)
+		*frame = vgl_perf_last_frame;
+	if (total) {
+		vgl_perf_counters.ffp_shader_cache_hits = vgl_ffp_shader_cache_hits;
+		vgl_perf_counters.ffp_shader_cache_misses = vgl_ffp_shader_cache_misses;
+		*total = vgl_perf_counters;
+	}
+}
+
+void vglUseDeferredDraws(GLboolean usage) {
+#ifdef HAVE_DEFERRED_DRAWS
+	if (vgl_deferred_draws && !usage) {
+		vglFlushDeferredDraws(gxm_context);
+		vglSyncDeferredDrawsState();
+	}
+	vgl_deferred_draws = usage;
+#endif
+}
+
+void vglGetDeferredDrawsStats(uint32_t *draws, uint32_t *state_changes, uint32_t *state_changes_saved) {
+#ifdef HAVE_DEFERRED_DRAWS
+	if (draws)
+		*draws = vgl_deferred_draws_stats[0];
+	if (state_changes)
+		*state_changes = vgl_deferred_draws_stats[1];
+	if (state_changes_saved)
+		*state_changes_saved = vgl_deferred_draws_stats[2];
+#else
+	if (draws)
+		*draws = 0;
+	if (state_changes)
+		*state_changes = 0;
+	if (state_changes_saved)
+		*state_changes_saved = 0;
+#endif
+}
+
 void vglSetupScratchMemory(GLboolean scratch_for_dynamic, GLboolean scratch_for_stream) {
 #if defined(HAVE_SCRATCH_MEMORY) && !defined(DISABLE_CIRCULAR_POOL)
 	vgl_dynamic_wants_scratch = scratch_for_dynamic;
@@ -839,6 +952,17 @@ void vglSetShaderCachePath(const char *path) {
 #endif
 }
 
+void vglCompactShaderCache(void) {
+	lock_shader_compiler()
+	shader_pack_compact(&ffp_shader_pack);
+	unlock_shader_compiler()
+#ifdef HAVE_SHADER_CACHE
+	finish_shader_jobs();
+	shader_pack_compact(&glsl_shader_pack);
+	shader_pack_compact(&glsl_translation_pack);
+#endif
+}
+
 void vglSetShaderAssociationPath(const char *path) {
 	shark_set_shader_association_path(path);
 }
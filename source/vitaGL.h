@@ -550,6 +550,8 @@ extern "C" {
 #define GL_COMPRESSED_RGBA_PVRTC_2BPPV2_IMG             0x9137
 #define GL_COMPRESSED_RGBA_PVRTC_4BPPV2_IMG             0x9138
 #define GL_QUERY_RESULT_NO_WAIT                         0x9194
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR              0x91B0
+#define GL_COMPLETION_STATUS_KHR                        0x91B1
 #define GL_COMPRESSED_RGBA8_ETC2_EAC                    0x9278
 
 #define VGL_YUV420P_NV12_BT601                         0x18E70
@@ -879,7 +881,10 @@ void glMatrixScaled(GLenum matrixMode, GLdouble x, GLdouble y, GLdouble z);
 void glMatrixScalef(GLenum matrixMode, GLfloat x, GLfloat y, GLfloat z);
 void glMatrixTranslated(GLenum matrixMode, GLdouble x, GLdouble y, GLdouble z);
 void glMatrixTranslatef(GLenum matrixMode, GLfloat x, GLfloat y, GLfloat z);
+void glMaxShaderCompilerThreadsKHR(GLuint count);
 void glMultiDrawArrays(GLenum mode, const GLint *first, const GLsizei *count, GLsizei drawcount);
+void glMultiDrawElements(GLenum mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei drawcount);
+void glMultiDrawElementsBaseVertex(GLenum mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei drawcount, const GLint *basevertex);
 void glMultiTexCoord2f(GLenum target, GLfloat s, GLfloat t);
 void glMultiTexCoord2fv(GLenum target, GLfloat *f);
 void glMultiTexCoord2i(GLenum target, GLint s, GLint t);
@@ -1140,6 +1145,29 @@ typedef enum {
 	VGL_MODE_POSTPONED // Moves shaders compilation into glLinkProgram. Best results since will always have correct shader couples for the translation for accurate semantic bindings resolution.
 } vglSemanticMode;
 
+typedef struct {
+	GLuint count; // Number of indices to draw
+	GLuint firstIndex; // Offset in elements from the indices base for the first index
+	GLint baseVertex; // Value added to every index when fetching vertices
+} vglDrawElementsIndirectCommand;
+
+typedef struct {
+	uint32_t ffp_draws; // Draw calls processed by the fixed function pipeline
+	uint32_t shaders_draws; // Draw calls processed by the shaders pipeline
+	uint32_t immediate_draws; // Immediate mode primitives drawn (glBegin/glEnd blocks and baked display lists geometry)
+	uint32_t ffp_shader_cache_hits; // Fixed function shaders found in the RAM cache
+	uint32_t ffp_shader_cache_misses; // Fixed function shaders loaded from the filesystem cache or compiled
+	uint32_t glsl_shader_cache_hits; // GLSL shaders loaded from the shader cache or reusing an already compiled program
+	uint32_t glsl_shader_cache_misses; // GLSL shaders compiled with the runtime shader compiler
+	uint32_t fragment_program_patches; // Fragment programs patched for new blend settings or output formats
+	uint64_t texture_bytes_uploaded; // Texture data bytes written to GPU memory
+	uint64_t texture_bytes_converted; // Texture data bytes that required a format conversion or compression on CPU
+	uint32_t circular_pool_usage; // Bytes requested to the circular pool (peak of a single frame for cumulative counters)
+	uint32_t circular_pool_overflows; // Circular pool reservations that didn't fit and fell back to a regular allocation
+	uint32_t heap_allocs[VGL_MEM_ALL]; // Internal heap allocations for each memory type
+	uint32_t gc_retirements; // Resources released by the garbage collector
+} vglPerfCounters;
+
 // vgl*
 // Add a new global custom semantic binding for the GLSL translator.
 void vglAddSemanticBinding(const GLchar *const *varying, GLint index, GLenum type);
@@ -1159,6 +1187,15 @@ void vglBufferData(GLenum target, const GLvoid *data);
 // calloc implementation for vitaGL internal memory pools.
 void *vglCalloc(uint32_t nmember, uint32_t size);
 
+// Captures the GL calls stream of the given number of frames, starting at the next buffer swap, to a file that can be analyzed with tools/vgl_capture.py and replayed with tools/vgl_replay. Requires HAVE_FRAME_CAPTURE.
+GLboolean vglCaptureFrames(const char *path, uint32_t frames);
+
+// Rewrites the packed shader caches dropping superseded shaders and storing an up to date index. Shader caches are also automatically compacted at init when required.
+void vglCompactShaderCache(void);
+
+// Writes the zones recorded by the CPU timeline profiler to a binary trace file convertible to Chrome trace JSON with tools/vgl_trace.py. Requires HAVE_PROFILING.
+GLboolean vglDumpProfilerTrace(const char *path);
+
 // Alloc memory from vitaGL internal memory pools. If the memory pools exhausted, vitaGL will attempt to free enough memory to not fail this allocation. Needs to be freed with vglFree.
 void *vglForceAlloc(uint32_t size);
 
@@ -1168,6 +1205,15 @@ void vglFree(void *addr);
 // Get the memory region that stores compressed splashscreen data during boot. This memory region can be safely used as a general purpose buffer after the splashscreen stops rendering.
 void *vglGetCaveBuffer(size_t *sz);
 
+// Get hits, misses and total saved bytes of the client arrays cache. Requires HAVE_CLIENT_ARRAYS_CACHE.
+void vglGetClientArraysCacheStats(uint32_t *hits, uint32_t *misses, uint64_t *bytes_saved);
+
+// Get number of draws submitted in deferred mode, GPU state changes emitted for them and state changes avoided by sorting them. Requires HAVE_DEFERRED_DRAWS.
+void vglGetDeferredDrawsStats(uint32_t *draws, uint32_t *state_changes, uint32_t *state_changes_saved);
+
+// Get hits, misses and evictions of the RAM cache for fixed function pipeline shaders.
+void vglGetFixedFunctionShaderCacheStats(uint32_t *hits, uint32_t *misses, uint32_t *evictions);
+
 // Get the current frame number.
 uint32_t vglGetFrameNumber();
 
@@ -1177,12 +1223,18 @@ char *vglGetFuncName(uint32_t func);
 // Get the internal sceGxm texture descriptor of a GL texture.
 SceGxmTexture *vglGetGxmTexture(GLenum target);
 
+// Get the performance counters of the last completed frame and the cumulative ones since vitaGL got initialized. Either pointer can be NULL.
+void vglGetPerfCounters(vglPerfCounters *frame, vglPerfCounters *total);
+
 // Get a GL function address given a function name.
 void *vglGetProcAddress(const char *name);
 
 // Get the internal texture data pointer of a GL texture.
 void *vglGetTexDataPointer(GLenum target);
 
+// Get number of custom shaders default uniform buffers copied to GPU memory, copies avoided by rebinding an unchanged buffer and total saved bytes.
+void vglGetUniformBuffersStats(uint32_t *uploads, uint32_t *reuses, uint64_t *bytes_saved);
+
 // Simple vitaGL init function. Legacy pool size is the amount of memory to reserve to handle immediate mode usage.
 GLboolean vglInit(int legacy_pool_size);
 
@@ -1195,6 +1247,9 @@ GLboolean vglInitWithCustomSizes(int legacy_pool_size, int width, int height, in
 // vitaGL init function with customizable resolution, memory pools thresholds and MSAA setup.
 GLboolean vglInitWithCustomThreshold(int pool_size, int width, int height, int ram_threshold, int cdram_threshold, int phycont_threshold, int cdlg_threshold, SceGxmMultisampleMode msaa);
 
+// Checks if a fixed function pipeline shaders precompilation job is still running. Must be called from the rendering thread.
+GLboolean vglIsPrecompilingFixedFunctionShaders(void);
+
 // Mark a memory block from a vitaGL internal memory pool to be deleted as soon as GPU finishes using it.
 void vglLazyFree(void *addr);
 
@@ -1204,6 +1259,9 @@ void *vglMalloc(uint32_t size);
 // malloc_usable_size implementation for vitaGL internal memory pools.
 size_t vglMallocUsableSize(void *ptr);
 
+// Designates a mat4 vertex uniform of a program to receive the model matrix of every draw of vglMultiDrawArraysMatrices.
+void vglMatrixPaletteUniform(GLuint prog, GLint location);
+
 // memalign implementation for vitaGL internal memory pools.
 void *vglMemalign(uint32_t alignment, uint32_t size);
 
@@ -1213,6 +1271,12 @@ size_t vglMemFree(vglMemType type);
 // Gets the total amount of free and used memory in a given internal memory pool.
 size_t vglMemTotal(vglMemType type);
 
+// Performs a batch of non-indexed draws sharing the same GL state, each one with its own column-major model matrix applied on top of the modelview matrix.
+void vglMultiDrawArraysMatrices(GLenum mode, const GLint *first, const GLsizei *count, const GLfloat *matrices, GLsizei drawcount);
+
+// Performs a batch of indexed draws sharing the same GL state, binding shaders, textures and uniforms only once. Indices are read from the bound element array buffer (or client memory) starting at indices.
+void vglMultiDrawElementsIndirect(GLenum mode, GLenum type, const void *indices, const vglDrawElementsIndirectCommand *cmds, GLsizei drawcount);
+
 // Replaces original texture data pointer with a new one in a GL texture.
 void vglOverloadTexDataPointer(GLenum target, void *data);
 
@@ -1222,6 +1286,9 @@ void vglOverrideTexFormat(GLenum target);
 // Allows to init phycont memory heap (VGL_MEM_PHYCONT) after vglInit* calls. Useful for when SceAvPlayer is used only for an intro video.
 void vglPhycontMemLazyInit(size_t size);
 
+// Loads or compiles every fixed function pipeline shader listed in a warm-up manifest (NULL for the one recorded at runtime), optionally on a background thread.
+GLboolean vglPrecompileFixedFunctionShaders(const char *manifest, GLboolean async);
+
 // Variant of glReadPixels that uses GPU underneat to perform the readback. The passed data pointer must be GPU mapped (eg: heap memory).
 void vglReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid *data);
 
@@ -1231,18 +1298,27 @@ void *vglRealloc(void *ptr, uint32_t size);
 // Change the total memory to use for internal circular pools to use in vitaGL. Disabled with NO_CIRCULAR_POOL. Default value: 32 * 1024 * 1024.
 void vglSetCircularPoolSize(uint32_t size);
 
+// Change the minimum size in bytes for a client array range to be cached across frames. Requires HAVE_CLIENT_ARRAYS_CACHE. Default value: 16384.
+void vglSetClientArraysCacheThreshold(uint32_t size);
+
 // Sets the number of buffers to use for the display swapchain. Default value: 3.
 void vglSetDisplayBufferCount(int count);
 
 // Setup a callback executed everytime a new frame is sent to the display. Useful to setup a CPU rendered overlay on-screen.
 void vglSetDisplayCallback(void (*cb)(void *framebuf));
 
+// Sets the number of vertex and fragment shaders for fixed function pipeline kept in RAM. Must be called before the first draw call with fixed function pipeline. Default value: 256.
+void vglSetFixedFunctionShaderCacheSize(uint32_t size);
+
 // Setup the fragment ring buffer size of sceGxm. Must be called before vglInit*. Default value: SCE_GXM_DEFAULT_FRAGMENT_RING_BUFFER_SIZE.
 void vglSetFragmentBufferSize(uint32_t size);
 
 // Setup the parameter buffer size of sceGxm. Must be called before vglInit*. Default value: SCE_GXM_DEFAULT_PARAMETER_BUFFER_SIZE.
 void vglSetParamBufferSize(uint32_t size);
 
+// Sets the number of zones kept by the CPU timeline profiler for every recording thread. Must be called before vglUseProfiler. Default value: 16384.
+void vglSetProfilerBufferSize(uint32_t size);
+
 // Change the currently used semantics binding resolution mode for the GLSL translator. Default value: VGL_MODE_POSTPONED.
 void vglSetSemanticBindingMode(GLenum mode);
 
@@ -1297,9 +1373,15 @@ void vglTexImageDepthBuffer(GLenum target);
 // Makes vitaGL use cached memory instead of uncached memory for its internal memory pools. Must be called before vglInit*.
 void vglUseCachedMem(GLboolean use);
 
+// Makes vitaGL record draw calls and submit them at scene end or at the first state change that can't be recorded, sorting opaque GL_LESS draws by shaders and textures. Sorting may change which draw wins on coplanar opaque geometry. Requires HAVE_DEFERRED_DRAWS. Default value: GL_FALSE.
+void vglUseDeferredDraws(GLboolean usage);
+
 // Makes the GLSL translator use low precision variables (eg: float -> half).
 void vglUseLowPrecision(GLboolean val);
 
+// Makes the CPU timeline profiler record timed zones for draw calls, shaders reloads, uniforms uploads, indices conversions, texture uploads, GPU allocations and garbage collector waits. Requires HAVE_PROFILING. Default value: GL_FALSE.
+void vglUseProfiler(GLboolean usage);
+
 // Allows to swap between triple and double buffering. Default value: GL_TRUE.
 void vglUseTripleBuffering(GLboolean usage);
 
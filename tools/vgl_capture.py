@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+#
+# This file is part of vitaGL
+#
+# Analyzes frame captures stored with vglCaptureFrames, reporting the CPU time
+# spent per call category and comparing captures taken with different builds.
+#
+# Captures hold call timings and arguments, the data they reference and the
+# state the captured draws depend on. They can be replayed on a host machine
+# with tools/vgl_replay, which writes a capture with its own timings that can be
+# analyzed and compared the same way.
+#
+# Usage: vgl_capture.py summary capture.bin
+#        vgl_capture.py diff base.bin new.bin [--threshold PCT]
+
+import argparse
+import struct
+import sys
+
+CAPTURE_MAGIC = 0x434C4756  # VGLC
+CAPTURE_VERSION = 2
+NAME_SIZE = 32
+
+HEADER = struct.Struct('<5I')
+CALL = struct.Struct('<%dsII' % NAME_SIZE)
+RECORD = struct.Struct('<BBHI')
+
+CALL_BLOB = 0
+CALL_FRAME = 1
+
+CATEGORY_INTERNAL = 0  # State records, not timed
+
+
+def read_name(raw):
+	return raw.split(b'\0', 1)[0].decode('utf-8', 'replace')
+
+
+class Capture:
+	def __init__(self, data):
+		magic, version, self.requested, calls_num, cats_num = HEADER.unpack_from(data, 0)
+		if magic != CAPTURE_MAGIC or version != CAPTURE_VERSION:
+			raise ValueError('not a vitaGL frame capture (or unsupported version)')
+		offs = HEADER.size
+		self.calls = []
+		for i in range(calls_num):
+			name, cat, has_data = CALL.unpack_from(data, offs)
+			self.calls.append((read_name(name), cat, has_data))
+			offs += CALL.size
+		self.categories = []
+		for i in range(cats_num):
+			self.categories.append(read_name(data[offs:offs + NAME_SIZE]))
+			offs += NAME_SIZE
+
+		self.frames = []  # Frame times in microseconds
+		self.call_stats = {}  # call -> [count, microseconds]
+		self.blobs = {}  # hash -> size
+		self.blob_refs = 0
+		self.blob_refs_bytes = 0
+		while offs + RECORD.size <= len(data):
+			call, args_num, frame, duration = RECORD.unpack_from(data, offs)
+			offs += RECORD.size
+			args = struct.unpack_from('<%dI' % args_num, data, offs)
+			offs += args_num * 4
+			if call == CALL_BLOB:
+				size = args[2]
+				self.blobs[args[0] | (args[1] << 32)] = size
+				offs += (size + 3) & ~3
+				continue
+			if call == CALL_FRAME:
+				self.frames.append(duration)
+				continue
+			if call >= len(self.calls) or self.calls[call][1] != CATEGORY_INTERNAL:
+				stats = self.call_stats.setdefault(call, [0, 0])
+				stats[0] += 1
+				stats[1] += duration
+			# Calls referencing data store its hash as their last two arguments
+			if call < len(self.calls) and self.calls[call][2]:
+				h = args[-2] | (args[-1] << 32)
+				if h:
+					self.blob_refs += 1
+					self.blob_refs_bytes += self.blobs.get(h, 0)
+		if len(self.frames) < self.requested:
+			sys.stderr.write('capture is truncated: %u of %u frames\n' % (len(self.frames), self.requested))
+
+	def call_name(self, call):
+		return self.calls[call][0] if call < len(self.calls) else 'Call %u' % call
+
+	def category_of(self, call):
+		cat = self.calls[call][1] if call < len(self.calls) else 0
+		return self.categories[cat] if cat < len(self.categories) else 'Category %u' % cat
+
+	def per_category(self):
+		res = {}
+		for call, (count, us) in self.call_stats.items():
+			stats = res.setdefault(self.category_of(call), [0, 0])
+			stats[0] += count
+			stats[1] += us
+		return res
+
+
+def load(path):
+	with open(path, 'rb') as f:
+		return Capture(f.read())
+
+
+def summary(args):
+	cap = load(args.capture)
+	frames = max(len(cap.frames), 1)
+	if cap.frames:
+		print('%u frames, frame time avg %.2f ms (min %.2f ms, max %.2f ms)' % (len(cap.frames),
+			sum(cap.frames) / 1000.0 / len(cap.frames), min(cap.frames) / 1000.0, max(cap.frames) / 1000.0))
+	print('')
+	print('%-16s %10s %12s %12s %10s' % ('Category', 'Calls', 'Total ms', 'ms/frame', 'avg us'))
+	for name, (count, us) in sorted(cap.per_category().items(), key=lambda x: -x[1][1]):
+		print('%-16s %10u %12.3f %12.3f %10.2f' % (name, count, us / 1000.0, us / 1000.0 / frames, us / float(count)))
+	print('')
+	print('%-28s %10s %12s %10s' % ('Call', 'Calls', 'Total ms', 'avg us'))
+	for call, (count, us) in sorted(cap.call_stats.items(), key=lambda x: -x[1][1]):
+		print('%-28s %10u %12.3f %10.2f' % (cap.call_name(call), count, us / 1000.0, us / float(count)))
+	print('')
+	stored = sum(cap.blobs.values())
+	print('%u unique data blobs (%u bytes) referenced %u times (%u bytes)' % (len(cap.blobs), stored, cap.blob_refs, cap.blob_refs_bytes))
+	return 0
+
+
+def diff(args):
+	base = load(args.base)
+	new = load(args.new)
+	base_frames = max(len(base.frames), 1)
+	new_frames = max(len(new.frames), 1)
+	base_cats = base.per_category()
+	new_cats = new.per_category()
+	regressed = False
+	print('%-16s %12s %12s %12s %8s' % ('Category', 'base ms/fr', 'new ms/fr', 'delta ms', 'delta %'))
+	for name in sorted(set(base_cats) | set(new_cats)):
+		b = base_cats.get(name, [0, 0])[1] / 1000.0 / base_frames
+		n = new_cats.get(name, [0, 0])[1] / 1000.0 / new_frames
+		pct = (n - b) * 100.0 / b if b else 0.0
+		mark = ''
+		if args.threshold is not None and b and pct > args.threshold:
+			mark = ' <'
+			regressed = True
+		print('%-16s %12.3f %12.3f %+12.3f %+7.1f%%%s' % (name, b, n, n - b, pct, mark))
+	return 1 if regressed else 0
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Analyzes vitaGL frame captures.')
+	sub = parser.add_subparsers(dest='cmd')
+	p = sub.add_parser('summary', help='reports CPU time per call category')
+	p.add_argument('capture')
+	p.set_defaults(func=summary)
+	p = sub.add_parser('diff', help='compares CPU time per call category between two captures')
+	p.add_argument('base')
+	p.add_argument('new')
+	p.add_argument('--threshold', type=float, help='exits with 1 if a category got slower by more than PCT percent')
+	p.set_defaults(func=diff)
+	args = parser.parse_args()
+	if not hasattr(args, 'func'):
+		parser.print_help()
+		return 1
+	return args.func(args)
+
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -0,0 +1,640 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * fake_gxm.c:
+ * Host implementation of sceGxm. Nothing is rendered: programs are parsed from real GXP
+ * binaries, uniform buffers and notifications behave like on hardware and every submitted
+ * scene and draw is counted so that a replay exercises the very same vitaGL code paths.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "fake_host.h"
+
+#define UNIFORM_RING_SIZE (4 * 1024 * 1024)
+
+host_gxm_stats gxm_stats;
+
+struct SceGxmContext {
+	const SceGxmVertexProgram *vertex_program;
+	const SceGxmFragmentProgram *fragment_program;
+	uint8_t *uniform_ring;
+	uint32_t uniform_ring_pos;
+	int in_scene;
+};
+
+struct SceGxmRegisteredProgram {
+	const SceGxmProgram *program;
+};
+
+struct SceGxmVertexProgram {
+	const SceGxmProgram *program;
+};
+
+struct SceGxmFragmentProgram {
+	const SceGxmProgram *program;
+};
+
+struct SceGxmShaderPatcher {
+	SceGxmShaderPatcherParams params;
+};
+
+struct SceGxmRenderTarget {
+	SceGxmRenderTargetParams params;
+};
+
+struct SceGxmSyncObject {
+	uint32_t dummy;
+};
+
+static SceGxmDisplayQueueCallback display_queue_callback = NULL;
+static volatile unsigned int notification_region[512];
+
+/*
+ * ------------------------------
+ * - INITIALIZATION
+ * ------------------------------
+ */
+int sceGxmInitialize(const SceGxmInitializeParams *params) {
+	display_queue_callback = params->displayQueueCallback;
+	return 0;
+}
+
+int sceGxmVshInitialize(const SceGxmInitializeParams *params) {
+	return sceGxmInitialize(params);
+}
+
+int sceGxmTerminate(void) {
+	return 0;
+}
+
+volatile unsigned int *sceGxmGetNotificationRegion(void) {
+	return notification_region;
+}
+
+int sceGxmNotificationWait(const SceGxmNotification *notification) {
+	return 0;
+}
+
+int sceGxmMapMemory(void *base, SceSize size, SceGxmMemoryAttribFlags attr) {
+	return 0;
+}
+
+int sceGxmUnmapMemory(void *base) {
+	return 0;
+}
+
+int sceGxmMapVertexUsseMemory(void *base, SceSize size, unsigned int *offset) {
+	*offset = (unsigned int)(uintptr_t)base;
+	return 0;
+}
+
+int sceGxmUnmapVertexUsseMemory(void *base) {
+	return 0;
+}
+
+int sceGxmMapFragmentUsseMemory(void *base, SceSize size, unsigned int *offset) {
+	*offset = (unsigned int)(uintptr_t)base;
+	return 0;
+}
+
+int sceGxmUnmapFragmentUsseMemory(void *base) {
+	return 0;
+}
+
+// Flips happen immediately, so the callback runs on the submitting thread
+int sceGxmDisplayQueueAddEntry(SceGxmSyncObject *oldBuffer, SceGxmSyncObject *newBuffer, const void *callbackData) {
+	gxm_stats.frames++;
+	if (display_queue_callback)
+		display_queue_callback(callbackData);
+	return 0;
+}
+
+int sceGxmDisplayQueueFinish(void) {
+	return 0;
+}
+
+int sceGxmSyncObjectCreate(SceGxmSyncObject **syncObject) {
+	*syncObject = calloc(1, sizeof(SceGxmSyncObject));
+	return 0;
+}
+
+int sceGxmSyncObjectDestroy(SceGxmSyncObject *syncObject) {
+	free(syncObject);
+	return 0;
+}
+
+int sceGxmCreateContext(const SceGxmContextParams *params, SceGxmContext **context) {
+	SceGxmContext *ctx = calloc(1, sizeof(SceGxmContext));
+	ctx->uniform_ring = mmap(NULL, UNIFORM_RING_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+	*context = ctx;
+	return 0;
+}
+
+int sceGxmDestroyContext(SceGxmContext *context) {
+	munmap(context->uniform_ring, UNIFORM_RING_SIZE);
+	free(context);
+	return 0;
+}
+
+int sceGxmCreateRenderTarget(const SceGxmRenderTargetParams *params, SceGxmRenderTarget **renderTarget) {
+	SceGxmRenderTarget *rt = calloc(1, sizeof(SceGxmRenderTarget));
+	rt->params = *params;
+	*renderTarget = rt;
+	return 0;
+}
+
+int sceGxmDestroyRenderTarget(SceGxmRenderTarget *renderTarget) {
+	free(renderTarget);
+	return 0;
+}
+
+int sceGxmPadHeartbeat(const SceGxmColorSurface *displaySurface, SceGxmSyncObject *displaySyncObject) {
+	return 0;
+}
+
+/*
+ * ------------------------------
+ * - SURFACES AND TEXTURES
+ * ------------------------------
+ */
+int sceGxmColorSurfaceInit(SceGxmColorSurface *surface, SceGxmColorFormat colorFormat, SceGxmColorSurfaceType surfaceType, SceGxmColorSurfaceScaleMode scaleMode, SceGxmOutputRegisterSize outputRegisterSize, unsigned int width, unsigned int height, unsigned int strideInPixels, void *data) {
+	memset(surface, 0, sizeof(SceGxmColorSurface));
+	surface->pbeSidebandWord = colorFormat;
+	surface->pbeEmitWords[0] = (uint32_t)(uintptr_t)data;
+	surface->pbeEmitWords[1] = width;
+	surface->pbeEmitWords[2] = height;
+	surface->pbeEmitWords[3] = strideInPixels;
+	surface->outputRegisterSize = outputRegisterSize;
+	return 0;
+}
+
+SceGxmColorFormat sceGxmColorSurfaceGetFormat(const SceGxmColorSurface *surface) {
+	return (SceGxmColorFormat)surface->pbeSidebandWord;
+}
+
+void *sceGxmColorSurfaceGetData(const SceGxmColorSurface *surface) {
+	return (void *)(uintptr_t)surface->pbeEmitWords[0];
+}
+
+int sceGxmDepthStencilSurfaceInit(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilFormat depthStencilFormat, SceGxmDepthStencilSurfaceType surfaceType, unsigned int strideInSamples, void *depthData, void *stencilData) {
+	surface->zlsControl = surfaceType | depthStencilFormat;
+	surface->depthData = depthData;
+	surface->stencilData = stencilData;
+	surface->backgroundDepth = 1.0f;
+	surface->backgroundControl = 0x300;
+	return 0;
+}
+
+void sceGxmDepthStencilSurfaceSetForceLoadMode(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilForceLoadMode forceLoad) {
+	surface->zlsControl = (surface->zlsControl & ~SCE_GXM_DEPTH_STENCIL_FORCE_LOAD_ENABLED) | forceLoad;
+}
+
+void sceGxmDepthStencilSurfaceSetForceStoreMode(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilForceStoreMode forceStore) {
+	surface->zlsControl = (surface->zlsControl & ~SCE_GXM_DEPTH_STENCIL_FORCE_STORE_ENABLED) | forceStore;
+}
+
+// Same control words layout vglInitLinearTexture produces
+int sceGxmTextureInitLinear(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat, unsigned int width, unsigned int height, unsigned int mipCount) {
+	texture->controlWords[0] = ((mipCount - 1) & 0xF) << 17 | 0x3E00090 | (texFormat & 0x80000000);
+	texture->controlWords[1] = (height - 1) | 0x60000000 | ((width - 1) << 12) | (texFormat & 0x1F000000);
+	texture->controlWords[2] = (uint32_t)(uintptr_t)data & 0xFFFFFFFC;
+	texture->controlWords[3] = ((texFormat & 0x7000) << 16) | 0x80000000;
+	return 0;
+}
+
+int sceGxmTextureSetData(SceGxmTexture *texture, const void *data) {
+	texture->controlWords[2] = (uint32_t)(uintptr_t)data & 0xFFFFFFFC;
+	return 0;
+}
+
+int sceGxmTextureSetWidth(SceGxmTexture *texture, unsigned int width) {
+	texture->controlWords[1] = (texture->controlWords[1] & 0xFF000FFF) | ((width - 1) << 12);
+	return 0;
+}
+
+int sceGxmTextureSetHeight(SceGxmTexture *texture, unsigned int height) {
+	texture->controlWords[1] = (texture->controlWords[1] & 0xFFFFF000) | (height - 1);
+	return 0;
+}
+
+// Linear and swizzled textures store sizes minus one, cube and tiled ones their base 2 logarithm
+#define TEXTURE_HAS_POT_SIZES(t) (((t)->controlWords[1] & 0xE0000000) == 0x40000000 || ((t)->controlWords[1] & 0xE0000000) == 0x00000000)
+
+unsigned int sceGxmTextureGetWidth(const SceGxmTexture *texture) {
+	if (TEXTURE_HAS_POT_SIZES(texture))
+		return 1 << ((texture->controlWords[1] >> 16) & 0xF);
+	return ((texture->controlWords[1] >> 12) & 0xFFF) + 1;
+}
+
+unsigned int sceGxmTextureGetHeight(const SceGxmTexture *texture) {
+	if (TEXTURE_HAS_POT_SIZES(texture))
+		return 1 << (texture->controlWords[1] & 0xF);
+	return (texture->controlWords[1] & 0xFFF) + 1;
+}
+
+/*
+ * ------------------------------
+ * - TRANSFERS
+ * ------------------------------
+ */
+static void signal_notification(const SceGxmNotification *notification) {
+	if (notification)
+		*notification->address = notification->value;
+}
+
+int sceGxmTransferCopy(uint32_t width, uint32_t height, uint32_t colorKeyValue, uint32_t colorKeyMask, SceGxmTransferColorKeyMode colorKeyMode, SceGxmTransferFormat srcFormat, SceGxmTransferType srcType, const void *srcAddress, uint32_t srcX, uint32_t srcY, int32_t srcStride, SceGxmTransferFormat destFormat, SceGxmTransferType destType, void *destAddress, uint32_t destX, uint32_t destY, int32_t destStride, SceGxmSyncObject *syncObject, uint32_t syncFlags, const SceGxmNotification *notification) {
+	signal_notification(notification);
+	return 0;
+}
+
+int sceGxmTransferDownscale(SceGxmTransferFormat srcFormat, const void *srcAddress, unsigned int srcX, unsigned int srcY, unsigned int srcWidth, unsigned int srcHeight, int srcStride, SceGxmTransferFormat destFormat, void *destAddress, unsigned int destX, unsigned int destY, int destStride, SceGxmSyncObject *syncObject, unsigned int syncFlags, const SceGxmNotification *notification) {
+	signal_notification(notification);
+	return 0;
+}
+
+int sceGxmTransferFinish(void) {
+	return 0;
+}
+
+/*
+ * ------------------------------
+ * - PROGRAMS
+ * ------------------------------
+ */
+// GXP header words and parameter records, see vglProgramGetParameterBase
+#define GXP_WORD(p, i) (((const uint32_t *)(p))[i])
+#define GXP_PARAM_BITS(p) (*(const uint16_t *)((const uint8_t *)(p) + 4))
+
+int sceGxmProgramCheck(const SceGxmProgram *program) {
+	return memcmp(program, "GXP", 4) ? SCE_GXM_ERROR_INVALID_VALUE : 0;
+}
+
+unsigned int sceGxmProgramGetSize(const SceGxmProgram *program) {
+	return GXP_WORD(program, 2);
+}
+
+SceGxmProgramType sceGxmProgramGetType(const SceGxmProgram *program) {
+	return (GXP_WORD(program, 5) & 1) ? SCE_GXM_FRAGMENT_PROGRAM : SCE_GXM_VERTEX_PROGRAM;
+}
+
+unsigned int sceGxmProgramGetDefaultUniformBufferSize(const SceGxmProgram *program) {
+	return GXP_WORD(program, 25) * 4;
+}
+
+unsigned int sceGxmProgramGetParameterCount(const SceGxmProgram *program) {
+	return GXP_WORD(program, 9);
+}
+
+const SceGxmProgramParameter *sceGxmProgramGetParameter(const SceGxmProgram *program, unsigned int index) {
+	const uint8_t *base = (const uint8_t *)program + 40 + GXP_WORD(program, 10);
+	return (const SceGxmProgramParameter *)(base + index * 16);
+}
+
+const SceGxmProgramParameter *sceGxmProgramFindParameterByName(const SceGxmProgram *program, const char *name) {
+	unsigned int cnt = sceGxmProgramGetParameterCount(program);
+	for (unsigned int i = 0; i < cnt; i++) {
+		const SceGxmProgramParameter *p = sceGxmProgramGetParameter(program, i);
+		if (!strcmp(sceGxmProgramParameterGetName(p), name))
+			return p;
+	}
+	return NULL;
+}
+
+unsigned int sceGxmProgramParameterGetIndex(const SceGxmProgram *program, const SceGxmProgramParameter *parameter) {
+	return ((const uint8_t *)parameter - (const uint8_t *)sceGxmProgramGetParameter(program, 0)) / 16;
+}
+
+SceGxmParameterCategory sceGxmProgramParameterGetCategory(const SceGxmProgramParameter *parameter) {
+	return (SceGxmParameterCategory)(GXP_PARAM_BITS(parameter) & 0xF);
+}
+
+const char *sceGxmProgramParameterGetName(const SceGxmProgramParameter *parameter) {
+	return (const char *)parameter + *(const int32_t *)parameter;
+}
+
+SceGxmParameterType sceGxmProgramParameterGetType(const SceGxmProgramParameter *parameter) {
+	return (SceGxmParameterType)((GXP_PARAM_BITS(parameter) >> 4) & 0xF);
+}
+
+unsigned int sceGxmProgramParameterGetComponentCount(const SceGxmProgramParameter *parameter) {
+	return (GXP_PARAM_BITS(parameter) >> 8) & 0xF;
+}
+
+unsigned int sceGxmProgramParameterGetContainerIndex(const SceGxmProgramParameter *parameter) {
+	return (GXP_PARAM_BITS(parameter) >> 12) & 0xF;
+}
+
+unsigned int sceGxmProgramParameterGetArraySize(const SceGxmProgramParameter *parameter) {
+	return GXP_WORD(parameter, 2);
+}
+
+unsigned int sceGxmProgramParameterGetResourceIndex(const SceGxmProgramParameter *parameter) {
+	return GXP_WORD(parameter, 3);
+}
+
+SceBool sceGxmProgramParameterIsSamplerCube(const SceGxmProgramParameter *parameter) {
+	return (((const uint8_t *)parameter)[7] >> 4) & 1;
+}
+
+const SceGxmProgram *sceGxmVertexProgramGetProgram(const SceGxmVertexProgram *vertexProgram) {
+	return vertexProgram->program;
+}
+
+const SceGxmProgram *sceGxmFragmentProgramGetProgram(const SceGxmFragmentProgram *fragmentProgram) {
+	return fragmentProgram->program;
+}
+
+int sceGxmSetUniformDataF(void *uniformBuffer, const SceGxmProgramParameter *parameter, unsigned int componentOffset, unsigned int componentCount, const float *sourceData) {
+	float *dst = (float *)uniformBuffer + sceGxmProgramParameterGetResourceIndex(parameter) + componentOffset;
+	memcpy(dst, sourceData, componentCount * sizeof(float));
+	return 0;
+}
+
+/*
+ * ------------------------------
+ * - SHADER PATCHER
+ * ------------------------------
+ */
+int sceGxmShaderPatcherCreate(const SceGxmShaderPatcherParams *params, SceGxmShaderPatcher **shaderPatcher) {
+	SceGxmShaderPatcher *p = calloc(1, sizeof(SceGxmShaderPatcher));
+	p->params = *params;
+	*shaderPatcher = p;
+	return 0;
+}
+
+int sceGxmShaderPatcherDestroy(SceGxmShaderPatcher *shaderPatcher) {
+	free(shaderPatcher);
+	return 0;
+}
+
+int sceGxmShaderPatcherRegisterProgram(SceGxmShaderPatcher *shaderPatcher, const SceGxmProgram *programHeader, SceGxmShaderPatcherId *programId) {
+	if (!programHeader || sceGxmProgramCheck(programHeader))
+		return SCE_GXM_ERROR_INVALID_VALUE;
+	SceGxmShaderPatcherId id = calloc(1, sizeof(struct SceGxmRegisteredProgram));
+	id->program = programHeader;
+	*programId = id;
+	return 0;
+}
+
+int sceGxmShaderPatcherUnregisterProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId) {
+	free(programId);
+	return 0;
+}
+
+int sceGxmShaderPatcherForceUnregisterProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId) {
+	free(programId);
+	return 0;
+}
+
+const SceGxmProgram *sceGxmShaderPatcherGetProgramFromId(SceGxmShaderPatcherId programId) {
+	return programId->program;
+}
+
+int sceGxmShaderPatcherCreateVertexProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId, const SceGxmVertexAttribute *attributes, unsigned int attributeCount, const SceGxmVertexStream *streams, unsigned int streamCount, SceGxmVertexProgram **vertexProgram) {
+	SceGxmVertexProgram *p = calloc(1, sizeof(SceGxmVertexProgram));
+	p->program = programId->program;
+	*vertexProgram = p;
+	return 0;
+}
+
+int sceGxmShaderPatcherCreateFragmentProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId, SceGxmOutputRegisterFormat outputFormat, SceGxmMultisampleMode multisampleMode, const SceGxmBlendInfo *blendInfo, const SceGxmProgram *vertexProgram, SceGxmFragmentProgram **fragmentProgram) {
+	SceGxmFragmentProgram *p = calloc(1, sizeof(SceGxmFragmentProgram));
+	p->program = programId->program;
+	*fragmentProgram = p;
+	return 0;
+}
+
+int sceGxmShaderPatcherCreateMaskUpdateFragmentProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmFragmentProgram **fragmentProgram) {
+	*fragmentProgram = calloc(1, sizeof(SceGxmFragmentProgram));
+	return 0;
+}
+
+int sceGxmShaderPatcherReleaseVertexProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmVertexProgram *vertexProgram) {
+	free(vertexProgram);
+	return 0;
+}
+
+int sceGxmShaderPatcherReleaseFragmentProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmFragmentProgram *fragmentProgram) {
+	free(fragmentProgram);
+	return 0;
+}
+
+unsigned int sceGxmShaderPatcherGetHostMemAllocated(const SceGxmShaderPatcher *shaderPatcher) {
+	return 0;
+}
+
+unsigned int sceGxmShaderPatcherGetBufferMemAllocated(const SceGxmShaderPatcher *shaderPatcher) {
+	return 0;
+}
+
+unsigned int sceGxmShaderPatcherGetVertexUsseMemAllocated(const SceGxmShaderPatcher *shaderPatcher) {
+	return 0;
+}
+
+unsigned int sceGxmShaderPatcherGetFragmentUsseMemAllocated(const SceGxmShaderPatcher *shaderPatcher) {
+	return 0;
+}
+
+/*
+ * ------------------------------
+ * - RENDERING
+ * ------------------------------
+ */
+int sceGxmBeginScene(SceGxmContext *context, unsigned int flags, const SceGxmRenderTarget *renderTarget, const SceGxmValidRegion *validRegion, SceGxmSyncObject *vertexSyncObject, SceGxmSyncObject *fragmentSyncObject, const SceGxmColorSurface *colorSurface, const SceGxmDepthStencilSurface *depthStencil) {
+	if (context->in_scene)
+		return SCE_GXM_ERROR_WITHIN_SCENE;
+	context->in_scene = 1;
+	gxm_stats.scenes++;
+	return 0;
+}
+
+int sceGxmEndScene(SceGxmContext *context, const SceGxmNotification *vertexNotification, const SceGxmNotification *fragmentNotification) {
+	if (!context->in_scene)
+		return SCE_GXM_ERROR_NOT_WITHIN_SCENE;
+	context->in_scene = 0;
+	signal_notification(vertexNotification);
+	signal_notification(fragmentNotification);
+	return 0;
+}
+
+void sceGxmFinish(SceGxmContext *context) {
+}
+
+int sceGxmPushUserMarker(SceGxmContext *context, const char *tag) {
+	return 0;
+}
+
+int sceGxmPopUserMarker(SceGxmContext *context) {
+	return 0;
+}
+
+void sceGxmSetVertexProgram(SceGxmContext *context, const SceGxmVertexProgram *vertexProgram) {
+	context->vertex_program = vertexProgram;
+}
+
+void sceGxmSetFragmentProgram(SceGxmContext *context, const SceGxmFragmentProgram *fragmentProgram) {
+	context->fragment_program = fragmentProgram;
+}
+
+static void *reserve_uniforms(SceGxmContext *context, const SceGxmProgram *program) {
+	uint32_t size = program ? (sceGxmProgramGetDefaultUniformBufferSize(program) + 15) & ~15 : 16;
+	if (context->uniform_ring_pos + size > UNIFORM_RING_SIZE)
+		context->uniform_ring_pos = 0;
+	void *res = context->uniform_ring + context->uniform_ring_pos;
+	context->uniform_ring_pos += size;
+	return res;
+}
+
+int sceGxmReserveVertexDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer) {
+	*uniformBuffer = reserve_uniforms(context, context->vertex_program ? context->vertex_program->program : NULL);
+	return 0;
+}
+
+int sceGxmReserveFragmentDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer) {
+	*uniformBuffer = reserve_uniforms(context, context->fragment_program ? context->fragment_program->program : NULL);
+	return 0;
+}
+
+int sceGxmSetVertexDefaultUniformBuffer(SceGxmContext *context, const void *bufferData) {
+	return 0;
+}
+
+int sceGxmSetFragmentDefaultUniformBuffer(SceGxmContext *context, const void *bufferData) {
+	return 0;
+}
+
+int sceGxmSetVertexUniformBuffer(SceGxmContext *context, unsigned int bufferIndex, const void *bufferData) {
+	return 0;
+}
+
+int sceGxmSetFragmentUniformBuffer(SceGxmContext *context, unsigned int bufferIndex, const void *bufferData) {
+	return 0;
+}
+
+int sceGxmSetVertexStream(SceGxmContext *context, unsigned int streamIndex, const void *streamData) {
+	return 0;
+}
+
+int sceGxmSetVertexTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture) {
+	return 0;
+}
+
+int sceGxmSetFragmentTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture) {
+	return 0;
+}
+
+int sceGxmSetVisibilityBuffer(SceGxmContext *context, void *bufferBase, unsigned int stridePerCore) {
+	return 0;
+}
+
+void sceGxmSetViewport(SceGxmContext *context, float xOffset, float xScale, float yOffset, float yScale, float zOffset, float zScale) {
+}
+
+void sceGxmSetRegionClip(SceGxmContext *context, SceGxmRegionClipMode mode, unsigned int xMin, unsigned int yMin, unsigned int xMax, unsigned int yMax) {
+}
+
+void sceGxmSetCullMode(SceGxmContext *context, SceGxmCullMode mode) {
+}
+
+void sceGxmSetTwoSidedEnable(SceGxmContext *context, SceGxmTwoSidedMode mode) {
+}
+
+void sceGxmSetWClampEnable(SceGxmContext *context, SceGxmWClampMode enable) {
+}
+
+void sceGxmSetFrontDepthFunc(SceGxmContext *context, SceGxmDepthFunc depthFunc) {
+}
+
+void sceGxmSetBackDepthFunc(SceGxmContext *context, SceGxmDepthFunc depthFunc) {
+}
+
+void sceGxmSetFrontDepthBias(SceGxmContext *context, int factor, int units) {
+}
+
+void sceGxmSetBackDepthBias(SceGxmContext *context, int factor, int units) {
+}
+
+void sceGxmSetFrontDepthWriteEnable(SceGxmContext *context, SceGxmDepthWriteMode enable) {
+}
+
+void sceGxmSetBackDepthWriteEnable(SceGxmContext *context, SceGxmDepthWriteMode enable) {
+}
+
+void sceGxmSetFrontFragmentProgramEnable(SceGxmContext *context, SceGxmFragmentProgramMode enable) {
+}
+
+void sceGxmSetBackFragmentProgramEnable(SceGxmContext *context, SceGxmFragmentProgramMode enable) {
+}
+
+void sceGxmSetFrontPointLineWidth(SceGxmContext *context, unsigned int width) {
+}
+
+void sceGxmSetBackPointLineWidth(SceGxmContext *context, unsigned int width) {
+}
+
+void sceGxmSetFrontPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode) {
+}
+
+void sceGxmSetBackPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode) {
+}
+
+void sceGxmSetFrontStencilFunc(SceGxmContext *context, SceGxmStencilFunc func, SceGxmStencilOp stencilFail, SceGxmStencilOp depthFail, SceGxmStencilOp depthPass, unsigned char compareMask, unsigned char writeMask) {
+}
+
+void sceGxmSetBackStencilFunc(SceGxmContext *context, SceGxmStencilFunc func, SceGxmStencilOp stencilFail, SceGxmStencilOp depthFail, SceGxmStencilOp depthPass, unsigned char compareMask, unsigned char writeMask) {
+}
+
+void sceGxmSetFrontStencilRef(SceGxmContext *context, unsigned int sref) {
+}
+
+void sceGxmSetBackStencilRef(SceGxmContext *context, unsigned int sref) {
+}
+
+void sceGxmSetFrontVisibilityTestEnable(SceGxmContext *context, SceGxmVisibilityTestMode enable) {
+}
+
+void sceGxmSetBackVisibilityTestEnable(SceGxmContext *context, SceGxmVisibilityTestMode enable) {
+}
+
+void sceGxmSetFrontVisibilityTestIndex(SceGxmContext *context, unsigned int index) {
+}
+
+void sceGxmSetBackVisibilityTestIndex(SceGxmContext *context, unsigned int index) {
+}
+
+void sceGxmSetFrontVisibilityTestOp(SceGxmContext *context, SceGxmVisibilityTestOp op) {
+}
+
+void sceGxmSetBackVisibilityTestOp(SceGxmContext *context, SceGxmVisibilityTestOp op) {
+}
+
+int sceGxmDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount) {
+	if (!context->in_scene)
+		return SCE_GXM_ERROR_NOT_WITHIN_SCENE;
+	gxm_stats.draws++;
+	gxm_stats.indices += indexCount;
+	return 0;
+}
+
+int sceGxmDrawInstanced(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount, unsigned int indexWrap) {
+	return sceGxmDraw(context, primType, indexType, indexData, indexCount);
+}
@@ -0,0 +1,43 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * fake_host.h:
+ * Host side entry points of the fake sceGxm, kernel and vitaShaRK backends
+ */
+
+#ifndef _FAKE_HOST_H_
+#define _FAKE_HOST_H_
+
+#include <vitasdk.h>
+
+// Counters updated by the fake sceGxm backend
+typedef struct {
+	uint32_t scenes;
+	uint32_t draws;
+	uint64_t indices;
+	uint32_t frames;
+} host_gxm_stats;
+
+extern host_gxm_stats gxm_stats; // Counters for the work submitted to the fake GPU
+
+void init_host(void);
+void host_set_io_root(const char *path);
+int host_run_low_stack(void *(*func)(void *), void *arg, SceSize stack_size);
+
+#endif
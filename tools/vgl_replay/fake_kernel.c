@@ -0,0 +1,640 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * fake_kernel.c:
+ * Host implementation of the Sce kernel, IO and system services used by vitaGL
+ */
+
+// vitasdk.h comes first, as glibc defines st_ctime and friends as macros
+#define _GNU_SOURCE
+#include "fake_host.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/personality.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_MEMBLOCKS 64
+#define MAX_THREADS 32
+#define MAX_SEMAS 64
+#define MAX_DIRS 16
+
+// vitaGL keeps pointers in 32 bit words, so every host allocation must live in the low 4GB
+static void *low_map(size_t size) {
+	void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT | MAP_NORESERVE, -1, 0);
+	return p == MAP_FAILED ? NULL : p;
+}
+
+/*
+ * ------------------------------
+ * - MEMORY BLOCKS
+ * ------------------------------
+ */
+typedef struct {
+	void *base;
+	SceSize size;
+	SceKernelMemBlockType type;
+} memblock;
+
+static memblock memblocks[MAX_MEMBLOCKS];
+
+SceUID sceKernelAllocMemBlock(const char *name, SceKernelMemBlockType type, SceSize size, SceKernelAllocMemBlockOpt *opt) {
+	for (int i = 0; i < MAX_MEMBLOCKS; i++) {
+		if (!memblocks[i].base) {
+			memblocks[i].base = low_map(size);
+			if (!memblocks[i].base)
+				return -1;
+			memblocks[i].size = size;
+			memblocks[i].type = type;
+			return i + 1;
+		}
+	}
+	return -1;
+}
+
+int sceKernelFreeMemBlock(SceUID uid) {
+	if (uid < 1 || uid > MAX_MEMBLOCKS || !memblocks[uid - 1].base)
+		return -1;
+	munmap(memblocks[uid - 1].base, memblocks[uid - 1].size);
+	memblocks[uid - 1].base = NULL;
+	return 0;
+}
+
+int sceKernelGetMemBlockBase(SceUID uid, void **base) {
+	if (uid < 1 || uid > MAX_MEMBLOCKS || !memblocks[uid - 1].base)
+		return -1;
+	*base = memblocks[uid - 1].base;
+	return 0;
+}
+
+SceUID sceKernelFindMemBlockByAddr(const void *addr, SceSize size) {
+	for (int i = 0; i < MAX_MEMBLOCKS; i++) {
+		if (memblocks[i].base && (uintptr_t)addr >= (uintptr_t)memblocks[i].base && (uintptr_t)addr < (uintptr_t)memblocks[i].base + memblocks[i].size)
+			return i + 1;
+	}
+	return -1;
+}
+
+int sceKernelGetMemBlockInfoByAddr(void *base, SceKernelMemBlockInfo *info) {
+	SceUID uid = sceKernelFindMemBlockByAddr(base, 0);
+	if (uid > 0) {
+		info->mappedBase = memblocks[uid - 1].base;
+		info->mappedSize = memblocks[uid - 1].size;
+		info->type = memblocks[uid - 1].type;
+	} else {
+		// The libc heap, reported as a single 256 MB block
+		info->mappedBase = (void *)((uintptr_t)base & ~(uintptr_t)0x0FFFFFFF);
+		info->mappedSize = 0x10000000;
+		info->type = SCE_KERNEL_MEMBLOCK_TYPE_USER_RW;
+	}
+	return 0;
+}
+
+int sceKernelGetFreeMemorySize(SceKernelFreeMemorySizeInfo *info) {
+	info->size_user = 0x0C800000;
+	info->size_cdram = 0x07000000;
+	info->size_phycont = 0x01A00000;
+	return 0;
+}
+
+/*
+ * ------------------------------
+ * - THREADS
+ * ------------------------------
+ */
+typedef struct {
+	SceKernelThreadEntry entry;
+	SceSize stack_size;
+	pthread_t handle;
+	SceSize arglen;
+	void *argp;
+	int used;
+} thread;
+
+static thread threads[MAX_THREADS];
+static pthread_mutex_t threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void *thread_trampoline(void *arg) {
+	thread *t = (thread *)arg;
+	int res = t->entry(t->arglen, t->argp);
+	return (void *)(intptr_t)res;
+}
+
+int host_run_low_stack(void *(*func)(void *), void *arg, SceSize stack_size) {
+	pthread_attr_t attr;
+	pthread_t handle;
+	void *stack = low_map(stack_size);
+	if (!stack)
+		return -1;
+	pthread_attr_init(&attr);
+	pthread_attr_setstack(&attr, stack, stack_size);
+	int res = pthread_create(&handle, &attr, func, arg);
+	pthread_attr_destroy(&attr);
+	if (res)
+		return -1;
+	pthread_join(handle, NULL);
+	munmap(stack, stack_size);
+	return 0;
+}
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority, SceSize stackSize, SceUInt attr, int cpuAffinityMask, const SceKernelThreadOptParam *option) {
+	pthread_mutex_lock(&threads_mutex);
+	for (int i = 0; i < MAX_THREADS; i++) {
+		if (!threads[i].used) {
+			threads[i].used = 1;
+			threads[i].entry = entry;
+			threads[i].stack_size = stackSize < 0x40000 ? 0x40000 : stackSize;
+			pthread_mutex_unlock(&threads_mutex);
+			return i + 1;
+		}
+	}
+	pthread_mutex_unlock(&threads_mutex);
+	return -1;
+}
+
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp) {
+	if (thid < 1 || thid > MAX_THREADS || !threads[thid - 1].used)
+		return -1;
+	thread *t = &threads[thid - 1];
+	t->arglen = arglen;
+	t->argp = NULL;
+	if (arglen) {
+		t->argp = malloc(arglen);
+		memcpy(t->argp, argp, arglen);
+	}
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setstack(&attr, low_map(t->stack_size), t->stack_size);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	int res = pthread_create(&t->handle, &attr, thread_trampoline, t);
+	pthread_attr_destroy(&attr);
+	return res ? -1 : 0;
+}
+
+int sceKernelExitDeleteThread(int status) {
+	pthread_exit((void *)(intptr_t)status);
+	return 0;
+}
+
+int sceKernelDelayThread(SceUInt delay) {
+	usleep(delay);
+	return 0;
+}
+
+int sceKernelGetThreadId(void) {
+	return (int)(uintptr_t)pthread_self();
+}
+
+int sceKernelGetThreadInfo(SceUID thid, SceKernelThreadInfo *info) {
+	memset(info, 0, sizeof(SceKernelThreadInfo));
+	return 0;
+}
+
+SceUID sceKernelGetProcessId(void) {
+	return getpid();
+}
+
+SceUID sceKernelLoadStartModule(const char *path, SceSize args, void *argp, int flags, SceKernelLMOption *option, int *status) {
+	return -1;
+}
+
+/*
+ * ------------------------------
+ * - SYNCHRONIZATION
+ * ------------------------------
+ */
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int count;
+	int used;
+} sema;
+
+static sema semas[MAX_SEMAS];
+static pthread_mutex_t semas_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int initVal, int maxVal, SceKernelSemaOptParam *option) {
+	pthread_mutex_lock(&semas_mutex);
+	for (int i = 0; i < MAX_SEMAS; i++) {
+		if (!semas[i].used) {
+			semas[i].used = 1;
+			semas[i].count = initVal;
+			pthread_mutex_init(&semas[i].mutex, NULL);
+			pthread_cond_init(&semas[i].cond, NULL);
+			pthread_mutex_unlock(&semas_mutex);
+			return i + 1;
+		}
+	}
+	pthread_mutex_unlock(&semas_mutex);
+	return -1;
+}
+
+int sceKernelDeleteSema(SceUID semaid) {
+	if (semaid < 1 || semaid > MAX_SEMAS || !semas[semaid - 1].used)
+		return -1;
+	pthread_mutex_destroy(&semas[semaid - 1].mutex);
+	pthread_cond_destroy(&semas[semaid - 1].cond);
+	semas[semaid - 1].used = 0;
+	return 0;
+}
+
+int sceKernelSignalSema(SceUID semaid, int signal) {
+	if (semaid < 1 || semaid > MAX_SEMAS || !semas[semaid - 1].used)
+		return -1;
+	sema *s = &semas[semaid - 1];
+	pthread_mutex_lock(&s->mutex);
+	s->count += signal;
+	pthread_cond_broadcast(&s->cond);
+	pthread_mutex_unlock(&s->mutex);
+	return 0;
+}
+
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout) {
+	if (semaid < 1 || semaid > MAX_SEMAS || !semas[semaid - 1].used)
+		return -1;
+	sema *s = &semas[semaid - 1];
+	pthread_mutex_lock(&s->mutex);
+	while (s->count < signal)
+		pthread_cond_wait(&s->cond, &s->mutex);
+	s->count -= signal;
+	pthread_mutex_unlock(&s->mutex);
+	return 0;
+}
+
+// SceKernelLwMutexWork is too small for a host mutex, so it only holds a pointer to one
+int sceKernelCreateLwMutex(SceKernelLwMutexWork *pWork, const char *pName, unsigned int attr, int initCount, const SceKernelLwMutexOptParam *pOptParam) {
+	pthread_mutex_t *m = malloc(sizeof(pthread_mutex_t));
+	pthread_mutexattr_t mattr;
+	pthread_mutexattr_init(&mattr);
+	pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(m, &mattr);
+	pthread_mutexattr_destroy(&mattr);
+	pWork->data[0] = (SceInt64)(uintptr_t)m;
+	for (int i = 0; i < initCount; i++)
+		pthread_mutex_lock(m);
+	return 0;
+}
+
+int sceKernelDeleteLwMutex(SceKernelLwMutexWork *pWork) {
+	pthread_mutex_t *m = (pthread_mutex_t *)(uintptr_t)pWork->data[0];
+	pthread_mutex_destroy(m);
+	free(m);
+	return 0;
+}
+
+int sceKernelLockLwMutex(SceKernelLwMutexWork *pWork, int lockCount, unsigned int *pTimeout) {
+	pthread_mutex_t *m = (pthread_mutex_t *)(uintptr_t)pWork->data[0];
+	for (int i = 0; i < lockCount; i++)
+		pthread_mutex_lock(m);
+	return 0;
+}
+
+int sceKernelUnlockLwMutex(SceKernelLwMutexWork *pWork, int unlockCount) {
+	pthread_mutex_t *m = (pthread_mutex_t *)(uintptr_t)pWork->data[0];
+	for (int i = 0; i < unlockCount; i++)
+		pthread_mutex_unlock(m);
+	return 0;
+}
+
+/*
+ * ------------------------------
+ * - TIME
+ * ------------------------------
+ */
+static uint64_t host_time_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+SceUInt32 sceKernelGetProcessTimeLow(void) {
+	return (SceUInt32)host_time_us();
+}
+
+int sceRtcGetCurrentTick(SceRtcTick *tick) {
+	tick->tick = host_time_us();
+	return 0;
+}
+
+SceUInt32 sceRtcGetTickResolution(void) {
+	return 1000000;
+}
+
+/*
+ * ------------------------------
+ * - C LIBRARY
+ * ------------------------------
+ */
+void *sceClibMemcpy(void *dst, const void *src, SceSize len) {
+	return memcpy(dst, src, len);
+}
+
+void *sceClibMemset(void *dst, int ch, SceSize len) {
+	return memset(dst, ch, len);
+}
+
+void *sceClibMemmove(void *dst, const void *src, SceSize len) {
+	return memmove(dst, src, len);
+}
+
+int sceClibMemcmp(const void *s1, const void *s2, SceSize len) {
+	return memcmp(s1, s2, len);
+}
+
+int sceClibPrintf(const char *fmt, ...) {
+	va_list list;
+	va_start(list, fmt);
+	int res = vprintf(fmt, list);
+	va_end(list);
+	return res;
+}
+
+void *sceDmacMemcpy(void *dst, const void *src, SceSize size) {
+	return memcpy(dst, src, size);
+}
+
+// Mspaces are served by the libc heap, which init_host keeps in the low 4GB
+SceClibMspace sceClibMspaceCreate(void *base, SceSize capacity) {
+	return base;
+}
+
+void *sceClibMspaceMalloc(SceClibMspace msp, SceSize size) {
+	return malloc(size);
+}
+
+void sceClibMspaceFree(SceClibMspace msp, void *ptr) {
+	free(ptr);
+}
+
+void *sceClibMspaceCalloc(SceClibMspace msp, SceSize nelem, SceSize size) {
+	return calloc(nelem, size);
+}
+
+void *sceClibMspaceRealloc(SceClibMspace msp, void *ptr, SceSize size) {
+	return realloc(ptr, size);
+}
+
+void *sceClibMspaceMemalign(SceClibMspace msp, SceSize boundary, SceSize size) {
+	return memalign(boundary, size);
+}
+
+SceSize sceClibMspaceMallocUsableSize(void *ptr) {
+	return malloc_usable_size(ptr);
+}
+
+void sceClibMspaceMallocStats(SceClibMspace msp, SceClibMspaceStats *stats) {
+	memset(stats, 0, sizeof(SceClibMspaceStats));
+}
+
+/*
+ * ------------------------------
+ * - IO
+ * ------------------------------
+ */
+static char io_root[256] = "vgl_root";
+static DIR *dirs[MAX_DIRS];
+
+void host_set_io_root(const char *path) {
+	strncpy(io_root, path, sizeof(io_root) - 1);
+}
+
+// Maps a "dev0:path" name to "<io_root>/dev0/path"
+static const char *host_path(const char *path, char *out) {
+	const char *sep = strchr(path, ':');
+	if (!sep) {
+		strcpy(out, path);
+		return out;
+	}
+	sprintf(out, "%s/%.*s/%s", io_root, (int)(sep - path), path, sep[1] == '/' ? sep + 2 : sep + 1);
+	return out;
+}
+
+static void host_mkdirs(const char *path) {
+	char tmp[512];
+	strcpy(tmp, path);
+	for (char *p = tmp + 1; *p; p++) {
+		if (*p == '/') {
+			*p = 0;
+			mkdir(tmp, 0777);
+			*p = '/';
+		}
+	}
+}
+
+SceUID sceIoOpen(const char *file, int flags, SceMode mode) {
+	char path[512];
+	int hflags = 0;
+	host_path(file, path);
+	if ((flags & SCE_O_RDWR) == SCE_O_RDWR)
+		hflags = O_RDWR;
+	else if (flags & SCE_O_WRONLY)
+		hflags = O_WRONLY;
+	else
+		hflags = O_RDONLY;
+	if (flags & SCE_O_APPEND)
+		hflags |= O_APPEND;
+	if (flags & SCE_O_CREAT) {
+		hflags |= O_CREAT;
+		host_mkdirs(path);
+	}
+	if (flags & SCE_O_TRUNC)
+		hflags |= O_TRUNC;
+	int fd = open(path, hflags, 0666);
+	return fd < 0 ? -1 : fd;
+}
+
+int sceIoClose(SceUID fd) {
+	return close(fd);
+}
+
+int sceIoRead(SceUID fd, void *buf, SceSize nbyte) {
+	return read(fd, buf, nbyte);
+}
+
+int sceIoWrite(SceUID fd, const void *buf, SceSize nbyte) {
+	return write(fd, buf, nbyte);
+}
+
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence) {
+	return lseek(fd, offset, whence == SCE_SEEK_SET ? SEEK_SET : (whence == SCE_SEEK_CUR ? SEEK_CUR : SEEK_END));
+}
+
+int sceIoRemove(const char *file) {
+	char path[512];
+	return unlink(host_path(file, path));
+}
+
+int sceIoRename(const char *oldname, const char *newname) {
+	char oldpath[512], newpath[512];
+	return rename(host_path(oldname, oldpath), host_path(newname, newpath));
+}
+
+int sceIoMkdir(const char *dir, SceMode mode) {
+	char path[512];
+	host_path(dir, path);
+	strcat(path, "/");
+	host_mkdirs(path);
+	return 0;
+}
+
+static void host_fill_stat(const struct stat *st, SceIoStat *stat) {
+	memset(stat, 0, sizeof(SceIoStat));
+	stat->st_mode = S_ISDIR(st->st_mode) ? SCE_S_IFDIR : 0;
+	stat->st_size = st->st_size;
+}
+
+int sceIoGetstat(const char *file, SceIoStat *stat) {
+	char path[512];
+	struct stat st;
+	if (lstat(host_path(file, path), &st))
+		return -1;
+	host_fill_stat(&st, stat);
+	return 0;
+}
+
+SceUID sceIoDopen(const char *dirname) {
+	char path[512];
+	for (int i = 0; i < MAX_DIRS; i++) {
+		if (!dirs[i]) {
+			dirs[i] = opendir(host_path(dirname, path));
+			return dirs[i] ? i + 1 : -1;
+		}
+	}
+	return -1;
+}
+
+int sceIoDread(SceUID fd, SceIoDirent *dir) {
+	struct dirent *d;
+	do {
+		d = readdir(dirs[fd - 1]);
+	} while (d && (!strcmp(d->d_name, ".") || !strcmp(d->d_name, "..")));
+	if (!d)
+		return 0;
+	memset(dir, 0, sizeof(SceIoDirent));
+	strncpy(dir->d_name, d->d_name, sizeof(dir->d_name) - 1);
+	dir->d_stat.st_mode = d->d_type == DT_DIR ? SCE_S_IFDIR : 0;
+	return 1;
+}
+
+int sceIoDclose(SceUID fd) {
+	closedir(dirs[fd - 1]);
+	dirs[fd - 1] = NULL;
+	return 0;
+}
+
+/*
+ * ------------------------------
+ * - SYSTEM SERVICES
+ * ------------------------------
+ */
+int sceDisplaySetFrameBuf(const SceDisplayFrameBuf *pParam, int sync) {
+	return 0;
+}
+
+int sceDisplayWaitVblankStartMulti(unsigned int vcount) {
+	return 0;
+}
+
+int sceDisplayGetMaximumFrameBufResolution(int *width, int *height) {
+	*width = 1920;
+	*height = 1088;
+	return 0;
+}
+
+SceUID sceSharedFbOpen(int smth) {
+	return -1;
+}
+
+int sceSharedFbClose(SceUID fb_id) {
+	return 0;
+}
+
+int sceSharedFbBegin(SceUID fb_id, SceSharedFbInfo *info) {
+	return 0;
+}
+
+int sceSharedFbEnd(SceUID fb_id) {
+	return 0;
+}
+
+int sceSharedFbGetInfo(SceUID fb_id, SceSharedFbInfo *info) {
+	return -1;
+}
+
+int sceCtrlPeekBufferPositive(int port, SceCtrlData *pad_data, int count) {
+	memset(pad_data, 0, sizeof(SceCtrlData));
+	return 0;
+}
+
+// Failing here keeps vitaGL out of system app mode
+int sceAppMgrGetBudgetInfo(SceAppMgrBudgetInfo *info) {
+	return -1;
+}
+
+int sceAppMgrAppParamGetString(int pid, int param, char *string, SceSize length) {
+	strncpy(string, "VGLREPLAY", length);
+	return 0;
+}
+
+int sceCommonDialogUpdate(const SceCommonDialogUpdateParam *updateParam) {
+	return 0;
+}
+
+int sceSysmoduleLoadModule(SceSysmoduleModuleId id) {
+	return -1;
+}
+
+// Restarts the process with a fixed address layout, as a randomized brk base can leave the libc
+// heap too little room below the low 4GB mappings and glibc then falls back to high addresses
+static void host_disable_aslr(void) {
+	static char cmdline[4096];
+	char *argv[64];
+	int pers = personality(0xFFFFFFFF);
+	if (pers < 0 || (pers & ADDR_NO_RANDOMIZE) || personality(pers | ADDR_NO_RANDOMIZE) < 0)
+		return;
+	int fd = open("/proc/self/cmdline", O_RDONLY);
+	if (fd < 0)
+		return;
+	ssize_t size = read(fd, cmdline, sizeof(cmdline) - 1);
+	close(fd);
+	int argc = 0;
+	for (ssize_t i = 0; i < size && argc < 63; i += strlen(&cmdline[i]) + 1)
+		argv[argc++] = &cmdline[i];
+	argv[argc] = NULL;
+	if (argc)
+		execv("/proc/self/exe", argv);
+}
+
+void init_host(void) {
+	host_disable_aslr();
+
+	// Keep the libc heap on brk so that allocations stay in the low 4GB
+	mallopt(M_MMAP_MAX, 0);
+	mallopt(M_ARENA_MAX, 1);
+}
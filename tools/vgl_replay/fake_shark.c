@@ -0,0 +1,346 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * fake_shark.c:
+ * Host stand-in for vitaShaRK. There is no Cg compiler on the host, so shaders are
+ * preprocessed and their interface (attributes, uniforms, samplers) is laid out in a
+ * GXP container with no code. That is all vitaGL ever reads back from a program.
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vitashark.h>
+#include "utils/preprocessor/preprocessor_c.h"
+#include "utils/shacccg_paramquery.h"
+
+#define MAX_PARAMS 128
+#define GXP_HEADER_SIZE 128
+
+typedef struct {
+	char name[64];
+	uint8_t category;
+	uint8_t type;
+	uint8_t components;
+	uint8_t is_cube;
+	uint32_t array_size;
+	uint32_t resource_index;
+} gxp_param;
+
+static void *(*shark_malloc)(size_t size) = malloc;
+static void (*shark_free)(void *ptr) = free;
+static uint8_t *shark_output = NULL;
+
+int shark_init(const char *path) {
+	return 0;
+}
+
+void shark_end(void) {
+}
+
+void shark_set_allocators(void *(*malloc_func)(size_t size), void (*free_func)(void *ptr)) {
+	shark_malloc = malloc_func;
+	shark_free = free_func;
+}
+
+void shark_install_log_cb(void (*cb)(const char *msg, shark_log_level msg_level, int line)) {
+}
+
+void shark_set_warnings_level(shark_warn_level level) {
+}
+
+void shark_set_shader_association_path(const char *path) {
+}
+
+void shark_clear_output(void) {
+	if (shark_output) {
+		shark_free(shark_output);
+		shark_output = NULL;
+	}
+}
+
+void *shark_get_internal_compile_output(void) {
+	return NULL;
+}
+
+// Parses a type name, returning the number of components of a single element
+static int parse_type(const char *type, uint8_t *gxm_type, uint32_t *rows, uint8_t *is_sampler, uint8_t *is_cube) {
+	*rows = 1;
+	*is_sampler = 0;
+	*is_cube = 0;
+	*gxm_type = SCE_GXM_PARAMETER_TYPE_F32;
+	if (!strncmp(type, "sampler", 7) || !strncmp(type, "isampler", 8) || !strncmp(type, "usampler", 8)) {
+		*is_sampler = 1;
+		*is_cube = strstr(type, "CUBE") || strstr(type, "Cube");
+		return 4;
+	}
+	const char *dims = type;
+	if (!strncmp(type, "half", 4) || !strncmp(type, "fixed", 5)) {
+		*gxm_type = SCE_GXM_PARAMETER_TYPE_F16;
+		dims += type[0] == 'h' ? 4 : 5;
+	} else if (!strncmp(type, "float", 5)) {
+		dims += 5;
+	} else if (!strncmp(type, "int", 3) || !strncmp(type, "short", 5) || !strncmp(type, "bool", 4) || !strncmp(type, "char", 4)) {
+		*gxm_type = SCE_GXM_PARAMETER_TYPE_S32;
+		while (isalpha(*dims))
+			dims++;
+	} else if (!strncmp(type, "unsigned", 8)) {
+		*gxm_type = SCE_GXM_PARAMETER_TYPE_U32;
+		dims += 8;
+	} else if (!strncmp(type, "vec", 3) || !strncmp(type, "mat", 3)) {
+		dims += 3;
+	} else {
+		return 0;
+	}
+	int cols = isdigit(dims[0]) ? dims[0] - '0' : 1;
+	if (dims[0] && dims[1] == 'x' && isdigit(dims[2]))
+		*rows = dims[2] - '0';
+	else if (!strncmp(type, "mat", 3))
+		*rows = cols;
+	return cols;
+}
+
+static const char *skip_blanks(const char *s) {
+	while (*s && isspace(*s))
+		s++;
+	return s;
+}
+
+static const char *read_word(const char *s, char *out, int max) {
+	int i = 0;
+	s = skip_blanks(s);
+	while (*s && (isalnum(*s) || *s == '_')) {
+		if (i < max - 1)
+			out[i++] = *s;
+		s++;
+	}
+	out[i] = 0;
+	return s;
+}
+
+// Parses a declaration like "uniform float4 name[2] : SEMANTIC", adding it to the parameters list
+static void parse_declaration(const char *start, const char *end, int global, gxp_param *params, int *num, int is_fragment) {
+	char decl[512], word[64], type[64] = {0}, name[64] = {0};
+	int len = end - start < (int)sizeof(decl) - 1 ? end - start : (int)sizeof(decl) - 1;
+	int is_uniform = global, is_out = 0;
+	uint32_t array_size = 1;
+	memcpy(decl, start, len);
+	decl[len] = 0;
+	char *sem = strchr(decl, ':');
+	if (sem)
+		*sem = 0;
+	char *eq = strchr(decl, '=');
+	if (eq)
+		*eq = 0;
+	const char *s = decl;
+	for (;;) {
+		s = read_word(s, word, sizeof(word));
+		if (!word[0])
+			break;
+		if (!strcmp(word, "uniform"))
+			is_uniform = 1;
+		else if (!strcmp(word, "out") || !strcmp(word, "inout"))
+			is_out = 1;
+		else if (!strcmp(word, "in") || !strcmp(word, "const") || !strcmp(word, "static") || !strcmp(word, "varying") || !strcmp(word, "attribute"))
+			continue;
+		else if (!type[0])
+			strcpy(type, word);
+		else if (!name[0])
+			strcpy(name, word);
+		s = skip_blanks(s);
+		if (name[0] && *s == '[') {
+			array_size = strtoul(s + 1, NULL, 10);
+			break;
+		}
+	}
+	if (!name[0] || is_out || *num >= MAX_PARAMS)
+		return;
+	if (global && strncmp(start, "uniform", 7))
+		return;
+
+	uint8_t gxm_type, is_sampler, is_cube;
+	uint32_t rows;
+	int comps = parse_type(type, &gxm_type, &rows, &is_sampler, &is_cube);
+	if (!comps)
+		return;
+	gxp_param *p = &params[*num];
+	strncpy(p->name, name, sizeof(p->name) - 1);
+	p->type = gxm_type;
+	p->components = comps;
+	p->is_cube = is_cube;
+	p->array_size = array_size * rows;
+	if (is_sampler)
+		p->category = SCE_GXM_PARAMETER_CATEGORY_SAMPLER;
+	else if (is_uniform)
+		p->category = SCE_GXM_PARAMETER_CATEGORY_UNIFORM;
+	else if (!is_fragment)
+		p->category = SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE;
+	else
+		return; // Fragment inputs are varyings, not program parameters
+	(*num)++;
+}
+
+// Blanks out comments and preprocessor leftovers in place
+static void strip_comments(char *s) {
+	while (*s) {
+		if (s[0] == '/' && s[1] == '/') {
+			while (*s && *s != '\n')
+				*s++ = ' ';
+		} else if (s[0] == '/' && s[1] == '*') {
+			while (*s && !(s[0] == '*' && s[1] == '/'))
+				*s++ = ' ';
+			if (*s) {
+				*s++ = ' ';
+				*s++ = ' ';
+			}
+		} else if (s[0] == '#') {
+			while (*s && *s != '\n')
+				*s++ = ' ';
+		} else {
+			s++;
+		}
+	}
+}
+
+// Collects uniforms declared at global scope and the parameters of main()
+static int collect_params(const char *src, gxp_param *params, int is_fragment) {
+	int num = 0, depth = 0;
+	const char *stmt = src;
+	for (const char *s = src; *s; s++) {
+		if (*s == '{') {
+			depth++;
+		} else if (*s == '}') {
+			depth--;
+			stmt = s + 1;
+		} else if (depth == 0 && *s == ';') {
+			parse_declaration(skip_blanks(stmt), s, 1, params, &num, is_fragment);
+			stmt = s + 1;
+		} else if (depth == 0 && *s == '(') {
+			// Function signatures: only the entry point exposes parameters
+			const char *p = s;
+			while (p > stmt && isspace(p[-1]))
+				p--;
+			int is_main = p - stmt >= 4 && !strncmp(p - 4, "main", 4) && (p - 4 == stmt || !isalnum(p[-5]));
+			const char *arg = s + 1;
+			int nest = 0;
+			for (s++; *s && (nest || *s != ')'); s++) {
+				if (*s == '(')
+					nest++;
+				else if (*s == ')')
+					nest--;
+				else if (!nest && *s == ',') {
+					if (is_main)
+						parse_declaration(arg, s, 0, params, &num, is_fragment);
+					arg = s + 1;
+				}
+			}
+			if (is_main && *s)
+				parse_declaration(arg, s, 0, params, &num, is_fragment);
+			if (!*s)
+				break;
+		}
+	}
+	return num;
+}
+
+SceGxmProgram *shark_compile_shader_extended(const char *src, uint32_t *size, shark_type type, shark_opt opt, int32_t use_fastmath, int32_t use_fastprecision, int32_t use_fastint) {
+	static gxp_param params[MAX_PARAMS];
+	char *pp = strdup(glsl_preprocessor_run("full", src));
+	glsl_preprocessor_clean();
+	strip_comments(pp);
+	int num = collect_params(pp, params, type == SHARK_FRAGMENT_SHADER);
+	free(pp);
+
+	// Laying out resources the way the real compiler does: attributes in 4-word registers,
+	// uniforms packed in the default uniform buffer, samplers in consecutive texture units
+	uint32_t attr_reg = 0, unif_reg = 0, sampler_unit = 0, names_size = 0;
+	for (int i = 0; i < num; i++) {
+		gxp_param *p = &params[i];
+		uint32_t elem = p->components == 3 ? 4 : p->components;
+		switch (p->category) {
+		case SCE_GXM_PARAMETER_CATEGORY_ATTRIBUTE:
+			p->resource_index = attr_reg;
+			attr_reg += 4 * p->array_size;
+			break;
+		case SCE_GXM_PARAMETER_CATEGORY_UNIFORM:
+			unif_reg = (unif_reg + elem - 1) / elem * elem;
+			p->resource_index = unif_reg;
+			unif_reg += elem * p->array_size;
+			break;
+		default:
+			p->resource_index = sampler_unit;
+			sampler_unit += p->array_size;
+			break;
+		}
+		names_size += strlen(p->name) + 1;
+	}
+
+	uint32_t total = GXP_HEADER_SIZE + num * 16 + names_size;
+	shark_clear_output();
+	shark_output = shark_malloc((total + 3) & ~3);
+	memset(shark_output, 0, (total + 3) & ~3);
+	uint32_t *words = (uint32_t *)shark_output;
+	memcpy(shark_output, "GXP", 4);
+	words[1] = 0x03500501;
+	words[2] = total;
+	words[5] = type == SHARK_FRAGMENT_SHADER ? 1 : 0;
+	words[9] = num;
+	words[10] = GXP_HEADER_SIZE - 40;
+	words[25] = unif_reg;
+	char *names = (char *)shark_output + GXP_HEADER_SIZE + num * 16;
+	for (int i = 0; i < num; i++) {
+		gxp_param *p = &params[i];
+		uint8_t *rec = shark_output + GXP_HEADER_SIZE + i * 16;
+		*(int32_t *)rec = (int32_t)(names - (char *)rec);
+		*(uint16_t *)(rec + 4) = p->category | (p->type << 4) | (p->components << 8) | ((p->category == SCE_GXM_PARAMETER_CATEGORY_UNIFORM ? 14 : 0) << 12);
+		rec[7] = p->is_cube << 4;
+		*(uint32_t *)(rec + 8) = p->array_size;
+		*(uint32_t *)(rec + 12) = p->resource_index;
+		strcpy(names, p->name);
+		names += strlen(p->name) + 1;
+	}
+	*size = total;
+	return (SceGxmProgram *)shark_output;
+}
+
+SceGxmProgram *shark_compile_shader(const char *src, uint32_t *size, shark_type type) {
+	return shark_compile_shader_extended(src, size, type, SHARK_OPT_DEFAULT, 0, 0, 0);
+}
+
+// No compile output exists, so parameter queries always come back empty
+SceShaccCgParameter sceShaccCgGetFirstParameter(const SceShaccCgCompileOutput *prog) {
+	return NULL;
+}
+
+SceShaccCgParameter sceShaccCgGetNextParameter(SceShaccCgParameter param) {
+	return NULL;
+}
+
+SceShaccCgParameterClass sceShaccCgGetParameterClass(SceShaccCgParameter param) {
+	return SCE_SHACCCG_PARAMETERCLASS_INVALID;
+}
+
+const char *sceShaccCgGetParameterName(SceShaccCgParameter param) {
+	return "";
+}
+
+uint32_t sceShaccCgGetParameterBufferIndex(SceShaccCgParameter param) {
+	return 0;
+}
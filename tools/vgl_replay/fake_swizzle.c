@@ -0,0 +1,55 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * fake_swizzle.c:
+ * Scalar host replacement for the NEON texture swizzler, moving the same amount of data
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+static void swizzle_copy(uint8_t *dst, uint8_t *src, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t stride, uint32_t bpp) {
+	for (uint32_t i = 0; i < height; i++) {
+		memcpy(dst + ((y + i) * stride + x) * bpp, src + i * width * bpp, width * bpp);
+	}
+}
+
+void SwizzleTexData8Bpp(uint8_t *dst, uint8_t *src, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t stride, uint32_t tileSize) {
+	swizzle_copy(dst, src, x, y, width, height, stride, 1);
+}
+
+void SwizzleTexData16Bpp(uint8_t *dst, uint8_t *src, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t stride, uint32_t tileSize) {
+	swizzle_copy(dst, src, x, y, width, height, stride, 2);
+}
+
+void SwizzleTexData32Bpp(uint8_t *dst, uint8_t *src, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t stride, uint32_t tileSize) {
+	swizzle_copy(dst, src, x, y, width, height, stride, 4);
+}
+
+void SwizzleTexData64Bpp(uint8_t *dst, uint8_t *src, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t stride, uint32_t tileSize) {
+	swizzle_copy(dst, src, x, y, width, height, stride, 8);
+}
+
+void SwizzleTexData128Bpp(uint8_t *dst, uint8_t *src, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t stride, uint32_t tileSize) {
+	swizzle_copy(dst, src, x, y, width, height, stride, 16);
+}
+
+void SwizzleTexDataETC1(uint8_t *dst, uint8_t *src, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t stride, uint32_t tileSize) {
+	swizzle_copy(dst, src, x, y, width, height, stride, 8);
+}
@@ -0,0 +1 @@
+#include "../../vitasdk.h"
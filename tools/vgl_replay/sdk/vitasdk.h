@@ -0,0 +1,390 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * vitasdk.h:
+ * Host stand-in for the vitasdk headers used by vitaGL, only declaring what vitaGL references.
+ * Enums that vitaGL packs into raw sceGxm words keep their real values, everything else is
+ * implemented by the fake sceGxm backend in fake_gxm.c and fake_kernel.c
+ */
+
+#ifndef _VGL_REPLAY_VITASDK_H_
+#define _VGL_REPLAY_VITASDK_H_
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Types
+typedef int SceUID;
+typedef unsigned int SceSize;
+typedef int SceSSize;
+typedef int SceBool;
+typedef int SceMode;
+typedef int64_t SceOff;
+typedef unsigned int SceUInt;
+typedef int32_t SceInt32;
+typedef uint32_t SceUInt32;
+typedef int64_t SceInt64;
+typedef uint64_t SceUInt64;
+typedef uint16_t SceUInt16;
+typedef uint8_t SceUInt8;
+typedef char SceChar8;
+typedef float SceFloat;
+typedef float SceFloat32;
+typedef uint64_t SceKernelSysClock;
+
+#define SCE_TRUE 1
+#define SCE_FALSE 0
+
+// Memory blocks
+typedef enum SceKernelMemBlockType {
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW = 0x09408060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE = 0x0C208060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_MAIN_PHYCONT_RW = 0x0C80D060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_MAIN_PHYCONT_NC_RW = 0x0D808060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_RW = 0x0C20D060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_MAIN_CDIALOG_RW = 0x0E20D060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_MAIN_CDIALOG_NC_RW = 0x0E208060
+} SceKernelMemBlockType;
+
+typedef struct SceKernelAllocMemBlockOpt {
+	SceSize size;
+	SceUInt32 attr;
+	SceSize alignment;
+	SceUInt32 uidBaseBlock;
+	const char *strBaseBlockName;
+	int flags;
+	int reserved[10];
+} SceKernelAllocMemBlockOpt;
+
+typedef struct SceKernelMemBlockInfo {
+	SceSize size;
+	void *mappedBase;
+	SceSize mappedSize;
+	int memoryType;
+	SceUInt32 access;
+	SceKernelMemBlockType type;
+} SceKernelMemBlockInfo;
+
+typedef struct SceKernelFreeMemorySizeInfo {
+	SceSize size;
+	SceSize size_user;
+	SceSize size_cdram;
+	SceSize size_phycont;
+} SceKernelFreeMemorySizeInfo;
+
+#define SCE_KERNEL_CPU_MASK_USER_ALL 0x70000
+
+SceUID sceKernelAllocMemBlock(const char *name, SceKernelMemBlockType type, SceSize size, SceKernelAllocMemBlockOpt *opt);
+int sceKernelFreeMemBlock(SceUID uid);
+int sceKernelGetMemBlockBase(SceUID uid, void **base);
+SceUID sceKernelFindMemBlockByAddr(const void *addr, SceSize size);
+int sceKernelGetMemBlockInfoByAddr(void *base, SceKernelMemBlockInfo *info);
+int sceKernelGetFreeMemorySize(SceKernelFreeMemorySizeInfo *info);
+
+// Threads and synchronization
+typedef int (*SceKernelThreadEntry)(SceSize args, void *argp);
+
+typedef struct SceKernelThreadOptParam {
+	SceSize size;
+	SceUInt32 attr;
+} SceKernelThreadOptParam;
+
+typedef struct SceKernelThreadInfo {
+	SceSize size;
+	SceUID processId;
+	char name[32];
+	SceUInt attr;
+	int status;
+	SceKernelThreadEntry entry;
+	void *stack;
+	int stackSize;
+	int initPriority;
+	int currentPriority;
+	int initCpuAffinityMask;
+	int currentCpuAffinityMask;
+	int currentCpuId;
+	int lastExecutedCpuId;
+	SceUInt waitType;
+	SceUID waitId;
+	int exitStatus;
+	SceKernelSysClock runClocks;
+	SceUInt intrPreemptCount;
+	SceUInt threadPreemptCount;
+	SceUInt threadReleaseCount;
+	SceUID fNotifyCallback;
+	int reserved;
+} SceKernelThreadInfo;
+
+typedef struct SceKernelSemaOptParam {
+	SceSize size;
+} SceKernelSemaOptParam;
+
+typedef struct SceKernelLwMutexWork {
+	SceInt64 data[4];
+} SceKernelLwMutexWork;
+
+typedef struct SceKernelLwMutexOptParam {
+	SceSize size;
+} SceKernelLwMutexOptParam;
+
+typedef struct SceKernelLMOption {
+	SceSize size;
+} SceKernelLMOption;
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority, SceSize stackSize, SceUInt attr, int cpuAffinityMask, const SceKernelThreadOptParam *option);
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp);
+int sceKernelExitDeleteThread(int status);
+int sceKernelDelayThread(SceUInt delay);
+int sceKernelGetThreadId(void);
+int sceKernelGetThreadInfo(SceUID thid, SceKernelThreadInfo *info);
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int initVal, int maxVal, SceKernelSemaOptParam *option);
+int sceKernelDeleteSema(SceUID semaid);
+int sceKernelSignalSema(SceUID semaid, int signal);
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout);
+int sceKernelCreateLwMutex(SceKernelLwMutexWork *pWork, const char *pName, unsigned int attr, int initCount, const SceKernelLwMutexOptParam *pOptParam);
+int sceKernelDeleteLwMutex(SceKernelLwMutexWork *pWork);
+int sceKernelLockLwMutex(SceKernelLwMutexWork *pWork, int lockCount, unsigned int *pTimeout);
+int sceKernelUnlockLwMutex(SceKernelLwMutexWork *pWork, int unlockCount);
+SceUInt32 sceKernelGetProcessTimeLow(void);
+SceUID sceKernelGetProcessId(void);
+SceUID sceKernelLoadStartModule(const char *path, SceSize args, void *argp, int flags, SceKernelLMOption *option, int *status);
+
+// C library
+typedef void *SceClibMspace;
+
+typedef struct SceClibMspaceStats {
+	SceSize capacity;
+	SceSize unk;
+	SceSize peak_in_use;
+	SceSize current_in_use;
+	SceSize unk2;
+	SceSize unk3;
+} SceClibMspaceStats;
+
+void *sceClibMemcpy(void *dst, const void *src, SceSize len);
+void *sceClibMemset(void *dst, int ch, SceSize len);
+void *sceClibMemmove(void *dst, const void *src, SceSize len);
+int sceClibMemcmp(const void *s1, const void *s2, SceSize len);
+int sceClibPrintf(const char *fmt, ...);
+SceClibMspace sceClibMspaceCreate(void *base, SceSize capacity);
+void *sceClibMspaceMalloc(SceClibMspace msp, SceSize size);
+void sceClibMspaceFree(SceClibMspace msp, void *ptr);
+void *sceClibMspaceCalloc(SceClibMspace msp, SceSize nelem, SceSize size);
+void *sceClibMspaceRealloc(SceClibMspace msp, void *ptr, SceSize size);
+void *sceClibMspaceMemalign(SceClibMspace msp, SceSize boundary, SceSize size);
+SceSize sceClibMspaceMallocUsableSize(void *ptr);
+void sceClibMspaceMallocStats(SceClibMspace msp, SceClibMspaceStats *stats);
+
+// DMA
+void *sceDmacMemcpy(void *dst, const void *src, SceSize size);
+
+// IO
+#define SCE_O_RDONLY 0x0001
+#define SCE_O_WRONLY 0x0002
+#define SCE_O_RDWR (SCE_O_RDONLY | SCE_O_WRONLY)
+#define SCE_O_APPEND 0x0100
+#define SCE_O_CREAT 0x0200
+#define SCE_O_TRUNC 0x0400
+
+#define SCE_SEEK_SET 0
+#define SCE_SEEK_CUR 1
+#define SCE_SEEK_END 2
+
+#define SCE_S_IFMT 0xF000
+#define SCE_S_IFDIR 0x1000
+#define SCE_S_ISDIR(m) (((m) & SCE_S_IFMT) == SCE_S_IFDIR)
+
+typedef struct SceDateTime {
+	unsigned short year;
+	unsigned short month;
+	unsigned short day;
+	unsigned short hour;
+	unsigned short minute;
+	unsigned short second;
+	unsigned int microsecond;
+} SceDateTime;
+
+typedef struct SceIoStat {
+	SceMode st_mode;
+	unsigned int st_attr;
+	SceOff st_size;
+	SceDateTime st_ctime;
+	SceDateTime st_atime;
+	SceDateTime st_mtime;
+	unsigned int st_private[6];
+} SceIoStat;
+
+typedef struct SceIoDirent {
+	SceIoStat d_stat;
+	char d_name[256];
+	void *d_private;
+	int dummy;
+} SceIoDirent;
+
+SceUID sceIoOpen(const char *file, int flags, SceMode mode);
+int sceIoClose(SceUID fd);
+int sceIoRead(SceUID fd, void *buf, SceSize nbyte);
+int sceIoWrite(SceUID fd, const void *buf, SceSize nbyte);
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence);
+int sceIoRemove(const char *file);
+int sceIoRename(const char *oldname, const char *newname);
+int sceIoMkdir(const char *dir, SceMode mode);
+int sceIoGetstat(const char *file, SceIoStat *stat);
+SceUID sceIoDopen(const char *dirname);
+int sceIoDread(SceUID fd, SceIoDirent *dir);
+int sceIoDclose(SceUID fd);
+
+// Display
+#define SCE_DISPLAY_PIXELFORMAT_A8B8G8R8 0
+#define SCE_DISPLAY_SETBUF_NEXTFRAME 1
+
+typedef struct SceDisplayFrameBuf {
+	SceSize size;
+	void *base;
+	unsigned int pitch;
+	unsigned int pixelformat;
+	unsigned int width;
+	unsigned int height;
+} SceDisplayFrameBuf;
+
+int sceDisplaySetFrameBuf(const SceDisplayFrameBuf *pParam, int sync);
+int sceDisplayWaitVblankStartMulti(unsigned int vcount);
+int sceDisplayGetMaximumFrameBufResolution(int *width, int *height);
+
+// Shared framebuffer
+typedef struct SceSharedFbInfo {
+	void *fb_base;
+	int fb_size;
+	void *fb_base2;
+	int unk0[6];
+	int stride;
+	int width;
+	int height;
+	int unk1;
+	int index;
+	int unk2[4];
+	int vsync;
+	int unk3[3];
+} SceSharedFbInfo;
+
+SceUID sceSharedFbOpen(int smth);
+int sceSharedFbClose(SceUID fb_id);
+int sceSharedFbBegin(SceUID fb_id, SceSharedFbInfo *info);
+int sceSharedFbEnd(SceUID fb_id);
+int sceSharedFbGetInfo(SceUID fb_id, SceSharedFbInfo *info);
+
+// Input
+#define SCE_CTRL_LEFT 0x0080
+#define SCE_CTRL_RIGHT 0x0020
+
+typedef struct SceCtrlData {
+	uint64_t timeStamp;
+	unsigned int buttons;
+	unsigned char lx;
+	unsigned char ly;
+	unsigned char rx;
+	unsigned char ry;
+	uint8_t up;
+	uint8_t right;
+	uint8_t down;
+	uint8_t left;
+	uint8_t lt;
+	uint8_t rt;
+	uint8_t l1;
+	uint8_t r1;
+	uint8_t triangle;
+	uint8_t circle;
+	uint8_t cross;
+	uint8_t square;
+	uint8_t reserved[4];
+} SceCtrlData;
+
+int sceCtrlPeekBufferPositive(int port, SceCtrlData *pad_data, int count);
+
+// Application manager
+typedef struct SceAppMgrBudgetInfo {
+	int size;
+	int app_mode;
+	int unk0;
+	unsigned int total_user_rw_mem;
+	unsigned int free_user_rw;
+	SceBool extra_mem_allowed;
+	int unk1;
+	unsigned int total_extra_mem;
+	unsigned int free_extra_mem;
+	int unk2[2];
+	unsigned int total_phycont_mem;
+	unsigned int free_phycont_mem;
+	int unk3[10];
+	unsigned int total_cdram_mem;
+	unsigned int free_cdram_mem;
+	int reserved[9];
+} SceAppMgrBudgetInfo;
+
+int sceAppMgrGetBudgetInfo(SceAppMgrBudgetInfo *info);
+int sceAppMgrAppParamGetString(int pid, int param, char *string, SceSize length);
+
+// Common dialog
+typedef struct SceCommonDialogRenderTargetInfo {
+	void *depthSurfaceData;
+	void *colorSurfaceData;
+	uint32_t surfaceType;
+	uint32_t colorFormat;
+	uint32_t width;
+	uint32_t height;
+	uint32_t strideInPixels;
+	uint8_t reserved[32];
+} SceCommonDialogRenderTargetInfo;
+
+typedef struct SceCommonDialogUpdateParam {
+	SceCommonDialogRenderTargetInfo renderTarget;
+	void *displaySyncObject;
+	uint8_t reserved[32];
+} SceCommonDialogUpdateParam;
+
+int sceCommonDialogUpdate(const SceCommonDialogUpdateParam *updateParam);
+
+// RTC
+typedef struct SceRtcTick {
+	SceUInt64 tick;
+} SceRtcTick;
+
+int sceRtcGetCurrentTick(SceRtcTick *tick);
+SceUInt32 sceRtcGetTickResolution(void);
+
+// System modules
+typedef enum SceSysmoduleModuleId {
+	SCE_SYSMODULE_RAZOR_HUD = 0x0047,
+	SCE_SYSMODULE_RAZOR_CAPTURE = 0x0048
+} SceSysmoduleModuleId;
+
+int sceSysmoduleLoadModule(SceSysmoduleModuleId id);
+
+#include "psp2/gxm.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * vitashark.h:
+ * Host stand-in for the vitaShaRK runtime shader compiler, implemented by fake_shark.c
+ */
+
+#ifndef _VGL_REPLAY_VITASHARK_H_
+#define _VGL_REPLAY_VITASHARK_H_
+
+#include <stdint.h>
+#include "psp2/gxm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum shark_type {
+	SHARK_VERTEX_SHADER,
+	SHARK_FRAGMENT_SHADER
+} shark_type;
+
+typedef enum shark_opt {
+	SHARK_OPT_SLOW,
+	SHARK_OPT_SAFE,
+	SHARK_OPT_DEFAULT,
+	SHARK_OPT_FAST,
+	SHARK_OPT_UNSAFE
+} shark_opt;
+
+typedef enum shark_log_level {
+	SHARK_LOG_INFO,
+	SHARK_LOG_WARNING,
+	SHARK_LOG_ERROR
+} shark_log_level;
+
+typedef enum shark_warn_level {
+	SHARK_WARN_SILENT,
+	SHARK_WARN_LOW,
+	SHARK_WARN_MEDIUM,
+	SHARK_WARN_HIGH,
+	SHARK_WARN_MAX
+} shark_warn_level;
+
+int shark_init(const char *path);
+void shark_end(void);
+void shark_set_allocators(void *(*malloc_func)(size_t size), void (*free_func)(void *ptr));
+void shark_install_log_cb(void (*cb)(const char *msg, shark_log_level msg_level, int line));
+void shark_set_warnings_level(shark_warn_level level);
+void shark_set_shader_association_path(const char *path);
+SceGxmProgram *shark_compile_shader_extended(const char *src, uint32_t *size, shark_type type, shark_opt opt, int32_t use_fastmath, int32_t use_fastprecision, int32_t use_fastint);
+SceGxmProgram *shark_compile_shader(const char *src, uint32_t *size, shark_type type);
+void shark_clear_output(void);
+void *shark_get_internal_compile_output(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,816 @@
+/*
+ * This file is part of vitaGL
+ * Copyright 2017, 2018, 2019, 2020 Rinnegatamante
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * vgl_replay.c:
+ * Replays frame captures stored with vglCaptureFrames on top of the fake host backends,
+ * writing a capture with the host CPU time spent in every replayed call
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fake_host.h"
+#include "shared.h"
+
+#define REPLAY_STACK_SIZE (8 * 1024 * 1024)
+#define REPLAY_LEGACY_POOL_SIZE (8 * 1024 * 1024) // Immediate mode vertices pool size
+#define REPLAY_INITIAL_MAP_SIZE 1024
+#define REPLAY_ZERO_ARRAY_SIZE (1024 * 1024) // Backing memory of client arrays whose content was not captured
+
+// Open addressing hash map of 64 bit keys (0 being reserved for empty entries)
+typedef struct {
+	uint64_t *keys;
+	uint64_t *values;
+	uint32_t size;
+	uint32_t num;
+} replay_map;
+
+typedef struct {
+	const char *in_path;
+	const char *out_path;
+	int res;
+} replay_job;
+
+static uint8_t *cap_data; // Capture file content
+static uint32_t cap_size;
+static const capture_header_call *cap_calls;
+static const char *cap_categories;
+static uint32_t cap_records_offs; // Offset of the first record
+
+static replay_map blobs; // Hash -> offset of the data in the capture
+static replay_map names; // Kind and captured name -> replayed name
+
+static uint64_t call_ns[CAPTURE_CALLS_NUM]; // Host CPU time spent per call
+static uint32_t call_count[CAPTURE_CALLS_NUM];
+static uint64_t call_rem_ns[CAPTURE_CALLS_NUM]; // Time not yet reported in whole microseconds
+static uint64_t frames_ns;
+
+// Replayer copies of the bindings internal records temporarily change
+static GLuint cur_array_buffer = 0;
+static GLenum cur_active_texture = GL_TEXTURE0;
+static GLenum cur_client_texture = GL_TEXTURE0;
+
+static void *zero_array = NULL;
+
+static uint64_t host_cpu_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t map_slot(replay_map *m, uint64_t key) {
+	uint32_t i = (uint32_t)(key ^ (key >> 29)) * 2654435761u & (m->size - 1);
+	while (m->keys[i] && m->keys[i] != key)
+		i = (i + 1) & (m->size - 1);
+	return i;
+}
+
+static void map_put(replay_map *m, uint64_t key, uint64_t value) {
+	if ((m->num + 1) * 2 > m->size) {
+		replay_map old = *m;
+		m->size = old.size ? old.size * 2 : REPLAY_INITIAL_MAP_SIZE;
+		m->keys = calloc(m->size, sizeof(uint64_t));
+		m->values = calloc(m->size, sizeof(uint64_t));
+		m->num = 0;
+		for (uint32_t i = 0; i < old.size; i++) {
+			if (old.keys[i])
+				map_put(m, old.keys[i], old.values[i]);
+		}
+		free(old.keys);
+		free(old.values);
+	}
+	uint32_t i = map_slot(m, key);
+	if (!m->keys[i]) {
+		m->keys[i] = key;
+		m->num++;
+	}
+	m->values[i] = value;
+}
+
+static GLboolean map_get(replay_map *m, uint64_t key, uint64_t *value) {
+	if (!m->size)
+		return GL_FALSE;
+	uint32_t i = map_slot(m, key);
+	if (!m->keys[i])
+		return GL_FALSE;
+	*value = m->values[i];
+	return GL_TRUE;
+}
+
+static void map_free(replay_map *m) {
+	free(m->keys);
+	free(m->values);
+	memset(m, 0, sizeof(replay_map));
+}
+
+// Returns the data referenced by the hash stored in the given arguments
+static const void *blob_data(const uint32_t *hash, uint32_t *size) {
+	uint64_t offs;
+	uint64_t key = hash[0] | ((uint64_t)hash[1] << 32);
+	if (!key || !map_get(&blobs, key, &offs)) {
+		if (size)
+			*size = 0;
+		return NULL;
+	}
+	// Blob records data follows their hash and size arguments
+	if (size)
+		*size = ((const uint32_t *)(cap_data + offs))[-1];
+	return cap_data + offs;
+}
+
+// Returns the replayed name of a captured object, creating it the first time it gets referenced
+static GLuint name_of(uint8_t kind, uint32_t name) {
+	if (!name)
+		return 0;
+	uint64_t res;
+	uint64_t key = ((uint64_t)kind << 32) | name;
+	if (map_get(&names, key, &res))
+		return (GLuint)res;
+	GLuint obj = 0;
+	switch (kind) {
+	case CAPTURE_OBJ_BUFFER:
+		glGenBuffers(1, &obj);
+		break;
+	case CAPTURE_OBJ_TEXTURE:
+		glGenTextures(1, &obj);
+		break;
+	case CAPTURE_OBJ_PROGRAM:
+		obj = glCreateProgram();
+		break;
+	default:
+		break;
+	}
+	map_put(&names, key, obj);
+	return obj;
+}
+
+static void bind_array_buffer(GLuint buffer) {
+	cur_array_buffer = buffer;
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+}
+
+static const GLvoid *array_pointer(const capture_vertex_array *a) {
+	if (a->buffer)
+		return (const GLvoid *)a->offset;
+	const void *data = blob_data(a->hash, NULL);
+	return data ? data : zero_array;
+}
+
+// Maps the sceGxm format textures got created with to an equivalent GL upload
+static void texture_format_to_gl(SceGxmTextureFormat format, GLenum *internal_format, GLenum *fmt, GLenum *type, GLboolean *compressed) {
+	*type = GL_UNSIGNED_BYTE;
+	*compressed = GL_FALSE;
+	switch (format) {
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8_BGR:
+		*internal_format = *fmt = GL_RGB;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U5U6U5_RGB:
+		*internal_format = *fmt = GL_RGB;
+		*type = GL_UNSIGNED_SHORT_5_6_5;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U5U5U5U1_RGBA:
+		*internal_format = *fmt = GL_RGBA;
+		*type = GL_UNSIGNED_SHORT_5_5_5_1;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U4U4U4U4_RGBA:
+		*internal_format = *fmt = GL_RGBA;
+		*type = GL_UNSIGNED_SHORT_4_4_4_4;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8_RGB:
+		*internal_format = *fmt = GL_BGR;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ARGB:
+		*internal_format = *fmt = GL_BGRA;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_RGBA:
+		*internal_format = *fmt = GL_ABGR_EXT;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U8_RRRR:
+		*internal_format = GL_INTENSITY;
+		*fmt = GL_RED;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U8_R111:
+		*internal_format = *fmt = GL_ALPHA;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U8_R:
+		*internal_format = *fmt = GL_RED;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_L8:
+		*internal_format = *fmt = GL_LUMINANCE;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U8U8_GR:
+		*internal_format = *fmt = GL_RG;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_A8L8:
+		*internal_format = *fmt = GL_LUMINANCE_ALPHA;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_UBC1_ABGR:
+		*internal_format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		*compressed = GL_TRUE;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_UBC2_ABGR:
+		*internal_format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+		*compressed = GL_TRUE;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_UBC3_ABGR:
+		*internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		*compressed = GL_TRUE;
+		break;
+	default:
+		*internal_format = *fmt = GL_RGBA;
+		break;
+	}
+}
+
+static void replay_texture(const uint32_t *args) {
+	GLuint tex = name_of(CAPTURE_OBJ_TEXTURE, args[0]);
+	GLenum target = args[1];
+	GLsizei width = args[2], height = args[3];
+	if (!width || !height)
+		return;
+
+	// Textures are recreated with empty content, uploads performed while capturing replace it
+	GLint bound;
+	glGetIntegerv(target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_BINDING_CUBE_MAP : GL_TEXTURE_BINDING_2D, &bound);
+	glBindTexture(target, tex);
+	GLenum internal_format, fmt, type;
+	GLboolean compressed;
+	texture_format_to_gl(args[4], &internal_format, &fmt, &type, &compressed);
+	for (int face = 0; face < (target == GL_TEXTURE_CUBE_MAP ? 6 : 1); face++) {
+		GLenum face_target = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+		if (compressed) {
+			GLsizei size = ((width + 3) / 4) * ((height + 3) / 4) * (internal_format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 8 : 16);
+			glCompressedTexImage2D(face_target, 0, internal_format, width, height, 0, size, NULL);
+		} else
+			glTexImage2D(face_target, 0, internal_format, width, height, 0, fmt, type, NULL);
+	}
+	if (args[5] > 1)
+		glGenerateMipmap(target);
+	glBindTexture(target, bound);
+}
+
+static void replay_shader(const uint32_t *args) {
+	uint32_t size;
+	const GLchar *data = (const GLchar *)blob_data(&args[3], &size);
+	GLuint shad = glCreateShader(args[1]);
+	map_put(&names, ((uint64_t)CAPTURE_OBJ_SHADER << 32) | args[0], shad);
+	if (!data)
+		return;
+	if (args[2])
+		glShaderBinary(1, &shad, 0, data, size);
+	else {
+		GLint len = size;
+		glShaderSource(shad, 1, &data, &len);
+	}
+}
+
+static void replay_program(const uint32_t *args) {
+	uint32_t size;
+	const capture_program_entry *e = (const capture_program_entry *)blob_data(&args[4], &size);
+	GLuint prog = name_of(CAPTURE_OBJ_PROGRAM, args[0]);
+	if (args[1])
+		glAttachShader(prog, name_of(CAPTURE_OBJ_SHADER, args[1]));
+	if (args[2])
+		glAttachShader(prog, name_of(CAPTURE_OBJ_SHADER, args[2]));
+	if (!args[3])
+		return;
+
+	uint32_t n = e ? size / sizeof(capture_program_entry) : 0;
+	for (uint32_t i = 0; i < n; i++) {
+		if (e[i].kind == CAPTURE_PROG_ATTRIB)
+			glBindAttribLocation(prog, e[i].value, e[i].name);
+	}
+	glLinkProgram(prog);
+	for (uint32_t i = 0; i < n; i++) {
+		if (e[i].kind == CAPTURE_PROG_SAMPLER)
+			glUniform1i(glGetUniformLocation(prog, e[i].name), e[i].value);
+		else if (e[i].kind == CAPTURE_PROG_PALETTE)
+			vglMatrixPaletteUniform(prog, glGetUniformLocation(prog, e[i].name));
+	}
+}
+
+// Changes a capability only if needed, as some of them (e.g. scissor test) cost extra GPU work whenever they get set
+static void set_capability(GLenum cap, uint32_t enabled) {
+	if (!glIsEnabled(cap) == !enabled)
+		return;
+	if (enabled)
+		glEnable(cap);
+	else
+		glDisable(cap);
+}
+
+static void replay_state(const uint32_t *args) {
+	uint32_t size;
+	const capture_texture_unit *units = (const capture_texture_unit *)blob_data(&args[4], &size);
+	if (units) {
+		const uint32_t(*caps)[2] = (const uint32_t(*)[2])&units[COMBINED_TEXTURE_IMAGE_UNITS_NUM];
+		uint32_t caps_num = (size - COMBINED_TEXTURE_IMAGE_UNITS_NUM * sizeof(capture_texture_unit)) / (2 * sizeof(uint32_t));
+		for (int i = 0; i < COMBINED_TEXTURE_IMAGE_UNITS_NUM; i++) {
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(GL_TEXTURE_2D, name_of(CAPTURE_OBJ_TEXTURE, units[i].tex_id[0]));
+#ifdef HAVE_UNPURE_TEXFORMATS
+			glBindTexture(GL_TEXTURE_1D, name_of(CAPTURE_OBJ_TEXTURE, units[i].tex_id[1]));
+#endif
+			glBindTexture(GL_TEXTURE_CUBE_MAP, name_of(CAPTURE_OBJ_TEXTURE, units[i].tex_id[2]));
+			set_capability(GL_TEXTURE_1D, units[i].state & (1 << 0));
+			set_capability(GL_TEXTURE_2D, units[i].state & (1 << 1));
+		}
+		for (uint32_t i = 0; i < caps_num; i++)
+			set_capability(caps[i][0], caps[i][1]);
+	}
+	glUseProgram(name_of(CAPTURE_OBJ_PROGRAM, args[0]));
+	cur_active_texture = GL_TEXTURE0 + args[1];
+	glActiveTexture(cur_active_texture);
+	cur_client_texture = GL_TEXTURE0 + args[2];
+	glClientActiveTexture(cur_client_texture);
+	bind_array_buffer(name_of(CAPTURE_OBJ_BUFFER, args[3]));
+}
+
+static void replay_vertex_arrays(const uint32_t *args) {
+	uint32_t size;
+	const capture_vertex_array *a = (const capture_vertex_array *)blob_data(&args[2], &size);
+	uint32_t n = a ? size / sizeof(capture_vertex_array) : 0;
+	if (args[0]) {
+		uint32_t enabled = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			glBindBuffer(GL_ARRAY_BUFFER, name_of(CAPTURE_OBJ_BUFFER, a[i].buffer));
+			enabled |= 1 << a[i].index;
+			switch (a[i].index) {
+			case CAPTURE_FFP_VERTEX:
+				glVertexPointer(a[i].size, a[i].type, a[i].stride, array_pointer(&a[i]));
+				break;
+			case CAPTURE_FFP_COLOR:
+				glColorPointer(a[i].size, a[i].type, a[i].stride, array_pointer(&a[i]));
+				break;
+			case CAPTURE_FFP_NORMAL:
+				glNormalPointer(a[i].type, a[i].stride, array_pointer(&a[i]));
+				break;
+			default:
+				glClientActiveTexture(GL_TEXTURE0 + a[i].index - CAPTURE_FFP_TEXCOORD);
+				glTexCoordPointer(a[i].size, a[i].type, a[i].stride, array_pointer(&a[i]));
+				break;
+			}
+		}
+		static const GLenum arrays[] = {GL_VERTEX_ARRAY, GL_COLOR_ARRAY, GL_NORMAL_ARRAY};
+		for (int i = 0; i < CAPTURE_FFP_TEXCOORD + TEXTURE_COORDS_NUM; i++) {
+			GLenum array = GL_TEXTURE_COORD_ARRAY;
+			if (i < CAPTURE_FFP_TEXCOORD)
+				array = arrays[i];
+			else
+				glClientActiveTexture(GL_TEXTURE0 + i - CAPTURE_FFP_TEXCOORD);
+			if (enabled & (1 << i))
+				glEnableClientState(array);
+			else
+				glDisableClientState(array);
+		}
+		glClientActiveTexture(cur_client_texture);
+	} else {
+		uint32_t enabled = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			glBindBuffer(GL_ARRAY_BUFFER, name_of(CAPTURE_OBJ_BUFFER, a[i].buffer));
+			glVertexAttribPointer(a[i].index, a[i].size, a[i].type, a[i].normalized, a[i].stride, array_pointer(&a[i]));
+			glVertexAttribDivisor(a[i].index, a[i].divisor);
+			enabled |= 1 << a[i].index;
+		}
+		for (int i = 0; i < VERTEX_ATTRIBS_NUM; i++) {
+			if (enabled & (1 << i))
+				glEnableVertexAttribArray(i);
+			else
+				glDisableVertexAttribArray(i);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, cur_array_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, name_of(CAPTURE_OBJ_BUFFER, args[1]));
+}
+
+static void replay_load_matrix(const uint32_t *args) {
+	const GLfloat *m = (const GLfloat *)blob_data(&args[2], NULL);
+	if (!m)
+		return;
+	if (args[0] == GL_TEXTURE) {
+		glActiveTexture(GL_TEXTURE0 + args[1]);
+		glMatrixLoadf(GL_TEXTURE, m);
+		glActiveTexture(cur_active_texture);
+	} else
+		glMatrixLoadf(args[0], m);
+}
+
+// Replays an internal record, returning GL_FALSE for unknown records
+static GLboolean replay_internal(uint8_t call, const uint32_t *args) {
+	const void *data;
+	switch (call) {
+	case CAPTURE_STATE:
+		replay_state(args);
+		break;
+	case CAPTURE_BUFFER:
+		glNamedBufferData(name_of(CAPTURE_OBJ_BUFFER, args[0]), args[1], blob_data(&args[2], NULL), GL_STATIC_DRAW);
+		break;
+	case CAPTURE_TEXTURE:
+		replay_texture(args);
+		break;
+	case CAPTURE_SHADER:
+		replay_shader(args);
+		break;
+	case CAPTURE_PROGRAM:
+		replay_program(args);
+		break;
+	case CAPTURE_UNIFORM_LOCATION:
+		data = blob_data(&args[2], NULL);
+		if (data)
+			map_put(&names, ((uint64_t)CAPTURE_OBJ_UNIFORM << 32) | args[0], (uint32_t)glGetUniformLocation(name_of(CAPTURE_OBJ_PROGRAM, args[1]), data));
+		break;
+	case CAPTURE_VERTEX_ARRAYS:
+		replay_vertex_arrays(args);
+		break;
+	case CAPTURE_LOAD_MATRIX:
+		replay_load_matrix(args);
+		break;
+	default:
+		return GL_FALSE;
+	}
+	return GL_TRUE;
+}
+
+static void replay_uniform(const uint32_t *args) {
+	uint64_t loc;
+	const void *v = blob_data(&args[4], NULL);
+	if (!v || !map_get(&names, ((uint64_t)CAPTURE_OBJ_UNIFORM << 32) | args[0], &loc))
+		return;
+	GLint location = (GLint)loc;
+	GLsizei count = args[2];
+	switch (args[1]) {
+	case GL_INT:
+		glUniform1iv(location, count, v);
+		break;
+	case GL_INT_VEC2:
+		glUniform2iv(location, count, v);
+		break;
+	case GL_INT_VEC3:
+		glUniform3iv(location, count, v);
+		break;
+	case GL_INT_VEC4:
+		glUniform4iv(location, count, v);
+		break;
+	case GL_FLOAT:
+		glUniform1fv(location, count, v);
+		break;
+	case GL_FLOAT_VEC2:
+		glUniform2fv(location, count, v);
+		break;
+	case GL_FLOAT_VEC3:
+		glUniform3fv(location, count, v);
+		break;
+	case GL_FLOAT_VEC4:
+		glUniform4fv(location, count, v);
+		break;
+	case GL_FLOAT_MAT2:
+		glUniformMatrix2fv(location, count, args[3], v);
+		break;
+	case GL_FLOAT_MAT3:
+		glUniformMatrix3fv(location, count, args[3], v);
+		break;
+	case GL_FLOAT_MAT4:
+		glUniformMatrix4fv(location, count, args[3], v);
+		break;
+	default:
+		break;
+	}
+}
+
+// Immediate mode vertices are submitted again, only glEnd gets timed as on the device
+static void replay_immediate(const uint32_t *args) {
+	uint32_t stride = args[2], texcoords_num = args[3];
+	const GLfloat *v = (const GLfloat *)blob_data(&args[5], NULL);
+	glBegin(args[0]);
+	for (uint32_t i = 0; v && i < args[1]; i++, v += stride) {
+		// Attributes only tracked for lighting are not stored in the compacted layout replayed here
+		if (!args[4])
+			glColor4fv(&v[3 + texcoords_num * 2]);
+		for (uint32_t j = 0; j < texcoords_num; j++)
+			glMultiTexCoord2f(GL_TEXTURE0 + j, v[3 + j * 2], v[4 + j * 2]);
+		glVertex3fv(v);
+	}
+}
+
+static void replay_multi_elements(const uint32_t *args, GLboolean is_indirect) {
+	uint32_t size;
+	const uint8_t *data = (const uint8_t *)blob_data(&args[is_indirect ? 5 : 4], &size);
+	if (!data)
+		return;
+	if (is_indirect) {
+		GLsizei drawcount = args[3];
+		uint32_t cmds_size = drawcount * sizeof(vglDrawElementsIndirectCommand);
+		const void *indices = size > cmds_size ? data + cmds_size : (const void *)args[2];
+		vglMultiDrawElementsIndirect(args[0], args[1], indices, (const vglDrawElementsIndirectCommand *)data, drawcount);
+		return;
+	}
+
+	GLsizei drawcount = args[2];
+	const uint32_t *counts = (const uint32_t *)data;
+	const uint32_t *bases = counts + drawcount;
+	const uint32_t *offsets = bases + drawcount;
+	GLboolean is_client = size > drawcount * 3 * sizeof(uint32_t);
+	const void **indices = malloc(drawcount * sizeof(void *));
+	GLboolean has_bases = GL_FALSE;
+	for (int j = 0; j < drawcount; j++) {
+		indices[j] = is_client ? (const void *)(data + drawcount * 3 * sizeof(uint32_t) + offsets[j]) : (const void *)offsets[j];
+		if (bases[j])
+			has_bases = GL_TRUE;
+	}
+	if (has_bases)
+		glMultiDrawElementsBaseVertex(args[0], (const GLsizei *)counts, args[1], indices, drawcount, (const GLint *)bases);
+	else
+		glMultiDrawElements(args[0], (const GLsizei *)counts, args[1], indices, drawcount);
+	free(indices);
+}
+
+// Replays a timed call, returning GL_FALSE for unknown calls
+static GLboolean replay_call(uint8_t call, const uint32_t *args) {
+	uint32_t size;
+	const void *data;
+	GLuint obj;
+	switch (call) {
+	case CAPTURE_DRAW_ARRAYS:
+		glDrawArrays(args[0], args[1], args[2]);
+		break;
+	case CAPTURE_DRAW_ARRAYS_INSTANCED:
+		glDrawArraysInstanced(args[0], args[1], args[2], args[3]);
+		break;
+	case CAPTURE_MULTI_DRAW_ARRAYS:
+		data = blob_data(&args[4], NULL);
+		if (!data)
+			break;
+		if (args[2])
+			vglMultiDrawArraysMatrices(args[0], (const GLint *)data, (const GLsizei *)data + args[1], (const GLfloat *)data + args[1] * 2, args[1]);
+		else
+			glMultiDrawArrays(args[0], (const GLint *)data, (const GLsizei *)data + args[1], args[1]);
+		break;
+	case CAPTURE_DRAW_ELEMENTS:
+		data = blob_data(&args[5], NULL);
+		glDrawElements(args[0], args[1], args[2], data ? data : (const void *)args[3]);
+		break;
+	case CAPTURE_DRAW_ELEMENTS_BASE_VERTEX:
+		data = blob_data(&args[6], NULL);
+		glDrawElementsBaseVertex(args[0], args[1], args[2], data ? data : (const void *)args[3], args[4]);
+		break;
+	case CAPTURE_DRAW_RANGE_ELEMENTS:
+		data = blob_data(&args[8], NULL);
+		if (args[6])
+			glDrawRangeElementsBaseVertex(args[0], args[1], args[2], args[3], args[4], (void *)(data ? data : (const void *)args[5]), args[6]);
+		else
+			glDrawRangeElements(args[0], args[1], args[2], args[3], args[4], data ? data : (const void *)args[5]);
+		break;
+	case CAPTURE_DRAW_ELEMENTS_INSTANCED:
+		data = blob_data(&args[6], NULL);
+		glDrawElementsInstanced(args[0], args[1], args[2], data ? data : (const void *)args[3], args[4]);
+		break;
+	case CAPTURE_MULTI_DRAW_ELEMENTS:
+		replay_multi_elements(args, GL_FALSE);
+		break;
+	case CAPTURE_MULTI_DRAW_ELEMENTS_INDIRECT:
+		replay_multi_elements(args, GL_TRUE);
+		break;
+	case CAPTURE_END:
+		glEnd();
+		break;
+	case CAPTURE_CLEAR:
+		glClear(args[0]);
+		break;
+	case CAPTURE_BUFFER_DATA:
+		glNamedBufferData(name_of(CAPTURE_OBJ_BUFFER, args[0]), args[1], blob_data(&args[3], NULL), args[2]);
+		break;
+	case CAPTURE_BUFFER_SUB_DATA:
+		data = blob_data(&args[3], NULL);
+		if (data)
+			glNamedBufferSubData(name_of(CAPTURE_OBJ_BUFFER, args[0]), args[1], args[2], data);
+		break;
+	case CAPTURE_TEX_IMAGE_2D:
+		glTexImage2D(args[0], args[1], args[2], args[3], args[4], 0, args[5], args[6], blob_data(&args[7], NULL));
+		break;
+	case CAPTURE_TEX_SUB_IMAGE_2D:
+		data = blob_data(&args[8], NULL);
+		if (data)
+			glTexSubImage2D(args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7], data);
+		break;
+	case CAPTURE_COMPRESSED_TEX_IMAGE_2D:
+		glCompressedTexImage2D(args[0], args[1], args[2], args[3], args[4], 0, args[5], blob_data(&args[6], NULL));
+		break;
+	case CAPTURE_BIND_BUFFER:
+		obj = name_of(CAPTURE_OBJ_BUFFER, args[1]);
+		if (args[0] == GL_ARRAY_BUFFER)
+			bind_array_buffer(obj);
+		else
+			glBindBuffer(args[0], obj);
+		break;
+	case CAPTURE_BIND_TEXTURE:
+		glBindTexture(args[0], name_of(CAPTURE_OBJ_TEXTURE, args[1]));
+		break;
+	case CAPTURE_ACTIVE_TEXTURE:
+		cur_active_texture = args[0];
+		glActiveTexture(args[0]);
+		break;
+	case CAPTURE_ENABLE:
+		glEnable(args[0]);
+		break;
+	case CAPTURE_DISABLE:
+		glDisable(args[0]);
+		break;
+	case CAPTURE_USE_PROGRAM:
+		glUseProgram(name_of(CAPTURE_OBJ_PROGRAM, args[0]));
+		break;
+	case CAPTURE_UNIFORM:
+		replay_uniform(args);
+		break;
+	case CAPTURE_SHADER_SOURCE:
+		data = blob_data(&args[1], &size);
+		if (data) {
+			GLint len = size;
+			glShaderSource(name_of(CAPTURE_OBJ_SHADER, args[0]), 1, (const GLchar *const *)&data, &len);
+		}
+		break;
+	case CAPTURE_COMPILE_SHADER:
+		glCompileShader(name_of(CAPTURE_OBJ_SHADER, args[0]));
+		break;
+	case CAPTURE_ATTACH_SHADER:
+		glAttachShader(name_of(CAPTURE_OBJ_PROGRAM, args[0]), name_of(CAPTURE_OBJ_SHADER, args[1]));
+		break;
+	case CAPTURE_BIND_ATTRIB_LOCATION:
+		data = blob_data(&args[2], NULL);
+		if (data)
+			glBindAttribLocation(name_of(CAPTURE_OBJ_PROGRAM, args[0]), args[1], data);
+		break;
+	case CAPTURE_LINK_PROGRAM:
+		glLinkProgram(name_of(CAPTURE_OBJ_PROGRAM, args[0]));
+		break;
+	default:
+		return GL_FALSE;
+	}
+	return GL_TRUE;
+}
+
+// Converts a call duration to microseconds, carrying sub microsecond remainders over to the next call of the same kind
+static uint32_t account_call(uint8_t call, uint64_t ns) {
+	call_ns[call] += ns;
+	call_count[call]++;
+	call_rem_ns[call] += ns;
+	uint32_t us = call_rem_ns[call] / 1000;
+	call_rem_ns[call] -= us * 1000ULL;
+	return us;
+}
+
+static GLboolean load_capture(const char *path) {
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return GL_FALSE;
+	}
+	fseek(f, 0, SEEK_END);
+	cap_size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	cap_data = malloc(cap_size);
+	if (fread(cap_data, 1, cap_size, f) != cap_size)
+		cap_size = 0;
+	fclose(f);
+
+	const capture_header *hdr = (const capture_header *)cap_data;
+	if (cap_size < sizeof(capture_header) || hdr->magic != CAPTURE_MAGIC || hdr->version != CAPTURE_VERSION) {
+		fprintf(stderr, "%s is not a vitaGL frame capture (or has an unsupported version)\n", path);
+		return GL_FALSE;
+	}
+	if (hdr->calls_num != CAPTURE_CALLS_NUM) {
+		fprintf(stderr, "%s has been captured with a different set of calls\n", path);
+		return GL_FALSE;
+	}
+	cap_calls = (const capture_header_call *)(cap_data + sizeof(capture_header));
+	cap_categories = (const char *)&cap_calls[hdr->calls_num];
+	cap_records_offs = sizeof(capture_header) + hdr->calls_num * sizeof(capture_header_call) + hdr->categories_num * CAPTURE_NAME_SIZE;
+	return GL_TRUE;
+}
+
+static void print_report(void) {
+	const capture_header *hdr = (const capture_header *)cap_data;
+	uint32_t frames = call_count[CAPTURE_FRAME] ? call_count[CAPTURE_FRAME] : 1;
+	printf("%u frames replayed, frame time avg %.3f ms\n\n", call_count[CAPTURE_FRAME], frames_ns / 1000000.0 / frames);
+	printf("%-16s %10s %12s %12s\n", "Category", "Calls", "Total ms", "ms/frame");
+	for (uint32_t c = 0; c < hdr->categories_num; c++) {
+		uint64_t ns = 0;
+		uint32_t count = 0;
+		for (int i = CAPTURE_FRAME + 1; i < CAPTURE_CALLS_NUM; i++) {
+			if (cap_calls[i].category == c) {
+				ns += call_ns[i];
+				count += call_count[i];
+			}
+		}
+		if (count)
+			printf("%-16.*s %10u %12.3f %12.3f\n", CAPTURE_NAME_SIZE, &cap_categories[c * CAPTURE_NAME_SIZE], count, ns / 1000000.0, ns / 1000000.0 / frames);
+	}
+	printf("\nsceGxm: %u scenes, %u draws, %llu indices\n", gxm_stats.scenes, gxm_stats.draws, (unsigned long long)gxm_stats.indices);
+}
+
+static void *replay(void *arg) {
+	replay_job *job = (replay_job *)arg;
+	job->res = 1;
+	if (!load_capture(job->in_path))
+		return NULL;
+	FILE *out = NULL;
+	if (job->out_path) {
+		out = fopen(job->out_path, "wb");
+		if (!out) {
+			fprintf(stderr, "cannot create %s\n", job->out_path);
+			return NULL;
+		}
+		fwrite(cap_data, 1, cap_records_offs, out);
+	}
+
+	vglInitExtended(REPLAY_LEGACY_POOL_SIZE, DISPLAY_WIDTH_DEF, DISPLAY_HEIGHT_DEF, 0x1000000, SCE_GXM_MULTISAMPLE_NONE);
+	zero_array = calloc(1, REPLAY_ZERO_ARRAY_SIZE);
+	// The boot splashscreen keeps submitting scenes until the first frame gets rendered, none of that work is part of the replay
+	glClear(GL_COLOR_BUFFER_BIT);
+	vglSwapBuffers(GL_FALSE);
+	memset(&gxm_stats, 0, sizeof(gxm_stats));
+
+	uint32_t offs = cap_records_offs;
+	uint64_t frame_start = host_cpu_ns();
+	while (offs + sizeof(capture_record) <= cap_size) {
+		capture_record rec = *(const capture_record *)(cap_data + offs);
+		const uint32_t *args = (const uint32_t *)(cap_data + offs + sizeof(capture_record));
+		uint32_t rec_size = sizeof(capture_record) + rec.args_num * sizeof(uint32_t);
+		if (offs + rec_size > cap_size)
+			break;
+
+		if (rec.call == CAPTURE_BLOB) {
+			map_put(&blobs, args[0] | ((uint64_t)args[1] << 32), offs + rec_size);
+			rec_size += (args[2] + 3) & ~3;
+		} else if (rec.call == CAPTURE_FRAME) {
+			vglSwapBuffers(GL_FALSE);
+			uint64_t now = host_cpu_ns();
+			frames_ns += now - frame_start;
+			call_count[CAPTURE_FRAME]++;
+			rec.duration = (now - frame_start) / 1000;
+			frame_start = now;
+		} else if (rec.call < CAPTURE_CALLS_NUM && cap_calls[rec.call].category == 0) {
+			// Recreating captured state is not accounted in the frame time
+			uint64_t start = host_cpu_ns();
+			replay_internal(rec.call, args);
+			frame_start += host_cpu_ns() - start;
+		} else {
+			if (rec.call == CAPTURE_END)
+				replay_immediate(args);
+			uint64_t start = host_cpu_ns();
+			if (!replay_call(rec.call, args)) {
+				fprintf(stderr, "unknown call %u in the capture\n", rec.call);
+				break;
+			}
+			rec.duration = account_call(rec.call, host_cpu_ns() - start);
+		}
+		if (out) {
+			fwrite(&rec, 1, sizeof(capture_record), out);
+			fwrite(cap_data + offs + sizeof(capture_record), 1, rec_size - sizeof(capture_record), out);
+		}
+		offs += rec_size;
+	}
+	if (out)
+		fclose(out);
+
+	print_report();
+	map_free(&blobs);
+	map_free(&names);
+	free(zero_array);
+	free(cap_data);
+	job->res = 0;
+	return NULL;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s capture.bin [replay.bin]\n", argv[0]);
+		fprintf(stderr, "Replays a vglCaptureFrames capture, optionally writing it back with the host timings\n");
+		return 1;
+	}
+	replay_job job = {argv[1], argc > 2 ? argv[2] : NULL, 1};
+	init_host();
+	// vitaGL stores pointers in 32 bit words, so it has to run on a stack placed in the low 4GB
+	if (host_run_low_stack(replay, &job, REPLAY_STACK_SIZE) < 0) {
+		fprintf(stderr, "cannot start the replay thread\n");
+		return 1;
+	}
+	return job.res;
+}
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+#
+# This file is part of vitaGL
+#
+# Converts a CPU timeline profiler trace dumped with vglDumpProfilerTrace
+# to Chrome trace JSON (loadable in chrome://tracing or ui.perfetto.dev).
+#
+# Usage: vgl_trace.py trace.bin [trace.json]
+
+import json
+import struct
+import sys
+
+TRACE_MAGIC = 0x544C4756  # VGLT
+TRACE_VERSION = 1
+NAME_SIZE = 32
+
+HEADER = struct.Struct('<5I')
+THREAD = struct.Struct('<I%dsII' % NAME_SIZE)
+EVENT = struct.Struct('<IIHH')
+
+
+def read_name(raw):
+	return raw.split(b'\0', 1)[0].decode('utf-8', 'replace')
+
+
+def convert(data):
+	magic, version, dump_time, zones_num, threads_num = HEADER.unpack_from(data, 0)
+	if magic != TRACE_MAGIC or version != TRACE_VERSION:
+		raise ValueError('not a vitaGL profiler trace (or unsupported version)')
+	offs = HEADER.size
+	zones = []
+	for i in range(zones_num):
+		zones.append(read_name(data[offs:offs + NAME_SIZE]))
+		offs += NAME_SIZE
+
+	events = []
+	for tid in range(threads_num):
+		thid, name, events_num, lost_num = THREAD.unpack_from(data, offs)
+		offs += THREAD.size
+		events.append({'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': tid,
+			'args': {'name': '%s (0x%08X)' % (read_name(name) or 'thread', thid)}})
+		if lost_num:
+			sys.stderr.write('%s: %u zones got overwritten before the dump\n' % (read_name(name), lost_num))
+		for i in range(events_num):
+			start, duration, zone, frame = EVENT.unpack_from(data, offs)
+			offs += EVENT.size
+			# Timestamps are 32 bit process times in microseconds, every event
+			# happened before the dump so we unwrap them relative to dump time
+			ts = dump_time - ((dump_time - start) & 0xFFFFFFFF)
+			zone_name = zones[zone] if zone < len(zones) else 'Zone %u' % zone
+			if zone == 0:
+				zone_name = '%s %u' % (zone_name, frame)
+			events.append({'name': zone_name, 'ph': 'X', 'pid': 0, 'tid': tid,
+				'ts': ts, 'dur': duration, 'args': {'frame': frame}})
+	# Making the trace start at zero
+	base = min([e['ts'] for e in events if 'ts' in e] or [0])
+	for e in events:
+		if 'ts' in e:
+			e['ts'] -= base
+	return {'traceEvents': events, 'displayTimeUnit': 'ms'}
+
+
+def main():
+	if len(sys.argv) < 2:
+		sys.stderr.write('Usage: %s trace.bin [trace.json]\n' % sys.argv[0])
+		return 1
+	with open(sys.argv[1], 'rb') as f:
+		trace = convert(f.read())
+	out = sys.argv[2] if len(sys.argv) > 2 else sys.argv[1].rsplit('.', 1)[0] + '.json'
+	with open(out, 'w') as f:
+		json.dump(trace, f)
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())